@@ -516,7 +516,7 @@ static int API_env_enum(va_list ap)
 {
 	int i, buflen;
 	char *last, **next, *s;
-	struct env_entry *match, search;
+	struct env_entry *match;
 	static char *var;
 
 	last = (char *)va_arg(ap, unsigned long);
@@ -532,9 +532,9 @@ static int API_env_enum(va_list ap)
 		s = strchr(var, '=');
 		if (s != NULL)
 			*s = 0;
-		search.key = var;
-		i = hsearch_r(search, ENV_FIND, &match, &env_htab, 0);
-		if (i == 0) {
+		/* the first entry with this prefix is the variable itself */
+		i = hmatch_r(var, 0, &match, &env_htab);
+		if (i == 0 || strcmp(match->key, var)) {
 			i = API_EINVAL;
 			goto done;
 		}
@@ -73,6 +73,7 @@ static void boot_jump_linux(struct bootm_headers *images, int flag)
 		r2 = (unsigned int)env_get("bootargs");
 	}
 
+	flush();
 	cleanup_before_linux();
 
 	if (!fake)
@@ -554,6 +554,56 @@ void dcache_enable(void)
 	set_sctlr(get_sctlr() | CR_C);
 }
 
+#if CONFIG_IS_ENABLED(CMO_HANDOFF_BY_RANGE)
+#define HANDOFF_MAX_RANGES	8
+
+/* Areas which dcache_disable() cleans, instead of the whole cache */
+static struct {
+	ulong start;
+	ulong end;
+} handoff_ranges[HANDOFF_MAX_RANGES];
+static int handoff_count;
+
+int dcache_handoff_add_range(ulong start, ulong size)
+{
+	int i;
+
+	for (i = 0; i < handoff_count; i++) {
+		if (handoff_ranges[i].start == start &&
+		    handoff_ranges[i].end == start + size)
+			return 0;
+	}
+	if (handoff_count == HANDOFF_MAX_RANGES)
+		return -ENOSPC;
+	handoff_ranges[handoff_count].start = start;
+	handoff_ranges[handoff_count].end = start + size;
+	handoff_count++;
+
+	return 0;
+}
+
+void dcache_handoff_clear(void)
+{
+	handoff_count = 0;
+}
+
+bool dcache_handoff_by_range(void)
+{
+	return handoff_count;
+}
+
+static void dcache_handoff_flush(void)
+{
+	int i;
+
+	for (i = 0; i < handoff_count; i++)
+		flush_dcache_range(handoff_ranges[i].start,
+				   handoff_ranges[i].end);
+}
+#else
+static inline void dcache_handoff_flush(void) {}
+#endif
+
 void dcache_disable(void)
 {
 	uint32_t sctlr;
@@ -564,6 +614,18 @@ void dcache_disable(void)
 	if (!(sctlr & CR_C))
 		return;
 
+	if (dcache_handoff_by_range()) {
+		/*
+		 * Only the areas needed after the handoff are cleaned. As
+		 * this is by VA, do it before turning the MMU off. U-Boot's
+		 * own area is one of them, so our stack stays coherent.
+		 */
+		dcache_handoff_flush();
+		set_sctlr(sctlr & ~(CR_C|CR_M));
+		__asm_invalidate_tlb_all();
+		return;
+	}
+
 	if (IS_ENABLED(CONFIG_CMO_BY_VA_ONLY)) {
 		/*
 		 * When invalidating by VA, do it *before* turning the MMU
@@ -11,6 +11,7 @@
  */
 
 #include <common.h>
+#include <bootstage.h>
 #include <command.h>
 #include <cpu_func.h>
 #include <irq_func.h>
@@ -37,6 +38,8 @@ void __weak board_cleanup_before_linux(void){}
 
 int cleanup_before_linux(void)
 {
+	bool by_range = dcache_handoff_by_range();
+
 	/*
 	 * this function is called just before we call linux
 	 * it prepares the processor for linux
@@ -48,6 +51,8 @@ int cleanup_before_linux(void)
 
 	disable_interrupts();
 
+	bootstage_start(BOOTSTAGE_ID_ACCUM_DCACHE,
+			by_range ? "dcache_range" : "dcache_all");
 	if (IS_ENABLED(CONFIG_CMO_BY_VA_ONLY)) {
 		/*
 		 * Disable D-cache.
@@ -63,11 +68,15 @@ int cleanup_before_linux(void)
 		/*
 		 * turn off D-cache
 		 * dcache_disable() in turn flushes the d-cache and disables
-		 * MMU
+		 * MMU. When only some areas are cleaned, they are also
+		 * invalidated already and the rest is left alone.
 		 */
 		dcache_disable();
-		invalidate_dcache_all();
+		if (!by_range)
+			invalidate_dcache_all();
 	}
+	bootstage_accum(BOOTSTAGE_ID_ACCUM_DCACHE);
+	dcache_handoff_clear();
 
 	return 0;
 }
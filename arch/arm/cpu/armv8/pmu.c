@@ -0,0 +1,220 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Performance counters using the ARMv8 PMU
+ *
+ * The cycle counter and three events are used. The cycle counter is 64 bits
+ * wide. The event counters are only 32 bits, so they are made 64 bits wide
+ * where the PMU allows it: with PMCR_EL0.LP on PMUv3p5, or else by chaining
+ * each to a second counter which counts its overflows. Otherwise they are
+ * extended in software each time they are read, and overflows which cannot
+ * have been accounted for are counted in perf_counts.wraps. State is kept in
+ * global_data since this is used before relocation.
+ */
+
+#include <perf.h>
+#include <asm/global_data.h>
+#include <asm/system.h>
+#include <linux/bitops.h>
+#include <linux/build_bug.h>
+#include <linux/errno.h>
+#include <linux/kernel.h>
+
+DECLARE_GLOBAL_DATA_PTR;
+
+#define ID_AA64DFR0_PMUVER_SHIFT	8
+#define ID_AA64DFR0_PMUVER_MASK		0xf
+#define ID_AA64DFR0_PMUVER_V3P5		0x6
+#define ID_AA64DFR0_PMUVER_IMP_DEF	0xf
+
+#define PMCR_E			BIT(0)	/* Enable all counters */
+#define PMCR_P			BIT(1)	/* Reset event counters */
+#define PMCR_C			BIT(2)	/* Reset cycle counter */
+#define PMCR_LC			BIT(6)	/* 64-bit cycle counter */
+#define PMCR_LP			BIT(7)	/* 64-bit event counters */
+#define PMCR_N_SHIFT		11
+#define PMCR_N_MASK		0x1f
+
+#define PMCNTEN_CYCLES		BIT(31)
+
+/* Count at EL2 as well as EL1, since U-Boot often runs at EL2 */
+#define PMEVTYPER_NSH		BIT(27)
+
+#define MDCR_EL2_HPMD		BIT(17)	/* Prohibit counting at EL2 */
+#define MDCR_EL3_SPME		BIT(17)	/* Allow counting in secure state */
+
+/* Architectural event numbers */
+enum {
+	ARMV8_PMUV3_INST_RETIRED	= 0x08,
+	ARMV8_PMUV3_L1D_CACHE_REFILL	= 0x03,
+	ARMV8_PMUV3_L1D_TLB_REFILL	= 0x05,
+	ARMV8_PMUV3_CHAIN		= 0x1e,
+};
+
+/* How the event counters are made 64 bits wide */
+enum {
+	PMU_MODE_SOFT,		/* extended by perf_read() */
+	PMU_MODE_LONG,		/* 64-bit counters (PMCR_EL0.LP) */
+	PMU_MODE_CHAIN,		/* even/odd counter pairs */
+};
+
+/* Event for each event counter, after the cycle counter */
+static const u32 pmu_events[] = {
+	ARMV8_PMUV3_INST_RETIRED,
+	ARMV8_PMUV3_L1D_CACHE_REFILL,
+	ARMV8_PMUV3_L1D_TLB_REFILL,
+};
+
+static void pmu_select(uint idx)
+{
+	asm volatile("msr pmselr_el0, %0" : : "r" ((u64)idx));
+	isb();
+}
+
+static void pmu_set_type(uint idx, u32 type)
+{
+	pmu_select(idx);
+	asm volatile("msr pmxevtyper_el0, %0"
+		     : : "r" ((u64)(PMEVTYPER_NSH | type)));
+}
+
+static u64 pmu_read_counter(uint idx)
+{
+	u64 val;
+
+	pmu_select(idx);
+	asm volatile("mrs %0, pmxevcntr_el0" : "=r" (val));
+
+	return val;
+}
+
+/* Read a chained pair, making sure the low half did not wrap meanwhile */
+static u64 pmu_read_chain(uint idx)
+{
+	u64 hi, lo, again;
+
+	hi = pmu_read_counter(idx + 1);
+	do {
+		lo = pmu_read_counter(idx);
+		again = hi;
+		hi = pmu_read_counter(idx + 1);
+	} while (hi != again);
+
+	return (hi << 32) | (u32)lo;
+}
+
+int perf_init(void)
+{
+	u64 dfr0, pmcr, mdcr, enable;
+	uint ver, num, mode;
+	int i;
+
+	BUILD_BUG_ON(ARRAY_SIZE(pmu_events) != PERF_ARCH_EVENTS);
+	BUILD_BUG_ON(ARRAY_SIZE(pmu_events) != PERF_EVENT_COUNT - 1);
+
+	if (gd->arch.perf_ready)
+		return 0;
+
+	asm volatile("mrs %0, id_aa64dfr0_el1" : "=r" (dfr0));
+	ver = (dfr0 >> ID_AA64DFR0_PMUVER_SHIFT) & ID_AA64DFR0_PMUVER_MASK;
+	if (!ver || ver == ID_AA64DFR0_PMUVER_IMP_DEF)
+		return -ENODEV;
+
+	asm volatile("mrs %0, pmcr_el0" : "=r" (pmcr));
+	num = (pmcr >> PMCR_N_SHIFT) & PMCR_N_MASK;
+	if (num < ARRAY_SIZE(pmu_events))
+		return -ENODEV;
+	if (ver >= ID_AA64DFR0_PMUVER_V3P5)
+		mode = PMU_MODE_LONG;
+	else if (num >= 2 * ARRAY_SIZE(pmu_events))
+		mode = PMU_MODE_CHAIN;
+	else
+		mode = PMU_MODE_SOFT;
+
+	switch (current_el()) {
+	case 3:
+		asm volatile("mrs %0, mdcr_el3" : "=r" (mdcr));
+		mdcr |= MDCR_EL3_SPME;
+		asm volatile("msr mdcr_el3, %0" : : "r" (mdcr));
+		break;
+	case 2:
+		asm volatile("mrs %0, mdcr_el2" : "=r" (mdcr));
+		mdcr &= ~MDCR_EL2_HPMD;
+		asm volatile("msr mdcr_el2, %0" : : "r" (mdcr));
+		break;
+	}
+
+	enable = PMCNTEN_CYCLES;
+	for (i = 0; i < ARRAY_SIZE(pmu_events); i++) {
+		if (mode == PMU_MODE_CHAIN) {
+			pmu_set_type(2 * i, pmu_events[i]);
+			pmu_set_type(2 * i + 1, ARMV8_PMUV3_CHAIN);
+			enable |= 3 << (2 * i);
+		} else {
+			pmu_set_type(i, pmu_events[i]);
+			enable |= BIT(i);
+		}
+	}
+	asm volatile("msr pmccfiltr_el0, %0" : : "r" ((u64)PMEVTYPER_NSH));
+	asm volatile("msr pmovsclr_el0, %0" : : "r" ((u64)~0U));
+	asm volatile("msr pmcntenset_el0, %0" : : "r" (enable));
+	pmcr |= PMCR_E | PMCR_P | PMCR_C | PMCR_LC;
+	if (mode == PMU_MODE_LONG)
+		pmcr |= PMCR_LP;
+	asm volatile("msr pmcr_el0, %0" : : "r" (pmcr));
+	isb();
+
+	for (i = 0; i < ARRAY_SIZE(pmu_events); i++) {
+		gd->arch.perf_last[i] = 0;
+		gd->arch.perf_count[i] = 0;
+	}
+	gd->arch.perf_wraps = 0;
+	gd->arch.perf_mode = mode;
+	gd->arch.perf_ready = true;
+
+	return 0;
+}
+
+int perf_read(struct perf_counts *counts)
+{
+	u64 cycles, ovs = 0;
+	int i;
+
+	if (!gd->arch.perf_ready)
+		return -ENODEV;
+
+	asm volatile("mrs %0, pmccntr_el0" : "=r" (cycles));
+	counts->count[PERF_CYCLES] = cycles;
+	if (gd->arch.perf_mode == PMU_MODE_SOFT) {
+		asm volatile("mrs %0, pmovsclr_el0" : "=r" (ovs));
+		asm volatile("msr pmovsclr_el0, %0" : : "r" (ovs));
+	}
+	for (i = 0; i < ARRAY_SIZE(pmu_events); i++) {
+		u32 val;
+
+		switch (gd->arch.perf_mode) {
+		case PMU_MODE_LONG:
+			gd->arch.perf_count[i] = pmu_read_counter(i);
+			break;
+		case PMU_MODE_CHAIN:
+			gd->arch.perf_count[i] = pmu_read_chain(2 * i);
+			break;
+		default:
+			val = pmu_read_counter(i);
+			/*
+			 * One wrap since the last read is accounted for below,
+			 * but if the counter overflowed and still reads higher,
+			 * at least 2^32 events were lost
+			 */
+			if ((ovs & BIT(i)) && val >= gd->arch.perf_last[i])
+				gd->arch.perf_wraps++;
+			gd->arch.perf_count[i] += (u32)(val -
+							gd->arch.perf_last[i]);
+			gd->arch.perf_last[i] = val;
+			break;
+		}
+		counts->count[PERF_INSTRUCTIONS + i] = gd->arch.perf_count[i];
+	}
+	counts->wraps = gd->arch.perf_wraps;
+
+	return 0;
+}
@@ -59,4 +59,39 @@ void dram_bank_mmu_setup(int bank);
  */
 int arm_reserve_mmu(void);
 
+#if CONFIG_IS_ENABLED(CMO_HANDOFF_BY_RANGE)
+/**
+ * dcache_handoff_add_range() - Add an area to clean at OS handoff
+ *
+ * Once areas have been added, the next dcache_disable() only cleans and
+ * invalidates these areas by VA, instead of flushing the whole cache.
+ *
+ * @start:	start address of the area
+ * @size:	size of the area in bytes
+ * Return: 0 if OK, -ENOSPC if too many areas have been added
+ */
+int dcache_handoff_add_range(ulong start, ulong size);
+
+/**
+ * dcache_handoff_clear() - Forget all areas to clean at OS handoff
+ *
+ * The next dcache_disable() flushes the whole cache again.
+ */
+void dcache_handoff_clear(void);
+
+/**
+ * dcache_handoff_by_range() - Check if areas to clean have been added
+ *
+ * Return: true if dcache_disable() only cleans the added areas
+ */
+bool dcache_handoff_by_range(void);
+#else
+static inline void dcache_handoff_clear(void) {}
+
+static inline bool dcache_handoff_by_range(void)
+{
+	return false;
+}
+#endif
+
 #endif /* _ASM_CACHE_H */
@@ -107,6 +107,15 @@ struct arch_global_data {
 #ifdef CONFIG_SMBIOS
 	ulong smbios_start;		/* Start address of SMBIOS table */
 #endif
+#if defined(CONFIG_ARM64) && defined(CONFIG_PERF)
+	/* PMU event counters, see arch/arm/cpu/armv8/pmu.c */
+#define PERF_ARCH_EVENTS	3
+	bool perf_ready;
+	u8 perf_mode;			/* How counters reach 64 bits */
+	u32 perf_last[PERF_ARCH_EVENTS];	/* Last value read */
+	u64 perf_count[PERF_ARCH_EVENTS];	/* 64-bit value of each */
+	u32 perf_wraps;			/* Overflows which were lost */
+#endif
 };
 
 #include <asm-generic/global_data.h>
@@ -70,6 +70,8 @@ static void announce_and_cleanup(int fake)
 
 	printf("\nStarting kernel ...%s\n\n", fake ?
 		"(fake run for tracing)" : "");
+	flush();
+
 	/*
 	 * Call remove function of all devices with a removal flag set.
 	 * This may be useful for last-stage operations, like cancelling
@@ -83,6 +85,47 @@ static void announce_and_cleanup(int fake)
 	cleanup_before_linux();
 }
 
+#if CONFIG_IS_ENABLED(CMO_HANDOFF_BY_RANGE)
+/**
+ * setup_handoff_ranges() - Select the areas to clean from the D-cache
+ *
+ * These are the reserved LMB regions holding the kernel, initrd and device
+ * tree, and U-Boot itself (including the EFI runtime services), which is
+ * still running until the jump and is found from the images struct and the
+ * stack. If one of them is not reserved, the whole cache is flushed.
+ *
+ * @images: images to boot
+ */
+static void setup_handoff_ranges(struct bootm_headers *images)
+{
+	struct lmb_property *res;
+	ulong addr[5];
+	int i, count = 0;
+
+	addr[count++] = images->ep;
+	if (images->rd_end > images->rd_start)
+		addr[count++] = images->rd_start;
+	if (images->ft_len)
+		addr[count++] = map_to_sysmem(images->ft_addr);
+	addr[count++] = map_to_sysmem(images);
+	addr[count++] = map_to_sysmem(addr);
+
+	dcache_handoff_clear();
+	for (i = 0; i < count; i++) {
+		res = lmb_get_reserved(&images->lmb, addr[i]);
+		if (!res || (res->flags & LMB_NOMAP) ||
+		    dcache_handoff_add_range(res->base, res->size)) {
+			log_debug("%lx not reserved, flushing whole cache\n",
+				  addr[i]);
+			dcache_handoff_clear();
+			return;
+		}
+	}
+}
+#else
+static inline void setup_handoff_ranges(struct bootm_headers *images) {}
+#endif
+
 static void setup_start_tag (struct bd_info *bd)
 {
 	params = (struct tag *)bd->bi_boot_params;
@@ -303,6 +346,7 @@ static void boot_jump_linux(struct bootm_headers *images, int flag)
 		(ulong) kernel_entry);
 	bootstage_mark(BOOTSTAGE_ID_RUN_OS);
 
+	setup_handoff_ranges(images);
 	announce_and_cleanup(fake);
 
 	if (!fake) {
@@ -293,6 +293,7 @@ int board_late_init(void)
 	status |= env_set_hex("scriptaddr", addr_alloc(&lmb, SZ_4M));
 	status |= env_set_hex("pxefile_addr_r", addr_alloc(&lmb, SZ_4M));
 	status |= env_set_hex("fdt_addr_r", addr_alloc(&lmb, SZ_2M));
+	lmb_uninit(&lmb);
 
 	if (status)
 		log_warning("%s: Failed to set run time variables\n", __func__);
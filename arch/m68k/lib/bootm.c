@@ -72,6 +72,7 @@ int do_bootm_linux(int flag, struct bootm_info *bmi)
 	      (ulong) kernel);
 
 	bootstage_mark(BOOTSTAGE_ID_RUN_OS);
+	flush();
 
 	/*
 	 * Linux Kernel Parameters (passing board info data):
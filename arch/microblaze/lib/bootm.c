@@ -57,6 +57,7 @@ static void boot_jump_linux(struct bootm_headers *images, int flag)
 	       "(fake run for tracing)" : "");
 	bootstage_mark_name(BOOTSTAGE_ID_BOOTM_HANDOFF, "start_kernel");
 
+	flush();
 	flush_cache_all();
 
 	if (!fake) {
@@ -51,6 +51,7 @@ static void announce_and_cleanup(int fake)
 #endif
 
 	board_quiesce_devices();
+	flush();
 
 	/*
 	 * Call remove function of all devices with a removal flag set.
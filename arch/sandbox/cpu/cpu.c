@@ -10,6 +10,8 @@
 #include <errno.h>
 #include <log.h>
 #include <os.h>
+#include <perf.h>
+#include <profile.h>
 #include <asm/global_data.h>
 #include <asm/io.h>
 #include <asm/malloc.h>
@@ -32,6 +34,8 @@ unsigned long map_len;
 
 void __noreturn sandbox_exit(void)
 {
+	flush();
+
 	/* Do this here while it still has an effect */
 	os_fd_restore();
 
@@ -306,6 +310,40 @@ void invalidate_dcache_range(unsigned long start, unsigned long stop)
 {
 }
 
+#if CONFIG_IS_ENABLED(PERF)
+int perf_init(void)
+{
+	return os_perf_init(PERF_EVENT_COUNT) ? -ENODEV : 0;
+}
+
+int perf_read(struct perf_counts *counts)
+{
+	unsigned long long vals[PERF_EVENT_COUNT];
+	int i, ret;
+
+	ret = os_perf_read(vals, PERF_EVENT_COUNT);
+	if (ret)
+		return ret;
+	for (i = 0; i < PERF_EVENT_COUNT; i++)
+		counts->count[i] = vals[i];
+	counts->wraps = 0;
+
+	return 0;
+}
+#endif
+
+#if CONFIG_IS_ENABLED(PROFILE)
+int arch_profile_start(uint period_us)
+{
+	return os_profile_start(period_us, profile_sample);
+}
+
+void arch_profile_stop(void)
+{
+	os_profile_stop();
+}
+#endif
+
 /**
  * setup_auto_tree() - Set up a basic device tree to allow sandbox to work
  *
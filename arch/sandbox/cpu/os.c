@@ -23,9 +23,11 @@
 #include <unistd.h>
 #include <sys/mman.h>
 #include <sys/stat.h>
+#include <sys/syscall.h>
 #include <sys/time.h>
 #include <sys/types.h>
 #include <linux/compiler_attributes.h>
+#include <linux/perf_event.h>
 #include <linux/types.h>
 
 #include <asm/fuzzing_engine.h>
@@ -366,6 +368,145 @@ int os_setup_signal_handlers(void)
 	return 0;
 }
 
+static void (*os_profile_tick)(unsigned long pc, unsigned long fp,
+			       unsigned long stack_top);
+static unsigned long os_profile_stack_top;
+
+static void os_profile_handler(int sig, siginfo_t *info, void *con)
+{
+	ucontext_t __maybe_unused *context = con;
+	unsigned long pc, fp;
+
+	/* Only hosts which keep a {next, return} frame record are walked */
+#if defined(__x86_64__)
+	pc = context->uc_mcontext.gregs[REG_RIP];
+	fp = context->uc_mcontext.gregs[REG_RBP];
+#elif defined(__aarch64__)
+	pc = context->uc_mcontext.pc;
+	fp = context->uc_mcontext.regs[29];
+#else
+	pc = 0;
+	fp = 0;
+#endif
+	os_profile_tick(pc, fp, os_profile_stack_top);
+}
+
+int os_profile_start(unsigned int period_us,
+		     void (*tick)(unsigned long pc, unsigned long fp,
+				  unsigned long stack_top))
+{
+	struct itimerval timer;
+	struct sigaction act;
+	pthread_attr_t attr;
+	size_t stack_size;
+	void *stack;
+
+	if (pthread_getattr_np(pthread_self(), &attr))
+		return -EINVAL;
+	if (pthread_attr_getstack(&attr, &stack, &stack_size)) {
+		pthread_attr_destroy(&attr);
+		return -EINVAL;
+	}
+	pthread_attr_destroy(&attr);
+	os_profile_stack_top = (unsigned long)stack + stack_size;
+	os_profile_tick = tick;
+
+	act.sa_sigaction = os_profile_handler;
+	sigemptyset(&act.sa_mask);
+	act.sa_flags = SA_SIGINFO | SA_RESTART;
+	if (sigaction(SIGPROF, &act, NULL))
+		return -errno;
+
+	timer.it_interval.tv_sec = period_us / 1000000;
+	timer.it_interval.tv_usec = period_us % 1000000;
+	timer.it_value = timer.it_interval;
+	if (setitimer(ITIMER_PROF, &timer, NULL)) {
+		signal(SIGPROF, SIG_DFL);
+		return -errno;
+	}
+
+	return 0;
+}
+
+void os_profile_stop(void)
+{
+	struct itimerval timer = {};
+
+	setitimer(ITIMER_PROF, &timer, NULL);
+	signal(SIGPROF, SIG_DFL);
+}
+
+/* Host events matching enum perf_event_id, counted in user space only */
+static const struct {
+	__u32 type;
+	__u64 config;
+} os_perf_events[] = {
+	{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+	{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+	{ PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D |
+		PERF_COUNT_HW_CACHE_OP_READ << 8 |
+		PERF_COUNT_HW_CACHE_RESULT_MISS << 16 },
+	{ PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_DTLB |
+		PERF_COUNT_HW_CACHE_OP_READ << 8 |
+		PERF_COUNT_HW_CACHE_RESULT_MISS << 16 },
+};
+
+#define OS_PERF_COUNT \
+	(sizeof(os_perf_events) / sizeof(os_perf_events[0]))
+
+static int os_perf_fd[OS_PERF_COUNT] = { -1, -1, -1, -1 };
+
+int os_perf_init(unsigned int count)
+{
+	int i;
+
+	if (count != OS_PERF_COUNT)
+		return -EINVAL;
+	if (os_perf_fd[0] != -1)
+		return 0;
+
+	for (i = 0; i < count; i++) {
+		struct perf_event_attr attr;
+		int fd;
+
+		memset(&attr, '\0', sizeof(attr));
+		attr.size = sizeof(attr);
+		attr.type = os_perf_events[i].type;
+		attr.config = os_perf_events[i].config;
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+		fd = syscall(__NR_perf_event_open, &attr, 0, -1, -1,
+			     PERF_FLAG_FD_CLOEXEC);
+		if (fd < 0) {
+			int err = -errno;
+
+			while (i--) {
+				close(os_perf_fd[i]);
+				os_perf_fd[i] = -1;
+			}
+			return err;
+		}
+		os_perf_fd[i] = fd;
+	}
+
+	return 0;
+}
+
+int os_perf_read(unsigned long long *counts, unsigned int count)
+{
+	int i;
+
+	if (count != OS_PERF_COUNT || os_perf_fd[0] == -1)
+		return -ENODEV;
+	for (i = 0; i < count; i++) {
+		if (read(os_perf_fd[i], &counts[i], sizeof(counts[i])) !=
+		    sizeof(counts[i]))
+			return -EIO;
+	}
+
+	return 0;
+}
+
 /* Put tty into raw mode so <tab> and <ctrl+c> work */
 void os_tty_raw(int fd, bool allow_sigs)
 {
@@ -148,8 +148,10 @@ int sandbox_main_loop_init(void)
 			retval = cli_simple_run_command("run distro_bootcmd",
 							0);
 #endif
-		if (!state->interactive)
+		if (!state->interactive) {
+			flush();
 			os_exit(retval);
+		}
 	}
 
 	return 0;
@@ -464,6 +466,8 @@ void __efi_runtime EFIAPI efi_reset_system(
 
 void sandbox_reset(void)
 {
+	flush();
+
 	/* Do this here while it still has an effect */
 	os_fd_restore();
 	if (state_uninit())
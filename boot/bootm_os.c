@@ -555,6 +555,8 @@ int boot_selected_os(int state, struct bootm_info *bmi, boot_os_fn *boot_fn)
 	arch_preboot_os();
 	board_preboot_os();
 
+	/* Nothing may be left in the console buffer once the OS takes over */
+	flush();
 	boot_fn(state, bmi);
 
 	/* Stand-alone may return when 'autostart' is 'no' */
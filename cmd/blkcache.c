@@ -4,25 +4,51 @@
  * Author: Eric Nelson<eric@nelint.com>
  *
  */
+#include <blk.h>
 #include <command.h>
 #include <config.h>
 #include <common.h>
+#include <fs.h>
 #include <malloc.h>
 #include <part.h>
 
 static int blkc_show(struct cmd_tbl *cmdtp, int flag,
 		     int argc, char *const argv[])
 {
+	struct block_cache_dev_stats dstats;
 	struct block_cache_stats stats;
+	int seq;
+
 	blkcache_stats(&stats);
 
 	printf("hits: %u\n"
 	       "misses: %u\n"
+	       "read-aheads: %u\n"
 	       "entries: %u\n"
 	       "max blocks/entry: %u\n"
 	       "max cache entries: %u\n",
-	       stats.hits, stats.misses, stats.entries,
+	       stats.hits, stats.misses, stats.readaheads, stats.entries,
 	       stats.max_blocks_per_entry, stats.max_entries);
+
+	for (seq = 0; !blkcache_dev_stats(seq, &dstats); seq++) {
+		if (!seq)
+			printf("\n%-10s %8s  %8s  %11s\n", "Device", "Hits",
+			       "Misses", "Read-aheads");
+		printf("%-6s %3d %8u  %8u  %11u\n",
+		       blk_get_uclass_name(dstats.iftype), dstats.devnum,
+		       dstats.hits, dstats.misses, dstats.readaheads);
+	}
+
+	if (IS_ENABLED(CONFIG_FS_CACHE)) {
+		struct fs_cache_stats fstats;
+
+		fs_cache_stats(&fstats);
+		printf("\nfile hits: %u\n"
+		       "file misses: %u\n"
+		       "file read-aheads: %u\n",
+		       fstats.hits, fstats.misses, fstats.readaheads);
+	}
+
 	return 0;
 }
 
@@ -10,6 +10,17 @@
 static int do_bootstage_report(struct cmd_tbl *cmdtp, int flag, int argc,
 			       char *const argv[])
 {
+	if (argc > 1) {
+		if (argc != 3 || strcmp(argv[1], "--top"))
+			return CMD_RET_USAGE;
+		if (!IS_ENABLED(CONFIG_BOOTSTAGE_TIMING)) {
+			printf("Timings not enabled (CONFIG_BOOTSTAGE_TIMING)\n");
+			return CMD_RET_FAILURE;
+		}
+		bootstage_report_top(dectoul(argv[2], NULL));
+
+		return 0;
+	}
 	bootstage_report();
 
 	return 0;
@@ -60,7 +71,7 @@ static int do_bootstage_stash(struct cmd_tbl *cmdtp, int flag, int argc,
 }
 
 static struct cmd_tbl cmd_bootstage_sub[] = {
-	U_BOOT_CMD_MKENT(report, 2, 1, do_bootstage_report, "", ""),
+	U_BOOT_CMD_MKENT(report, 3, 1, do_bootstage_report, "", ""),
 	U_BOOT_CMD_MKENT(stash, 4, 0, do_bootstage_stash, "", ""),
 	U_BOOT_CMD_MKENT(unstash, 4, 0, do_bootstage_stash, "", ""),
 };
@@ -91,6 +102,7 @@ U_BOOT_CMD(bootstage, 4, 1, do_boostage,
 	"Boot stage command",
 	" - check boot progress and timing\n"
 	"report                      - Print a report\n"
+	"report --top <n>            - Print the <n> slowest initcalls/probes\n"
 	"stash [<start> [<size>]]    - Stash data into memory\n"
 	"unstash [<start> [<size>]]  - Unstash data from memory"
 );
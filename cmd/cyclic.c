@@ -76,10 +76,38 @@ static int do_cyclic_list(struct cmd_tbl *cmdtp, int flag, int argc,
 	return 0;
 }
 
+static int do_cyclic_stats(struct cmd_tbl *cmdtp, int flag, int argc,
+			   char *const argv[])
+{
+	static const char *const late_names[CYCLIC_LATE_BUCKETS] = {
+		"<10us", "<100us", "<1ms", "<10ms", "<100ms", ">=100ms",
+	};
+	struct cyclic_info *cyclic;
+	struct hlist_node *tmp;
+	u64 avg;
+	int i;
+
+	hlist_for_each_entry_safe(cyclic, tmp, cyclic_get_list(), list) {
+		avg = cyclic->run_cnt ?
+			lldiv(cyclic->cpu_time_us, cyclic->run_cnt) : 0;
+		printf("function: %s, runs: %lld, cpu-time avg: %lld us, max: %lld us, late max: %lld us\n",
+		       cyclic->name, cyclic->run_cnt, avg,
+		       cyclic->cpu_time_max_us, cyclic->late_max_us);
+		printf("   late:");
+		for (i = 0; i < CYCLIC_LATE_BUCKETS; i++)
+			printf(" %s %lld", late_names[i], cyclic->late_hist[i]);
+		printf("\n");
+	}
+
+	return 0;
+}
+
 U_BOOT_LONGHELP(cyclic,
 	"demo <cycletime_ms> <delay_us> - register cyclic demo function\n"
-	"cyclic list - list cyclic functions\n");
+	"cyclic list - list cyclic functions\n"
+	"cyclic stats - show run-time and lateness of cyclic functions\n");
 
 U_BOOT_CMD_WITH_SUBCMDS(cyclic, "Cyclic", cyclic_help_text,
 	U_BOOT_SUBCMD_MKENT(demo, 3, 1, do_cyclic_demo),
-	U_BOOT_SUBCMD_MKENT(list, 1, 1, do_cyclic_list));
+	U_BOOT_SUBCMD_MKENT(list, 1, 1, do_cyclic_list),
+	U_BOOT_SUBCMD_MKENT(stats, 1, 1, do_cyclic_stats));
@@ -8,8 +8,10 @@
 #include <command.h>
 #include <dm.h>
 #include <getopt.h>
+#include <env.h>
 #include <log.h>
 #include <malloc.h>
+#include <mapmem.h>
 #include <asm/global_data.h>
 
 static char log_fmt_chars[LOGF_COUNT] = "clFLfm";
@@ -375,6 +377,34 @@ static int do_log_rec(struct cmd_tbl *cmdtp, int flag, int argc,
 	return 0;
 }
 
+static int do_log_dump(struct cmd_tbl *cmdtp, int flag, int argc,
+		       char *const argv[])
+{
+	ulong addr, size;
+	char *buf;
+	int ret;
+
+	if (argc == 2)
+		return CMD_RET_USAGE;
+	if (argc < 3) {
+		ret = log_ring_dump(NULL, 0);
+	} else {
+		addr = hextoul(argv[1], NULL);
+		size = hextoul(argv[2], NULL);
+		buf = map_sysmem(addr, size);
+		ret = log_ring_dump(buf, size);
+		unmap_sysmem(buf);
+		if (ret >= 0)
+			env_set_hex("filesize", ret);
+	}
+	if (ret < 0) {
+		printf("Cannot dump log ring (err=%dE)\n", ret);
+		return CMD_RET_FAILURE;
+	}
+
+	return 0;
+}
+
 U_BOOT_LONGHELP(log,
 	"level [<level>] - get/set log level\n"
 	"categories - list log categories\n"
@@ -404,7 +434,9 @@ U_BOOT_LONGHELP(log,
 	"\tc=category, l=level, F=file, L=line number, f=function, m=msg\n"
 	"\tor 'default', or 'all' for all\n"
 	"log rec <category> <level> <file> <line> <func> <message> - "
-		"output a log record");
+		"output a log record\n"
+	"log dump [<addr> <size>] - show the records in the log ring, or write\n"
+	"\tthem as text to memory, setting filesize");
 
 U_BOOT_CMD_WITH_SUBCMDS(log, "log system", log_help_text,
 	U_BOOT_SUBCMD_MKENT(level, 2, 1, do_log_level),
@@ -416,4 +448,5 @@ U_BOOT_CMD_WITH_SUBCMDS(log, "log system", log_help_text,
 	U_BOOT_SUBCMD_MKENT(filter-remove, 4, 1, do_log_filter_remove),
 	U_BOOT_SUBCMD_MKENT(format, 2, 1, do_log_format),
 	U_BOOT_SUBCMD_MKENT(rec, 7, 1, do_log_rec),
+	U_BOOT_SUBCMD_MKENT(dump, 3, 1, do_log_dump),
 );
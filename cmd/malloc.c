@@ -0,0 +1,45 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Show information about the malloc() heap
+ */
+
+#include <common.h>
+#include <command.h>
+#include <display_options.h>
+#include <malloc.h>
+
+static int do_malloc_stats(struct cmd_tbl *cmdtp, int flag, int argc,
+			   char *const argv[])
+{
+	struct malloc_slab_info slab;
+	struct malloc_info info;
+	uint i;
+
+	malloc_get_info(&info);
+	printf("total bytes   = ");
+	print_size(info.total_bytes, "\n");
+	printf("in use bytes  = ");
+	print_size(info.in_use_bytes, "\n");
+	printf("max claimed   = ");
+	print_size(info.max_claimed_bytes, "\n");
+	printf("malloc calls  = %lu\n", info.malloc_count);
+	printf("free calls    = %lu\n", info.free_count);
+	printf("malloc time   = %lu us\n", info.time_us);
+
+	for (i = 0; !malloc_get_slab_info(i, &slab); i++) {
+		if (!i)
+			printf("\n%6s  %8s  %6s  %8s  %8s  %10s\n", "Size",
+			       "Per page", "Pages", "In use", "Peak", "Allocs");
+		printf("%6u  %8u  %6lu  %8lu  %8lu  %10lu\n", slab.size,
+		       slab.per_page, slab.pages, slab.in_use, slab.peak,
+		       slab.allocs);
+	}
+
+	return 0;
+}
+
+U_BOOT_LONGHELP(malloc,
+	"stats - show heap usage and allocator statistics\n");
+
+U_BOOT_CMD_WITH_SUBCMDS(malloc, "Heap information", malloc_help_text,
+	U_BOOT_SUBCMD_MKENT(stats, 1, 1, do_malloc_stats));
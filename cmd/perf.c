@@ -0,0 +1,64 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Count hardware events while running a command
+ */
+
+#include <common.h>
+#include <command.h>
+#include <perf.h>
+#include <time.h>
+#include <vsprintf.h>
+
+static int do_perf_stat(struct cmd_tbl *cmdtp, int flag, int argc,
+			char *const argv[])
+{
+	struct perf_counts start, end, delta;
+	ulong start_us, elapsed_us;
+	int repeatable = 0;
+	u64 cycles, insns;
+	int ret, i;
+
+	if (argc < 2)
+		return CMD_RET_USAGE;
+
+	ret = perf_init();
+	if (!ret)
+		ret = perf_read(&start);
+	if (ret) {
+		printf("Performance counters not available (err=%dE)\n", ret);
+		return CMD_RET_FAILURE;
+	}
+
+	start_us = timer_get_us();
+	ret = cmd_process(0, argc - 1, argv + 1, &repeatable, NULL);
+	elapsed_us = timer_get_us() - start_us;
+	perf_read(&end);
+	perf_sub(&delta, &end, &start);
+
+	printf("\nPerformance counters for '%s':\n", argv[1]);
+	for (i = 0; i < PERF_EVENT_COUNT; i++) {
+		print_grouped_ull(delta.count[i], 15);
+		printf("  %s\n", perf_event_name(i));
+	}
+	cycles = delta.count[PERF_CYCLES];
+	insns = delta.count[PERF_INSTRUCTIONS];
+	if (cycles) {
+		ulong ipc = insns * 100 / cycles;
+
+		printf("%16lu.%02lu  instructions per cycle\n", ipc / 100,
+		       ipc % 100);
+	}
+	printf("%12lu.%06lu  seconds elapsed\n", elapsed_us / 1000000,
+	       elapsed_us % 1000000);
+	if (delta.wraps)
+		printf("Warning: %u counter wraps missed, counts are low\n",
+		       delta.wraps);
+
+	return ret;
+}
+
+U_BOOT_LONGHELP(perf,
+	"stat <command> [<args>...] - run a command and count hardware events");
+
+U_BOOT_CMD_WITH_SUBCMDS(perf, "Hardware performance counters", perf_help_text,
+	U_BOOT_SUBCMD_MKENT(stat, CONFIG_SYS_MAXARGS, 0, do_perf_stat));
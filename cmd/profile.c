@@ -0,0 +1,110 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Control the sampling profiler
+ */
+
+#include <common.h>
+#include <command.h>
+#include <display_options.h>
+#include <env.h>
+#include <mapmem.h>
+#include <profile.h>
+#include <vsprintf.h>
+
+/* Default time between samples, giving 1000 samples per second */
+#define PROFILE_DEFAULT_PERIOD_US	1000
+
+static int do_profile_start(struct cmd_tbl *cmdtp, int flag, int argc,
+			    char *const argv[])
+{
+	uint period_us = PROFILE_DEFAULT_PERIOD_US;
+	int ret;
+
+	if (argc > 1)
+		period_us = dectoul(argv[1], NULL);
+	if (!period_us)
+		return CMD_RET_USAGE;
+
+	ret = profile_start(period_us);
+	if (ret) {
+		printf("Cannot start profiler (err=%d)\n", ret);
+		return CMD_RET_FAILURE;
+	}
+
+	return 0;
+}
+
+static int do_profile_stop(struct cmd_tbl *cmdtp, int flag, int argc,
+			   char *const argv[])
+{
+	profile_stop();
+
+	return 0;
+}
+
+static int do_profile_reset(struct cmd_tbl *cmdtp, int flag, int argc,
+			    char *const argv[])
+{
+	profile_reset();
+
+	return 0;
+}
+
+static int do_profile_stats(struct cmd_tbl *cmdtp, int flag, int argc,
+			    char *const argv[])
+{
+	struct profile_stats stats;
+
+	profile_get_stats(&stats);
+	printf("state       = %s\n", stats.running ? "running" : "stopped");
+	printf("period      = %u us\n", stats.period_us);
+	printf("samples     = %lu\n", stats.samples);
+	printf("recorded    = %lu\n", stats.recorded);
+	printf("dropped     = %lu\n", stats.dropped);
+	printf("unknown     = %lu\n", stats.unknown);
+	printf("buffer used = ");
+	print_size(stats.used, " of ");
+	print_size(stats.size, "\n");
+
+	return 0;
+}
+
+static int do_profile_dump(struct cmd_tbl *cmdtp, int flag, int argc,
+			   char *const argv[])
+{
+	size_t size, needed;
+	ulong addr;
+	void *buf;
+	int ret;
+
+	if (argc < 3)
+		return CMD_RET_USAGE;
+	addr = hextoul(argv[1], NULL);
+	size = hextoul(argv[2], NULL);
+
+	buf = map_sysmem(addr, size);
+	ret = profile_list_samples(buf, size, &needed);
+	unmap_sysmem(buf);
+	if (ret) {
+		printf("Error: buffer too small (%#zx bytes needed)\n", needed);
+		return CMD_RET_FAILURE;
+	}
+	printf("Samples dumped to %08lx, size %#zx\n", addr, needed);
+	env_set_hex("filesize", needed);
+
+	return 0;
+}
+
+U_BOOT_LONGHELP(profile,
+	"start [<period_us>] - start taking samples (default 1000us apart)\n"
+	"profile stop               - stop taking samples\n"
+	"profile reset              - discard all samples\n"
+	"profile stats              - show sampling statistics\n"
+	"profile dump <addr> <size> - write samples to memory for proftool");
+
+U_BOOT_CMD_WITH_SUBCMDS(profile, "Sampling profiler", profile_help_text,
+	U_BOOT_SUBCMD_MKENT(start, 2, 1, do_profile_start),
+	U_BOOT_SUBCMD_MKENT(stop, 1, 1, do_profile_stop),
+	U_BOOT_SUBCMD_MKENT(reset, 1, 1, do_profile_reset),
+	U_BOOT_SUBCMD_MKENT(stats, 1, 1, do_profile_stats),
+	U_BOOT_SUBCMD_MKENT(dump, 3, 1, do_profile_dump));
@@ -354,6 +354,7 @@ static int abortboot_key_sequence(int bootdelay)
 	 * To print the bootdelay value upon bootup.
 	 */
 	printf(CONFIG_AUTOBOOT_PROMPT, bootdelay);
+	flush();
 #  endif
 
 	if (IS_ENABLED(CONFIG_AUTOBOOT_ENCRYPTION)) {
@@ -376,6 +377,7 @@ static int abortboot_single_key(int bootdelay)
 	unsigned long ts;
 
 	printf("Hit any key to stop autoboot: %2d ", bootdelay);
+	flush();
 
 	/*
 	 * Check if key already pressed
@@ -405,6 +407,7 @@ static int abortboot_single_key(int bootdelay)
 		} while (!abort && get_timer(ts) < 1000);
 
 		printf("\b\b\b%2d ", bootdelay);
+		flush();
 	}
 
 	putc('\n');
@@ -16,6 +16,7 @@
 #include <hang.h>
 #include <log.h>
 #include <malloc.h>
+#include <perf.h>
 #include <sort.h>
 #include <spl.h>
 #include <asm/global_data.h>
@@ -26,6 +27,11 @@ DECLARE_GLOBAL_DATA_PTR;
 
 enum {
 	RECORD_COUNT = CONFIG_VAL(BOOTSTAGE_RECORD_COUNT),
+#if CONFIG_IS_ENABLED(BOOTSTAGE_TIMING)
+	TIMING_COUNT = CONFIG_BOOTSTAGE_TIMING_COUNT,
+	TIMING_KIND_LEN = 12,
+	TIMING_NAME_LEN = 20,
+#endif
 };
 
 struct bootstage_record {
@@ -36,16 +42,72 @@ struct bootstage_record {
 	enum bootstage_id id;
 };
 
+#if CONFIG_IS_ENABLED(BOOTSTAGE_TIMING)
+/**
+ * struct bootstage_timing - time taken by an initcall or device probe
+ *
+ * Names are copied rather than referenced since this table is relocated
+ * with a simple copy
+ *
+ * @start_us: Time when the timing started
+ * @total_us: Time taken, including nested timings
+ * @child_us: Time taken by nested timings
+ * @outer: Slot of the enclosing timing, or -1 if none
+ * @active: true if the timing has not finished yet
+ * @kind: Kind of entry, e.g. "initcall" or a uclass name
+ * @name: Name of the initcall or device
+ * @parent: Name of the parent device, or "" if none
+ */
+struct bootstage_timing {
+	u32 start_us;
+	u32 total_us;
+	u32 child_us;
+	short outer;
+	bool active;
+	char kind[TIMING_KIND_LEN];
+	char name[TIMING_NAME_LEN];
+	char parent[TIMING_NAME_LEN];
+};
+#endif
+
+/**
+ * struct bootstage_perf - performance counters for a bootstage record
+ *
+ * These are kept apart from the records so that the stash format does not
+ * depend on whether counters are enabled
+ *
+ * @id: Bootstage ID of the record
+ * @start: Counters at the mark, or at the last bootstage_start()
+ * @total: Total counts for an accumulated activity
+ */
+struct bootstage_perf {
+	enum bootstage_id id;
+	struct perf_counts start;
+	struct perf_counts total;
+};
+
 struct bootstage_data {
 	uint rec_count;
 	uint next_id;
 	struct bootstage_record record[RECORD_COUNT];
+#if CONFIG_IS_ENABLED(BOOTSTAGE_PERF)
+	uint perf_count;	/* Number of entries used in perf[] */
+	struct bootstage_perf perf[RECORD_COUNT];
+#endif
+#if CONFIG_IS_ENABLED(BOOTSTAGE_TIMING)
+	uint timing_count;	/* Number of slots used in timing[] */
+	uint timing_dropped;	/* Number of entries dropped when full */
+	int timing_inner;	/* Slot of innermost active timing, or -1 */
+	bool timing_busy;	/* true while reading the timer */
+	struct bootstage_timing timing[TIMING_COUNT];
+#endif
 };
 
 enum {
 	BOOTSTAGE_VERSION	= 0,
 	BOOTSTAGE_MAGIC		= 0xb00757a3,
 	BOOTSTAGE_DIGITS	= 9,
+	BOOTSTAGE_PERF_DIGITS	= 12,
 };
 
 struct bootstage_hdr {
@@ -111,6 +173,28 @@ struct bootstage_record *ensure_id(struct bootstage_data *data,
 	return rec;
 }
 
+static struct bootstage_perf *find_perf(struct bootstage_data *data,
+					 enum bootstage_id id, bool create)
+{
+#if CONFIG_IS_ENABLED(BOOTSTAGE_PERF)
+	struct bootstage_perf *perf;
+	int i;
+
+	for (i = 0, perf = data->perf; i < data->perf_count; i++, perf++) {
+		if (perf->id == id)
+			return perf;
+	}
+	if (create && data->perf_count < RECORD_COUNT) {
+		perf = &data->perf[data->perf_count++];
+		memset(perf, '\0', sizeof(*perf));
+		perf->id = id;
+		return perf;
+	}
+#endif
+
+	return NULL;
+}
+
 ulong bootstage_add_record(enum bootstage_id id, const char *name,
 			   int flags, ulong mark)
 {
@@ -136,6 +220,13 @@ ulong bootstage_add_record(enum bootstage_id id, const char *name,
 			rec->name = name;
 			rec->flags = flags;
 			rec->id = id;
+			if (CONFIG_IS_ENABLED(BOOTSTAGE_PERF)) {
+				struct bootstage_perf *perf;
+
+				perf = find_perf(data, id, true);
+				if (perf)
+					perf_read(&perf->start);
+			}
 		} else {
 			log_warning("Bootstage space exhausted\n");
 		}
@@ -199,6 +290,12 @@ uint32_t bootstage_start(enum bootstage_id id, const char *name)
 	if (rec) {
 		rec->start_us = start_us;
 		rec->name = name;
+		if (CONFIG_IS_ENABLED(BOOTSTAGE_PERF)) {
+			struct bootstage_perf *perf = find_perf(data, id, true);
+
+			if (perf)
+				perf_read(&perf->start);
+		}
 	}
 
 	return start_us;
@@ -214,6 +311,18 @@ uint32_t bootstage_accum(enum bootstage_id id)
 		return 0;
 	duration = (uint32_t)timer_get_boot_us() - rec->start_us;
 	rec->time_us += duration;
+	if (CONFIG_IS_ENABLED(BOOTSTAGE_PERF)) {
+		struct bootstage_perf *perf = find_perf(data, id, false);
+		struct perf_counts now, delta;
+		int i;
+
+		if (perf && !perf_read(&now)) {
+			perf_sub(&delta, &now, &perf->start);
+			for (i = 0; i < PERF_EVENT_COUNT; i++)
+				perf->total.count[i] += delta.count[i];
+			perf->total.wraps += delta.wraps;
+		}
+	}
 
 	return duration;
 }
@@ -239,7 +348,28 @@ static const char *get_record_name(char *buf, int len,
 	return buf;
 }
 
-static uint32_t print_time_record(struct bootstage_record *rec, uint32_t prev)
+/**
+ * print_perf() - Print the performance counters for a record, if enabled
+ *
+ * @counts: Counts to print, or NULL to leave the columns blank
+ */
+static void print_perf(const struct perf_counts *counts)
+{
+	int i;
+
+	if (!CONFIG_IS_ENABLED(BOOTSTAGE_PERF))
+		return;
+	for (i = 0; i < PERF_EVENT_COUNT; i++) {
+		if (counts)
+			print_grouped_ull(counts->count[i],
+					  BOOTSTAGE_PERF_DIGITS);
+		else
+			printf("%15s", "");
+	}
+}
+
+static uint32_t print_time_record(struct bootstage_record *rec, uint32_t prev,
+				  const struct perf_counts *counts)
 {
 	char buf[20];
 
@@ -250,6 +380,7 @@ static uint32_t print_time_record(struct bootstage_record *rec, uint32_t prev)
 		print_grouped_ull(rec->time_us, BOOTSTAGE_DIGITS);
 		print_grouped_ull(rec->time_us - prev, BOOTSTAGE_DIGITS);
 	}
+	print_perf(counts);
 	printf("  %s\n", get_record_name(buf, sizeof(buf), rec));
 
 	return rec->time_us;
@@ -331,21 +462,41 @@ void bootstage_report(void)
 {
 	struct bootstage_data *data = gd->bootstage;
 	struct bootstage_record *rec = data->record;
+	struct perf_counts prev_counts = {}, delta;
+	struct bootstage_perf *perf;
 	uint32_t prev;
+	u32 wraps = 0;
 	int i;
 
 	printf("Timer summary in microseconds (%d records):\n",
 	       data->rec_count);
-	printf("%11s%11s  %s\n", "Mark", "Elapsed", "Stage");
+	printf("%11s%11s", "Mark", "Elapsed");
+	if (CONFIG_IS_ENABLED(BOOTSTAGE_PERF)) {
+		for (i = 0; i < PERF_EVENT_COUNT; i++)
+			printf("%15s", perf_event_name(i));
+	}
+	printf("  %s\n", "Stage");
 
-	prev = print_time_record(rec, 0);
+	prev = print_time_record(rec, 0, NULL);
+	perf = find_perf(data, rec->id, false);
+	if (perf)
+		prev_counts = perf->start;
 
 	/* Sort records by increasing time */
 	qsort(data->record, data->rec_count, sizeof(*rec), h_compare_record);
 
 	for (i = 1, rec++; i < data->rec_count; i++, rec++) {
-		if (rec->id && !rec->start_us)
-			prev = print_time_record(rec, prev);
+		if (rec->id && !rec->start_us) {
+			/* Show the counts since the previous mark */
+			perf = find_perf(data, rec->id, false);
+			if (perf) {
+				perf_sub(&delta, &perf->start, &prev_counts);
+				prev_counts = perf->start;
+				wraps += delta.wraps;
+			}
+			prev = print_time_record(rec, prev,
+						 perf ? &delta : NULL);
+		}
 	}
 	if (data->rec_count > RECORD_COUNT)
 		printf("Overflowed internal boot id table by %d entries\n"
@@ -354,10 +505,150 @@ void bootstage_report(void)
 
 	puts("\nAccumulated time:\n");
 	for (i = 0, rec = data->record; i < data->rec_count; i++, rec++) {
-		if (rec->start_us)
-			prev = print_time_record(rec, -1);
+		if (rec->start_us) {
+			perf = find_perf(data, rec->id, false);
+			prev = print_time_record(rec, -1,
+						 perf ? &perf->total : NULL);
+			if (perf)
+				wraps += perf->total.wraps;
+		}
+	}
+	if (wraps)
+		printf("\nWarning: %u counter wraps missed, counts are low\n",
+		       wraps);
+}
+
+#if CONFIG_IS_ENABLED(BOOTSTAGE_TIMING)
+static u32 timing_self_us(const struct bootstage_timing *tm)
+{
+	return tm->total_us - tm->child_us;
+}
+
+/* Find the completed entry which took the least time, to make room */
+static int timing_find_victim(struct bootstage_data *data)
+{
+	int slot = -1;
+	int i;
+
+	for (i = 0; i < data->timing_count; i++) {
+		struct bootstage_timing *tm = &data->timing[i];
+
+		if (!tm->active && (slot == -1 ||
+				    tm->total_us < data->timing[slot].total_us))
+			slot = i;
+	}
+
+	return slot;
+}
+
+int bootstage_timing_start(const char *kind, const char *name,
+			   const char *parent)
+{
+	struct bootstage_data *data = gd->bootstage;
+	struct bootstage_timing *tm;
+	int slot;
+
+	/* Reading the timer may probe the timer device, so avoid recursion */
+	if (!data || data->timing_busy)
+		return -1;
+	if (data->timing_count < TIMING_COUNT) {
+		slot = data->timing_count++;
+	} else {
+		slot = timing_find_victim(data);
+		if (slot == -1)
+			return -1;
+		data->timing_dropped++;
+	}
+
+	tm = &data->timing[slot];
+	strlcpy(tm->kind, kind, sizeof(tm->kind));
+	strlcpy(tm->name, name, sizeof(tm->name));
+	strlcpy(tm->parent, parent ? parent : "", sizeof(tm->parent));
+	tm->total_us = 0;
+	tm->child_us = 0;
+	tm->outer = data->timing_inner;
+	tm->active = true;
+	data->timing_inner = slot;
+
+	data->timing_busy = true;
+	tm->start_us = timer_get_boot_us();
+	data->timing_busy = false;
+
+	return slot;
+}
+
+void bootstage_timing_end(int slot)
+{
+	struct bootstage_data *data = gd->bootstage;
+	struct bootstage_timing *tm;
+
+	if (!data || slot < 0)
+		return;
+	tm = &data->timing[slot];
+	data->timing_busy = true;
+	tm->total_us = (u32)timer_get_boot_us() - tm->start_us;
+	data->timing_busy = false;
+	tm->active = false;
+
+	data->timing_inner = tm->outer;
+	if (tm->outer != -1)
+		data->timing[tm->outer].child_us += tm->total_us;
+}
+
+static int h_compare_timing(const void *p1, const void *p2)
+{
+	const struct bootstage_timing *tm1 = *(struct bootstage_timing **)p1;
+	const struct bootstage_timing *tm2 = *(struct bootstage_timing **)p2;
+	u32 self1 = timing_self_us(tm1), self2 = timing_self_us(tm2);
+
+	if (self1 != self2)
+		return self1 < self2 ? 1 : -1;
+	if (tm1->total_us != tm2->total_us)
+		return tm1->total_us < tm2->total_us ? 1 : -1;
+
+	return 0;
+}
+
+void bootstage_report_top(int count)
+{
+	struct bootstage_data *data = gd->bootstage;
+	struct bootstage_timing **list;
+	int i, num;
+
+	if (!data || !data->timing_count) {
+		printf("No initcall or probe timings\n");
+		return;
 	}
+	list = malloc(data->timing_count * sizeof(*list));
+	if (!list) {
+		printf("Out of memory\n");
+		return;
+	}
+	for (i = 0, num = 0; i < data->timing_count; i++) {
+		if (!data->timing[i].active)
+			list[num++] = &data->timing[i];
+	}
+	qsort(list, num, sizeof(*list), h_compare_timing);
+
+	printf("Top %d of %d initcalls and probes, in microseconds:\n",
+	       min(count, num), num);
+	printf("%11s%11s  %-*s  %-*s  %s\n", "Self", "Total",
+	       TIMING_KIND_LEN - 1, "Type", TIMING_NAME_LEN - 1, "Name",
+	       "Parent");
+	for (i = 0; i < num && i < count; i++) {
+		struct bootstage_timing *tm = list[i];
+
+		print_grouped_ull(timing_self_us(tm), BOOTSTAGE_DIGITS);
+		print_grouped_ull(tm->total_us, BOOTSTAGE_DIGITS);
+		printf("  %-*s  %-*s  %s\n", TIMING_KIND_LEN - 1, tm->kind,
+		       TIMING_NAME_LEN - 1, tm->name, tm->parent);
+	}
+	if (data->timing_dropped)
+		printf("Dropped %u quicker entries, please increase CONFIG_BOOTSTAGE_TIMING_COUNT\n",
+		       data->timing_dropped);
+	free(list);
 }
+#endif
 
 /**
  * Append data to a memory buffer
@@ -541,6 +832,11 @@ int bootstage_init(bool first)
 		return -ENOMEM;
 	data = gd->bootstage;
 	memset(data, '\0', size);
+	if (CONFIG_IS_ENABLED(BOOTSTAGE_PERF))
+		perf_init();
+#if CONFIG_IS_ENABLED(BOOTSTAGE_TIMING)
+	data->timing_inner = -1;
+#endif
 	if (first) {
 		data->next_id = BOOTSTAGE_ID_USER;
 		bootstage_add_record(BOOTSTAGE_ID_AWAKE, "reset", 0, 0);
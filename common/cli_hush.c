@@ -81,10 +81,12 @@
 #include <linux/ctype.h>    /* isalpha, isdigit */
 #include <console.h>
 #include <bootretry.h>
+#include <bootstage.h>
 #include <cli.h>
 #include <cli_hush.h>
 #include <command.h>        /* find_cmd */
 #include <asm/global_data.h>
+#include <u-boot/crc.h>
 #endif
 #ifndef __U_BOOT__
 #include <ctype.h>     /* isalpha, isdigit */
@@ -373,8 +375,17 @@ static inline void debug_printf(const char *format, ...) { }
 #define final_printf debug_printf
 
 #ifdef __U_BOOT__
+/* set while parsing ahead for the parse cache, which reports errors later */
+static int syntax_quiet;
+
+#if CONFIG_IS_ENABLED(HUSH_PARSE_CACHE)
+/* set while running a cached script, whose words must stay unchanged */
+static int parse_cache_running;
+#endif
+
 static void syntax_err(void) {
-	 printf("syntax error\n");
+	if (!syntax_quiet)
+		printf("syntax error\n");
 }
 #else
 static void __syntax(char *file, int line) {
@@ -1513,6 +1524,36 @@ shell_terminal_error:
 }
 #endif
 
+#if defined(__U_BOOT__) && CONFIG_IS_ENABLED(HUSH_PARSE_CACHE)
+/*
+ * Run a command with a copy of its arguments. Commands may change their
+ * arguments in place, but those of a cached script are used again.
+ */
+static int run_cmd_copy(int flag, int argc, char *argv[])
+{
+	char **copy, *p;
+	size_t size;
+	int i, rcode;
+
+	size = (argc + 1) * sizeof(char *);
+	for (i = 0; i < argc; i++)
+		size += strlen(argv[i]) + 1;
+	copy = xmalloc(size);
+	p = (char *)(copy + argc + 1);
+	for (i = 0; i < argc; i++) {
+		copy[i] = p;
+		strcpy(p, argv[i]);
+		p += strlen(p) + 1;
+	}
+	copy[argc] = NULL;
+
+	rcode = cmd_process(flag, argc, copy, &flag_repeat, NULL);
+	free(copy);
+
+	return rcode;
+}
+#endif
+
 /* run_pipe_real() starts all the jobs, but doesn't wait for anything
  * to finish.  See checkjobs().
  *
@@ -1672,6 +1713,11 @@ static int run_pipe_real(struct pipe *pi)
 			return -1;
 		}
 		/* Process the command */
+#if CONFIG_IS_ENABLED(HUSH_PARSE_CACHE)
+		if (parse_cache_running)
+			return run_cmd_copy(flag, child->argc - i,
+					    child->argv + i);
+#endif
 		return cmd_process(flag, child->argc - i, child->argv + i,
 				   &flag_repeat, NULL);
 #endif
@@ -3184,6 +3230,8 @@ static int parse_stream_outer(struct in_str *inp, int flag)
 	int rcode;
 #ifdef __U_BOOT__
 	int code = 1;
+	/* Reading from the console waits for the user, so is not timed */
+	bool timed = inp->get == static_get;
 #endif
 	do {
 		ctx.type = flag;
@@ -3191,9 +3239,15 @@ static int parse_stream_outer(struct in_str *inp, int flag)
 		update_ifs_map();
 		if (!(flag & FLAG_PARSE_SEMICOLON) || (flag & FLAG_REPARSING)) mapset((uchar *)";$&|", 0);
 		inp->promptmode=1;
+#ifdef __U_BOOT__
+		if (timed)
+			bootstage_start(BOOTSTAGE_ID_ACCUM_HUSH, "hush_parse");
+#endif
 		rcode = parse_stream(&temp, &ctx, inp,
 				     flag & FLAG_CONT_ON_NEWLINE ? -1 : '\n');
 #ifdef __U_BOOT__
+		if (timed)
+			bootstage_accum(BOOTSTAGE_ID_ACCUM_HUSH);
 		if (rcode == 1) flag_repeat = 0;
 #endif
 		if (rcode != 1 && ctx.old_flag != 0) {
@@ -3255,6 +3309,239 @@ static int parse_stream_outer(struct in_str *inp, int flag)
 #endif /* __U_BOOT__ */
 }
 
+#if defined(__U_BOOT__) && CONFIG_IS_ENABLED(HUSH_PARSE_CACHE)
+/*
+ * Cache of parsed scripts, so that running the same script again (e.g. a
+ * variable with 'run' in a boot loop) does not tokenize it again. Variable
+ * expansion is still done when each command runs, so the parsed form only
+ * depends on the script text, the parse flags and $IFS.
+ *
+ * run_list_real() leaves a list as it found it, except when a 'for' loop
+ * is left early (the loop variable is then still replaced by a value) or
+ * when a command is prefixed by variable assignments. Lists with the
+ * latter are not cached and the former is checked after each run.
+ */
+struct parse_cache {
+	char *src;		/* copy of the script */
+	uint hash;		/* CRC32 of the script and $IFS */
+	int flag;		/* parse flags */
+	struct pipe **lists;	/* one list per command line */
+	int count;		/* number of lists */
+	char **for_vars;	/* 'for' loop variables, to detect changes */
+	int nr_for;		/* number of for_vars */
+	int busy;		/* being run (a script may run itself) */
+	ulong last_used;	/* for LRU replacement */
+};
+
+static struct parse_cache parse_cache[CONFIG_HUSH_PARSE_CACHE_SIZE];
+static ulong parse_cache_tick;
+static ulong parse_cache_hits;
+
+ulong hush_parse_cache_hits(void)
+{
+	return parse_cache_hits;
+}
+
+static void parse_cache_free(struct parse_cache *pc)
+{
+	int i;
+
+	for (i = 0; i < pc->count; i++)
+		free_pipe_list(pc->lists[i], 0);
+	free(pc->lists);
+	free(pc->for_vars);
+	free(pc->src);
+	memset(pc, '\0', sizeof(*pc));
+}
+
+/*
+ * Return the number of 'for' loops in a list, or -1 if running it would
+ * change it
+ */
+static int parse_cache_check_list(struct pipe *pi)
+{
+	struct child_prog *child;
+	int nr_for = 0;
+	int i, j;
+
+	for (; pi; pi = pi->next) {
+		if (pi->r_mode == RES_FOR && pi->num_progs)
+			nr_for++;
+		for (i = 0; i < pi->num_progs; i++) {
+			child = &pi->progs[i];
+			if (child->group)
+				return -1;
+			if (!child->argv)
+				continue;
+			/* "a=b cmd" consumes its assignments when run */
+			for (j = 0; is_assignment(child->argv[j]); j++)
+				;
+			if (j && child->argv[j])
+				return -1;
+		}
+	}
+
+	return nr_for;
+}
+
+/* Visit the 'for' loop variables of all lists, saving or checking them */
+static bool parse_cache_for_vars(struct parse_cache *pc, bool save)
+{
+	struct pipe *pi;
+	int i, n = 0;
+
+	for (i = 0; i < pc->count; i++) {
+		for (pi = pc->lists[i]; pi; pi = pi->next) {
+			if (pi->r_mode != RES_FOR || !pi->num_progs)
+				continue;
+			if (save)
+				pc->for_vars[n] = pi->progs->argv[0];
+			else if (pc->for_vars[n] != pi->progs->argv[0])
+				return false;
+			n++;
+		}
+	}
+
+	return true;
+}
+
+/*
+ * Parse all command lines of a script into @pc, without running them.
+ * Return 0 if OK, -1 on a syntax error or if the script cannot be cached
+ */
+static int parse_cache_parse(struct parse_cache *pc, const char *s, int flag)
+{
+	struct in_str input;
+	struct p_context ctx;
+	o_string temp = NULL_O_STRING;
+	struct pipe **lists;
+	int rcode, nr_for;
+
+	setup_string_in_str(&input, s);
+	syntax_quiet = 1;
+	do {
+		ctx.type = flag;
+		initialize_context(&ctx);
+		update_ifs_map();
+		if (!(flag & FLAG_PARSE_SEMICOLON))
+			mapset((uchar *)";$&|", 0);
+		input.promptmode = 1;
+		bootstage_start(BOOTSTAGE_ID_ACCUM_HUSH, "hush_parse");
+		rcode = parse_stream(&temp, &ctx, &input,
+				     flag & FLAG_CONT_ON_NEWLINE ? -1 : '\n');
+		bootstage_accum(BOOTSTAGE_ID_ACCUM_HUSH);
+		if (rcode == 1 || ctx.old_flag != 0) {
+			if (ctx.old_flag != 0)
+				free(ctx.stack);
+			b_free(&temp);
+			free_pipe_list(ctx.list_head, 0);
+			goto err;
+		}
+		done_word(&temp, &ctx);
+		done_pipe(&ctx, PIPE_SEQ);
+		b_free(&temp);
+
+		nr_for = parse_cache_check_list(ctx.list_head);
+		lists = realloc(pc->lists, (pc->count + 1) * sizeof(*lists));
+		if (nr_for < 0 || !lists) {
+			free_pipe_list(ctx.list_head, 0);
+			goto err;
+		}
+		pc->lists = lists;
+		pc->lists[pc->count++] = ctx.list_head;
+		pc->nr_for += nr_for;
+	} while (rcode != -1 && !(flag & FLAG_EXIT_FROM_LOOP) && b_peek(&input));
+	syntax_quiet = 0;
+
+	if (pc->nr_for) {
+		pc->for_vars = malloc(pc->nr_for * sizeof(*pc->for_vars));
+		if (!pc->for_vars)
+			return -1;
+		parse_cache_for_vars(pc, true);
+	}
+
+	return 0;
+err:
+	syntax_quiet = 0;
+	return -1;
+}
+
+/*
+ * Find the script in the cache, or parse it into a new entry. Return NULL
+ * if it cannot be cached
+ */
+static struct parse_cache *parse_cache_get(const char *s, int flag)
+{
+	struct parse_cache *pc, *victim = NULL;
+	const char *ifs = env_get("IFS");
+	size_t len = strlen(s);
+	uint hash;
+	int i;
+
+	if (!(gd->flags & GD_FLG_RELOC))
+		return NULL;
+
+	hash = crc32(0, (const uchar *)s, len);
+	if (ifs)
+		hash = crc32(hash, (const uchar *)ifs, strlen(ifs));
+
+	for (i = 0; i < ARRAY_SIZE(parse_cache); i++) {
+		pc = &parse_cache[i];
+		if (pc->busy)
+			continue;
+		if (pc->src && pc->hash == hash && pc->flag == flag &&
+		    !strcmp(pc->src, s)) {
+			debug("hush: parse cache hit for '%.20s'\n", s);
+			pc->last_used = ++parse_cache_tick;
+			parse_cache_hits++;
+			return pc;
+		}
+		if (!victim || pc->last_used < victim->last_used)
+			victim = pc;
+	}
+	if (!victim)
+		return NULL;
+
+	parse_cache_free(victim);
+	victim->src = strdup(s);
+	if (!victim->src || parse_cache_parse(victim, s, flag)) {
+		parse_cache_free(victim);
+		return NULL;
+	}
+	victim->hash = hash;
+	victim->flag = flag;
+	victim->last_used = ++parse_cache_tick;
+
+	return victim;
+}
+
+/* Run all command lines of a cached script, like parse_stream_outer() */
+static int parse_cache_run(struct parse_cache *pc)
+{
+	int code = 1;
+	int i;
+
+	pc->busy++;
+	parse_cache_running++;
+	for (i = 0; i < pc->count; i++) {
+		code = run_list_real(pc->lists[i]);
+		if (code == -2)		/* exit */
+			break;
+		if (code == -1)
+			flag_repeat = 0;
+	}
+	parse_cache_running--;
+	pc->busy--;
+
+	if (!parse_cache_for_vars(pc, false))
+		parse_cache_free(pc);
+	if (code == -2)
+		return -2;
+
+	return (code != 0) ? 1 : 0;
+}
+#endif
+
 #ifndef __U_BOOT__
 static int parse_string_outer(const char *s, int flag)
 #else
@@ -3269,6 +3556,25 @@ int parse_string_outer(const char *s, int flag)
 		return 1;
 	if (!*s)
 		return 0;
+#if CONFIG_IS_ENABLED(HUSH_PARSE_CACHE)
+	if (!(flag & FLAG_REPARSING)) {
+		struct parse_cache *pc;
+
+		if (!(p = strchr(s, '\n')) || *++p) {
+			p = xmalloc(strlen(s) + 2);
+			strcpy(p, s);
+			strcat(p, "\n");
+			pc = parse_cache_get(p, flag);
+			free(p);
+		} else {
+			pc = parse_cache_get(s, flag);
+		}
+		if (pc) {
+			rcode = parse_cache_run(pc);
+			return rcode == -2 ? last_return_code : rcode;
+		}
+	}
+#endif
 	if (!(p = strchr(s, '\n')) || *++p) {
 		p = xmalloc(strlen(s) + 2);
 		strcpy(p, s);
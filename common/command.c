@@ -15,7 +15,9 @@
 #include <env.h>
 #include <image.h>
 #include <log.h>
+#include <malloc.h>
 #include <mapmem.h>
+#include <sort.h>
 #include <asm/global_data.h>
 #include <linux/ctype.h>
 
@@ -89,6 +91,19 @@ int _do_help(struct cmd_tbl *cmd_start, int cmd_items, struct cmd_tbl *cmdtp,
 	return rcode;
 }
 
+#ifdef CONFIG_CMDLINE
+/*
+ * Some commands allow length modifiers (like "cp.b");
+ * compare command name only until first dot.
+ */
+static int cmd_name_len(const char *cmd)
+{
+	const char *p;
+
+	return ((p = strchr(cmd, '.')) == NULL) ? strlen(cmd) : (p - cmd);
+}
+#endif
+
 /* find command table entry for a command */
 struct cmd_tbl *find_cmd_tbl(const char *cmd, struct cmd_tbl *table,
 			     int table_len)
@@ -96,17 +111,12 @@ struct cmd_tbl *find_cmd_tbl(const char *cmd, struct cmd_tbl *table,
 #ifdef CONFIG_CMDLINE
 	struct cmd_tbl *cmdtp;
 	struct cmd_tbl *cmdtp_temp = table;	/* Init value */
-	const char *p;
 	int len;
 	int n_found = 0;
 
 	if (!cmd)
 		return NULL;
-	/*
-	 * Some commands allow length modifiers (like "cp.b");
-	 * compare command name only until first dot.
-	 */
-	len = ((p = strchr(cmd, '.')) == NULL) ? strlen (cmd) : (p - cmd);
+	len = cmd_name_len(cmd);
 
 	for (cmdtp = table; cmdtp != table + table_len; cmdtp++) {
 		if (strncmp(cmd, cmdtp->name, len) == 0) {
@@ -125,10 +135,80 @@ struct cmd_tbl *find_cmd_tbl(const char *cmd, struct cmd_tbl *table,
 	return NULL;	/* not found or ambiguous command */
 }
 
+#ifdef CONFIG_CMDLINE
+/*
+ * The linker list is almost, but not quite, sorted by command name (some
+ * entries use a different name from their symbol, e.g. "?"), so keep an
+ * index of it sorted by name. It is built on first use after relocation.
+ */
+static struct cmd_tbl **cmd_index;
+
+static int cmd_index_cmp(const void *a, const void *b)
+{
+	const struct cmd_tbl *c1 = *(const struct cmd_tbl **)a;
+	const struct cmd_tbl *c2 = *(const struct cmd_tbl **)b;
+
+	return strcmp(c1->name, c2->name);
+}
+
+static struct cmd_tbl **cmd_index_get(struct cmd_tbl *table, int table_len)
+{
+	int i;
+
+	if (cmd_index || !(gd->flags & GD_FLG_RELOC))
+		return cmd_index;
+
+	cmd_index = malloc(table_len * sizeof(*cmd_index));
+	if (!cmd_index)
+		return NULL;
+	for (i = 0; i < table_len; i++)
+		cmd_index[i] = table + i;
+	qsort(cmd_index, table_len, sizeof(*cmd_index), cmd_index_cmp);
+
+	return cmd_index;
+}
+
+/*
+ * Same as find_cmd_tbl() but using a binary search in @index. Commands
+ * starting with the same prefix are adjacent, with a full match first.
+ */
+static struct cmd_tbl *find_cmd_index(const char *cmd, struct cmd_tbl **index,
+				      int table_len)
+{
+	int lo = 0, hi = table_len;
+	int len;
+
+	len = cmd_name_len(cmd);
+	while (lo < hi) {
+		int mid = lo + (hi - lo) / 2;
+
+		if (strncmp(index[mid]->name, cmd, len) < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	if (lo == table_len || strncmp(index[lo]->name, cmd, len))
+		return NULL;	/* not found */
+	if (!index[lo]->name[len])
+		return index[lo];	/* full match */
+	if (lo + 1 < table_len && !strncmp(index[lo + 1]->name, cmd, len))
+		return NULL;	/* ambiguous command */
+
+	return index[lo];	/* abbreviated command */
+}
+#endif /* CONFIG_CMDLINE */
+
 struct cmd_tbl *find_cmd(const char *cmd)
 {
 	struct cmd_tbl *start = ll_entry_start(struct cmd_tbl, cmd);
 	const int len = ll_entry_count(struct cmd_tbl, cmd);
+#ifdef CONFIG_CMDLINE
+	struct cmd_tbl **index = cmd_index_get(start, len);
+
+	if (index && cmd)
+		return find_cmd_index(cmd, index, len);
+#endif
 	return find_cmd_tbl(cmd, start, len);
 }
 
@@ -456,6 +456,10 @@ int console_start(int file, struct stdio_dev *sdev)
 {
 	int error;
 
+	/* Buffered output belongs to the previous devices */
+	if (file == stdout)
+		console_buffer_flush();
+
 	if (!console_needs_start_stop(file, sdev))
 		return 0;
 
@@ -471,6 +475,9 @@ int console_start(int file, struct stdio_dev *sdev)
 
 void console_stop(int file, struct stdio_dev *sdev)
 {
+	if (file == stdout)
+		console_buffer_flush();
+
 	if (!console_needs_start_stop(file, sdev))
 		return;
 
@@ -539,23 +546,120 @@ int ftstc(int file)
 	return -1;
 }
 
+#if CONFIG_IS_ENABLED(CONSOLE_BUFFER)
+/**
+ * struct console_buffer - output waiting to be written to stdout
+ *
+ * Output is written to the stdout devices a batch at a time, so that each
+ * device's puts() method sees a long string rather than one character or one
+ * short string at a time
+ *
+ * @buf: Buffered output, with space for a nul terminator
+ * @len: Number of characters in @buf
+ * @last_flush: Time of the last flush, in ms
+ * @flushing: true while the buffer is being written out
+ */
+static struct console_buffer {
+	char buf[CONFIG_CONSOLE_BUFFER_SIZE + 1];
+	int len;
+	ulong last_flush;
+	bool flushing;
+} con_buf;
+
+void console_buffer_flush(void)
+{
+	/* The buffer is in BSS, which is not available before relocation */
+	if (!(gd->flags & GD_FLG_DEVINIT) || !con_buf.len || con_buf.flushing)
+		return;
+
+	con_buf.flushing = true;
+	con_buf.buf[con_buf.len] = '\0';
+	console_puts(stdout, con_buf.buf);
+	con_buf.len = 0;
+	con_buf.last_flush = get_timer(0);
+	con_buf.flushing = false;
+}
+
+void console_buffer_poll(void)
+{
+	if ((gd->flags & GD_FLG_DEVINIT) && con_buf.len &&
+	    get_timer(con_buf.last_flush) >= CONFIG_CONSOLE_BUFFER_LATENCY_MS)
+		console_buffer_flush();
+}
+
+int console_buffer_pending(void)
+{
+	return gd->flags & GD_FLG_DEVINIT ? con_buf.len : 0;
+}
+
+/**
+ * console_buffer_write() - Add output to the buffer
+ *
+ * @file: File being written to (e.g. stdout)
+ * @s: Output to add
+ * @len: Number of characters in @s
+ * Return: true if the output was buffered, false if the caller must write it
+ *	directly
+ */
+static bool console_buffer_write(int file, const char *s, int len)
+{
+	int upto;
+
+	if (!(gd->flags & GD_FLG_DEVINIT))
+		return false;
+
+	/* Keep other output in order with stdout */
+	if (file != stdout) {
+		console_buffer_flush();
+		return false;
+	}
+
+	/* Output from within a flush, e.g. from a cyclic function */
+	if (con_buf.flushing)
+		return false;
+
+	while (len) {
+		upto = min(len, CONFIG_CONSOLE_BUFFER_SIZE - con_buf.len);
+		memcpy(con_buf.buf + con_buf.len, s, upto);
+		con_buf.len += upto;
+		s += upto;
+		len -= upto;
+		if (con_buf.len == CONFIG_CONSOLE_BUFFER_SIZE)
+			console_buffer_flush();
+	}
+	console_buffer_poll();
+
+	return true;
+}
+#else
+static inline bool console_buffer_write(int file, const char *s, int len)
+{
+	return false;
+}
+#endif
+
 void fputc(int file, const char c)
 {
-	if ((unsigned int)file < MAX_FILES)
+	if ((unsigned int)file < MAX_FILES &&
+	    !console_buffer_write(file, &c, 1))
 		console_putc(file, c);
 }
 
 void fputs(int file, const char *s)
 {
-	if ((unsigned int)file < MAX_FILES)
+	if ((unsigned int)file < MAX_FILES &&
+	    !console_buffer_write(file, s, strlen(s)))
 		console_puts(file, s);
 }
 
 #ifdef CONFIG_CONSOLE_FLUSH_SUPPORT
 void fflush(int file)
 {
-	if ((unsigned int)file < MAX_FILES)
+	if ((unsigned int)file < MAX_FILES) {
+		if (file == stdout)
+			console_buffer_flush();
 		console_flush(file);
+	}
 }
 #endif
 
@@ -590,6 +694,9 @@ int getchar(void)
 	if (!gd->have_console)
 		return 0;
 
+	/* Make sure that any prompt is visible */
+	console_buffer_flush();
+
 	ch = console_record_getc();
 	if (ch != -1)
 		return ch;
@@ -788,6 +895,9 @@ void flush(void)
 	if (IS_ENABLED(CONFIG_DEBUG_UART) && !(gd->flags & GD_FLG_SERIAL_READY))
 		return;
 
+	/* Output buffered before the console was silenced is still due */
+	console_buffer_flush();
+
 	if (IS_ENABLED(CONFIG_SILENT_CONSOLE) && (gd->flags & GD_FLG_SILENT))
 		return;
 
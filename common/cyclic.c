@@ -8,6 +8,7 @@
  * Copyright (C) 2022 Stefan Roese <sr@denx.de>
  */
 
+#include <console.h>
 #include <cyclic.h>
 #include <log.h>
 #include <malloc.h>
@@ -26,6 +27,49 @@ struct hlist_head *cyclic_get_list(void)
 	return (struct hlist_head *)&gd->cyclic_list;
 }
 
+/**
+ * cyclic_queue() - Add a function to the list in order of its deadline
+ *
+ * Functions with the same deadline are kept in the order they were added, so
+ * that none of them is starved
+ *
+ * @cyclic: Cyclic function to add, with @next_call set up
+ */
+static void cyclic_queue(struct cyclic_info *cyclic)
+{
+	struct cyclic_info *pos, *last = NULL;
+
+	hlist_for_each_entry(pos, cyclic_get_list(), list) {
+		if (time_after64(pos->next_call, cyclic->next_call)) {
+			hlist_add_before(&cyclic->list, &pos->list);
+			return;
+		}
+		last = pos;
+	}
+	if (last)
+		hlist_add_after(&last->list, &cyclic->list);
+	else
+		hlist_add_head(&cyclic->list, cyclic_get_list());
+}
+
+/**
+ * cyclic_account_late() - Record how late a function started
+ *
+ * @cyclic: Cyclic function being started
+ * @late_us: Time since its deadline, in us
+ */
+static void cyclic_account_late(struct cyclic_info *cyclic, uint64_t late_us)
+{
+	uint64_t limit = 10;
+	int i;
+
+	for (i = 0; i < CYCLIC_LATE_BUCKETS - 1 && late_us >= limit; i++)
+		limit *= 10;
+	cyclic->late_hist[i]++;
+	if (late_us > cyclic->late_max_us)
+		cyclic->late_max_us = late_us;
+}
+
 struct cyclic_info *cyclic_register(cyclic_func_t func, uint64_t delay_us,
 				    const char *name, void *ctx)
 {
@@ -43,7 +87,8 @@ struct cyclic_info *cyclic_register(cyclic_func_t func, uint64_t delay_us,
 	cyclic->name = strdup(name);
 	cyclic->delay_us = delay_us;
 	cyclic->start_time_us = timer_get_us();
-	hlist_add_head(&cyclic->list, cyclic_get_list());
+	cyclic->next_call = cyclic->start_time_us;
+	cyclic_queue(cyclic);
 
 	return cyclic;
 }
@@ -58,44 +103,60 @@ int cyclic_unregister(struct cyclic_info *cyclic)
 
 void cyclic_run(void)
 {
+	struct hlist_head *list = cyclic_get_list();
 	struct cyclic_info *cyclic;
-	struct hlist_node *tmp;
-	uint64_t now, cpu_time;
+	uint64_t now, start, cpu_time;
 
 	/* Prevent recursion */
 	if (gd->flags & GD_FLG_CYCLIC_RUNNING)
 		return;
 
+	/* The list is in deadline order, so only the first entry matters */
+	if (hlist_empty(list))
+		return;
+	cyclic = hlist_entry(list->first, struct cyclic_info, list);
+	now = timer_get_us();
+	if (time_before64(now, cyclic->next_call))
+		return;
+
 	gd->flags |= GD_FLG_CYCLIC_RUNNING;
-	hlist_for_each_entry_safe(cyclic, tmp, cyclic_get_list(), list) {
-		/*
-		 * Check if this cyclic function needs to get called, e.g.
-		 * do not call the cyclic func too often
-		 */
-		now = timer_get_us();
-		if (time_after_eq64(now, cyclic->next_call)) {
-			/* Call cyclic function and account it's cpu-time */
-			cyclic->next_call = now + cyclic->delay_us;
-			cyclic->func(cyclic->ctx);
-			cyclic->run_cnt++;
-			cpu_time = timer_get_us() - now;
-			cyclic->cpu_time_us += cpu_time;
-
-			/* Check if cpu-time exceeds max allowed time */
-			if ((cpu_time > CONFIG_CYCLIC_MAX_CPU_TIME_US) &&
-			    (!cyclic->already_warned)) {
-				pr_err("cyclic function %s took too long: %lldus vs %dus max\n",
-				       cyclic->name, cpu_time,
-				       CONFIG_CYCLIC_MAX_CPU_TIME_US);
-
-				/*
-				 * Don't disable this function, just warn once
-				 * about this exceeding CPU time usage
-				 */
-				cyclic->already_warned = true;
-			}
+	start = now;
+	do {
+		cyclic_account_late(cyclic, now - cyclic->next_call);
+		cyclic->next_call = now + cyclic->delay_us;
+		hlist_del(&cyclic->list);
+		cyclic_queue(cyclic);
+
+		/* Call cyclic function and account it's cpu-time */
+		cyclic->func(cyclic->ctx);
+		cyclic->run_cnt++;
+		cpu_time = timer_get_us() - now;
+		cyclic->cpu_time_us += cpu_time;
+		if (cpu_time > cyclic->cpu_time_max_us)
+			cyclic->cpu_time_max_us = cpu_time;
+
+		/* Check if cpu-time exceeds max allowed time */
+		if ((cpu_time > CONFIG_CYCLIC_MAX_CPU_TIME_US) &&
+		    (!cyclic->already_warned)) {
+			pr_err("cyclic function %s took too long: %lldus vs %dus max\n",
+			       cyclic->name, cpu_time,
+			       CONFIG_CYCLIC_MAX_CPU_TIME_US);
+
+			/*
+			 * Don't disable this function, just warn once
+			 * about this exceeding CPU time usage
+			 */
+			cyclic->already_warned = true;
 		}
-	}
+
+		/* Leave the rest for later if the budget is used up */
+		if (hlist_empty(list))
+			break;
+		now = timer_get_us();
+		if (now - start >= CONFIG_CYCLIC_RUN_BUDGET_US)
+			break;
+		cyclic = hlist_entry(list->first, struct cyclic_info, list);
+	} while (time_after_eq64(now, cyclic->next_call));
 	gd->flags &= ~GD_FLG_CYCLIC_RUNNING;
 }
 
@@ -109,8 +170,10 @@ void schedule(void)
 	 * schedule() might get called very early before the cyclic IF is
 	 * ready. Make sure to only call cyclic_run() when it's initalized.
 	 */
-	if (gd)
+	if (gd) {
 		cyclic_run();
+		console_buffer_poll();
+	}
 }
 
 int cyclic_unregister_all(void)
@@ -13,11 +13,16 @@
 #endif
 
 #include <common.h>
+#include <div64.h>
 #include <log.h>
 #include <asm/global_data.h>
 
 #include <malloc.h>
+#include <time.h>
 #include <asm/io.h>
+#include <linux/bitops.h>
+#include <linux/errno.h>
+#include <linux/sizes.h>
 #include <valgrind/memcheck.h>
 
 #ifdef DEBUG
@@ -601,6 +606,8 @@ ulong mem_malloc_brk = 0;
 static bool malloc_testing;	/* enable test mode */
 static int malloc_max_allocs;	/* return NULL after this many calls to malloc() */
 
+static void slab_reset(void);
+
 void *sbrk(ptrdiff_t increment)
 {
 	ulong old = mem_malloc_brk;
@@ -626,6 +633,7 @@ void mem_malloc_init(ulong start, ulong size)
 	mem_malloc_start = start;
 	mem_malloc_end = start + size;
 	mem_malloc_brk = start;
+	slab_reset();
 
 #ifdef CONFIG_SYS_MALLOC_DEFAULT_TO_INIT
 	malloc_init();
@@ -1285,11 +1293,11 @@ static void malloc_extend_top(nb) INTERNAL_SIZE_T nb;
 
 */
 
-STATIC_IF_MCHECK
+static
 #if __STD_C
-Void_t* mALLOc_impl(size_t bytes)
+Void_t* mALLOc_core(size_t bytes)
 #else
-Void_t* mALLOc_impl(bytes) size_t bytes;
+Void_t* mALLOc_core(bytes) size_t bytes;
 #endif
 {
   mchunkptr victim;                  /* inspected/selected chunk */
@@ -1571,11 +1579,11 @@ Void_t* mALLOc_impl(bytes) size_t bytes;
 */
 
 
-STATIC_IF_MCHECK
+static
 #if __STD_C
-void fREe_impl(Void_t* mem)
+void fREe_core(Void_t* mem)
 #else
-void fREe_impl(mem) Void_t* mem;
+void fREe_core(mem) Void_t* mem;
 #endif
 {
   mchunkptr p;         /* chunk corresponding to mem */
@@ -1713,11 +1721,11 @@ void fREe_impl(mem) Void_t* mem;
 */
 
 
-STATIC_IF_MCHECK
+static
 #if __STD_C
-Void_t* rEALLOc_impl(Void_t* oldmem, size_t bytes)
+Void_t* rEALLOc_core(Void_t* oldmem, size_t bytes)
 #else
-Void_t* rEALLOc_impl(oldmem, bytes) Void_t* oldmem; size_t bytes;
+Void_t* rEALLOc_core(oldmem, bytes) Void_t* oldmem; size_t bytes;
 #endif
 {
   INTERNAL_SIZE_T    nb;      /* padded request size */
@@ -1743,7 +1751,7 @@ Void_t* rEALLOc_impl(oldmem, bytes) Void_t* oldmem; size_t bytes;
 
 #ifdef REALLOC_ZERO_BYTES_FREES
   if (!bytes) {
-	fREe_impl(oldmem);
+	fREe_core(oldmem);
 	return NULL;
   }
 #endif
@@ -1751,7 +1759,7 @@ Void_t* rEALLOc_impl(oldmem, bytes) Void_t* oldmem; size_t bytes;
   if ((long)bytes < 0) return NULL;
 
   /* realloc of null is supposed to be same as malloc */
-  if (oldmem == NULL) return mALLOc_impl(bytes);
+  if (oldmem == NULL) return mALLOc_core(bytes);
 
 #if CONFIG_IS_ENABLED(SYS_MALLOC_F)
 	if (!(gd->flags & GD_FLG_FULL_MALLOC_INIT)) {
@@ -1776,7 +1784,7 @@ Void_t* rEALLOc_impl(oldmem, bytes) Void_t* oldmem; size_t bytes;
     /* Note the extra SIZE_SZ overhead. */
     if(oldsize - SIZE_SZ >= nb) return oldmem; /* do nothing */
     /* Must alloc, copy, free. */
-    newmem = mALLOc_impl(bytes);
+    newmem = mALLOc_core(bytes);
     if (!newmem)
 	return NULL; /* propagate failure */
     MALLOC_COPY(newmem, oldmem, oldsize - 2*SIZE_SZ);
@@ -1887,7 +1895,7 @@ Void_t* rEALLOc_impl(oldmem, bytes) Void_t* oldmem; size_t bytes;
 
     /* Must allocate */
 
-    newmem = mALLOc_impl (bytes);
+    newmem = mALLOc_core (bytes);
 
     if (newmem == NULL)  /* propagate failure */
       return NULL;
@@ -1904,7 +1912,7 @@ Void_t* rEALLOc_impl(oldmem, bytes) Void_t* oldmem; size_t bytes;
 
     /* Otherwise copy, free, and exit */
     MALLOC_COPY(newmem, oldmem, oldsize - SIZE_SZ);
-    fREe_impl(oldmem);
+    fREe_core(oldmem);
     return newmem;
   } else {
     VALGRIND_RESIZEINPLACE_BLOCK(oldmem, 0, bytes, SIZE_SZ);
@@ -1923,7 +1931,7 @@ Void_t* rEALLOc_impl(oldmem, bytes) Void_t* oldmem; size_t bytes;
     set_inuse_bit_at_offset(remainder, remainder_size);
     VALGRIND_MALLOCLIKE_BLOCK(chunk2mem(remainder), remainder_size, SIZE_SZ,
 			      false);
-    fREe_impl(chunk2mem(remainder)); /* let free() deal with it */
+    fREe_core(chunk2mem(remainder)); /* let free() deal with it */
   }
   else
   {
@@ -1957,11 +1965,11 @@ Void_t* rEALLOc_impl(oldmem, bytes) Void_t* oldmem; size_t bytes;
 */
 
 
-STATIC_IF_MCHECK
+static
 #if __STD_C
-Void_t* mEMALIGn_impl(size_t alignment, size_t bytes)
+Void_t* mEMALIGn_core(size_t alignment, size_t bytes)
 #else
-Void_t* mEMALIGn_impl(alignment, bytes) size_t alignment; size_t bytes;
+Void_t* mEMALIGn_core(alignment, bytes) size_t alignment; size_t bytes;
 #endif
 {
   INTERNAL_SIZE_T    nb;      /* padded  request size */
@@ -1984,7 +1992,7 @@ Void_t* mEMALIGn_impl(alignment, bytes) size_t alignment; size_t bytes;
 
   /* If need less alignment than we give anyway, just relay to malloc */
 
-  if (alignment <= MALLOC_ALIGNMENT) return mALLOc_impl(bytes);
+  if (alignment <= MALLOC_ALIGNMENT) return mALLOc_core(bytes);
 
   /* Otherwise, ensure that it is at least a minimum chunk size */
 
@@ -1993,7 +2001,7 @@ Void_t* mEMALIGn_impl(alignment, bytes) size_t alignment; size_t bytes;
   /* Call malloc with worst case padding to hit alignment. */
 
   nb = request2size(bytes);
-  m  = (char*)(mALLOc_impl(nb + alignment + MINSIZE));
+  m  = (char*)(mALLOc_core(nb + alignment + MINSIZE));
 
   /*
   * The attempt to over-allocate (with a size large enough to guarantee the
@@ -2009,7 +2017,7 @@ Void_t* mEMALIGn_impl(alignment, bytes) size_t alignment; size_t bytes;
      * Use bytes not nb, since mALLOc internally calls request2size too, and
      * each call increases the size to allocate, to account for the header.
      */
-    m  = (char*)(mALLOc_impl(bytes));
+    m  = (char*)(mALLOc_core(bytes));
     /* Aligned -> return it */
     if ((((unsigned long)(m)) % alignment) == 0)
       return m;
@@ -2017,10 +2025,10 @@ Void_t* mEMALIGn_impl(alignment, bytes) size_t alignment; size_t bytes;
      * Otherwise, try again, requesting enough extra space to be able to
      * acquire alignment.
      */
-    fREe_impl(m);
+    fREe_core(m);
     /* Add in extra bytes to match misalignment of unexpanded allocation */
     extra = alignment - (((unsigned long)(m)) % alignment);
-    m  = (char*)(mALLOc_impl(bytes + extra));
+    m  = (char*)(mALLOc_core(bytes + extra));
     /*
      * m might not be the same as before. Validate that the previous value of
      * extra still works for the current value of m.
@@ -2029,7 +2037,7 @@ Void_t* mEMALIGn_impl(alignment, bytes) size_t alignment; size_t bytes;
     if (m) {
       extra2 = alignment - (((unsigned long)(m)) % alignment);
       if (extra2 > extra) {
-        fREe_impl(m);
+        fREe_core(m);
         m = NULL;
       }
     }
@@ -2079,7 +2087,7 @@ Void_t* mEMALIGn_impl(alignment, bytes) size_t alignment; size_t bytes;
     set_head(newp, newsize | PREV_INUSE);
     set_inuse_bit_at_offset(newp, newsize);
     set_head_size(p, leadsize);
-    fREe_impl(chunk2mem(p));
+    fREe_core(chunk2mem(p));
     p = newp;
     VALGRIND_MALLOCLIKE_BLOCK(chunk2mem(p), bytes, SIZE_SZ, false);
 
@@ -2097,7 +2105,7 @@ Void_t* mEMALIGn_impl(alignment, bytes) size_t alignment; size_t bytes;
     set_head_size(p, nb);
     VALGRIND_MALLOCLIKE_BLOCK(chunk2mem(remainder), remainder_size, SIZE_SZ,
 			      false);
-    fREe_impl(chunk2mem(remainder));
+    fREe_core(chunk2mem(remainder));
   }
 
   check_inuse_chunk(p);
@@ -2145,11 +2153,11 @@ Void_t* pvALLOc(bytes) size_t bytes;
 
 */
 
-STATIC_IF_MCHECK
+static
 #if __STD_C
-Void_t* cALLOc_impl(size_t n, size_t elem_size)
+Void_t* cALLOc_core(size_t n, size_t elem_size)
 #else
-Void_t* cALLOc_impl(n, elem_size) size_t n; size_t elem_size;
+Void_t* cALLOc_core(n, elem_size) size_t n; size_t elem_size;
 #endif
 {
   mchunkptr p;
@@ -2165,7 +2173,7 @@ Void_t* cALLOc_impl(n, elem_size) size_t n; size_t elem_size;
   INTERNAL_SIZE_T oldtopsize = chunksize(top);
 #endif
 #endif
-  Void_t* mem = mALLOc_impl (sz);
+  Void_t* mem = mALLOc_core (sz);
 
   if ((long)n < 0) return NULL;
 
@@ -2206,6 +2214,420 @@ Void_t* cALLOc_impl(n, elem_size) size_t n; size_t elem_size;
   }
 }
 
+/*
+  Slab front end
+
+    Small requests are served from per-size-class slabs when
+    CONFIG_SYS_MALLOC_SLAB is enabled. A slab is one SLAB_PAGE_SIZE
+    page, itself allocated from the main heap, holding a struct
+    slab_page followed by equal-sized objects. Objects have no header
+    of their own: free() finds the page by rounding the pointer down
+    and checks a bitmap, covering the whole heap, of which pages are
+    slabs. Empty pages are given back to the heap, except for the last
+    one in each class.
+
+    The slabs are only used once the full malloc() is running; requests
+    made before that, and aligned requests, go straight to the chunk
+    allocator above.
+*/
+
+#if CONFIG_IS_ENABLED(SYS_MALLOC_SLAB)
+
+#define SLAB_PAGE_SIZE	SZ_4K
+#define SLAB_HDR_SIZE	\
+	((sizeof(struct slab_page) + MALLOC_ALIGN_MASK) & ~MALLOC_ALIGN_MASK)
+
+struct slab_class;
+
+/**
+ * struct slab_page - header at the start of each slab page
+ *
+ * @next: next page of this class with free objects
+ * @prev: previous page of this class with free objects
+ * @cls: size class the objects belong to
+ * @free: first free object, each of which holds a pointer to the next
+ * @inuse: number of objects allocated from this page
+ */
+struct slab_page {
+	struct slab_page *next;
+	struct slab_page *prev;
+	struct slab_class *cls;
+	void *free;
+	uint inuse;
+};
+
+/**
+ * struct slab_class - a slab size class
+ *
+ * @size: object size in bytes
+ * @per_page: number of objects in each page
+ * @partial: pages with at least one free object
+ * @pages: number of pages allocated to this class
+ * @inuse: number of objects allocated
+ * @peak: highest value of @inuse
+ * @allocs: total number of objects allocated
+ */
+struct slab_class {
+	uint size;
+	uint per_page;
+	struct slab_page *partial;
+	ulong pages;
+	ulong inuse;
+	ulong peak;
+	ulong allocs;
+};
+
+/* Sizes chosen to fit the driver-model structures and small strings */
+static struct slab_class slab_classes[] = {
+	{ .size = 16 }, { .size = 32 }, { .size = 48 }, { .size = 64 },
+	{ .size = 96 }, { .size = 128 }, { .size = 192 }, { .size = 256 },
+};
+
+#define SLAB_MAX_SIZE	256
+
+static ulong *slab_map;		/* one bit per heap page, set for slabs */
+static ulong slab_map_base;	/* address of the page for bit 0 */
+static ulong slab_map_pages;	/* number of bits in slab_map */
+static bool slab_failed;	/* the bitmap could not be allocated */
+
+static void slab_reset(void)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(slab_classes); i++) {
+		struct slab_class *cls = &slab_classes[i];
+
+		cls->partial = NULL;
+		cls->pages = 0;
+		cls->inuse = 0;
+		cls->peak = 0;
+		cls->allocs = 0;
+	}
+	slab_map = NULL;
+	slab_failed = false;
+}
+
+static int slab_init(void)
+{
+	size_t len;
+	int i;
+
+	if (slab_failed || (!mem_malloc_start && !mem_malloc_end))
+		return -1;
+	slab_map_base = mem_malloc_start & ~(SLAB_PAGE_SIZE - 1);
+	slab_map_pages = (mem_malloc_end - slab_map_base + SLAB_PAGE_SIZE - 1) /
+			 SLAB_PAGE_SIZE;
+	len = BITS_TO_LONGS(slab_map_pages) * sizeof(ulong);
+	slab_map = mALLOc_core(len);
+	if (!slab_map) {
+		slab_failed = true;
+		return -1;
+	}
+	memset(slab_map, '\0', len);
+	for (i = 0; i < ARRAY_SIZE(slab_classes); i++)
+		slab_classes[i].per_page = (SLAB_PAGE_SIZE - SLAB_HDR_SIZE) /
+					   slab_classes[i].size;
+
+	return 0;
+}
+
+/* Return the slab page holding @mem, or NULL if it is not a slab object */
+static struct slab_page *slab_page_of(Void_t *mem)
+{
+	ulong addr = (ulong)mem;
+	ulong idx;
+
+	if (!slab_map || addr < slab_map_base)
+		return NULL;
+	idx = (addr - slab_map_base) / SLAB_PAGE_SIZE;
+	if (idx >= slab_map_pages ||
+	    !(slab_map[idx / BITS_PER_LONG] & BIT(idx % BITS_PER_LONG)))
+		return NULL;
+
+	return (struct slab_page *)(addr & ~(SLAB_PAGE_SIZE - 1));
+}
+
+static void slab_mark(struct slab_page *page, bool set)
+{
+	ulong idx = ((ulong)page - slab_map_base) / SLAB_PAGE_SIZE;
+
+	if (set)
+		slab_map[idx / BITS_PER_LONG] |= BIT(idx % BITS_PER_LONG);
+	else
+		slab_map[idx / BITS_PER_LONG] &= ~BIT(idx % BITS_PER_LONG);
+}
+
+static void slab_link(struct slab_class *cls, struct slab_page *page)
+{
+	page->prev = NULL;
+	page->next = cls->partial;
+	if (page->next)
+		page->next->prev = page;
+	cls->partial = page;
+}
+
+static void slab_unlink(struct slab_class *cls, struct slab_page *page)
+{
+	if (page->prev)
+		page->prev->next = page->next;
+	else
+		cls->partial = page->next;
+	if (page->next)
+		page->next->prev = page->prev;
+}
+
+static struct slab_page *slab_new_page(struct slab_class *cls)
+{
+	struct slab_page *page;
+	char *obj;
+	uint i;
+
+	page = mEMALIGn_core(SLAB_PAGE_SIZE, SLAB_PAGE_SIZE);
+	if (!page)
+		return NULL;
+	page->cls = cls;
+	page->inuse = 0;
+	page->free = NULL;
+
+	/* Thread the free list so that objects are handed out in order */
+	obj = (char *)page + SLAB_HDR_SIZE;
+	for (i = cls->per_page; i--;) {
+		Void_t **ptr = (Void_t **)(obj + i * cls->size);
+
+		*ptr = page->free;
+		page->free = ptr;
+	}
+	slab_mark(page, true);
+	slab_link(cls, page);
+	cls->pages++;
+
+	return page;
+}
+
+static Void_t *slab_alloc(size_t bytes)
+{
+	struct slab_class *cls;
+	struct slab_page *page;
+	Void_t **obj;
+
+	if (!bytes || bytes > SLAB_MAX_SIZE)
+		return NULL;
+#if CONFIG_IS_ENABLED(SYS_MALLOC_F)
+	if (!(gd->flags & GD_FLG_FULL_MALLOC_INIT))
+		return NULL;
+#endif
+	/* Let the chunk allocator do the failure injection */
+	if (CONFIG_IS_ENABLED(UNIT_TEST) && malloc_testing)
+		return NULL;
+	if (!slab_map && slab_init())
+		return NULL;
+
+	for (cls = slab_classes; cls->size < bytes; cls++)
+		;
+	page = cls->partial;
+	if (!page) {
+		page = slab_new_page(cls);
+		if (!page)
+			return NULL;
+	}
+
+	obj = page->free;
+	page->free = *obj;
+	if (++page->inuse == cls->per_page)
+		slab_unlink(cls, page);
+	if (++cls->inuse > cls->peak)
+		cls->peak = cls->inuse;
+	cls->allocs++;
+
+	return obj;
+}
+
+static inline uint slab_size(struct slab_page *page)
+{
+	return page->cls->size;
+}
+
+static void slab_release_page(struct slab_class *cls, struct slab_page *page)
+{
+	slab_unlink(cls, page);
+	slab_mark(page, false);
+	cls->pages--;
+	fREe_core(page);
+}
+
+static void slab_free(struct slab_page *page, Void_t *mem)
+{
+	struct slab_class *cls = page->cls;
+	struct slab_page *spare;
+
+	*(Void_t **)mem = page->free;
+	page->free = mem;
+	if (page->inuse-- == cls->per_page) {
+		slab_link(cls, page);
+		/*
+		 * An empty page is only kept while it is the only one with
+		 * room, so drop it now that this page has some
+		 */
+		spare = page->next;
+		if (spare && !spare->inuse)
+			slab_release_page(cls, spare);
+	}
+	cls->inuse--;
+
+	/* Keep one empty page per class to avoid thrashing */
+	if (!page->inuse && (page->next || page->prev))
+		slab_release_page(cls, page);
+}
+
+#else
+static inline void slab_reset(void) {}
+static inline struct slab_page *slab_page_of(Void_t *mem) { return NULL; }
+static inline Void_t *slab_alloc(size_t bytes) { return NULL; }
+static inline void slab_free(struct slab_page *page, Void_t *mem) {}
+static inline uint slab_size(struct slab_page *page) { return 0; }
+#endif /* SYS_MALLOC_SLAB */
+
+/*
+  Statistics
+
+    With CONFIG_SYS_MALLOC_STATS the entry points below count calls and
+    the timer ticks spent inside the allocator. Nested calls, made while
+    the timer driver is being probed, are counted but not timed again.
+*/
+
+#if CONFIG_IS_ENABLED(SYS_MALLOC_STATS)
+static ulong malloc_count;
+static ulong free_count;
+static u64 malloc_ticks;
+static int malloc_depth;
+
+static u64 malloc_stats_start(void)
+{
+	if (malloc_depth++)
+		return 0;
+	/* Do not probe the timer from inside malloc() */
+	if (CONFIG_IS_ENABLED(TIMER) && !IS_ENABLED(CONFIG_TIMER_EARLY) &&
+	    !gd->timer)
+		return 0;
+
+	return get_ticks();
+}
+
+static void malloc_stats_end(u64 start, bool is_free)
+{
+	if (!--malloc_depth && start)
+		malloc_ticks += get_ticks() - start;
+	if (is_free)
+		free_count++;
+	else
+		malloc_count++;
+}
+#else
+static inline u64 malloc_stats_start(void) { return 0; }
+static inline void malloc_stats_end(u64 start, bool is_free) {}
+#endif
+
+/*
+  Entry points, which place the slabs and statistics in front of the
+  chunk allocator
+*/
+
+STATIC_IF_MCHECK
+Void_t *mALLOc_impl(size_t bytes)
+{
+	u64 start = malloc_stats_start();
+	Void_t *mem;
+
+	mem = slab_alloc(bytes);
+	if (!mem)
+		mem = mALLOc_core(bytes);
+	malloc_stats_end(start, false);
+
+	return mem;
+}
+
+STATIC_IF_MCHECK
+void fREe_impl(Void_t *mem)
+{
+	u64 start = malloc_stats_start();
+	struct slab_page *page;
+
+	page = slab_page_of(mem);
+	if (page)
+		slab_free(page, mem);
+	else
+		fREe_core(mem);
+	malloc_stats_end(start, true);
+}
+
+STATIC_IF_MCHECK
+Void_t *rEALLOc_impl(Void_t *oldmem, size_t bytes)
+{
+	u64 start = malloc_stats_start();
+	struct slab_page *page;
+	Void_t *mem;
+
+	page = slab_page_of(oldmem);
+	if (!oldmem) {
+		mem = slab_alloc(bytes);
+		if (!mem)
+			mem = mALLOc_core(bytes);
+	} else if (!page) {
+		mem = rEALLOc_core(oldmem, bytes);
+	} else if (bytes && bytes <= slab_size(page)) {
+		mem = oldmem;
+	} else {
+		/* Move to a bigger class, or out of the slabs */
+		mem = slab_alloc(bytes);
+		if (!mem)
+			mem = mALLOc_core(bytes);
+		if (mem) {
+			memcpy(mem, oldmem,
+			       min_t(size_t, bytes, slab_size(page)));
+			slab_free(page, oldmem);
+		}
+	}
+	malloc_stats_end(start, false);
+
+	return mem;
+}
+
+STATIC_IF_MCHECK
+Void_t *mEMALIGn_impl(size_t alignment, size_t bytes)
+{
+	u64 start = malloc_stats_start();
+	Void_t *mem = NULL;
+
+	if (alignment <= MALLOC_ALIGNMENT)
+		mem = slab_alloc(bytes);
+	if (!mem)
+		mem = mEMALIGn_core(alignment, bytes);
+	malloc_stats_end(start, false);
+
+	return mem;
+}
+
+STATIC_IF_MCHECK
+Void_t *cALLOc_impl(size_t n, size_t elem_size)
+{
+	u64 start;
+	Void_t *mem;
+
+	/* Reject requests whose size does not fit in size_t */
+	if (elem_size && n > SIZE_MAX / elem_size)
+		return NULL;
+
+	start = malloc_stats_start();
+	mem = slab_alloc(n * elem_size);
+	if (mem)
+		memset(mem, '\0', n * elem_size);
+	else
+		mem = cALLOc_core(n, elem_size);
+	malloc_stats_end(start, false);
+
+	return mem;
+}
+
 /*
 
   cfree just calls free. It is needed/defined on some systems
@@ -2409,8 +2831,13 @@ size_t malloc_usable_size(mem) Void_t* mem;
 #endif
 {
   mchunkptr p;
+  struct slab_page *page;
+
   if (mem == NULL)
     return 0;
+  page = slab_page_of(mem);
+  if (page)
+    return slab_size(page);
   else
   {
     p = mem2chunk(mem);
@@ -2503,6 +2930,53 @@ void malloc_stats(void)
 }
 #endif	/* DEBUG */
 
+#if CONFIG_IS_ENABLED(SYS_MALLOC_STATS)
+void malloc_get_info(struct malloc_info *info)
+{
+	INTERNAL_SIZE_T avail = 0;
+	mbinptr b;
+	mchunkptr p;
+	int i;
+
+	if (sbrked_mem) {
+		avail = chunksize(top);
+		for (i = 1; i < NAV; ++i) {
+			b = bin_at(i);
+			for (p = last(b); p != b; p = p->bk)
+				avail += chunksize(p);
+		}
+	}
+
+	info->total_bytes = mem_malloc_end - mem_malloc_start;
+	info->in_use_bytes = sbrked_mem - avail;
+	info->max_claimed_bytes = max_sbrked_mem;
+	info->malloc_count = malloc_count;
+	info->free_count = free_count;
+	info->time_us = lldiv(malloc_ticks * 1000000, get_tbclk());
+}
+
+int malloc_get_slab_info(uint idx, struct malloc_slab_info *info)
+{
+#if CONFIG_IS_ENABLED(SYS_MALLOC_SLAB)
+	struct slab_class *cls;
+
+	if (idx >= ARRAY_SIZE(slab_classes))
+		return -ENOENT;
+	cls = &slab_classes[idx];
+	info->size = cls->size;
+	info->per_page = cls->per_page;
+	info->pages = cls->pages;
+	info->in_use = cls->inuse;
+	info->peak = cls->peak;
+	info->allocs = cls->allocs;
+
+	return 0;
+#else
+	return -ENOENT;
+#endif
+}
+#endif
+
 /*
   mallinfo returns a copy of updated current mallinfo.
 */
@@ -12,6 +12,7 @@
 #include <malloc.h>
 #include <asm/global_data.h>
 #include <dm/uclass.h>
+#include <linux/ctype.h>
 
 DECLARE_GLOBAL_DATA_PTR;
 
@@ -192,6 +193,79 @@ static bool log_passes_filters(struct log_device *ldev, struct log_rec *rec)
 	return false;
 }
 
+/**
+ * log_fmt_cont() - Check whether a message leaves its line open
+ *
+ * This works from the format string, without formatting the message. If the
+ * message ends with a string or character argument, that argument is checked
+ * when it is the only one; otherwise the message is taken to end its line.
+ *
+ * @fmt:	Format string of the message
+ * @args:	Arguments for @fmt
+ * Return:	true if the message does not end with a newline
+ */
+static bool log_fmt_cont(const char *fmt, va_list args)
+{
+	const char *p, *spec = NULL, *tail = fmt;
+	int len = strlen(fmt);
+	int count = 0;
+	va_list copy;
+	bool cont;
+
+	if (!len || fmt[len - 1] == '\n')
+		return false;
+
+	/* Find the last conversion and the text after it */
+	for (p = fmt; (p = strchr(p, '%')); ) {
+		if (p[1] == '%') {
+			p += 2;
+			continue;
+		}
+		spec = p++;
+		count++;
+		p += strspn(p, "-+ #0123456789.*hlLqzjt");
+		if (!*p)
+			return true;
+		if (*p == 'p') {
+			while (isalnum(p[1]))
+				p++;
+		}
+		tail = ++p;
+	}
+	if (*tail || !spec)
+		return true;
+
+	switch (tail[-1]) {
+	case 's':
+	case 'c':
+		break;
+	default:
+		/* Numbers and pointers never end with a newline */
+		return true;
+	}
+	/* Only a plain conversion of the sole argument can be checked */
+	if (count != 1)
+		return false;
+	for (p = spec + 1; p < tail; p++) {
+		if (strchr(".*l", *p))
+			return false;
+	}
+
+	va_copy(copy, args);
+	if (tail[-1] == 'c') {
+		cont = va_arg(copy, int) != '\n';
+	} else {
+		const char *str = va_arg(copy, const char *);
+
+		/* A NULL string is shown as "<NULL>" */
+		len = str ? strlen(str) : 1;
+		cont = len && (!str || str[len - 1] != '\n');
+	}
+	va_end(copy);
+
+	return cont;
+}
+
 /**
  * log_dispatch() - Send a log record to all log devices for processing
  *
@@ -207,6 +281,7 @@ static int log_dispatch(struct log_rec *rec, const char *fmt, va_list args)
 {
 	struct log_device *ldev;
 	char buf[CONFIG_SYS_CBSIZE];
+	bool unformatted = false;
 
 	/*
 	 * When a log driver writes messages (e.g. via the network stack) this
@@ -221,6 +296,16 @@ static int log_dispatch(struct log_rec *rec, const char *fmt, va_list args)
 	list_for_each_entry(ldev, &gd->log_head, sibling_node) {
 		if ((ldev->flags & LOGDF_ENABLE) &&
 		    log_passes_filters(ldev, rec)) {
+			if (ldev->drv->emit_fmt) {
+				va_list copy;
+
+				/* Leave args intact for other drivers */
+				va_copy(copy, args);
+				ldev->drv->emit_fmt(ldev, rec, fmt, copy);
+				va_end(copy);
+				unformatted = true;
+				continue;
+			}
 			if (!rec->msg) {
 				int len;
 
@@ -231,6 +316,10 @@ static int log_dispatch(struct log_rec *rec, const char *fmt, va_list args)
 			ldev->drv->emit(ldev, rec);
 		}
 	}
+
+	/* Without the message, work out from the format whether it ends */
+	if (unformatted && !rec->msg)
+		gd->log_cont = log_fmt_cont(fmt, args);
 	gd->processing_msg = false;
 	return 0;
 }
@@ -0,0 +1,654 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Log driver which keeps records in a RAM ring, formatting them only when
+ * they are read out
+ *
+ * Only the format string and the raw arguments are stored, so recording a
+ * message costs little more than copying its arguments. Strings, including
+ * the file and function names, are copied since they may not exist later.
+ * Pointer extensions such as %pU are formatted straight away, since the data
+ * they point to may change.
+ */
+
+#include <common.h>
+#include <log.h>
+#include <malloc.h>
+#include <vsprintf.h>
+#include <asm/global_data.h>
+#include <linux/ctype.h>
+#include <linux/kernel.h>
+
+DECLARE_GLOBAL_DATA_PTR;
+
+/* Space for the arguments of one record */
+#define LOG_RING_MAX_ARGS	256
+
+/* Space for each of the file and function names of one record */
+#define LOG_RING_MAX_NAME	80
+
+/* Longest conversion specifier, e.g. "%-*.*llx" with the stars filled in */
+#define LOG_RING_MAX_SPEC	32
+
+/**
+ * enum log_ring_arg_t - type of argument used by a conversion specifier
+ *
+ * @LOGRA_INT: int, or smaller
+ * @LOGRA_LONG: long
+ * @LOGRA_LLONG: long long
+ * @LOGRA_SIZE: size_t or ptrdiff_t
+ * @LOGRA_PTR: pointer which is printed as an address
+ * @LOGRA_STR: string, which is copied into the ring
+ * @LOGRA_PEXT: pointer with an extension, or wide string, which is formatted
+ *	into a string at once
+ */
+enum log_ring_arg_t {
+	LOGRA_INT,
+	LOGRA_LONG,
+	LOGRA_LLONG,
+	LOGRA_SIZE,
+	LOGRA_PTR,
+	LOGRA_STR,
+	LOGRA_PEXT,
+};
+
+/**
+ * struct log_ring_spec - a conversion specifier in a format string
+ *
+ * @start: Pointer to the '%'
+ * @len: Length of the specifier, including the '%'
+ * @stars: Number of '*' in the specifier, each taking an int argument
+ * @type: Type of the argument
+ */
+struct log_ring_spec {
+	const char *start;
+	int len;
+	int stars;
+	enum log_ring_arg_t type;
+};
+
+/**
+ * struct log_ring_rec - header of a record in the ring
+ *
+ * The file and function names follow this header, then the arguments.
+ * Records are aligned to a long.
+ *
+ * @size: Size of the record in bytes, including this header, or 0 to mark
+ *	that the next record is at the start of the ring
+ * @line: Line number where the record was generated
+ * @cat: Category (enum log_category_t)
+ * @level: Level (enum log_level_t)
+ * @flags: Flags (enum log_rec_flags)
+ * @file: Name of file where the record was generated, copied into the record
+ * @func: Function where the record was generated, copied into the record
+ * @fmt: Format string for the message
+ */
+struct log_ring_rec {
+	u16 size;
+	u16 line;
+	u16 cat;
+	u8 level;
+	u8 flags;
+	const char *file;
+	const char *func;
+	const char *fmt;
+};
+
+/**
+ * struct log_ring - the ring of records
+ *
+ * @buf: Ring buffer, or NULL if not allocated yet
+ * @size: Size of @buf in bytes
+ * @head: Offset where the next record is written
+ * @tail: Offset of the oldest record
+ * @count: Number of records in the ring
+ */
+struct log_ring {
+	char *buf;
+	uint size;
+	uint head;
+	uint tail;
+	uint count;
+};
+
+static struct log_ring ring;
+
+/**
+ * log_ring_next_spec() - find the next conversion which takes arguments
+ *
+ * @fmt: Format string to search
+ * @spec: Returns information about the conversion
+ * Return: pointer to the rest of the format string after the conversion, or
+ * NULL if there are no more
+ */
+static const char *log_ring_next_spec(const char *fmt,
+				      struct log_ring_spec *spec)
+{
+	const char *p;
+	int longs = 0;
+
+	for (p = fmt; (p = strchr(p, '%')); p += 2) {
+		if (p[1] != '%')
+			break;
+	}
+	if (!p)
+		return NULL;
+	spec->start = p++;
+	spec->stars = 0;
+
+	while (*p && strchr("-+ #0", *p))
+		p++;
+	if (*p == '*') {
+		spec->stars++;
+		p++;
+	}
+	while (isdigit(*p))
+		p++;
+	if (*p == '.') {
+		p++;
+		if (*p == '*') {
+			spec->stars++;
+			p++;
+		}
+		while (isdigit(*p))
+			p++;
+	}
+
+	spec->type = LOGRA_INT;
+	for (; *p && strchr("hlLqzjt", *p); p++) {
+		if (*p == 'l')
+			longs++;
+		else if (*p == 'L' || *p == 'q' || *p == 'j')
+			longs = 2;
+		else if (*p == 'z' || *p == 't')
+			spec->type = LOGRA_SIZE;
+	}
+	if (longs == 1)
+		spec->type = LOGRA_LONG;
+	else if (longs > 1)
+		spec->type = LOGRA_LLONG;
+
+	switch (*p) {
+	case '\0':
+		return NULL;
+	case 's':
+		/* Wide strings are formatted at once */
+		spec->type = longs ? LOGRA_PEXT : LOGRA_STR;
+		break;
+	case 'p':
+		spec->type = LOGRA_PTR;
+		if (isalnum(p[1])) {
+			spec->type = LOGRA_PEXT;
+			while (isalnum(p[1]))
+				p++;
+		}
+		break;
+	}
+	p++;
+	spec->len = p - spec->start;
+
+	return p;
+}
+
+/**
+ * log_ring_spec_str() - make a conversion specifier with its widths filled in
+ *
+ * @spec: Conversion to copy
+ * @stars: Value of each '*' in the conversion
+ * @out: Returns the specifier as a nul-terminated string
+ */
+static void log_ring_spec_str(const struct log_ring_spec *spec,
+			      const int *stars, char out[LOG_RING_MAX_SPEC])
+{
+	char *end = out + LOG_RING_MAX_SPEC - 1;
+	int i;
+
+	for (i = 0; i < spec->len && out < end; i++) {
+		if (spec->start[i] == '*')
+			out += scnprintf(out, end - out + 1, "%d", *stars++);
+		else
+			*out++ = spec->start[i];
+	}
+	*out = '\0';
+}
+
+static bool log_ring_put(char **posp, char *end, const void *val, int len)
+{
+	if (end - *posp < len)
+		return false;
+	memcpy(*posp, val, len);
+	*posp += len;
+
+	return true;
+}
+
+static bool log_ring_put_str(char **posp, char *end, const char *str)
+{
+	int len;
+
+	if (*posp == end)
+		return false;
+	len = min_t(int, strlen(str), end - *posp - 1);
+	memcpy(*posp, str, len);
+	(*posp)[len] = '\0';
+	*posp += len + 1;
+
+	return true;
+}
+
+/**
+ * log_ring_pack() - store the arguments of a message
+ *
+ * If the arguments do not fit, strings are truncated and the remaining
+ * arguments are dropped
+ *
+ * @buf: Buffer for the arguments
+ * @size: Size of @buf
+ * @fmt: Format string
+ * @args: Arguments for @fmt
+ * Return: number of bytes used in @buf
+ */
+static int log_ring_pack(char *buf, int size, const char *fmt, va_list args)
+{
+	char spec_str[LOG_RING_MAX_SPEC], str[LOG_RING_MAX_ARGS];
+	char *pos = buf, *end = buf + size;
+	struct log_ring_spec spec;
+	bool ok = true;
+
+	while (ok && (fmt = log_ring_next_spec(fmt, &spec))) {
+		int stars[2];
+		int i;
+
+		for (i = 0; i < spec.stars; i++) {
+			stars[i] = va_arg(args, int);
+			ok &= log_ring_put(&pos, end, &stars[i], sizeof(int));
+		}
+		switch (spec.type) {
+		case LOGRA_INT: {
+			int val = va_arg(args, int);
+
+			ok &= log_ring_put(&pos, end, &val, sizeof(val));
+			break;
+		}
+		case LOGRA_LONG: {
+			long val = va_arg(args, long);
+
+			ok &= log_ring_put(&pos, end, &val, sizeof(val));
+			break;
+		}
+		case LOGRA_LLONG: {
+			long long val = va_arg(args, long long);
+
+			ok &= log_ring_put(&pos, end, &val, sizeof(val));
+			break;
+		}
+		case LOGRA_SIZE: {
+			size_t val = va_arg(args, size_t);
+
+			ok &= log_ring_put(&pos, end, &val, sizeof(val));
+			break;
+		}
+		case LOGRA_PTR: {
+			void *val = va_arg(args, void *);
+
+			ok &= log_ring_put(&pos, end, &val, sizeof(val));
+			break;
+		}
+		case LOGRA_STR: {
+			const char *val = va_arg(args, const char *);
+
+			if (!val)
+				val = "<NULL>";
+			ok &= log_ring_put_str(&pos, end, val);
+			break;
+		}
+		case LOGRA_PEXT: {
+			void *val = va_arg(args, void *);
+
+			log_ring_spec_str(&spec, stars, spec_str);
+			snprintf(str, sizeof(str), spec_str, val);
+			ok &= log_ring_put_str(&pos, end, str);
+			break;
+		}
+		}
+	}
+
+	return pos - buf;
+}
+
+static bool log_ring_get(const char **posp, const char *end, void *val,
+			 int len)
+{
+	if (end - *posp < len)
+		return false;
+	memcpy(val, *posp, len);
+	*posp += len;
+
+	return true;
+}
+
+/**
+ * log_ring_add_text() - add literal text from a format string
+ *
+ * @out: Place to add the text
+ * @end: End of the output buffer
+ * @text: Text to add, in which "%%" becomes "%"
+ * @len: Number of characters of @text to use
+ * Return: pointer to the nul terminator after the text
+ */
+static char *log_ring_add_text(char *out, char *end, const char *text,
+			       int len)
+{
+	int i;
+
+	for (i = 0; i < len && out < end - 1; i++) {
+		if (text[i] == '%' && text[i + 1] == '%')
+			i++;
+		*out++ = text[i];
+	}
+	*out = '\0';
+
+	return out;
+}
+
+static const char *log_ring_get_str(const char **posp, const char *end)
+{
+	const char *str = *posp;
+	int len;
+
+	len = strnlen(str, end - str);
+	if (len == end - str)
+		return NULL;
+	*posp += len + 1;
+
+	return str;
+}
+
+/**
+ * log_ring_format_msg() - format the message of a record
+ *
+ * @rec: Record to format
+ * @buf: Buffer for the message
+ * @size: Size of @buf
+ * Return: number of characters written to @buf, not including the nul
+ */
+static int log_ring_format_msg(const struct log_ring_rec *rec, char *buf,
+			       int size)
+{
+	const char *pos = rec->func + strlen(rec->func) + 1;
+	const char *end = (const char *)rec + rec->size;
+	const char *fmt = rec->fmt, *next;
+	char spec_str[LOG_RING_MAX_SPEC];
+	struct log_ring_spec spec;
+	char *out = buf;
+
+	while ((next = log_ring_next_spec(fmt, &spec))) {
+		int stars[2];
+		bool ok = true;
+		int i;
+
+		out = log_ring_add_text(out, buf + size, fmt,
+					spec.start - fmt);
+		for (i = 0; i < spec.stars; i++)
+			ok &= log_ring_get(&pos, end, &stars[i], sizeof(int));
+		if (!ok)
+			break;
+		log_ring_spec_str(&spec, stars, spec_str);
+
+		switch (spec.type) {
+		case LOGRA_INT: {
+			int val;
+
+			ok = log_ring_get(&pos, end, &val, sizeof(val));
+			if (ok)
+				out += scnprintf(out, buf + size - out,
+						 spec_str, val);
+			break;
+		}
+		case LOGRA_LONG: {
+			long val;
+
+			ok = log_ring_get(&pos, end, &val, sizeof(val));
+			if (ok)
+				out += scnprintf(out, buf + size - out,
+						 spec_str, val);
+			break;
+		}
+		case LOGRA_LLONG: {
+			long long val;
+
+			ok = log_ring_get(&pos, end, &val, sizeof(val));
+			if (ok)
+				out += scnprintf(out, buf + size - out,
+						 spec_str, val);
+			break;
+		}
+		case LOGRA_SIZE: {
+			size_t val;
+
+			ok = log_ring_get(&pos, end, &val, sizeof(val));
+			if (ok)
+				out += scnprintf(out, buf + size - out,
+						 spec_str, val);
+			break;
+		}
+		case LOGRA_PTR: {
+			void *val;
+
+			ok = log_ring_get(&pos, end, &val, sizeof(val));
+			if (ok)
+				out += scnprintf(out, buf + size - out,
+						 spec_str, val);
+			break;
+		}
+		case LOGRA_STR:
+		case LOGRA_PEXT: {
+			const char *val = log_ring_get_str(&pos, end);
+
+			ok = val;
+			if (!ok)
+				break;
+			if (spec.type == LOGRA_PEXT)
+				strcpy(spec_str, "%s");
+			out += scnprintf(out, buf + size - out, spec_str, val);
+			break;
+		}
+		}
+		if (!ok)
+			break;
+		fmt = next;
+	}
+
+	/* Show the rest, or mark where arguments were dropped */
+	if (next)
+		out += scnprintf(out, buf + size - out, "...\n");
+	else
+		out = log_ring_add_text(out, buf + size, fmt, strlen(fmt));
+
+	return out - buf;
+}
+
+/**
+ * log_ring_format() - format a record in the same way as the console driver
+ *
+ * @rec: Record to format
+ * @buf: Buffer for the text
+ * @size: Size of @buf
+ * Return: number of characters written to @buf, not including the nul
+ */
+static int log_ring_format(const struct log_ring_rec *rec, char *buf,
+			   int size)
+{
+	int fmt = gd->log_fmt;
+	char *out = buf;
+
+	*buf = '\0';
+
+	if (!(rec->flags & LOGRECF_CONT) && fmt != BIT(LOGF_MSG)) {
+		if (fmt & BIT(LOGF_LEVEL))
+			out += scnprintf(out, buf + size - out, "%s.",
+					 log_get_level_name(rec->level));
+		if (fmt & BIT(LOGF_CAT))
+			out += scnprintf(out, buf + size - out, "%s,",
+					 log_get_cat_name(rec->cat));
+		if (fmt & BIT(LOGF_FILE))
+			out += scnprintf(out, buf + size - out, "%s:",
+					 rec->file);
+		if (fmt & BIT(LOGF_LINE))
+			out += scnprintf(out, buf + size - out, "%d-",
+					 rec->line);
+		if (fmt & BIT(LOGF_FUNC))
+			out += scnprintf(out, buf + size - out, "%*s()",
+					 CONFIG_LOGF_FUNC_PAD, rec->func);
+		if (fmt & BIT(LOGF_MSG))
+			out += scnprintf(out, buf + size - out, " ");
+	}
+	if (fmt & BIT(LOGF_MSG))
+		out += log_ring_format_msg(rec, out, buf + size - out);
+
+	return out - buf;
+}
+
+/**
+ * log_ring_rec_at() - get the record at an offset, following any wrap marker
+ *
+ * @offp: Offset of the record, updated to 0 if the ring wraps there
+ * Return: pointer to the record
+ */
+static struct log_ring_rec *log_ring_rec_at(uint *offp)
+{
+	struct log_ring_rec *rec;
+
+	rec = (struct log_ring_rec *)(ring.buf + *offp);
+	if (*offp == ring.size || !rec->size) {
+		*offp = 0;
+		rec = (struct log_ring_rec *)ring.buf;
+	}
+
+	return rec;
+}
+
+/**
+ * log_ring_alloc() - make space for a new record, dropping old ones
+ *
+ * @size: Size of the record, which must be aligned and fit in the ring
+ * Return: pointer to the new record
+ */
+static struct log_ring_rec *log_ring_alloc(uint size)
+{
+	struct log_ring_rec *rec;
+
+	while (ring.count) {
+		if (ring.head > ring.tail) {
+			if (ring.head + size <= ring.size)
+				break;
+
+			/* Mark the unused end of the ring and wrap */
+			rec = (struct log_ring_rec *)(ring.buf + ring.head);
+			if (ring.head < ring.size)
+				rec->size = 0;
+			ring.head = 0;
+			continue;
+		}
+		if (ring.head + size <= ring.tail)
+			break;
+
+		/* Drop the oldest record */
+		rec = log_ring_rec_at(&ring.tail);
+		ring.tail += rec->size;
+		ring.count--;
+	}
+	if (!ring.count)
+		ring.head = ring.tail = 0;
+
+	rec = (struct log_ring_rec *)(ring.buf + ring.head);
+	ring.head += size;
+	ring.count++;
+
+	return rec;
+}
+
+static int log_ring_emit_fmt(struct log_device *ldev, struct log_rec *rec,
+			     const char *fmt, va_list args)
+{
+	char data[2 * LOG_RING_MAX_NAME + LOG_RING_MAX_ARGS];
+	char *pos = data, *func;
+	struct log_ring_rec *hdr;
+	uint size;
+	int len;
+
+	/* The ring lives in the heap, which is not set up until relocation */
+	if (!(gd->flags & GD_FLG_FULL_MALLOC_INIT))
+		return -ENOSYS;
+	if (!ring.buf) {
+		ring.buf = malloc(CONFIG_LOG_RING_SIZE);
+		if (!ring.buf)
+			return -ENOMEM;
+		ring.size = ALIGN_DOWN(CONFIG_LOG_RING_SIZE, sizeof(long));
+	}
+
+	/* The names may be in memory which is freed once this returns */
+	log_ring_put_str(&pos, pos + LOG_RING_MAX_NAME, rec->file ?: "");
+	func = pos;
+	log_ring_put_str(&pos, pos + LOG_RING_MAX_NAME, rec->func ?: "");
+	len = pos - data;
+	len += log_ring_pack(pos, data + sizeof(data) - pos, fmt, args);
+	size = ALIGN(sizeof(*hdr) + len, sizeof(long));
+	hdr = log_ring_alloc(size);
+	hdr->size = size;
+	hdr->line = rec->line;
+	hdr->cat = rec->cat;
+	hdr->level = rec->level;
+	hdr->flags = rec->flags;
+	hdr->fmt = fmt;
+	memcpy(hdr + 1, data, len);
+	hdr->file = (const char *)(hdr + 1);
+	hdr->func = hdr->file + (func - data);
+
+	return 0;
+}
+
+int log_ring_dump(char *buf, int size)
+{
+	char line[CONFIG_SYS_CBSIZE];
+	uint tail = ring.tail;
+	int total = 0;
+	uint i;
+
+	for (i = 0; i < ring.count; i++) {
+		struct log_ring_rec *rec;
+		int len;
+
+		rec = log_ring_rec_at(&tail);
+		tail += rec->size;
+
+		len = log_ring_format(rec, line, sizeof(line));
+		if (!buf) {
+			puts(line);
+		} else {
+			if (total + len >= size)
+				return -ENOSPC;
+			memcpy(buf + total, line, len + 1);
+		}
+		total += len;
+	}
+	if (buf && !total) {
+		if (!size)
+			return -ENOSPC;
+		*buf = '\0';
+	}
+
+	return total;
+}
+
+void log_ring_reset(void)
+{
+	ring.head = 0;
+	ring.tail = 0;
+	ring.count = 0;
+}
+
+LOG_DRIVER(ring) = {
+	.name		= "ring",
+	.emit_fmt	= log_ring_emit_fmt,
+	.flags		= LOGDF_ENABLE,
+};
@@ -29,6 +29,7 @@
 #include <dm/ofnode.h>
 #include <linux/compiler.h>
 #include <linux/ctype.h>
+#include <linux/list.h>
 #include <linux/printk.h>
 #include <u-boot/crc.h>
 
@@ -62,6 +63,7 @@ static gpt_entry *alloc_read_gpt_entries(struct blk_desc *desc,
 static int is_pte_valid(gpt_entry * pte);
 static int find_valid_gpt(struct blk_desc *desc, gpt_header *gpt_head,
 			  gpt_entry **pgpt_pte);
+static void gpt_put_pte(gpt_entry *pte);
 
 static char *print_efiname(gpt_entry *pte)
 {
@@ -212,8 +214,8 @@ int get_disk_guid(struct blk_desc *desc, char *guid)
 	guid_bin = gpt_head->disk_guid.b;
 	uuid_bin_to_str(guid_bin, guid, UUID_STR_FORMAT_GUID);
 
-	/* Remember to free pte */
-	free(gpt_pte);
+	/* Remember to release pte */
+	gpt_put_pte(gpt_pte);
 	return 0;
 }
 
@@ -254,8 +256,8 @@ void part_print_efi(struct blk_desc *desc)
 		printf("\tguid:\t%pUl\n", uuid);
 	}
 
-	/* Remember to free pte */
-	free(gpt_pte);
+	/* Remember to release pte */
+	gpt_put_pte(gpt_pte);
 	return;
 }
 
@@ -278,7 +280,7 @@ int part_get_info_efi(struct blk_desc *desc, int part,
 	if (part > le32_to_cpu(gpt_head->num_partition_entries) ||
 	    !is_pte_valid(&gpt_pte[part - 1])) {
 		log_debug("Invalid partition number %d\n", part);
-		free(gpt_pte);
+		gpt_put_pte(gpt_pte);
 		return -EPERM;
 	}
 
@@ -307,8 +309,8 @@ int part_get_info_efi(struct blk_desc *desc, int part,
 	log_debug("start 0x" LBAF ", size 0x" LBAF ", name %s\n", info->start,
 		  info->size, info->name);
 
-	/* Remember to free pte */
-	free(gpt_pte);
+	/* Remember to release pte */
+	gpt_put_pte(gpt_pte);
 	return 0;
 }
 
@@ -1074,6 +1076,133 @@ static int is_gpt_valid(struct blk_desc *desc, u64 lba, gpt_header *pgpt_head,
 	return 1;
 }
 
+/**
+ * struct gpt_cache - A validated GPT kept for later lookups on a device
+ *
+ * The entry is only used while the block-cache generation of the device is
+ * unchanged, so writing or erasing the device, switching its hardware
+ * partition or scanning it again causes the GPT to be read and checked again.
+ *
+ * @sibling: Node in gpt_cache_list
+ * @desc: Block device the GPT was read from
+ * @gen: Block-cache generation of the device when the GPT was read
+ * @hwpart: Hardware partition selected when the GPT was read
+ * @lba: Number of blocks in the device
+ * @blksz: Block size of the device
+ * @head: GPT header, padded to @blksz
+ * @pte: Partition table entries
+ */
+struct gpt_cache {
+	struct list_head sibling;
+	struct blk_desc *desc;
+	ulong gen;
+	int hwpart;
+	lbaint_t lba;
+	ulong blksz;
+	gpt_header *head;
+	gpt_entry *pte;
+};
+
+static LIST_HEAD(gpt_cache_list);
+
+/**
+ * gpt_cache_find() - Find the cached GPT for a device
+ *
+ * @desc: Block device to look up
+ * Return: cache entry for @desc, valid or not, or NULL if none
+ */
+static struct gpt_cache *gpt_cache_find(struct blk_desc *desc)
+{
+	struct gpt_cache *gc;
+
+	list_for_each_entry(gc, &gpt_cache_list, sibling) {
+		if (gc->desc == desc)
+			return gc;
+	}
+
+	return NULL;
+}
+
+static void gpt_cache_free(struct gpt_cache *gc)
+{
+	list_del(&gc->sibling);
+	free(gc->head);
+	free(gc->pte);
+	free(gc);
+}
+
+void gpt_cache_drop(struct blk_desc *desc)
+{
+	struct gpt_cache *gc;
+
+	gc = gpt_cache_find(desc);
+	if (gc)
+		gpt_cache_free(gc);
+}
+
+/**
+ * gpt_cache_store() - Keep a validated GPT for later lookups
+ *
+ * On success the cache takes over @pte. On failure @pte is left to the
+ * caller and the cache is unchanged.
+ *
+ * @desc: Block device the GPT was read from
+ * @gc: Existing entry for @desc, or NULL to add one
+ * @gen: Block-cache generation of the device before the GPT was read
+ * @gpt_head: GPT header
+ * @pte: Partition table entries
+ * Return: 0 if OK, -ENOMEM if out of memory
+ */
+static int gpt_cache_store(struct blk_desc *desc, struct gpt_cache *gc,
+			   ulong gen, gpt_header *gpt_head, gpt_entry *pte)
+{
+	gpt_header *head;
+
+	head = malloc(desc->blksz);
+	if (!head)
+		return -ENOMEM;
+	if (!gc) {
+		gc = calloc(1, sizeof(*gc));
+		if (!gc) {
+			free(head);
+			return -ENOMEM;
+		}
+		list_add(&gc->sibling, &gpt_cache_list);
+	}
+
+	memcpy(head, gpt_head, desc->blksz);
+	free(gc->head);
+	free(gc->pte);
+	gc->desc = desc;
+	gc->gen = gen;
+	gc->hwpart = desc->hwpart;
+	gc->lba = desc->lba;
+	gc->blksz = desc->blksz;
+	gc->head = head;
+	gc->pte = pte;
+
+	return 0;
+}
+
+/**
+ * gpt_put_pte() - Release PTEs returned by find_valid_gpt()
+ *
+ * @pte: Partition table entries
+ */
+static void gpt_put_pte(gpt_entry *pte)
+{
+	struct gpt_cache *gc;
+
+	/* Entries which could not be cached belong to the caller */
+	if (CONFIG_IS_ENABLED(EFI_PARTITION_CACHE)) {
+		list_for_each_entry(gc, &gpt_cache_list, sibling) {
+			if (gc->pte == pte)
+				return;
+		}
+	}
+	free(pte);
+}
+
 /**
  * find_valid_gpt() - finds a valid GPT header and PTEs
  *
@@ -1081,13 +1210,27 @@ static int is_gpt_valid(struct blk_desc *desc, u64 lba, gpt_header *pgpt_head,
  * ptes is a PTEs ptr, filled on return.
  *
  * Description: returns 1 if found a valid gpt,  0 on error.
- * If valid, returns pointers to PTEs.
+ * If valid, returns pointers to PTEs, which must be released with
+ * gpt_put_pte().
  */
 static int find_valid_gpt(struct blk_desc *desc, gpt_header *gpt_head,
 			  gpt_entry **pgpt_pte)
 {
+	struct gpt_cache *gc = NULL;
+	ulong gen = 0;
 	int r;
 
+	if (CONFIG_IS_ENABLED(EFI_PARTITION_CACHE)) {
+		gen = blkcache_generation(desc->uclass_id, desc->devnum);
+		gc = gpt_cache_find(desc);
+		if (gc && gc->gen == gen && gc->hwpart == desc->hwpart &&
+		    gc->lba == desc->lba && gc->blksz == desc->blksz) {
+			memcpy(gpt_head, gc->head, desc->blksz);
+			*pgpt_pte = gc->pte;
+			return 1;
+		}
+	}
+
 	r = is_gpt_valid(desc, GPT_PRIMARY_PARTITION_TABLE_LBA, gpt_head,
 			 pgpt_pte);
 
@@ -1103,6 +1246,15 @@ static int find_valid_gpt(struct blk_desc *desc, gpt_header *gpt_head,
 		if (r != 2)
 			log_debug("        Using Backup GPT\n");
 	}
+
+	if (CONFIG_IS_ENABLED(EFI_PARTITION_CACHE) &&
+	    gpt_cache_store(desc, gc, gen, gpt_head, *pgpt_pte)) {
+		/* Use the table without caching it, dropping the stale one */
+		log_debug("Can't allocate GPT cache\n");
+		if (gc)
+			gpt_cache_free(gc);
+	}
+
 	return 1;
 }
 
@@ -11,6 +11,7 @@
 #include <dm.h>
 #include <log.h>
 #include <malloc.h>
+#include <memalign.h>
 #include <part.h>
 #include <dm/device-internal.h>
 #include <dm/lists.h>
@@ -428,19 +429,13 @@ static int blk_buffer_aligned(struct bounce_buffer *state)
 	return 1;	/* Default, any buffer is OK */
 }
 
-long blk_read(struct udevice *dev, lbaint_t start, lbaint_t blkcnt, void *buf)
+static long blk_read_dev(struct udevice *dev, lbaint_t start, lbaint_t blkcnt,
+			 void *buf)
 {
 	struct blk_desc *desc = dev_get_uclass_plat(dev);
 	const struct blk_ops *ops = blk_get_ops(dev);
 	ulong blks_read;
 
-	if (!ops->read)
-		return -ENOSYS;
-
-	if (blkcache_read(desc->uclass_id, desc->devnum,
-			  start, blkcnt, desc->blksz, buf))
-		return blkcnt;
-
 	if (IS_ENABLED(CONFIG_BOUNCE_BUFFER) && desc->bb) {
 		struct blk_bounce_buffer bbstate = { .dev = dev };
 		int ret;
@@ -466,6 +461,82 @@ long blk_read(struct udevice *dev, lbaint_t start, lbaint_t blkcnt, void *buf)
 	return blks_read;
 }
 
+/**
+ * blk_read_ahead() - Read blocks, along with some after them for the cache
+ *
+ * @dev: Block device to read from
+ * @start: First block to read
+ * @blkcnt: Number of blocks to read into @buf
+ * @extra: Number of blocks to read after those, which only go in the cache
+ * @buf: Buffer for the data
+ * Return: number of blocks read into @buf, or -ve on error
+ */
+static long blk_read_ahead(struct udevice *dev, lbaint_t start, lbaint_t blkcnt,
+			   lbaint_t extra, void *buf)
+{
+	struct blk_desc *desc = dev_get_uclass_plat(dev);
+	long blks_read;
+	void *tmp;
+
+	tmp = malloc_cache_aligned((blkcnt + extra) * desc->blksz);
+	if (!tmp)
+		return blk_read_dev(dev, start, blkcnt, buf);
+
+	blks_read = blk_read_dev(dev, start, blkcnt + extra, tmp);
+	if (blks_read != blkcnt + extra) {
+		/* Perhaps something is wrong with the extra blocks */
+		free(tmp);
+		return blk_read_dev(dev, start, blkcnt, buf);
+	}
+	memcpy(buf, tmp, blkcnt * desc->blksz);
+	free(tmp);
+
+	return blkcnt;
+}
+
+long blk_read(struct udevice *dev, lbaint_t start, lbaint_t blkcnt, void *buf)
+{
+	struct blk_desc *desc = dev_get_uclass_plat(dev);
+	const struct blk_ops *ops = blk_get_ops(dev);
+	lbaint_t done, cnt, miss, extra;
+	long blks_read;
+
+	if (!ops->read)
+		return -ENOSYS;
+
+	/*
+	 * Take what we can from the cache, reading only the parts which are
+	 * missing from the device
+	 */
+	for (done = 0; done < blkcnt; done += cnt) {
+		lbaint_t blk = start + done;
+		void *ptr = buf + done * desc->blksz;
+
+		cnt = blkcache_read(desc->uclass_id, desc->devnum, blk,
+				    blkcnt - done, desc->blksz, ptr, &miss);
+		if (cnt)
+			continue;
+
+		cnt = miss;
+		extra = blkcache_readahead(desc->uclass_id, desc->devnum, blk,
+					   cnt);
+		/* Don't read past the end of the device */
+		if (blk + cnt + extra > desc->lba)
+			extra = max(desc->lba, blk + cnt) - blk - cnt;
+		if (extra)
+			blks_read = blk_read_ahead(dev, blk, cnt, extra, ptr);
+		else
+			blks_read = blk_read_dev(dev, blk, cnt, ptr);
+		if (blks_read != cnt) {
+			if (blks_read < 0 && !done)
+				return blks_read;
+			return done + max(blks_read, 0L);
+		}
+	}
+
+	return blkcnt;
+}
+
 long blk_write(struct udevice *dev, lbaint_t start, lbaint_t blkcnt,
 	       const void *buf)
 {
@@ -851,9 +922,17 @@ static int blk_post_probe(struct udevice *dev)
 	return 0;
 }
 
+static int blk_pre_remove(struct udevice *dev)
+{
+	gpt_cache_drop(dev_get_uclass_plat(dev));
+
+	return 0;
+}
+
 UCLASS_DRIVER(blk) = {
 	.id		= UCLASS_BLK,
 	.name		= "blk",
 	.post_probe	= blk_post_probe,
+	.pre_remove	= blk_pre_remove,
 	.per_device_plat_auto	= sizeof(struct blk_desc),
 };
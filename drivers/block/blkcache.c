@@ -10,38 +10,117 @@
 #include <malloc.h>
 #include <part.h>
 #include <asm/global_data.h>
+#include <linux/bitops.h>
 #include <linux/ctype.h>
 #include <linux/list.h>
 
+DECLARE_GLOBAL_DATA_PTR;
+
+/* Number of hash buckets, which must be a power of two */
+#define BLKCACHE_BUCKETS	256
+
+/* The valid bitmap limits the number of blocks in each entry */
+#define BLKCACHE_MAX_BLOCKS	64
+
+/* The cache may use at most this fraction of the malloc() heap */
+#define BLKCACHE_HEAP_SHARE	8
+
+/**
+ * struct block_cache_node - A cached group of blocks
+ *
+ * Each entry covers an aligned group of max_blocks_per_entry blocks, not all
+ * of which need to be present.
+ *
+ * @lh:		Link in the block_cache list, most recently used first
+ * @hash:	Link in the hash bucket for this entry
+ * @iftype:	Uclass ID of the device
+ * @devnum:	Device number
+ * @start:	First block covered by this entry
+ * @valid:	Bitmap of the blocks which are present, bit 0 being @start
+ * @blksz:	Size of each block in bytes
+ * @cache:	Data for the blocks
+ */
 struct block_cache_node {
 	struct list_head lh;
+	struct hlist_node hash;
 	int iftype;
 	int devnum;
 	lbaint_t start;
-	lbaint_t blkcnt;
+	u64 valid;
 	unsigned long blksz;
 	char *cache;
 };
 
+/**
+ * struct block_cache_dev - Information about a device using the cache
+ *
+ * @sibling:	Link in the block_cache_devs list
+ * @stats:	Statistics for this device
+ * @next:	Block after the last one read from the device, used to detect
+ *		sequential reads
+ * @gen:	Generation, which changes each time the device's cache is
+ *		invalidated
+ */
+struct block_cache_dev {
+	struct list_head sibling;
+	struct block_cache_dev_stats stats;
+	lbaint_t next;
+	ulong gen;
+};
+
 static LIST_HEAD(block_cache);
+static LIST_HEAD(block_cache_devs);
+static struct hlist_head *block_cache_hash;
+static ulong block_cache_bytes;
+static ulong block_cache_gen;
 
 static struct block_cache_stats _stats = {
 	.max_blocks_per_entry = 8,
-	.max_entries = 32
+	.max_entries = (CONFIG_BLOCK_CACHE_SIZE << 10) / (8 * 512),
 };
 
+/**
+ * cache_max_bytes() - Get the maximum number of bytes to use for cached blocks
+ *
+ * Return: CONFIG_BLOCK_CACHE_SIZE in bytes, limited to a share of the heap
+ */
+static ulong cache_max_bytes(void)
+{
+	ulong heap = mem_malloc_end - mem_malloc_start;
+
+#if CONFIG_IS_ENABLED(SYS_MALLOC_F)
+	if (!(gd->flags & GD_FLG_FULL_MALLOC_INIT))
+		heap = gd->malloc_limit;
+#endif
+
+	return min((ulong)CONFIG_BLOCK_CACHE_SIZE << 10,
+		   heap / BLKCACHE_HEAP_SHARE);
+}
+
+static uint cache_hash(int iftype, int devnum, lbaint_t start)
+{
+	u32 val = (u32)(start / _stats.max_blocks_per_entry) ^
+		iftype << 24 ^ devnum << 16;
+
+	/* Fibonacci hashing, using the top bits */
+	return (val * 0x9e3779b9) >> 24 & (BLKCACHE_BUCKETS - 1);
+}
+
 static struct block_cache_node *cache_find(int iftype, int devnum,
-					   lbaint_t start, lbaint_t blkcnt,
-					   unsigned long blksz)
+					   lbaint_t blk, unsigned long blksz)
 {
 	struct block_cache_node *node;
+	struct hlist_head *head;
+	lbaint_t start;
+
+	if (!block_cache_hash)
+		return NULL;
 
-	list_for_each_entry(node, &block_cache, lh)
-		if ((node->iftype == iftype) &&
-		    (node->devnum == devnum) &&
-		    (node->blksz == blksz) &&
-		    (node->start <= start) &&
-		    (node->start + node->blkcnt >= start + blkcnt)) {
+	start = blk - blk % _stats.max_blocks_per_entry;
+	head = &block_cache_hash[cache_hash(iftype, devnum, start)];
+	hlist_for_each_entry(node, head, hash) {
+		if (node->iftype == iftype && node->devnum == devnum &&
+		    node->start == start && node->blksz == blksz) {
 			if (block_cache.next != &node->lh) {
 				/* maintain MRU ordering */
 				list_del(&node->lh);
@@ -49,103 +128,275 @@ static struct block_cache_node *cache_find(int iftype, int devnum,
 			}
 			return node;
 		}
-	return 0;
-}
-
-int blkcache_read(int iftype, int devnum,
-		  lbaint_t start, lbaint_t blkcnt,
-		  unsigned long blksz, void *buffer)
-{
-	struct block_cache_node *node = cache_find(iftype, devnum, start,
-						   blkcnt, blksz);
-	if (node) {
-		const char *src = node->cache + (start - node->start) * blksz;
-		memcpy(buffer, src, blksz * blkcnt);
-		debug("hit: start " LBAF ", count " LBAFU "\n",
-		      start, blkcnt);
-		++_stats.hits;
-		return 1;
 	}
 
-	debug("miss: start " LBAF ", count " LBAFU "\n",
-	      start, blkcnt);
-	++_stats.misses;
-	return 0;
+	return NULL;
 }
 
-void blkcache_fill(int iftype, int devnum,
-		   lbaint_t start, lbaint_t blkcnt,
-		   unsigned long blksz, void const *buffer)
+static void cache_drop(struct block_cache_node *node)
 {
-	lbaint_t bytes;
-	struct block_cache_node *node;
+	debug("drop: start " LBAF ", valid %llx\n", node->start, node->valid);
+	list_del(&node->lh);
+	hlist_del(&node->hash);
+	block_cache_bytes -= _stats.max_blocks_per_entry * node->blksz;
+	_stats.entries--;
+}
 
-	/* don't cache big stuff */
-	if (blkcnt > _stats.max_blocks_per_entry)
-		return;
+static struct block_cache_node *cache_new(int iftype, int devnum,
+					  lbaint_t start, unsigned long blksz)
+{
+	ulong bytes = _stats.max_blocks_per_entry * blksz;
+	ulong max_bytes = cache_max_bytes();
+	struct block_cache_node *node = NULL, *lru;
 
-	if (_stats.max_entries == 0)
-		return;
+	if (!block_cache_hash) {
+		block_cache_hash = calloc(BLKCACHE_BUCKETS,
+					  sizeof(struct hlist_head));
+		if (!block_cache_hash)
+			return NULL;
+	}
 
-	bytes = blksz * blkcnt;
-	if (_stats.max_entries <= _stats.entries) {
-		/* pop LRU */
-		node = (struct block_cache_node *)block_cache.prev;
-		list_del(&node->lh);
-		_stats.entries--;
-		debug("drop: start " LBAF ", count " LBAFU "\n",
-		      node->start, node->blkcnt);
-		if (node->blkcnt * node->blksz < bytes) {
+	/*
+	 * Pop LRU entries until the new one fits, which may take several if
+	 * they have smaller blocks. Keep the first suitable one to reuse.
+	 */
+	while (!list_empty(&block_cache) &&
+	       (_stats.entries >= _stats.max_entries ||
+		block_cache_bytes + bytes > max_bytes)) {
+		lru = list_last_entry(&block_cache, struct block_cache_node,
+				      lh);
+		cache_drop(lru);
+		if (!node && lru->blksz == blksz) {
+			node = lru;
+		} else {
+			free(lru->cache);
+			free(lru);
+		}
+	}
+	if (_stats.entries >= _stats.max_entries ||
+	    block_cache_bytes + bytes > max_bytes) {
+		if (node) {
 			free(node->cache);
-			node->cache = 0;
+			free(node);
 		}
-	} else {
-		node = malloc(sizeof(*node));
-		if (!node)
-			return;
-		node->cache = 0;
+		return NULL;
 	}
 
-	if (!node->cache) {
+	if (!node) {
+		node = malloc(sizeof(*node));
+		if (!node)
+			return NULL;
 		node->cache = malloc(bytes);
 		if (!node->cache) {
 			free(node);
-			return;
+			return NULL;
 		}
 	}
 
-	debug("fill: start " LBAF ", count " LBAFU "\n",
-	      start, blkcnt);
-
 	node->iftype = iftype;
 	node->devnum = devnum;
 	node->start = start;
-	node->blkcnt = blkcnt;
+	node->valid = 0;
 	node->blksz = blksz;
-	memcpy(node->cache, buffer, bytes);
 	list_add(&node->lh, &block_cache);
+	hlist_add_head(&node->hash,
+		       &block_cache_hash[cache_hash(iftype, devnum, start)]);
+	block_cache_bytes += bytes;
 	_stats.entries++;
+
+	return node;
 }
 
-void blkcache_invalidate(int iftype, int devnum)
+/**
+ * cache_get_dev() - Get the information for a device, creating it if needed
+ *
+ * @iftype:	Uclass ID of the device
+ * @devnum:	Device number
+ * Return: device information, or NULL if out of memory
+ */
+static struct block_cache_dev *cache_get_dev(int iftype, int devnum)
 {
-	struct list_head *entry, *n;
+	struct block_cache_dev *bdev;
+
+	list_for_each_entry(bdev, &block_cache_devs, sibling) {
+		if (bdev->stats.iftype == iftype &&
+		    bdev->stats.devnum == devnum)
+			return bdev;
+	}
+
+	bdev = calloc(1, sizeof(*bdev));
+	if (!bdev)
+		return NULL;
+	bdev->stats.iftype = iftype;
+	bdev->stats.devnum = devnum;
+	bdev->next = -1;
+	bdev->gen = ++block_cache_gen;
+	list_add_tail(&bdev->sibling, &block_cache_devs);
+
+	return bdev;
+}
+
+lbaint_t blkcache_read(int iftype, int devnum,
+		       lbaint_t start, lbaint_t blkcnt,
+		       unsigned long blksz, void *buffer, lbaint_t *missp)
+{
+	lbaint_t bpe = _stats.max_blocks_per_entry;
 	struct block_cache_node *node;
+	struct block_cache_dev *bdev;
+	lbaint_t done, miss;
+
+	/* Copy out blocks until we find one which is not in the cache */
+	for (done = 0; done < blkcnt;) {
+		lbaint_t blk = start + done;
+		uint off, cnt;
 
-	list_for_each_safe(entry, n, &block_cache) {
-		node = (struct block_cache_node *)entry;
+		node = cache_find(iftype, devnum, blk, blksz);
+		if (!node)
+			break;
+		off = blk - node->start;
+		if (!(node->valid & BIT_ULL(off)))
+			break;
+		for (cnt = 1; off + cnt < bpe && done + cnt < blkcnt; cnt++) {
+			if (!(node->valid & BIT_ULL(off + cnt)))
+				break;
+		}
+		memcpy(buffer + done * blksz, node->cache + off * blksz,
+		       cnt * blksz);
+		done += cnt;
+	}
+
+	bdev = cache_get_dev(iftype, devnum);
+	if (done) {
+		debug("hit: start " LBAF ", count " LBAFU "\n", start, done);
+		++_stats.hits;
+		if (bdev)
+			++bdev->stats.hits;
+		return done;
+	}
+
+	/* Work out how many blocks must be read before the next cached one */
+	for (miss = 0; miss < blkcnt && _stats.entries;) {
+		lbaint_t blk = start + miss;
+
+		node = cache_find(iftype, devnum, blk, blksz);
+		if (!node)
+			miss += bpe - blk % bpe;
+		else if (node->valid & BIT_ULL(blk - node->start))
+			break;
+		else
+			miss++;
+	}
+	*missp = min(blkcnt, miss ? miss : blkcnt);
+
+	debug("miss: start " LBAF ", count " LBAFU "\n", start, *missp);
+	++_stats.misses;
+	if (bdev)
+		++bdev->stats.misses;
+
+	return 0;
+}
+
+lbaint_t blkcache_readahead(int iftype, int devnum, lbaint_t start,
+			    lbaint_t blkcnt)
+{
+	struct block_cache_dev *bdev;
+	lbaint_t extra = 0;
+
+	bdev = cache_get_dev(iftype, devnum);
+	if (!bdev)
+		return 0;
+
+	/*
+	 * If this read follows on from the last one, assume that the caller
+	 * is working through the device and read a little further
+	 */
+	if (start == bdev->next && blkcnt < CONFIG_BLOCK_CACHE_READAHEAD) {
+		extra = CONFIG_BLOCK_CACHE_READAHEAD - blkcnt;
+		debug("read-ahead: start " LBAF ", count " LBAFU "\n",
+		      start + blkcnt, extra);
+		++_stats.readaheads;
+		++bdev->stats.readaheads;
+	}
+	bdev->next = start + blkcnt + extra;
+
+	return extra;
+}
+
+void blkcache_fill(int iftype, int devnum,
+		   lbaint_t start, lbaint_t blkcnt,
+		   unsigned long blksz, void const *buffer)
+{
+	lbaint_t bpe = _stats.max_blocks_per_entry;
+	struct block_cache_node *node;
+	lbaint_t done;
+
+	if (_stats.max_entries == 0)
+		return;
+
+	/*
+	 * Don't cache big stuff, such as file data, since it would push out
+	 * the metadata which is worth keeping. Allow for read-ahead though.
+	 */
+	if (blkcnt > max_t(lbaint_t, bpe, CONFIG_BLOCK_CACHE_READAHEAD))
+		return;
+
+	debug("fill: start " LBAF ", count " LBAFU "\n", start, blkcnt);
+	for (done = 0; done < blkcnt;) {
+		lbaint_t blk = start + done;
+		uint off, cnt;
+
+		node = cache_find(iftype, devnum, blk, blksz);
+		if (!node) {
+			node = cache_new(iftype, devnum, blk - blk % bpe,
+					 blksz);
+			if (!node)
+				return;
+		}
+		off = blk - node->start;
+		cnt = min(bpe - off, blkcnt - done);
+		memcpy(node->cache + off * blksz, buffer + done * blksz,
+		       cnt * blksz);
+		node->valid |= GENMASK_ULL(off + cnt - 1, off);
+		done += cnt;
+	}
+}
+
+void blkcache_invalidate(int iftype, int devnum)
+{
+	struct block_cache_node *node, *n;
+	struct block_cache_dev *bdev;
+
+	list_for_each_entry_safe(node, n, &block_cache, lh) {
 		if (iftype == -1 ||
 		    (node->iftype == iftype && node->devnum == devnum)) {
-			list_del(entry);
+			cache_drop(node);
 			free(node->cache);
 			free(node);
-			--_stats.entries;
+		}
+	}
+
+	list_for_each_entry(bdev, &block_cache_devs, sibling) {
+		if (iftype == -1 || (bdev->stats.iftype == iftype &&
+				     bdev->stats.devnum == devnum)) {
+			bdev->next = -1;
+			bdev->gen = ++block_cache_gen;
 		}
 	}
 }
 
+ulong blkcache_generation(int iftype, int devnum)
+{
+	struct block_cache_dev *bdev;
+
+	bdev = cache_get_dev(iftype, devnum);
+
+	return bdev ? bdev->gen : ++block_cache_gen;
+}
+
 void blkcache_configure(unsigned blocks, unsigned entries)
 {
+	blocks = clamp(blocks, 1U, (unsigned)BLKCACHE_MAX_BLOCKS);
+
 	/* invalidate cache if there is a change */
 	if ((blocks != _stats.max_blocks_per_entry) ||
 	    (entries != _stats.max_entries))
@@ -156,6 +407,7 @@ void blkcache_configure(unsigned blocks, unsigned entries)
 
 	_stats.hits = 0;
 	_stats.misses = 0;
+	_stats.readaheads = 0;
 }
 
 void blkcache_stats(struct block_cache_stats *stats)
@@ -163,9 +415,35 @@ void blkcache_stats(struct block_cache_stats *stats)
 	memcpy(stats, &_stats, sizeof(*stats));
 	_stats.hits = 0;
 	_stats.misses = 0;
+	_stats.readaheads = 0;
+}
+
+int blkcache_dev_stats(int seq, struct block_cache_dev_stats *stats)
+{
+	struct block_cache_dev *bdev;
+
+	list_for_each_entry(bdev, &block_cache_devs, sibling) {
+		if (!seq--) {
+			memcpy(stats, &bdev->stats, sizeof(*stats));
+			bdev->stats.hits = 0;
+			bdev->stats.misses = 0;
+			bdev->stats.readaheads = 0;
+			return 0;
+		}
+	}
+
+	return -ENOENT;
 }
 
 void blkcache_free(void)
 {
+	struct block_cache_dev *bdev, *n;
+
 	blkcache_invalidate(-1, 0);
+	list_for_each_entry_safe(bdev, n, &block_cache_devs, sibling) {
+		list_del(&bdev->sibling);
+		free(bdev);
+	}
+	free(block_cache_hash);
+	block_cache_hash = NULL;
 }
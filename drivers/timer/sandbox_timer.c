@@ -14,14 +14,27 @@
 /* system timer offset in ms */
 static unsigned long sandbox_timer_offset;
 
+/* host time in us at which the timer is stopped, or 0 if it is running */
+static u64 sandbox_timer_frozen;
+
 void timer_test_add_offset(unsigned long offset)
 {
 	sandbox_timer_offset += offset;
 }
 
+void timer_test_freeze(bool freeze)
+{
+	if (!freeze)
+		sandbox_timer_frozen = 0;
+	else if (!sandbox_timer_frozen)
+		sandbox_timer_frozen = os_get_nsec() / 1000;
+}
+
 u64 notrace timer_early_get_count(void)
 {
-	return os_get_nsec() / 1000 + sandbox_timer_offset * 1000;
+	u64 now = sandbox_timer_frozen ?: os_get_nsec() / 1000;
+
+	return now + sandbox_timer_offset * 1000;
 }
 
 unsigned long notrace timer_early_get_rate(void)
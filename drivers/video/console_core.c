@@ -56,72 +56,103 @@ int check_bpix_support(int bpix)
 		return -ENOSYS;
 }
 
-inline void fill_pixel_and_goto_next(void **dstp, u32 value, int pbytes, int step)
+void fill_pixels(void *dst, u32 value, int pbytes, int count)
 {
-	u8 *dst_byte = *dstp;
+	int i;
 
-	if (pbytes == 4) {
-		u32 *dst = *dstp;
-		*dst = value;
+	switch (pbytes) {
+	case 4: {
+		u32 *dst32 = dst;
+
+		for (i = 0; i < count; i++)
+			*dst32++ = value;
+		break;
+	}
+	case 2: {
+		u16 *dst16 = dst;
+
+		for (i = 0; i < count; i++)
+			*dst16++ = value;
+		break;
+	}
+	default:
+		memset(dst, value, count);
+		break;
+	}
+}
+
+/**
+ * fill_font_bits() - Write a line of font pixels to the framebuffer
+ *
+ * This picks out @count bits from the font data, starting at bit @pos and
+ * moving @pos_step bits each time, and writes a foreground or background
+ * pixel for each. Bits are numbered from the top bit of the first byte.
+ *
+ * The pixel size is decided once for the whole line, rather than for each
+ * pixel, so that the compiler can produce a tight loop for each case.
+ *
+ * @pfont:	Font data
+ * @pos:	Bit number of the first pixel
+ * @pos_step:	Number of bits to move forward for each pixel
+ * @count:	Number of pixels to write
+ * @dst:	Framebuffer address of the first pixel
+ * @dir:	1 to write left to right, -1 to write right to left
+ * @vid_priv:	Video device, giving the colours and pixel size
+ */
+static void fill_font_bits(const uchar *pfont, uint pos, uint pos_step,
+			   int count, void *dst, int dir,
+			   struct video_priv *vid_priv)
+{
+	u32 fg = vid_priv->colour_fg, bg = vid_priv->colour_bg;
+	int i;
+
+#define FONT_BIT(pos)	(pfont[(pos) / 8] & (0x80 >> ((pos) % 8)))
+	switch (VNBYTES(vid_priv->bpix)) {
+	case 4: {
+		u32 *dst32 = dst;
+
+		for (i = 0; i < count; i++, pos += pos_step, dst32 += dir)
+			*dst32 = FONT_BIT(pos) ? fg : bg;
+		break;
+	}
+	case 2: {
+		u16 *dst16 = dst;
+
+		for (i = 0; i < count; i++, pos += pos_step, dst16 += dir)
+			*dst16 = FONT_BIT(pos) ? fg : bg;
+		break;
 	}
-	if (pbytes == 2) {
-		u16 *dst = *dstp;
-		*dst = value;
+	default: {
+		u8 *dst8 = dst;
+
+		for (i = 0; i < count; i++, pos += pos_step, dst8 += dir)
+			*dst8 = FONT_BIT(pos) ? fg : bg;
+		break;
 	}
-	if (pbytes == 1) {
-		u8 *dst = *dstp;
-		*dst = value;
 	}
-	*dstp = dst_byte + step;
+#undef FONT_BIT
 }
 
 int fill_char_vertically(uchar *pfont, void **line, struct video_priv *vid_priv,
 			 struct video_fontdata *fontdata, bool direction)
 {
-	int step, line_step, pbytes, bitcount, width_remainder, ret;
-	void *dst;
+	int dir, line_step, ret;
 
 	ret = check_bpix_support(vid_priv->bpix);
 	if (ret)
 		return ret;
 
-	pbytes = VNBYTES(vid_priv->bpix);
 	if (direction) {
-		step = -pbytes;
+		dir = -1;
 		line_step = -vid_priv->line_length;
 	} else {
-		step = pbytes;
+		dir = 1;
 		line_step = vid_priv->line_length;
 	}
 
-	width_remainder = fontdata->width % 8;
 	for (int row = 0; row < fontdata->height; row++) {
-		uchar bits;
-
-		bitcount = 8;
-		dst = *line;
-		for (int col = 0; col < fontdata->byte_width; col++) {
-			if (width_remainder) {
-				bool is_last_col = (fontdata->byte_width - col == 1);
-
-				if (is_last_col)
-					bitcount = width_remainder;
-			}
-			bits = pfont[col];
-
-			for (int bit = 0; bit < bitcount; bit++) {
-				u32 value = (bits & 0x80) ?
-					vid_priv->colour_fg :
-					vid_priv->colour_bg;
-
-				fill_pixel_and_goto_next(&dst,
-							 value,
-							 pbytes,
-							 step
-				);
-				bits <<= 1;
-			}
-		}
+		fill_font_bits(pfont, 0, 1, fontdata->width, *line, dir,
+			       vid_priv);
 		*line += line_step;
 		pfont += fontdata->byte_width;
 	}
@@ -131,47 +162,25 @@ int fill_char_vertically(uchar *pfont, void **line, struct video_priv *vid_priv,
 int fill_char_horizontally(uchar *pfont, void **line, struct video_priv *vid_priv,
 			   struct video_fontdata *fontdata, bool direction)
 {
-	int step, line_step, pbytes, bitcount = 8, width_remainder, ret;
-	void *dst;
-	u8 mask;
+	int dir, line_step, ret;
 
 	ret = check_bpix_support(vid_priv->bpix);
 	if (ret)
 		return ret;
 
-	pbytes = VNBYTES(vid_priv->bpix);
 	if (direction) {
-		step = -pbytes;
+		dir = -1;
 		line_step = vid_priv->line_length;
 	} else {
-		step = pbytes;
+		dir = 1;
 		line_step = -vid_priv->line_length;
 	}
 
-	width_remainder = fontdata->width % 8;
-	for (int col = 0; col < fontdata->byte_width; col++) {
-		mask = 0x80;
-		if (width_remainder) {
-			bool is_last_col = (fontdata->byte_width - col == 1);
-
-			if (is_last_col)
-				bitcount = width_remainder;
-		}
-		for (int bit = 0; bit < bitcount; bit++) {
-			dst = *line;
-			for (int row = 0; row < fontdata->height; row++) {
-				u32 value = (pfont[row * fontdata->byte_width + col]
-					     & mask) ? vid_priv->colour_fg : vid_priv->colour_bg;
-
-				fill_pixel_and_goto_next(&dst,
-							 value,
-							 pbytes,
-							 step
-				);
-			}
-			*line += line_step;
-			mask >>= 1;
-		}
+	/* Each column of the character becomes a line in the framebuffer */
+	for (int col = 0; col < fontdata->width; col++) {
+		fill_font_bits(pfont, col, fontdata->byte_width * 8,
+			       fontdata->height, *line, dir, vid_priv);
+		*line += line_step;
 	}
 	return ret;
 }
@@ -179,29 +188,23 @@ int fill_char_horizontally(uchar *pfont, void **line, struct video_priv *vid_pri
 int draw_cursor_vertically(void **line, struct video_priv *vid_priv,
 			   uint height, bool direction)
 {
-	int step, line_step, pbytes, ret;
-	uint value;
-	void *dst;
+	int pbytes, line_step, ret;
 
 	ret = check_bpix_support(vid_priv->bpix);
 	if (ret)
 		return ret;
 
 	pbytes = VNBYTES(vid_priv->bpix);
-	if (direction) {
-		step = -pbytes;
-		line_step = -vid_priv->line_length;
-	} else {
-		step = pbytes;
-		line_step = vid_priv->line_length;
-	}
-
-	value = vid_priv->colour_fg;
+	line_step = direction ? -vid_priv->line_length : vid_priv->line_length;
 
 	for (int row = 0; row < height; row++) {
-		dst = *line;
-		for (int col = 0; col < VIDCONSOLE_CURSOR_WIDTH; col++)
-			fill_pixel_and_goto_next(&dst, value, pbytes, step);
+		void *dst = *line;
+
+		/* When flipped, the cursor extends to the left */
+		if (direction)
+			dst -= (VIDCONSOLE_CURSOR_WIDTH - 1) * pbytes;
+		fill_pixels(dst, vid_priv->colour_fg, pbytes,
+			    VIDCONSOLE_CURSOR_WIDTH);
 		*line += line_step;
 	}
 	return ret;
@@ -20,17 +20,15 @@ static int console_set_row_1(struct udevice *dev, uint row, int clr)
 	struct console_simple_priv *priv = dev_get_priv(dev);
 	struct video_fontdata *fontdata = priv->fontdata;
 	int pbytes = VNBYTES(vid_priv->bpix);
-	void *start, *dst, *line;
-	int i, j;
+	void *start, *line;
+	int j;
 	int ret;
 
 	start = vid_priv->fb + vid_priv->line_length -
 		(row + 1) * fontdata->height * pbytes;
 	line = start;
 	for (j = 0; j < vid_priv->ysize; j++) {
-		dst = line;
-		for (i = 0; i < fontdata->height; i++)
-			fill_pixel_and_goto_next(&dst, clr, pbytes, pbytes);
+		fill_pixels(line, clr, pbytes, fontdata->height);
 		line += vid_priv->line_length;
 	}
 	ret = vidconsole_sync_copy(dev, start, line);
@@ -107,18 +105,15 @@ static int console_set_row_2(struct udevice *dev, uint row, int clr)
 	struct video_priv *vid_priv = dev_get_uclass_priv(dev->parent);
 	struct console_simple_priv *priv = dev_get_priv(dev);
 	struct video_fontdata *fontdata = priv->fontdata;
-	void *start, *line, *dst, *end;
+	void *start, *end;
 	int pixels = fontdata->height * vid_priv->xsize;
-	int i, ret;
+	int ret;
 	int pbytes = VNBYTES(vid_priv->bpix);
 
 	start = vid_priv->fb + vid_priv->ysize * vid_priv->line_length -
 		(row + 1) * fontdata->height * vid_priv->line_length;
-	line = start;
-	dst = line;
-	for (i = 0; i < pixels; i++)
-		fill_pixel_and_goto_next(&dst, clr, pbytes, pbytes);
-	end = dst;
+	fill_pixels(start, clr, pbytes, pixels);
+	end = start + pixels * pbytes;
 	ret = vidconsole_sync_copy(dev, start, end);
 	if (ret)
 		return ret;
@@ -186,15 +181,13 @@ static int console_set_row_3(struct udevice *dev, uint row, int clr)
 	struct console_simple_priv *priv = dev_get_priv(dev);
 	struct video_fontdata *fontdata = priv->fontdata;
 	int pbytes = VNBYTES(vid_priv->bpix);
-	void *start, *dst, *line;
-	int i, j, ret;
+	void *start, *line;
+	int j, ret;
 
 	start = vid_priv->fb + row * fontdata->height * pbytes;
 	line = start;
 	for (j = 0; j < vid_priv->ysize; j++) {
-		dst = line;
-		for (i = 0; i < fontdata->height; i++)
-			fill_pixel_and_goto_next(&dst, clr, pbytes, pbytes);
+		fill_pixels(line, clr, pbytes, fontdata->height);
 		line += vid_priv->line_length;
 	}
 	ret = vidconsole_sync_copy(dev, start, line);
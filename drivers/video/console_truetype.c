@@ -156,12 +156,45 @@ struct console_tt_metrics {
 	double scale;
 };
 
+/**
+ * struct console_tt_glyph - A rendered glyph
+ *
+ * Rendering a glyph is by far the most expensive part of writing a character,
+ * so glyphs are kept in a cache, indexed by font / size, code point and the
+ * position within a pixel they were rendered at.
+ *
+ * @met:	Font / size combination used to render the glyph, or NULL if
+ *		this cache entry is empty
+ * @cp:		Unicode code point of the glyph
+ * @shift:	Position within the first pixel that the glyph was rendered
+ *		at, 0 <= shift < 1
+ * @width:	Width of the image in pixels
+ * @height:	Height of the image in pixels
+ * @xoff:	X offset of the image from the cursor position
+ * @yoff:	Y offset of the image from the baseline
+ * @data:	8-bit-per-pixel image of the glyph, or NULL if it is empty,
+ *		e.g. a space
+ */
+struct console_tt_glyph {
+	struct console_tt_metrics *met;
+	int cp;
+	double shift;
+	int width;
+	int height;
+	int xoff;
+	int yoff;
+	u8 *data;
+};
+
 /**
  * struct console_tt_priv - Private data for this driver
  *
  * @cur_met:	Current metrics being used
  * @metrics:	List metrics that can be used
  * @num_metrics:	Number of available metrics
+ * @glyphs:	Glyph cache, or NULL if there is none
+ * @num_glyphs:	Number of entries in the glyph cache
+ * @glyph_hits:	Number of glyphs found in the cache
  * @pos:	List of cursor positions for each character written. This is
  *		used to handle backspace. We clear the frame buffer between
  *		the last position and the current position, thus erasing the
@@ -173,6 +206,9 @@ struct console_tt_priv {
 	struct console_tt_metrics *cur_met;
 	struct console_tt_metrics metrics[CONFIG_CONSOLE_TRUETYPE_MAX_METRICS];
 	int num_metrics;
+	struct console_tt_glyph *glyphs;
+	int num_glyphs;
+	uint glyph_hits;
 	struct pos_info pos[POS_HISTORY_SIZE];
 	int pos_ptr;
 };
@@ -262,6 +298,56 @@ static int console_truetype_move_rows(struct udevice *dev, uint rowdst,
 	return 0;
 }
 
+/**
+ * get_glyph() - Get the rendered image of a character
+ *
+ * If the glyph cache is enabled, the glyph is looked up in the cache, rendering
+ * it only if it is not already there. Since the cursor position is a whole
+ * number of 1 / VID_FRAC_DIV pixels, the same values of @x_shift come up
+ * again and again, so glyphs are only reused at exactly the same position and
+ * the output is the same as without the cache. Otherwise the glyph is rendered
+ * into @tmp and the caller must free its data when done.
+ *
+ * @priv:	Private data for the console
+ * @cp:		Unicode code point to render
+ * @x_shift:	Position of the glyph within the first pixel, 0 <= x_shift < 1
+ * @tmp:	Glyph to use if the cache is not in use
+ * Return: glyph, which is @tmp if the cache was not used
+ */
+static struct console_tt_glyph *get_glyph(struct console_tt_priv *priv, int cp,
+					  double x_shift,
+					  struct console_tt_glyph *tmp)
+{
+	struct console_tt_metrics *met = priv->cur_met;
+	struct console_tt_glyph *glyph = tmp;
+
+	if (priv->glyphs) {
+		uint hash;
+
+		hash = (cp * VID_FRAC_DIV + (int)(x_shift * VID_FRAC_DIV)) * 31 +
+			(met - priv->metrics);
+		glyph = &priv->glyphs[hash % priv->num_glyphs];
+		if (glyph->met == met && glyph->cp == cp &&
+		    glyph->shift == x_shift) {
+			priv->glyph_hits++;
+			return glyph;
+		}
+		free(glyph->data);
+	}
+
+	glyph->met = met;
+	glyph->cp = cp;
+	glyph->shift = x_shift;
+	glyph->data = stbtt_GetCodepointBitmapSubpixel(&met->font, met->scale,
+						       met->scale, x_shift, 0,
+						       cp, &glyph->width,
+						       &glyph->height,
+						       &glyph->xoff,
+						       &glyph->yoff);
+
+	return glyph;
+}
+
 static int console_truetype_putc_xy(struct udevice *dev, uint x, uint y,
 				    int cp)
 {
@@ -271,12 +357,13 @@ static int console_truetype_putc_xy(struct udevice *dev, uint x, uint y,
 	struct console_tt_priv *priv = dev_get_priv(dev);
 	struct console_tt_metrics *met = priv->cur_met;
 	stbtt_fontinfo *font = &met->font;
-	int width, height, xoff, yoff;
+	struct console_tt_glyph tmp, *glyph;
+	int width, height, xoff;
 	double xpos, x_shift;
 	int lsb;
 	int width_frac, linenum;
 	struct pos_info *pos;
-	u8 *bits, *data;
+	u8 *bits;
 	int advance;
 	void *start, *end, *line;
 	int row, ret;
@@ -320,17 +407,18 @@ static int console_truetype_putc_xy(struct udevice *dev, uint x, uint y,
 	 * image of the character. For empty characters, like ' ', data will
 	 * return NULL;
 	 */
-	data = stbtt_GetCodepointBitmapSubpixel(font, met->scale, met->scale,
-						x_shift, 0, cp, &width, &height,
-						&xoff, &yoff);
-	if (!data)
+	glyph = get_glyph(priv, cp, x_shift, &tmp);
+	if (!glyph->data)
 		return width_frac;
+	width = glyph->width;
+	height = glyph->height;
+	xoff = glyph->xoff;
 
 	/* Figure out where to write the character in the frame buffer */
-	bits = data;
+	bits = glyph->data;
 	start = vid_priv->fb + y * vid_priv->line_length +
 		VID_TO_PIXEL(x) * VNBYTES(vid_priv->bpix);
-	linenum = met->baseline + yoff;
+	linenum = met->baseline + glyph->yoff;
 	if (linenum > 0)
 		start += linenum * vid_priv->line_length;
 	line = start;
@@ -413,16 +501,18 @@ static int console_truetype_putc_xy(struct udevice *dev, uint x, uint y,
 			break;
 		}
 		default:
-			free(data);
+			if (glyph == &tmp)
+				free(tmp.data);
 			return -ENOSYS;
 		}
 
 		line += vid_priv->line_length;
 	}
+	if (glyph == &tmp)
+		free(tmp.data);
 	ret = vidconsole_sync_copy(dev, start, line);
 	if (ret)
 		return ret;
-	free(data);
 
 	return width_frac;
 }
@@ -986,11 +1076,42 @@ static int console_truetype_probe(struct udevice *dev)
 
 	select_metrics(dev, &priv->metrics[ret]);
 
+	/* The console still works without the cache, just more slowly */
+	if (CONFIG_CONSOLE_TRUETYPE_GLYPHS) {
+		priv->glyphs = calloc(CONFIG_CONSOLE_TRUETYPE_GLYPHS,
+				      sizeof(struct console_tt_glyph));
+		if (priv->glyphs)
+			priv->num_glyphs = CONFIG_CONSOLE_TRUETYPE_GLYPHS;
+	}
+
 	debug("%s: ready\n", __func__);
 
 	return 0;
 }
 
+uint console_truetype_glyph_hits(struct udevice *dev)
+{
+	struct console_tt_priv *priv = dev_get_priv(dev);
+
+	return priv->glyph_hits;
+}
+
+static int console_truetype_remove(struct udevice *dev)
+{
+	struct console_tt_priv *priv = dev_get_priv(dev);
+	int i;
+
+	if (priv->glyphs) {
+		for (i = 0; i < priv->num_glyphs; i++)
+			free(priv->glyphs[i].data);
+		free(priv->glyphs);
+		priv->glyphs = NULL;
+		priv->num_glyphs = 0;
+	}
+
+	return 0;
+}
+
 struct vidconsole_ops console_truetype_ops = {
 	.putc_xy	= console_truetype_putc_xy,
 	.move_rows	= console_truetype_move_rows,
@@ -1012,5 +1133,6 @@ U_BOOT_DRIVER(vidconsole_truetype) = {
 	.id	= UCLASS_VIDEO_CONSOLE,
 	.ops	= &console_truetype_ops,
 	.probe	= console_truetype_probe,
+	.remove	= console_truetype_remove,
 	.priv_auto	= sizeof(struct console_tt_priv),
 };
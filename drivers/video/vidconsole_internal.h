@@ -31,15 +31,14 @@ struct console_simple_priv {
 int check_bpix_support(int bpix);
 
 /**
- * Fill 1 pixel in framebuffer, and go to next one.
+ * fill_pixels() - Fill a run of pixels in the framebuffer with one value
  *
- * @param dstp		a pointer to pointer to framebuffer.
- * @param value		value to write to framebuffer.
- * @param pbytes	framebuffer bytes per pixel.
- * @param step		framebuffer pointer increment. Usually is equal to pbytes,
- *			and may be negative to control filling direction.
+ * @dst:	Framebuffer address of the first pixel
+ * @value:	Value to write to each pixel
+ * @pbytes:	Framebuffer bytes per pixel
+ * @count:	Number of pixels to fill, moving left to right
  */
-void fill_pixel_and_goto_next(void **dstp, u32 value, int pbytes, int step);
+void fill_pixels(void *dst, u32 value, int pbytes, int count);
 
 /**
  * Fills 1 character in framebuffer vertically. Vertically means we're filling char font data rows
@@ -385,7 +385,7 @@ void env_set_default(const char *s, int flags)
 		debug("Using default environment\n");
 	}
 
-	flags |= H_DEFAULT;
+	flags |= H_DEFAULT | H_ZEROCOPY;
 	if (himport_r(&env_htab, default_environment,
 			sizeof(default_environment), '\0', flags, 0,
 			0, NULL) == 0) {
@@ -438,9 +438,12 @@ int env_import(const char *buf, int check, int flags)
 		}
 	}
 
-	if (himport_r(&env_htab, (char *)ep->data, ENV_SIZE, '\0', flags, 0,
-			0, NULL)) {
+	if (himport_r(&env_htab, (char *)ep->data, ENV_SIZE, '\0',
+		      flags | H_ZEROCOPY, 0, 0, NULL)) {
 		gd->flags |= GD_FLG_ENV_READY;
+		/* The table now matches the stored copy, unless merged */
+		if (!(flags & H_NOCLEAR) && !CONFIG_IS_ENABLED(ENV_APPEND))
+			hclean_r(&env_htab);
 		return 0;
 	}
 
@@ -533,7 +536,28 @@ int env_import_redund(const char *buf1, int buf1_read_fail,
 
 	env_flags = ep->flags;
 
-	return env_import((char *)ep, 0, flags);
+	ret = env_import((char *)ep, 0, flags);
+
+	/*
+	 * If the other copy is unreadable or corrupt, keep the table dirty so
+	 * that the next save rewrites it rather than being skipped.
+	 */
+	if (!ret && IS_ENABLED(CONFIG_ENV_SAVE_SKIP_UNCHANGED)) {
+		const env_t *other;
+		int other_fail;
+
+		if (ep == (env_t *)buf1) {
+			other = (env_t *)buf2;
+			other_fail = buf2_read_fail;
+		} else {
+			other = (env_t *)buf1;
+			other_fail = buf1_read_fail;
+		}
+		if (other_fail || crc32(0, other->data, ENV_SIZE) != other->crc)
+			env_htab.dirty = true;
+	}
+
+	return ret;
 }
 #endif /* CONFIG_SYS_REDUNDAND_ENVIRONMENT */
 
@@ -270,14 +270,22 @@ int env_save(void)
 			return -ENODEV;
 		}
 
+		if (IS_ENABLED(CONFIG_ENV_SAVE_SKIP_UNCHANGED) &&
+		    !env_htab.dirty && gd->env_valid != ENV_INVALID) {
+			printf("unchanged, skipped\n");
+			return 0;
+		}
+
 		ret = drv->save();
 		if (ret)
 			printf("Failed (%d)\n", ret);
 		else
 			printf("OK\n");
 
-		if (!ret)
+		if (!ret) {
+			hclean_r(&env_htab);
 			return 0;
+		}
 	}
 
 	return -ENODEV;
@@ -308,8 +316,11 @@ int env_erase(void)
 		else
 			printf("OK\n");
 
-		if (!ret)
+		if (!ret) {
+			/* Storage no longer holds the table contents */
+			env_htab.dirty = true;
 			return 0;
+		}
 	}
 
 	return -ENODEV;
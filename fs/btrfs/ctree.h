@@ -122,6 +122,11 @@ struct btrfs_fs_info {
 	u32 nodesize;
 	u32 sectorsize;
 	u32 stripesize;
+
+	/* Last partly read compressed extent, decompressed */
+	u64 last_comp_bytenr;
+	u32 last_comp_len;
+	char *last_comp_data;
 };
 
 static inline u32 BTRFS_MAX_ITEM_SIZE(const struct btrfs_fs_info *info)
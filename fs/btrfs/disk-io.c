@@ -763,6 +763,7 @@ void btrfs_free_fs_info(struct btrfs_fs_info *fs_info)
 	free(fs_info->chunk_root);
 	free(fs_info->csum_root);
 	free(fs_info->super_copy);
+	free(fs_info->last_comp_data);
 	free(fs_info);
 }
 
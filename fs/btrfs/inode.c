@@ -408,11 +408,37 @@ out:
 	return ret;
 }
 
+/*
+ * Read @len bytes at @logical into @dest, trying each mirror in turn.
+ *
+ * Return 0 if OK, <0 for error.
+ */
+static int read_data_mirrors(struct btrfs_fs_info *fs_info, char *dest,
+			     u64 logical, u64 len)
+{
+	int num_copies;
+	u64 read;
+	int ret;
+	int i;
+
+	num_copies = btrfs_num_copies(fs_info, logical, len);
+	for (i = 1; i <= num_copies; i++) {
+		read = len;
+		ret = read_extent_data(fs_info, dest, logical, &read, i);
+		if (ret >= 0 && read == len)
+			return 0;
+	}
+	return -EIO;
+}
+
 /*
  * Read out regular extent.
  *
  * Truncating should be handled by the caller.
  *
+ * The last compressed extent which was only partly read is kept
+ * decompressed, so reading the rest of it does not decompress it again.
+ *
  * @offset and @len should not cross the extent boundary.
  * Return the number of bytes read.
  * Return <0 for error.
@@ -425,15 +451,13 @@ int btrfs_read_extent_reg(struct btrfs_path *path,
 	struct btrfs_fs_info *fs_info = leaf->fs_info;
 	struct btrfs_key key;
 	u64 extent_num_bytes;
+	u64 extent_offset;
 	u64 disk_bytenr;
-	u64 read;
 	char *cbuf = NULL;
 	char *dbuf = NULL;
 	u32 csize;
 	u32 dsize;
-	bool finished = false;
-	int num_copies;
-	int i;
+	bool direct;
 	int slot = path->slots[0];
 	int ret;
 
@@ -451,52 +475,40 @@ int btrfs_read_extent_reg(struct btrfs_path *path,
 		return len;
 	}
 
+	extent_offset = btrfs_file_extent_offset(leaf, fi) + offset -
+			key.offset;
 	if (btrfs_file_extent_compression(leaf, fi) == BTRFS_COMPRESS_NONE) {
-		u64 logical;
-
-		logical = btrfs_file_extent_disk_bytenr(leaf, fi) +
-			  btrfs_file_extent_offset(leaf, fi) +
-			  offset - key.offset;
-		read = len;
-
-		num_copies = btrfs_num_copies(fs_info, logical, len);
-		for (i = 1; i <= num_copies; i++) {
-			ret = read_extent_data(fs_info, dest, logical, &read, i);
-			if (ret < 0 || read != len)
-				continue;
-			finished = true;
-			break;
-		}
-		if (!finished)
-			return -EIO;
+		ret = read_data_mirrors(fs_info, dest,
+				btrfs_file_extent_disk_bytenr(leaf, fi) +
+				extent_offset, len);
+		if (ret < 0)
+			return ret;
 		return len;
 	}
 
 	csize = btrfs_file_extent_disk_num_bytes(leaf, fi);
 	dsize = btrfs_file_extent_ram_bytes(leaf, fi);
 	disk_bytenr = btrfs_file_extent_disk_bytenr(leaf, fi);
-	num_copies = btrfs_num_copies(fs_info, disk_bytenr, csize);
 
+	if (fs_info->last_comp_data &&
+	    fs_info->last_comp_bytenr == disk_bytenr &&
+	    fs_info->last_comp_len == dsize) {
+		memcpy(dest, fs_info->last_comp_data + extent_offset, len);
+		return len;
+	}
+
+	/* Decompress straight into @dest if the whole extent is wanted */
+	direct = !extent_offset && len == dsize;
 	cbuf = malloc_cache_aligned(csize);
-	dbuf = malloc_cache_aligned(dsize);
+	dbuf = direct ? dest : malloc_cache_aligned(dsize);
 	if (!cbuf || !dbuf) {
 		ret = -ENOMEM;
 		goto out;
 	}
 	/* For compressed extent, we must read the whole on-disk extent */
-	for (i = 1; i <= num_copies; i++) {
-		read = csize;
-		ret = read_extent_data(fs_info, cbuf, disk_bytenr,
-				       &read, i);
-		if (ret < 0 || read != csize)
-			continue;
-		finished = true;
-		break;
-	}
-	if (!finished) {
-		ret = -EIO;
+	ret = read_data_mirrors(fs_info, cbuf, disk_bytenr, csize);
+	if (ret < 0)
 		goto out;
-	}
 
 	ret = btrfs_decompress(btrfs_file_extent_compression(leaf, fi), cbuf,
 			       csize, dbuf, dsize);
@@ -510,14 +522,20 @@ int btrfs_read_extent_reg(struct btrfs_path *path,
 	 */
 	if (ret < dsize)
 		memset(dbuf + ret, 0, dsize - ret);
-	/* Then copy the needed part */
-	memcpy(dest,
-	       dbuf + btrfs_file_extent_offset(leaf, fi) + offset - key.offset,
-	       len);
+	/* Then copy the needed part, keeping the rest for the next read */
+	if (!direct) {
+		memcpy(dest, dbuf + extent_offset, len);
+		free(fs_info->last_comp_data);
+		fs_info->last_comp_data = dbuf;
+		fs_info->last_comp_bytenr = disk_bytenr;
+		fs_info->last_comp_len = dsize;
+		dbuf = NULL;
+	}
 	ret = len;
 out:
 	free(cbuf);
-	free(dbuf);
+	if (!direct)
+		free(dbuf);
 	return ret;
 }
 
@@ -668,6 +686,10 @@ int btrfs_file_read(struct btrfs_root *root, u64 ino, u64 file_offset, u64 len,
 	u64 aligned_end = round_down(file_offset + len, fs_info->sectorsize);
 	u64 next_offset;
 	u64 cur = aligned_start;
+	u64 pend_logical = 0;
+	u64 pend_len = 0;
+	char *pend_dest = NULL;
+	int pend_copies = 0;
 	int ret = 0;
 
 	btrfs_init_path(&path);
@@ -704,6 +726,7 @@ int btrfs_file_read(struct btrfs_root *root, u64 ino, u64 file_offset, u64 len,
 	/* Read the aligned part */
 	while (cur < aligned_end) {
 		u64 extent_num_bytes;
+		u64 len_in_extent;
 		u8 type;
 
 		btrfs_release_path(&path);
@@ -712,10 +735,8 @@ int btrfs_file_read(struct btrfs_root *root, u64 ino, u64 file_offset, u64 len,
 			goto out;
 		if (ret > 0) {
 			/* No next, direct exit */
-			if (!next_offset) {
-				ret = 0;
-				goto out;
-			}
+			if (!next_offset)
+				break;
 			/*
 			 * Find a extent gap, mostly caused by NO_HOLE feature.
 			 * Just to next offset directly.
@@ -744,12 +765,55 @@ int btrfs_file_read(struct btrfs_root *root, u64 ino, u64 file_offset, u64 len,
 		/* Read the remaining part of the extent */
 		extent_num_bytes = btrfs_file_extent_num_bytes(path.nodes[0],
 							       fi);
-		ret = btrfs_read_extent_reg(&path, fi, cur,
-				min(extent_num_bytes, aligned_end - cur),
-				dest + cur - file_offset);
+		len_in_extent = min(key.offset + extent_num_bytes - cur,
+				    aligned_end - cur);
+
+		/*
+		 * Uncompressed extents are read straight into @dest, and ones
+		 * which follow on from each other on disk are read together.
+		 */
+		if (btrfs_file_extent_compression(path.nodes[0], fi) ==
+		    BTRFS_COMPRESS_NONE) {
+			struct extent_buffer *leaf = path.nodes[0];
+			u64 logical = btrfs_file_extent_disk_bytenr(leaf, fi) +
+				btrfs_file_extent_offset(leaf, fi) +
+				cur - key.offset;
+			char *to = dest + cur - file_offset;
+			int copies = btrfs_num_copies(fs_info, logical,
+						      len_in_extent);
+
+			if (pend_len && (pend_logical + pend_len != logical ||
+					 pend_dest + pend_len != to ||
+					 pend_copies != copies ||
+					 pend_len + len_in_extent > SZ_1G)) {
+				ret = read_data_mirrors(fs_info, pend_dest,
+							pend_logical, pend_len);
+				if (ret < 0)
+					goto out;
+				pend_len = 0;
+			}
+			if (!pend_len) {
+				pend_logical = logical;
+				pend_dest = to;
+				pend_copies = copies;
+			}
+			pend_len += len_in_extent;
+			cur += len_in_extent;
+			continue;
+		}
+
+		ret = btrfs_read_extent_reg(&path, fi, cur, len_in_extent,
+					    dest + cur - file_offset);
+		if (ret < 0)
+			goto out;
+		cur += len_in_extent;
+	}
+
+	if (pend_len) {
+		ret = read_data_mirrors(fs_info, pend_dest, pend_logical,
+					pend_len);
 		if (ret < 0)
 			goto out;
-		cur += min(extent_num_bytes, aligned_end - cur);
 	}
 
 	/* Read the tailing unaligned part*/
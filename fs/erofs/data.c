@@ -1,6 +1,7 @@
 // SPDX-License-Identifier: GPL-2.0+
 #include "internal.h"
 #include "decompress.h"
+#include <linux/list.h>
 
 static int erofs_map_blocks_flatmode(struct erofs_inode *inode,
 				     struct erofs_map_blocks *map,
@@ -271,6 +272,92 @@ int z_erofs_read_one_data(struct erofs_inode *inode,
 	return 0;
 }
 
+/* a whole decompressed extent, most recently used first */
+struct z_erofs_cache_entry {
+	struct list_head lh;
+	erofs_nid_t nid;
+	erofs_off_t la, pa, len;
+	char *data;
+};
+
+static LIST_HEAD(z_erofs_cache);
+static erofs_off_t z_erofs_cache_bytes;
+
+static void z_erofs_cache_drop(struct z_erofs_cache_entry *e)
+{
+	list_del(&e->lh);
+	z_erofs_cache_bytes -= e->len;
+	free(e->data);
+	free(e);
+}
+
+void z_erofs_cache_free(void)
+{
+	struct z_erofs_cache_entry *e, *n;
+
+	list_for_each_entry_safe(e, n, &z_erofs_cache, lh)
+		z_erofs_cache_drop(e);
+}
+
+/*
+ * Copy part of a compressed extent from the cache, decompressing the whole
+ * extent into it first if it is not there. Returns -EFBIG if the extent is
+ * too large to be cached.
+ */
+static int z_erofs_cache_read(struct erofs_inode *inode,
+			      struct erofs_map_blocks *map, char *raw,
+			      char *buffer, erofs_off_t skip,
+			      erofs_off_t length)
+{
+	erofs_off_t max = (erofs_off_t)CONFIG_FS_EROFS_ZIP_CACHE_SIZE << 10;
+	struct z_erofs_cache_entry *e;
+	int ret;
+
+	list_for_each_entry(e, &z_erofs_cache, lh) {
+		if (e->nid == inode->nid && e->la == map->m_la &&
+		    e->pa == map->m_pa) {
+			list_move(&e->lh, &z_erofs_cache);
+			goto copy;
+		}
+	}
+
+	if (map->m_llen > max)
+		return -EFBIG;
+
+	while (z_erofs_cache_bytes + map->m_llen > max)
+		z_erofs_cache_drop(list_last_entry(&z_erofs_cache,
+						   struct z_erofs_cache_entry,
+						   lh));
+
+	e = malloc(sizeof(*e));
+	if (!e)
+		return -ENOMEM;
+	e->data = malloc(map->m_llen);
+	if (!e->data) {
+		free(e);
+		return -ENOMEM;
+	}
+
+	ret = z_erofs_read_one_data(inode, map, raw, e->data, 0, map->m_llen,
+				    false);
+	if (ret < 0) {
+		free(e->data);
+		free(e);
+		return ret;
+	}
+
+	e->nid = inode->nid;
+	e->la = map->m_la;
+	e->pa = map->m_pa;
+	e->len = map->m_llen;
+	list_add(&e->lh, &z_erofs_cache);
+	z_erofs_cache_bytes += e->len;
+
+copy:
+	memcpy(buffer, e->data + skip, length - skip);
+	return 0;
+}
+
 static int z_erofs_read_data(struct erofs_inode *inode, char *buffer,
 			     erofs_off_t size, erofs_off_t offset)
 {
@@ -327,6 +414,23 @@ static int z_erofs_read_data(struct erofs_inode *inode, char *buffer,
 			}
 		}
 
+		/*
+		 * a read covering the whole extent is decompressed in place,
+		 * while partial ones go through the cache unless the data is
+		 * in the packed inode, which is cached itself.
+		 */
+		if ((skip || trimmed) && CONFIG_FS_EROFS_ZIP_CACHE_SIZE &&
+		    !(map.m_flags & EROFS_MAP_FRAGMENT)) {
+			ret = z_erofs_cache_read(inode, &map, raw,
+						 buffer + end - offset, skip,
+						 length);
+			if (ret != -EFBIG) {
+				if (ret < 0)
+					break;
+				continue;
+			}
+		}
+
 		ret = z_erofs_read_one_data(inode, &map, raw,
 					    buffer + end - offset, skip, length,
 					    trimmed);
@@ -80,6 +80,95 @@ out_inflate_end:
 }
 #endif
 
+#if IS_ENABLED(CONFIG_ZSTD)
+#include <linux/zstd.h>
+
+/* workspace for the streaming decompressor, grown to the largest window */
+static void *z_erofs_zstd_wksp;
+static size_t z_erofs_zstd_wksp_size;
+
+static int z_erofs_decompress_zstd(struct z_erofs_decompress_req *rq)
+{
+	u8 *dest = (u8 *)rq->out;
+	u8 *src = (u8 *)rq->in;
+	u8 *buff = NULL;
+	unsigned int inputmargin = 0;
+	zstd_frame_header hdr;
+	zstd_in_buffer in_buf;
+	zstd_out_buffer out_buf;
+	zstd_dstream *stream;
+	size_t zret, wsize;
+	int ret = 0;
+
+	while (!src[inputmargin & (erofs_blksiz() - 1)])
+		if (!(++inputmargin & (erofs_blksiz() - 1)))
+			break;
+
+	if (inputmargin >= rq->inputsize)
+		return -EFSCORRUPTED;
+
+	zret = zstd_get_frame_header(&hdr, src + inputmargin,
+				     rq->inputsize - inputmargin);
+	if (zret || hdr.windowSize > Z_EROFS_PCLUSTER_MAX_SIZE)
+		return -EFSCORRUPTED;
+
+	wsize = zstd_dstream_workspace_bound(hdr.windowSize);
+	if (wsize > z_erofs_zstd_wksp_size) {
+		free(z_erofs_zstd_wksp);
+		z_erofs_zstd_wksp = malloc(wsize);
+		if (!z_erofs_zstd_wksp) {
+			z_erofs_zstd_wksp_size = 0;
+			return -ENOMEM;
+		}
+		z_erofs_zstd_wksp_size = wsize;
+	}
+
+	stream = zstd_init_dstream(hdr.windowSize, z_erofs_zstd_wksp,
+				   z_erofs_zstd_wksp_size);
+	if (!stream)
+		return -EIO;
+
+	if (rq->decodedskip) {
+		buff = malloc(rq->decodedlength);
+		if (!buff)
+			return -ENOMEM;
+		dest = buff;
+	}
+
+	in_buf.src = src + inputmargin;
+	in_buf.size = rq->inputsize - inputmargin;
+	in_buf.pos = 0;
+	out_buf.dst = dest;
+	out_buf.size = rq->decodedlength;
+	out_buf.pos = 0;
+
+	/* stop once the output is full, which handles partial decoding too */
+	do {
+		zret = zstd_decompress_stream(stream, &out_buf, &in_buf);
+		if (zstd_is_error(zret))
+			break;
+	} while (zret && out_buf.pos < out_buf.size &&
+		 in_buf.pos < in_buf.size);
+
+	if (zstd_is_error(zret) || out_buf.pos != rq->decodedlength) {
+		erofs_err("failed to decompress zstd in[%u, %u] out[%u]: %s",
+			  rq->inputsize, inputmargin, rq->decodedlength,
+			  zstd_is_error(zret) ? zstd_get_error_name(zret) :
+			  "truncated");
+		ret = -EIO;
+		goto out;
+	}
+
+	if (rq->decodedskip)
+		memcpy(rq->out, dest + rq->decodedskip,
+		       rq->decodedlength - rq->decodedskip);
+
+out:
+	free(buff);
+	return ret;
+}
+#endif
+
 #if IS_ENABLED(CONFIG_LZ4)
 #include <u-boot/lz4.h>
 static int z_erofs_decompress_lz4(struct z_erofs_decompress_req *rq)
@@ -176,6 +265,10 @@ int z_erofs_decompress(struct z_erofs_decompress_req *rq)
 #if IS_ENABLED(CONFIG_ZLIB)
 	if (rq->alg == Z_EROFS_COMPRESSION_DEFLATE)
 		return z_erofs_decompress_deflate(rq);
+#endif
+#if IS_ENABLED(CONFIG_ZSTD)
+	if (rq->alg == Z_EROFS_COMPRESSION_ZSTD)
+		return z_erofs_decompress_zstd(rq);
 #endif
 	return -EOPNOTSUPP;
 }
@@ -7,6 +7,14 @@ struct erofs_sb_info sbi;
 static struct erofs_ctxt {
 	struct disk_partition cur_part_info;
 	struct blk_desc *cur_dev;
+
+	/* filesystem which the decompressed cluster cache belongs to */
+	struct blk_desc *cache_dev;
+	lbaint_t cache_part_start;
+	u8 cache_uuid[16];
+	u64 cache_build_time;
+	u32 cache_build_time_nsec;
+	u64 cache_blocks;
 } ctxt;
 
 int erofs_dev_read(int device_id, void *buf, u64 offset, size_t len)
@@ -41,6 +49,22 @@ int erofs_probe(struct blk_desc *fs_dev_desc,
 	if (ret)
 		goto error;
 
+	/* the cache survives erofs_close() but not a change of filesystem */
+	if (ctxt.cache_dev != fs_dev_desc ||
+	    ctxt.cache_part_start != fs_partition->start ||
+	    memcmp(ctxt.cache_uuid, sbi.uuid, sizeof(sbi.uuid)) ||
+	    ctxt.cache_build_time != sbi.build_time ||
+	    ctxt.cache_build_time_nsec != sbi.build_time_nsec ||
+	    ctxt.cache_blocks != sbi.primarydevice_blocks) {
+		z_erofs_cache_free();
+		ctxt.cache_dev = fs_dev_desc;
+		ctxt.cache_part_start = fs_partition->start;
+		memcpy(ctxt.cache_uuid, sbi.uuid, sizeof(sbi.uuid));
+		ctxt.cache_build_time = sbi.build_time;
+		ctxt.cache_build_time_nsec = sbi.build_time_nsec;
+		ctxt.cache_blocks = sbi.primarydevice_blocks;
+	}
+
 	return 0;
 error:
 	ctxt.cur_dev = NULL;
@@ -1642,6 +1642,65 @@ int ext4fs_read_inode(struct ext2_data *data, int ino, struct ext2_inode *inode)
 	return 1;
 }
 
+/**
+ * ext4fs_map_extent() - Map a file block using the inode's extent tree
+ *
+ * @inode:	Inode of the file, which must use extents
+ * @fileblock:	Logical block within the file
+ * @cache:	Cache to use for reading extent-tree blocks
+ * @countp:	Returns the number of blocks, starting at @fileblock, which
+ *		are contiguous on disk (or which form part of the same hole)
+ * Return: filesystem block holding @fileblock, 0 if it is in a hole, or
+ *	-EINVAL if the extent tree is invalid
+ */
+static long int ext4fs_map_extent(struct ext2_inode *inode, int fileblock,
+				  struct ext_block_cache *cache, int *countp)
+{
+	struct ext4_extent_header *root, *ext_block;
+	struct ext4_extent *extent;
+	long int startblock, endblock;
+	unsigned long long start;
+	int log2_blksz;
+	int i;
+
+	log2_blksz = LOG2_BLOCK_SIZE(ext4fs_root) - get_fs()->dev_desc->log2blksz;
+	root = (struct ext4_extent_header *)inode->b.blocks.dir_blocks;
+	ext_block = ext4fs_get_extent_block(ext4fs_root, cache, root, fileblock,
+					    log2_blksz);
+	if (!ext_block) {
+		printf("invalid extent block\n");
+		return -EINVAL;
+	}
+
+	extent = (struct ext4_extent *)(ext_block + 1);
+
+	for (i = 0; i < le16_to_cpu(ext_block->eh_entries); i++) {
+		startblock = le32_to_cpu(extent[i].ee_block);
+		endblock = startblock + le16_to_cpu(extent[i].ee_len);
+
+		if (startblock > fileblock) {
+			/* Sparse file */
+			*countp = startblock - fileblock;
+			return 0;
+
+		} else if (fileblock < endblock) {
+			start = le16_to_cpu(extent[i].ee_start_hi);
+			start = (start << 32) +
+				le32_to_cpu(extent[i].ee_start_lo);
+			*countp = endblock - fileblock;
+			return (fileblock - startblock) + start;
+		}
+	}
+
+	/*
+	 * Past the last extent: if this leaf is the whole tree the rest of the
+	 * file is a hole, otherwise the next leaf may start at any block
+	 */
+	*countp = ext_block == root ? INT_MAX : 1;
+
+	return 0;
+}
+
 long int read_allocated_block(struct ext2_inode *inode, int fileblock,
 			      struct ext_block_cache *cache)
 {
@@ -1652,18 +1711,14 @@ long int read_allocated_block(struct ext2_inode *inode, int fileblock,
 	long int rblock;
 	long int perblock_parent;
 	long int perblock_child;
-	unsigned long long start;
 	/* get the blocksize of the filesystem */
 	blksz = EXT2_BLOCK_SIZE(ext4fs_root);
 	log2_blksz = LOG2_BLOCK_SIZE(ext4fs_root)
 		- get_fs()->dev_desc->log2blksz;
 
 	if (le32_to_cpu(inode->flags) & EXT4_EXTENTS_FL) {
-		long int startblock, endblock;
 		struct ext_block_cache *c, cd;
-		struct ext4_extent_header *ext_block;
-		struct ext4_extent *extent;
-		int i;
+		int count;
 
 		if (cache) {
 			c = cache;
@@ -1671,43 +1726,11 @@ long int read_allocated_block(struct ext2_inode *inode, int fileblock,
 			c = &cd;
 			ext_cache_init(c);
 		}
-		ext_block =
-			ext4fs_get_extent_block(ext4fs_root, c,
-						(struct ext4_extent_header *)
-						inode->b.blocks.dir_blocks,
-						fileblock, log2_blksz);
-		if (!ext_block) {
-			printf("invalid extent block\n");
-			if (!cache)
-				ext_cache_fini(c);
-			return -EINVAL;
-		}
-
-		extent = (struct ext4_extent *)(ext_block + 1);
-
-		for (i = 0; i < le16_to_cpu(ext_block->eh_entries); i++) {
-			startblock = le32_to_cpu(extent[i].ee_block);
-			endblock = startblock + le16_to_cpu(extent[i].ee_len);
-
-			if (startblock > fileblock) {
-				/* Sparse file */
-				if (!cache)
-					ext_cache_fini(c);
-				return 0;
-
-			} else if (fileblock < endblock) {
-				start = le16_to_cpu(extent[i].ee_start_hi);
-				start = (start << 32) +
-					le32_to_cpu(extent[i].ee_start_lo);
-				if (!cache)
-					ext_cache_fini(c);
-				return (fileblock - startblock) + start;
-			}
-		}
-
+		blknr = ext4fs_map_extent(inode, fileblock, c, &count);
 		if (!cache)
 			ext_cache_fini(c);
-		return 0;
+
+		return blknr;
 	}
 
 	/* Direct blocks. */
@@ -1995,6 +2018,48 @@ long int read_allocated_block(struct ext2_inode *inode, int fileblock,
 	return blknr;
 }
 
+/**
+ * read_allocated_blocks() - Map a run of file blocks to the disk
+ *
+ * This finds the run of blocks starting at @fileblock which are contiguous on
+ * disk, so that the caller can read them with a single device access. For
+ * extent-based files the run is the rest of the extent holding @fileblock.
+ *
+ * @inode:	Inode of the file
+ * @fileblock:	First logical block within the file
+ * @maxblocks:	Maximum number of blocks to map
+ * @cache:	Cache to use for reading extent-tree blocks
+ * @countp:	Returns the number of blocks mapped, at least 1
+ * Return: filesystem block holding @fileblock, 0 if the run is a hole, or
+ *	-ve on error
+ */
+long int read_allocated_blocks(struct ext2_inode *inode, int fileblock,
+			       int maxblocks, struct ext_block_cache *cache,
+			       int *countp)
+{
+	long int blknr, next;
+	int count;
+
+	if (le32_to_cpu(inode->flags) & EXT4_EXTENTS_FL) {
+		blknr = ext4fs_map_extent(inode, fileblock, cache, &count);
+		*countp = min(count, maxblocks);
+
+		return blknr;
+	}
+
+	blknr = read_allocated_block(inode, fileblock, cache);
+	if (blknr < 0)
+		return blknr;
+	for (count = 1; count < maxblocks; count++) {
+		next = read_allocated_block(inode, fileblock + count, cache);
+		if (next < 0 || next != (blknr ? blknr + count : 0))
+			break;
+	}
+	*countp = count;
+
+	return blknr;
+}
+
 /**
  * ext4fs_reinit_global() - Reinitialize values of ext4 write implementation's
  *			    global pointers
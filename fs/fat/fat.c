@@ -201,12 +201,12 @@ static __u32 get_fatent(fsdata *mydata, __u32 entry)
 
 	/* Read a new block of FAT entries into the cache. */
 	if (bufnum != mydata->fatbufnum) {
-		__u32 getsize = FATBUFBLOCKS;
+		__u32 getsize = mydata->fatbufblocks;
 		__u8 *bufptr = mydata->fatbuf;
 		__u32 fatlength = mydata->fatlength;
-		__u32 startblock = bufnum * FATBUFBLOCKS;
+		__u32 startblock = bufnum * mydata->fatbufblocks;
 
-		/* Cap length if fatlength is not a multiple of FATBUFBLOCKS */
+		/* Cap length if fatlength is not a multiple of fatbufblocks */
 		if (startblock + getsize > fatlength)
 			getsize = fatlength - startblock;
 
@@ -417,18 +417,18 @@ static int get_contents(fsdata *mydata, dir_entry *dentptr, loff_t pos,
 
 		/* get remaining bytes */
 		actsize = filesize;
-		if (get_cluster(mydata, curclust, buffer, (int)actsize) != 0) {
+		if (get_cluster(mydata, curclust, buffer, actsize) != 0) {
 			printf("Error reading cluster\n");
 			return -1;
 		}
 		*gotsize += actsize;
 		return 0;
 getit:
-		if (get_cluster(mydata, curclust, buffer, (int)actsize) != 0) {
+		if (get_cluster(mydata, curclust, buffer, actsize) != 0) {
 			printf("Error reading cluster\n");
 			return -1;
 		}
-		*gotsize += (int)actsize;
+		*gotsize += actsize;
 		filesize -= actsize;
 		buffer += actsize;
 
@@ -616,6 +616,24 @@ out_free:
 	return ret;
 }
 
+/*
+ * Work out how many sectors of the FAT to hold in memory. The whole table is
+ * used if it fits in CONFIG_FS_FAT_CACHE_SIZE, so that following a cluster
+ * chain only reads it once.
+ */
+static __u32 fat_buf_blocks(fsdata *mydata)
+{
+	__u32 blocks = (CONFIG_FS_FAT_CACHE_SIZE << 10) / mydata->sect_size;
+
+	if (blocks >= mydata->fatlength)
+		return mydata->fatlength;
+
+	/* A FAT12 entry must not be split between two windows */
+	blocks -= blocks % FATBUFBLOCKS;
+
+	return max_t(__u32, blocks, FATBUFBLOCKS);
+}
+
 static int get_fs_info(fsdata *mydata)
 {
 	boot_sector bs;
@@ -668,6 +686,7 @@ static int get_fs_info(fsdata *mydata)
 		mydata->data_begin = mydata->rootdir_sect -
 					(mydata->clust_size * 2);
 		mydata->root_cluster = bs.root_cluster;
+		mydata->fsinfo_sect = bs.info_sector;
 	} else {
 		mydata->rootdir_size = (get_unaligned_le16(bs.dir_entries) *
 					 sizeof(dir_entry)) /
@@ -686,6 +705,7 @@ static int get_fs_info(fsdata *mydata)
 
 	mydata->fatbufnum = -1;
 	mydata->fat_dirty = 0;
+	mydata->fatbufblocks = fat_buf_blocks(mydata);
 	mydata->fatbuf = malloc_cache_aligned(FATBUFSIZE);
 	if (mydata->fatbuf == NULL) {
 		debug("Error: allocating memory\n");
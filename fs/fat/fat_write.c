@@ -218,10 +218,9 @@ static int disk_write(__u32 block, __u32 nr_blocks, void *buf)
  */
 static int flush_dirty_fat_buffer(fsdata *mydata)
 {
-	int getsize = FATBUFBLOCKS;
-	__u32 fatlength = mydata->fatlength;
-	__u8 *bufptr = mydata->fatbuf;
-	__u32 startblock = mydata->fatbufnum * FATBUFBLOCKS;
+	__u32 startblock = mydata->fatbufnum * mydata->fatbufblocks;
+	int getsize = mydata->dirty_end - mydata->dirty_start;
+	__u8 *bufptr;
 
 	debug("debug: evicting %d, dirty: %d\n", mydata->fatbufnum,
 	      (int)mydata->fat_dirty);
@@ -229,11 +228,9 @@ static int flush_dirty_fat_buffer(fsdata *mydata)
 	if ((!mydata->fat_dirty) || (mydata->fatbufnum == -1))
 		return 0;
 
-	/* Cap length if fatlength is not a multiple of FATBUFBLOCKS */
-	if (startblock + getsize > fatlength)
-		getsize = fatlength - startblock;
-
-	startblock += mydata->fat_sect;
+	/* Only write back the sectors which were changed */
+	bufptr = mydata->fatbuf + mydata->dirty_start * mydata->sect_size;
+	startblock += mydata->fat_sect + mydata->dirty_start;
 
 	/* Write FAT buf */
 	if (disk_write(startblock, getsize, bufptr) < 0) {
@@ -254,6 +251,62 @@ static int flush_dirty_fat_buffer(fsdata *mydata)
 	return 0;
 }
 
+/* FAT32 FSInfo sector */
+#define FSINFO_LEAD_SIG		0x41615252
+#define FSINFO_STRUC_SIG	0x61417272
+#define FSINFO_STRUC_OFFSET	484
+#define FSINFO_FREE_OFFSET	488
+#define FSINFO_FREE_UNKNOWN	0xffffffff
+
+/*
+ * Update the free-cluster count in the FAT32 FSInfo sector. This is left
+ * alone if the count is not known, since the OS then works it out itself.
+ */
+static int flush_fsinfo(fsdata *mydata)
+{
+	ALLOC_CACHE_ALIGN_BUFFER(__u8, block, mydata->sect_size);
+	__u32 free_count;
+
+	if (mydata->fatsize != 32 || !mydata->fsinfo_sect ||
+	    !mydata->free_delta)
+		return 0;
+
+	if (disk_read(mydata->fsinfo_sect, 1, block) < 0) {
+		debug("error: reading FSInfo sector\n");
+		return -1;
+	}
+	if (get_unaligned_le32(block) != FSINFO_LEAD_SIG ||
+	    get_unaligned_le32(block + FSINFO_STRUC_OFFSET) !=
+	    FSINFO_STRUC_SIG)
+		return 0;
+
+	free_count = get_unaligned_le32(block + FSINFO_FREE_OFFSET);
+	if (free_count == FSINFO_FREE_UNKNOWN)
+		return 0;
+	put_unaligned_le32(free_count + mydata->free_delta,
+			   block + FSINFO_FREE_OFFSET);
+	if (disk_write(mydata->fsinfo_sect, 1, block) < 0) {
+		debug("error: writing FSInfo sector\n");
+		return -1;
+	}
+	mydata->free_delta = 0;
+
+	return 0;
+}
+
+/*
+ * Write back all changes to the FAT at the end of an operation. Until then
+ * they are held in the FAT buffer, so that it is written once rather than
+ * after each step.
+ */
+static int flush_fat(fsdata *mydata)
+{
+	if (flush_dirty_fat_buffer(mydata) < 0)
+		return -1;
+
+	return flush_fsinfo(mydata);
+}
+
 /**
  * fat_find_empty_dentries() - find a sequence of available directory entries
  *
@@ -436,13 +489,28 @@ fill_dir_slot(fat_itr *itr, const char *l_name, const char *shortname)
 	return 0;
 }
 
+static bool clust_used(fsdata *mydata, __u32 clust)
+{
+	return mydata->usedmap[BIT_WORD(clust)] & BIT_MASK(clust);
+}
+
+static void set_clust_used(fsdata *mydata, __u32 clust, bool used)
+{
+	if (used)
+		mydata->usedmap[BIT_WORD(clust)] |= BIT_MASK(clust);
+	else
+		mydata->usedmap[BIT_WORD(clust)] &= ~BIT_MASK(clust);
+}
+
 /*
  * Set the entry at index 'entry' in a FAT (12/16/32) table.
  */
 static int set_fatent_value(fsdata *mydata, __u32 entry, __u32 entry_value)
 {
 	__u32 bufnum, offset, off16;
+	__u32 first, last;
 	__u16 val1, val2;
+	bool used;
 
 	switch (mydata->fatsize) {
 	case 32:
@@ -464,12 +532,12 @@ static int set_fatent_value(fsdata *mydata, __u32 entry, __u32 entry_value)
 
 	/* Read a new block of FAT entries into the cache. */
 	if (bufnum != mydata->fatbufnum) {
-		int getsize = FATBUFBLOCKS;
+		int getsize = mydata->fatbufblocks;
 		__u8 *bufptr = mydata->fatbuf;
 		__u32 fatlength = mydata->fatlength;
-		__u32 startblock = bufnum * FATBUFBLOCKS;
+		__u32 startblock = bufnum * mydata->fatbufblocks;
 
-		/* Cap length if fatlength is not a multiple of FATBUFBLOCKS */
+		/* Cap length if fatlength is not a multiple of fatbufblocks */
 		if (startblock + getsize > fatlength)
 			getsize = fatlength - startblock;
 
@@ -485,7 +553,38 @@ static int set_fatent_value(fsdata *mydata, __u32 entry, __u32 entry_value)
 		mydata->fatbufnum = bufnum;
 	}
 
-	/* Mark as dirty */
+	/* Keep track of clusters being allocated and freed */
+	used = get_fatent(mydata, entry) != 0;
+	if (used != !!entry_value) {
+		mydata->free_delta += used ? 1 : -1;
+		if (entry < mydata->used_known)
+			set_clust_used(mydata, entry, !used);
+	}
+
+	/* Mark as dirty, including the second byte of a FAT12 entry */
+	switch (mydata->fatsize) {
+	case 32:
+		first = offset * 4;
+		last = first + 3;
+		break;
+	case 16:
+		first = offset * 2;
+		last = first + 1;
+		break;
+	default:
+		first = (offset * 3) / 2;
+		last = first + 1;
+		break;
+	}
+	first /= mydata->sect_size;
+	last = last / mydata->sect_size + 1;
+	if (!mydata->fat_dirty) {
+		mydata->dirty_start = first;
+		mydata->dirty_end = last;
+	} else {
+		mydata->dirty_start = min(mydata->dirty_start, first);
+		mydata->dirty_end = max(mydata->dirty_end, last);
+	}
 	mydata->fat_dirty = 1;
 
 	/* Set the actual entry */
@@ -542,22 +641,126 @@ static int set_fatent_value(fsdata *mydata, __u32 entry, __u32 entry_value)
 	return 0;
 }
 
+/*
+ * Get the number of entries in the FAT, which is limited both by the size of
+ * the table and by the number of clusters in the filesystem
+ */
+static __u32 fat_num_clust(fsdata *mydata)
+{
+	__u32 num = (mydata->total_sect - mydata->data_begin) /
+		mydata->clust_size;
+	u64 max = div_u64((u64)mydata->fatlength * mydata->sect_size * 8,
+			  mydata->fatsize);
+
+	return min_t(u64, num, max);
+}
+
+/**
+ * fat_scan_used() - record which clusters are in use
+ *
+ * The bitmap of clusters in use is built as allocation needs it, reading
+ * the FAT up to the end of the window holding @entry. This way each part of
+ * the FAT is only scanned once, however many clusters are allocated.
+ *
+ * @mydata:	filesystem data
+ * @entry:	FAT entry which must be recorded in the bitmap
+ * Return:	0 on success, -ENOMEM if the bitmap cannot be allocated
+ */
+static int fat_scan_used(fsdata *mydata, __u32 entry)
+{
+	__u32 per_buf, end;
+
+	if (!mydata->usedmap) {
+		mydata->num_clust = fat_num_clust(mydata);
+		mydata->usedmap = calloc(BITS_TO_LONGS(mydata->num_clust),
+					 sizeof(long));
+		if (!mydata->usedmap)
+			return -ENOMEM;
+
+		/* The first two entries are reserved */
+		set_clust_used(mydata, 0, true);
+		set_clust_used(mydata, 1, true);
+		mydata->used_known = 2;
+	}
+
+	switch (mydata->fatsize) {
+	case 32:
+		per_buf = FAT32BUFSIZE;
+		break;
+	case 16:
+		per_buf = FAT16BUFSIZE;
+		break;
+	default:
+		per_buf = FAT12BUFSIZE;
+		break;
+	}
+	end = min((entry / per_buf + 1) * per_buf, mydata->num_clust);
+
+	for (; mydata->used_known < end; mydata->used_known++) {
+		if (get_fatent(mydata, mydata->used_known))
+			set_clust_used(mydata, mydata->used_known, true);
+	}
+
+	return 0;
+}
+
+/**
+ * fat_find_free() - find a run of free clusters
+ *
+ * @mydata:	filesystem data
+ * @entry:	cluster to start searching from
+ * @count:	number of free clusters needed, one after the other
+ * Return:	first cluster of the run, or 0 if there is none
+ */
+static __u32 fat_find_free(fsdata *mydata, __u32 entry, __u32 count)
+{
+	__u32 start = 0, run = 0;
+
+	if (fat_scan_used(mydata, entry))
+		return 0;
+
+	for (; entry < mydata->num_clust; entry++) {
+		if (entry >= mydata->used_known &&
+		    fat_scan_used(mydata, entry))
+			return 0;
+
+		/* Skip quickly over clusters which are all in use */
+		if (!(entry % BITS_PER_LONG) &&
+		    entry + BITS_PER_LONG <= mydata->used_known &&
+		    mydata->usedmap[BIT_WORD(entry)] == ~0UL) {
+			entry += BITS_PER_LONG - 1;
+			run = 0;
+			continue;
+		}
+
+		if (clust_used(mydata, entry)) {
+			run = 0;
+			continue;
+		}
+		if (!run++)
+			start = entry;
+		if (run == count)
+			return start;
+	}
+
+	return 0;
+}
+
 /*
  * Determine the next free cluster after 'entry' in a FAT (12/16/32) table
  * and link it to 'entry'. EOC marker is not set on returned entry.
+ * Return 0 if there are no free clusters.
  */
 static __u32 determine_fatent(fsdata *mydata, __u32 entry)
 {
-	__u32 next_fat, next_entry = entry + 1;
+	__u32 next_entry;
 
-	while (1) {
-		next_fat = get_fatent(mydata, next_entry);
-		if (next_fat == 0) {
-			/* found free entry, link to entry */
-			set_fatent_value(mydata, entry, next_entry);
-			break;
-		}
-		next_entry++;
+	next_entry = fat_find_free(mydata, entry + 1, 1);
+	if (!next_entry)
+		next_entry = fat_find_free(mydata, 3, 1);
+	if (next_entry) {
+		/* found free entry, link to entry */
+		set_fatent_value(mydata, entry, next_entry);
 	}
 	debug("FAT%d: entry: %08x, entry_value: %04x\n",
 	       mydata->fatsize, entry, next_entry);
@@ -801,18 +1004,18 @@ get_set_cluster(fsdata *mydata, __u32 clustnum, loff_t pos, __u8 *buffer,
 }
 
 /*
- * Find the first empty cluster
+ * Find the first run of 'count' empty clusters, so that a new file can be
+ * written in one piece, or failing that the first empty cluster.
+ * Return 0 if the filesystem is full.
  */
-static int find_empty_cluster(fsdata *mydata)
+static __u32 find_empty_cluster(fsdata *mydata, __u32 count)
 {
-	__u32 fat_val, entry = 3;
+	__u32 entry = 0;
 
-	while (1) {
-		fat_val = get_fatent(mydata, entry);
-		if (fat_val == 0)
-			break;
-		entry++;
-	}
+	if (count > 1)
+		entry = fat_find_free(mydata, 3, count);
+	if (!entry)
+		entry = fat_find_free(mydata, 3, 1);
 
 	return entry;
 }
@@ -821,7 +1024,8 @@ static int find_empty_cluster(fsdata *mydata)
  * new_dir_table() - allocate a cluster for additional directory entries
  *
  * @itr:	directory iterator
- * Return:	0 on success, -EIO otherwise
+ * Return:	0 on success, -ENOSPC if the filesystem is full,
+ *		-EIO otherwise
  */
 static int new_dir_table(fat_itr *itr)
 {
@@ -830,7 +1034,9 @@ static int new_dir_table(fat_itr *itr)
 	int dir_oldclust = itr->clust;
 	unsigned int bytesperclust = mydata->clust_size * mydata->sect_size;
 
-	dir_newclust = find_empty_cluster(mydata);
+	dir_newclust = find_empty_cluster(mydata, 1);
+	if (!dir_newclust)
+		return -ENOSPC;
 
 	/*
 	 * Flush before updating FAT to ensure valid directory structure
@@ -850,7 +1056,12 @@ static int new_dir_table(fat_itr *itr)
 	else if (mydata->fatsize == 12)
 		set_fatent_value(mydata, dir_newclust, 0xff8);
 
-	if (flush_dirty_fat_buffer(mydata) < 0)
+	/*
+	 * Entries may be written to the new cluster before the operation
+	 * finishes, so link it into the directory on the device now, in case
+	 * the operation later fails
+	 */
+	if (flush_fat(mydata) < 0)
 		return -EIO;
 
 	itr->dent = (dir_entry *)itr->block;
@@ -862,6 +1073,9 @@ static int new_dir_table(fat_itr *itr)
 
 /*
  * Set empty cluster from 'entry' to the end of a file
+ *
+ * This is not flushed, so if the operation fails the file keeps its chain on
+ * the device, rather than being left pointing at free clusters.
  */
 static int clear_fatent(fsdata *mydata, __u32 entry)
 {
@@ -877,10 +1091,6 @@ static int clear_fatent(fsdata *mydata, __u32 entry)
 		entry = fat_val;
 	}
 
-	/* Flush fat buffer */
-	if (flush_dirty_fat_buffer(mydata) < 0)
-		return -1;
-
 	return 0;
 }
 
@@ -1072,14 +1282,25 @@ set_clusters:
 
 	/* Assure that curclust is valid */
 	if (!curclust) {
-		curclust = find_empty_cluster(mydata);
+		u32 count = div_u64(filesize + bytesperclust - 1,
+				    bytesperclust);
+
+		curclust = find_empty_cluster(mydata, count);
+		if (!curclust) {
+			printf("Error: no space left: %llu\n", filesize);
+			return -1;
+		}
 		set_start_cluster(mydata, dentptr, curclust);
 	} else {
 		newclust = get_fatent(mydata, curclust);
 
 		if (IS_LAST_CLUST(newclust, mydata->fatsize)) {
 			newclust = determine_fatent(mydata, curclust);
-			set_fatent_value(mydata, curclust, newclust);
+			if (!newclust) {
+				printf("Error: no space left: %llu\n",
+				       filesize);
+				return -1;
+			}
 			curclust = newclust;
 		} else {
 			debug("error: something wrong\n");
@@ -1099,6 +1320,11 @@ set_clusters:
 		/* search for consecutive clusters */
 		while (actsize < filesize) {
 			newclust = determine_fatent(mydata, endclust);
+			if (!newclust) {
+				printf("Error: no space left: %llu\n",
+				       filesize);
+				return -1;
+			}
 
 			if ((newclust - 1) != endclust)
 				/* write to <curclust..endclust> */
@@ -1463,7 +1689,7 @@ int file_fat_write_at(const char *filename, loff_t pos, void *buffer,
 	debug("attempt to write 0x%llx bytes\n", *actwrite);
 
 	/* Flush fat buffer */
-	ret = flush_dirty_fat_buffer(mydata);
+	ret = flush_fat(mydata);
 	if (ret) {
 		printf("Error: flush fat buffer\n");
 		ret = -EIO;
@@ -1476,6 +1702,7 @@ int file_fat_write_at(const char *filename, loff_t pos, void *buffer,
 exit:
 	free(filename_copy);
 	free(mydata->fatbuf);
+	free(mydata->usedmap);
 	free(itr);
 	return ret;
 }
@@ -1578,7 +1805,7 @@ static int delete_dentry_long(fat_itr *itr)
 
 	/* free cluster blocks */
 	clear_fatent(mydata, START(dent));
-	if (flush_dirty_fat_buffer(mydata) < 0) {
+	if (flush_fat(mydata) < 0) {
 		printf("Error: flush fat buffer\n");
 		return -EIO;
 	}
@@ -1666,6 +1893,7 @@ int fat_unlink(const char *filename)
 
 exit:
 	free(fsdata.fatbuf);
+	free(fsdata.usedmap);
 	free(itr);
 	free(filename_copy);
 
@@ -1797,7 +2025,7 @@ int fat_mkdir(const char *dirname)
 	}
 
 	/* Flush fat buffer */
-	ret = flush_dirty_fat_buffer(mydata);
+	ret = flush_fat(mydata);
 	if (ret) {
 		printf("Error: flush fat buffer\n");
 		ret = -EIO;
@@ -1810,6 +2038,7 @@ int fat_mkdir(const char *dirname)
 exit:
 	free(dirname_copy);
 	free(mydata->fatbuf);
+	free(mydata->usedmap);
 	free(itr);
 	free(dotdent);
 	return ret;
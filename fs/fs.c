@@ -26,6 +26,7 @@
 #include <asm/global_data.h>
 #include <asm/io.h>
 #include <div64.h>
+#include <linux/list.h>
 #include <linux/math64.h>
 #include <linux/sizes.h>
 #include <efi_loader.h>
@@ -157,6 +158,10 @@ struct fstype_info {
 	 * filesystem.
 	 */
 	bool null_dev_desc_ok;
+	/* Can file data be kept in the filesystem cache? */
+	bool cache;
+	/* Does .read() only support reading from the start of the file? */
+	bool read_from_start;
 	int (*probe)(struct blk_desc *fs_dev_desc,
 		     struct disk_partition *fs_partition);
 	int (*ls)(const char *dirname);
@@ -193,6 +198,7 @@ static struct fstype_info fstypes[] = {
 		.fstype = FS_TYPE_FAT,
 		.name = "fat",
 		.null_dev_desc_ok = false,
+		.cache = true,
 		.probe = fat_set_blk_dev,
 		.close = fat_close,
 		.ls = fs_ls_generic,
@@ -221,6 +227,7 @@ static struct fstype_info fstypes[] = {
 		.fstype = FS_TYPE_EXT,
 		.name = "ext4",
 		.null_dev_desc_ok = false,
+		.cache = true,
 		.probe = ext4fs_probe,
 		.close = ext4fs_close,
 		.ls = ext4fs_ls,
@@ -305,6 +312,7 @@ static struct fstype_info fstypes[] = {
 		.fstype = FS_TYPE_BTRFS,
 		.name = "btrfs",
 		.null_dev_desc_ok = false,
+		.cache = true,
 		.probe = btrfs_probe,
 		.close = btrfs_close,
 		.ls = btrfs_ls,
@@ -325,6 +333,8 @@ static struct fstype_info fstypes[] = {
 		.fstype = FS_TYPE_SQUASHFS,
 		.name = "squashfs",
 		.null_dev_desc_ok = false,
+		.cache = true,
+		.read_from_start = true,
 		.probe = sqfs_probe,
 		.opendir = sqfs_opendir,
 		.readdir = sqfs_readdir,
@@ -346,6 +356,7 @@ static struct fstype_info fstypes[] = {
 		.fstype = FS_TYPE_EROFS,
 		.name = "erofs",
 		.null_dev_desc_ok = false,
+		.cache = true,
 		.probe = erofs_probe,
 		.opendir = erofs_opendir,
 		.readdir = erofs_readdir,
@@ -395,6 +406,360 @@ static struct fstype_info *fs_get_info(int fstype)
 	return info;
 }
 
+#define FS_CACHE_PAGE_SIZE	SZ_4K
+#define FS_CACHE_MAX_FILES	64
+
+#if CONFIG_IS_ENABLED(FS_CACHE)
+#define FS_CACHE_BYTES		((ulong)CONFIG_FS_CACHE_SIZE << 10)
+#define FS_CACHE_AHEAD		((loff_t)CONFIG_FS_CACHE_READAHEAD << 10)
+#else
+#define FS_CACHE_BYTES		0UL
+#define FS_CACHE_AHEAD		0
+#endif
+
+/**
+ * struct fs_cache_file - A file whose size or data is cached
+ *
+ * @sibling:	Link in the fs_cache_files list, most recently used first
+ * @pages:	List of cached pages of the file
+ * @desc:	Block device holding the filesystem
+ * @part_start:	Start of the partition holding the filesystem
+ * @fstype:	Filesystem type
+ * @gen:	Block-cache generation of the device when the file was cached
+ * @name:	Path of the file
+ * @size:	Size of the file, or -1 if not known
+ * @next:	Offset after the last read, used to detect sequential reads
+ */
+struct fs_cache_file {
+	struct list_head sibling;
+	struct list_head pages;
+	struct blk_desc *desc;
+	lbaint_t part_start;
+	int fstype;
+	ulong gen;
+	char *name;
+	loff_t size;
+	loff_t next;
+};
+
+/**
+ * struct fs_cache_page - A page of file data
+ *
+ * @sibling:	Link in the file's list of pages
+ * @lru:	Link in the fs_cache_lru list, most recently used first
+ * @offset:	Offset of the page in the file, a multiple of the page size
+ * @len:	Number of valid bytes, less than the page size only at the end
+ *		of the file
+ * @data:	Contents of the page
+ */
+struct fs_cache_page {
+	struct list_head sibling;
+	struct list_head lru;
+	loff_t offset;
+	uint len;
+	char data[];
+};
+
+static LIST_HEAD(fs_cache_files);
+static LIST_HEAD(fs_cache_lru);
+static ulong fs_cache_bytes;
+static int fs_cache_nfiles;
+static struct fs_cache_stats fs_cache_counts;
+
+static ulong fs_cache_max(void)
+{
+	return FS_CACHE_BYTES;
+}
+
+void fs_cache_stats(struct fs_cache_stats *stats)
+{
+	*stats = fs_cache_counts;
+	memset(&fs_cache_counts, '\0', sizeof(fs_cache_counts));
+}
+
+/**
+ * fs_cache_small() - Check whether a read is small enough to be cached
+ *
+ * @info:	Current filesystem type
+ * @offset:	Offset in the file to read from
+ * @len:	Number of bytes to read, 0 to read to the end of the file
+ * Return: true if the read can be served from the cache, false if it is
+ * large or its size is not known before the file's size is
+ */
+static bool fs_cache_small(struct fstype_info *info, loff_t offset,
+			   loff_t len)
+{
+	if (!len)
+		return false;
+	if (info->read_from_start)
+		len += offset;
+
+	return len <= fs_cache_max() / 4;
+}
+
+static void fs_cache_drop_page(struct fs_cache_page *page)
+{
+	list_del(&page->sibling);
+	list_del(&page->lru);
+	fs_cache_bytes -= FS_CACHE_PAGE_SIZE;
+	free(page);
+}
+
+static void fs_cache_drop_pages(struct fs_cache_file *file)
+{
+	struct fs_cache_page *page, *n;
+
+	list_for_each_entry_safe(page, n, &file->pages, sibling)
+		fs_cache_drop_page(page);
+}
+
+static void fs_cache_drop_file(struct fs_cache_file *file)
+{
+	fs_cache_drop_pages(file);
+	list_del(&file->sibling);
+	fs_cache_nfiles--;
+	free(file->name);
+	free(file);
+}
+
+/* Drop everything cached for a device, or for all devices if @desc is NULL */
+static void fs_cache_invalidate(struct blk_desc *desc)
+{
+	struct fs_cache_file *file, *n;
+
+	if (!CONFIG_IS_ENABLED(FS_CACHE))
+		return;
+
+	list_for_each_entry_safe(file, n, &fs_cache_files, sibling) {
+		if (!desc || file->desc == desc)
+			fs_cache_drop_file(file);
+	}
+}
+
+/**
+ * fs_cache_get_file() - Find a file in the cache of the current filesystem
+ *
+ * @info:	Current filesystem type
+ * @filename:	Path of the file
+ * @create:	true to add the file if it is not in the cache
+ * Return: cache entry, or NULL if the file is not cached or cannot be
+ * cached
+ */
+static struct fs_cache_file *fs_cache_get_file(struct fstype_info *info,
+					       const char *filename,
+					       bool create)
+{
+	struct fs_cache_file *file;
+	ulong gen;
+
+	if (!CONFIG_IS_ENABLED(FS_CACHE) || !info->cache || !fs_dev_desc)
+		return NULL;
+
+	gen = blkcache_generation(fs_dev_desc->uclass_id, fs_dev_desc->devnum);
+	list_for_each_entry(file, &fs_cache_files, sibling) {
+		if (file->desc != fs_dev_desc ||
+		    file->part_start != fs_partition.start ||
+		    file->fstype != info->fstype || strcmp(file->name, filename))
+			continue;
+
+		/* The device has been written or reinitialised since */
+		if (file->gen != gen) {
+			fs_cache_drop_pages(file);
+			file->gen = gen;
+			file->size = -1;
+			file->next = 0;
+		}
+		list_move(&file->sibling, &fs_cache_files);
+
+		return file;
+	}
+
+	if (!create)
+		return NULL;
+
+	if (fs_cache_nfiles >= FS_CACHE_MAX_FILES)
+		fs_cache_drop_file(list_last_entry(&fs_cache_files,
+						   struct fs_cache_file,
+						   sibling));
+
+	file = calloc(1, sizeof(*file));
+	if (!file)
+		return NULL;
+	file->name = strdup(filename);
+	if (!file->name) {
+		free(file);
+		return NULL;
+	}
+	INIT_LIST_HEAD(&file->pages);
+	file->desc = fs_dev_desc;
+	file->part_start = fs_partition.start;
+	file->fstype = info->fstype;
+	file->gen = gen;
+	file->size = -1;
+	list_add(&file->sibling, &fs_cache_files);
+	fs_cache_nfiles++;
+
+	return file;
+}
+
+static struct fs_cache_page *fs_cache_find_page(struct fs_cache_file *file,
+						loff_t offset)
+{
+	struct fs_cache_page *page;
+
+	list_for_each_entry(page, &file->pages, sibling) {
+		if (page->offset == offset) {
+			list_move(&page->lru, &fs_cache_lru);
+			return page;
+		}
+	}
+
+	return NULL;
+}
+
+static void fs_cache_add_page(struct fs_cache_file *file, loff_t offset,
+			      const void *data, uint len)
+{
+	struct fs_cache_page *page;
+
+	while (fs_cache_bytes + FS_CACHE_PAGE_SIZE > fs_cache_max())
+		fs_cache_drop_page(list_last_entry(&fs_cache_lru,
+						   struct fs_cache_page, lru));
+
+	page = malloc(sizeof(*page) + FS_CACHE_PAGE_SIZE);
+	if (!page)
+		return;
+	page->offset = offset;
+	page->len = len;
+	memcpy(page->data, data, len);
+	list_add(&page->sibling, &file->pages);
+	list_add(&page->lru, &fs_cache_lru);
+	fs_cache_bytes += FS_CACHE_PAGE_SIZE;
+}
+
+/**
+ * fs_cache_fill() - Read pages of a file into the cache
+ *
+ * This reads from the page at @start up to @end, or up to the first page
+ * which is already cached, adding read-ahead if requested.
+ *
+ * @info:	Current filesystem type
+ * @file:	File to read
+ * @start:	Offset of the first page to read
+ * @end:	Offset after the last byte needed
+ * @ahead:	true to read ahead beyond @end
+ * Return: 0 if OK, -ve on error
+ */
+static int fs_cache_fill(struct fstype_info *info, struct fs_cache_file *file,
+			 loff_t start, loff_t end, bool ahead)
+{
+	loff_t pos, from, got;
+	char *buf;
+	int ret;
+
+	if (ahead && FS_CACHE_AHEAD) {
+		end += FS_CACHE_AHEAD;
+		fs_cache_counts.readaheads++;
+	}
+	end = min(ALIGN(end, FS_CACHE_PAGE_SIZE), file->size);
+	end = min(end, start + (loff_t)fs_cache_max() / 2);
+	for (pos = start + FS_CACHE_PAGE_SIZE; pos < end;
+	     pos += FS_CACHE_PAGE_SIZE) {
+		if (fs_cache_find_page(file, pos)) {
+			end = pos;
+			break;
+		}
+	}
+
+	from = info->read_from_start ? 0 : start;
+	buf = malloc(end - from);
+	if (!buf)
+		return -ENOMEM;
+	fs_cache_counts.misses++;
+	ret = info->read(file->name, buf, from, end - from, &got);
+	if (ret) {
+		free(buf);
+		return ret;
+	}
+
+	for (pos = start; pos < from + got; pos += FS_CACHE_PAGE_SIZE) {
+		if (!fs_cache_find_page(file, pos))
+			fs_cache_add_page(file, pos, buf + pos - from,
+					  min_t(loff_t, FS_CACHE_PAGE_SIZE,
+						from + got - pos));
+	}
+	free(buf);
+
+	return 0;
+}
+
+/**
+ * fs_cache_read() - Read part of a file through the cache
+ *
+ * @info:	Current filesystem type
+ * @file:	File to read
+ * @buf:	Buffer to read into
+ * @offset:	Offset in the file to read from
+ * @len:	Number of bytes to read, 0 to read to the end of the file
+ * @actread:	Returns the number of bytes read
+ * Return: 0 if OK, -EAGAIN if the read should go to the filesystem instead,
+ * other -ve value on error
+ */
+static int fs_cache_read(struct fstype_info *info, struct fs_cache_file *file,
+			 void *buf, loff_t offset, loff_t len, loff_t *actread)
+{
+	loff_t pos, end, want, page_start;
+	struct fs_cache_page *page;
+	bool ahead, hit = true;
+	uint n;
+	int ret;
+
+	if (file->size < 0) {
+		fs_cache_counts.misses++;
+		hit = false;
+		ret = info->size(file->name, &file->size);
+		if (ret) {
+			fs_cache_drop_file(file);
+			return -EAGAIN;
+		}
+	}
+
+	/* Leave errors and large reads to the filesystem */
+	if (offset >= file->size)
+		return -EAGAIN;
+	want = file->size - offset;
+	if (len && len < want)
+		want = len;
+	if ((info->read_from_start ? offset + want : want) > fs_cache_max() / 4)
+		return -EAGAIN;
+
+	ahead = offset == file->next;
+	end = offset + want;
+	for (pos = offset; pos < end; pos += n) {
+		page_start = pos & ~(loff_t)(FS_CACHE_PAGE_SIZE - 1);
+		page = fs_cache_find_page(file, page_start);
+		if (!page) {
+			ret = fs_cache_fill(info, file, page_start, end, ahead);
+			if (ret)
+				return ret;
+			hit = false;
+			page = fs_cache_find_page(file, page_start);
+			if (!page)
+				return -EAGAIN;
+		}
+		if (pos - page_start >= page->len)
+			break;
+		n = min_t(loff_t, end - pos, page->len - (pos - page_start));
+		memcpy(buf + pos - offset, page->data + pos - page_start, n);
+	}
+	*actread = pos - offset;
+	file->next = pos;
+	if (hit)
+		fs_cache_counts.hits++;
+
+	return 0;
+}
+
 /**
  * fs_get_type() - Get type of current filesystem
  *
@@ -505,11 +870,18 @@ int fs_ls(const char *dirname)
 
 int fs_exists(const char *filename)
 {
+	struct fs_cache_file *file;
 	int ret;
 
 	struct fstype_info *info = fs_get_info(fs_type);
 
-	ret = info->exists(filename);
+	file = fs_cache_get_file(info, filename, false);
+	if (file && file->size >= 0) {
+		fs_cache_counts.hits++;
+		ret = 1;
+	} else {
+		ret = info->exists(filename);
+	}
 
 	fs_close();
 
@@ -518,11 +890,26 @@ int fs_exists(const char *filename)
 
 int fs_size(const char *filename, loff_t *size)
 {
+	struct fs_cache_file *file;
 	int ret;
 
 	struct fstype_info *info = fs_get_info(fs_type);
 
-	ret = info->size(filename, size);
+	file = fs_cache_get_file(info, filename, false);
+	if (file && file->size >= 0) {
+		fs_cache_counts.hits++;
+		*size = file->size;
+		ret = 0;
+	} else {
+		ret = info->size(filename, size);
+		if (!ret) {
+			file = fs_cache_get_file(info, filename, true);
+			if (file) {
+				fs_cache_counts.misses++;
+				file->size = *size;
+			}
+		}
+	}
 
 	fs_close();
 
@@ -534,15 +921,21 @@ int fs_size(const char *filename, loff_t *size)
 static int fs_read_lmb_check(const char *filename, ulong addr, loff_t offset,
 			     loff_t len, struct fstype_info *info)
 {
+	struct fs_cache_file *file;
 	struct lmb lmb;
 	int ret;
 	loff_t size;
 	loff_t read_len;
 
 	/* get the actual size of the file */
-	ret = info->size(filename, &size);
-	if (ret)
-		return ret;
+	file = fs_cache_get_file(info, filename, false);
+	if (file && file->size >= 0) {
+		size = file->size;
+	} else {
+		ret = info->size(filename, &size);
+		if (ret)
+			return ret;
+	}
 	if (offset >= size) {
 		/* offset >= EOF, no bytes will be written */
 		return 0;
@@ -556,11 +949,12 @@ static int fs_read_lmb_check(const char *filename, ulong addr, loff_t offset,
 	lmb_init_and_reserve(&lmb, gd->bd, (void *)gd->fdt_blob);
 	lmb_dump_all(&lmb);
 
-	if (lmb_alloc_addr(&lmb, addr, read_len) == addr)
-		return 0;
+	ret = lmb_alloc_addr(&lmb, addr, read_len) == addr ? 0 : -ENOSPC;
+	lmb_uninit(&lmb);
+	if (ret)
+		log_err("** Reading file would overwrite reserved memory **\n");
 
-	log_err("** Reading file would overwrite reserved memory **\n");
-	return -ENOSPC;
+	return ret;
 }
 #endif
 
@@ -568,6 +962,8 @@ static int _fs_read(const char *filename, ulong addr, loff_t offset, loff_t len,
 		    int do_lmb_check, loff_t *actread)
 {
 	struct fstype_info *info = fs_get_info(fs_type);
+	struct fs_cache_file *file;
+	bool small;
 	void *buf;
 	int ret;
 
@@ -584,7 +980,18 @@ static int _fs_read(const char *filename, ulong addr, loff_t offset, loff_t len,
 	 * means read the whole file.
 	 */
 	buf = map_sysmem(addr, len);
-	ret = info->read(filename, buf, offset, len, actread);
+	ret = -EAGAIN;
+
+	/*
+	 * Only small reads add a file to the cache. Reading to the end of the
+	 * file uses it only if the file's size is already known.
+	 */
+	small = fs_cache_small(info, offset, len);
+	file = fs_cache_get_file(info, filename, small);
+	if (file && (small || file->size >= 0))
+		ret = fs_cache_read(info, file, buf, offset, len, actread);
+	if (ret == -EAGAIN)
+		ret = info->read(filename, buf, offset, len, actread);
 	unmap_sysmem(buf);
 
 	/* If we requested a specific number of bytes, check we got it */
@@ -608,6 +1015,7 @@ int fs_write(const char *filename, ulong addr, loff_t offset, loff_t len,
 	void *buf;
 	int ret;
 
+	fs_cache_invalidate(fs_dev_desc);
 	buf = map_sysmem(addr, len);
 	ret = info->write(filename, buf, offset, len, actwrite);
 	unmap_sysmem(buf);
@@ -679,6 +1087,7 @@ int fs_unlink(const char *filename)
 
 	struct fstype_info *info = fs_get_info(fs_type);
 
+	fs_cache_invalidate(fs_dev_desc);
 	ret = info->unlink(filename);
 
 	fs_close();
@@ -692,6 +1101,7 @@ int fs_mkdir(const char *dirname)
 
 	struct fstype_info *info = fs_get_info(fs_type);
 
+	fs_cache_invalidate(fs_dev_desc);
 	ret = info->mkdir(dirname);
 
 	fs_close();
@@ -704,6 +1114,7 @@ int fs_ln(const char *fname, const char *target)
 	struct fstype_info *info = fs_get_info(fs_type);
 	int ret;
 
+	fs_cache_invalidate(fs_dev_desc);
 	ret = info->ln(fname, target);
 
 	if (ret < 0) {
@@ -8,6 +8,7 @@
  */
 
 #include <asm/unaligned.h>
+#include <blk.h>
 #include <div64.h>
 #include <errno.h>
 #include <fs.h>
@@ -93,71 +94,105 @@ static int sqfs_calc_n_blks(__le64 start, __le64 end, u64 *offset)
 	return DIV_ROUND_UP(table_size + *offset, ctxt.cur_dev->blksz);
 }
 
+/* Drops the metadata and fragment blocks cached for the last filesystem */
+static void sqfs_cache_free(void)
+{
+	int i;
+
+	free(ctxt.inode_table);
+	free(ctxt.dir_table);
+	free(ctxt.dir_pos_list);
+	ctxt.inode_table = NULL;
+	ctxt.dir_table = NULL;
+	ctxt.dir_pos_list = NULL;
+	ctxt.dir_metablks = 0;
+
+	for (i = 0; i < ctxt.frag_blocks; i++)
+		free(ctxt.frag_entries[i]);
+	free(ctxt.frag_entries);
+	free(ctxt.frag_index);
+	ctxt.frag_entries = NULL;
+	ctxt.frag_index = NULL;
+	ctxt.frag_blocks = 0;
+
+	for (i = 0; i < ARRAY_SIZE(ctxt.frags); i++) {
+		free(ctxt.frags[i].data);
+		ctxt.frags[i].data = NULL;
+	}
+}
+
 /*
- * Retrieves fragment block entry and returns true if the fragment block is
- * compressed
+ * Reads the fragment index table, which holds the position of each metadata
+ * block of fragment block entries
  */
-static int sqfs_frag_lookup(u32 inode_fragment_index,
-			    struct squashfs_fragment_block_entry *e)
+static int sqfs_read_frag_index(void)
 {
-	u64 start, end, exp_tbl, n_blks, src_len, table_offset, start_block;
-	unsigned char *metadata_buffer, *metadata, *table;
-	struct squashfs_fragment_block_entry *entries;
 	struct squashfs_super_block *sblk = ctxt.sblk;
-	unsigned long dest_len;
-	int block, offset, ret;
-	u16 header;
-
-	metadata_buffer = NULL;
-	entries = NULL;
-	table = NULL;
-
-	if (inode_fragment_index >= get_unaligned_le32(&sblk->fragments))
-		return -EINVAL;
+	u64 start, n_blks, table_offset;
+	unsigned char *table;
+	int count, i;
 
+	count = DIV_ROUND_UP(get_unaligned_le32(&sblk->fragments),
+			     SQFS_MAX_ENTRIES);
 	start = get_unaligned_le64(&sblk->fragment_table_start);
-	end = get_unaligned_le64(&sblk->id_table_start);
-	exp_tbl = get_unaligned_le64(&sblk->export_table_start);
-
-	if (exp_tbl > start && exp_tbl < end)
-		end = exp_tbl;
-
 	n_blks = sqfs_calc_n_blks(sblk->fragment_table_start,
-				  cpu_to_le64(end), &table_offset);
-
-	start /= ctxt.cur_dev->blksz;
+				  cpu_to_le64(start + count * sizeof(u64)),
+				  &table_offset);
 
-	/* Allocate a proper sized buffer to store the fragment index table */
 	table = malloc_cache_aligned(n_blks * ctxt.cur_dev->blksz);
-	if (!table) {
-		ret = -ENOMEM;
-		goto out;
+	if (!table)
+		return -ENOMEM;
+
+	if (sqfs_disk_read(start / ctxt.cur_dev->blksz, n_blks, table) < 0) {
+		free(table);
+		return -EINVAL;
 	}
 
-	if (sqfs_disk_read(start, n_blks, table) < 0) {
-		ret = -EINVAL;
-		goto out;
+	ctxt.frag_index = malloc(count * sizeof(u64));
+	ctxt.frag_entries = calloc(count, sizeof(*ctxt.frag_entries));
+	if (!ctxt.frag_index || !ctxt.frag_entries) {
+		free(ctxt.frag_index);
+		free(ctxt.frag_entries);
+		ctxt.frag_index = NULL;
+		ctxt.frag_entries = NULL;
+		free(table);
+		return -ENOMEM;
 	}
 
-	block = SQFS_FRAGMENT_INDEX(inode_fragment_index);
-	offset = SQFS_FRAGMENT_INDEX_OFFSET(inode_fragment_index);
+	for (i = 0; i < count; i++)
+		ctxt.frag_index[i] = get_unaligned_le64(table + table_offset +
+							i * sizeof(u64));
+	ctxt.frag_blocks = count;
+	free(table);
 
-	/*
-	 * Get the start offset of the metadata block that contains the right
-	 * fragment block entry
-	 */
-	start_block = get_unaligned_le64(table + table_offset + block *
-					 sizeof(u64));
+	return 0;
+}
+
+/* Reads and decompresses one metadata block of fragment block entries */
+static int sqfs_read_frag_entries(int block)
+{
+	u64 start, end, n_blks, src_len, table_offset, start_block;
+	struct squashfs_fragment_block_entry *entries = NULL;
+	struct squashfs_super_block *sblk = ctxt.sblk;
+	unsigned char *metadata_buffer, *metadata;
+	unsigned long dest_len;
+	int ret = 0;
+	u16 header;
+
+	/* Only the block itself is needed, not the rest of the table */
+	start_block = ctxt.frag_index[block];
+	end = min(start_block + SQFS_HEADER_SIZE + SQFS_METADATA_BLOCK_SIZE,
+		  get_unaligned_le64(&sblk->fragment_table_start));
+	if (end <= start_block + SQFS_HEADER_SIZE)
+		return -EINVAL;
 
 	start = start_block / ctxt.cur_dev->blksz;
-	n_blks = sqfs_calc_n_blks(cpu_to_le64(start_block),
-				  sblk->fragment_table_start, &table_offset);
+	n_blks = sqfs_calc_n_blks(cpu_to_le64(start_block), cpu_to_le64(end),
+				  &table_offset);
 
 	metadata_buffer = malloc_cache_aligned(n_blks * ctxt.cur_dev->blksz);
-	if (!metadata_buffer) {
-		ret = -ENOMEM;
-		goto out;
-	}
+	if (!metadata_buffer)
+		return -ENOMEM;
 
 	if (sqfs_disk_read(start, n_blks, metadata_buffer) < 0) {
 		ret = -EINVAL;
@@ -167,9 +202,10 @@ static int sqfs_frag_lookup(u32 inode_fragment_index,
 	/* Every metadata block starts with a 16-bit header */
 	header = get_unaligned_le16(metadata_buffer + table_offset);
 	metadata = metadata_buffer + table_offset + SQFS_HEADER_SIZE;
+	src_len = SQFS_METADATA_SIZE(header);
 
-	if (!metadata || !header) {
-		ret = -ENOMEM;
+	if (!header || src_len > end - start_block - SQFS_HEADER_SIZE) {
+		ret = -EINVAL;
 		goto out;
 	}
 
@@ -180,7 +216,6 @@ static int sqfs_frag_lookup(u32 inode_fragment_index,
 	}
 
 	if (SQFS_COMPRESSED_METADATA(header)) {
-		src_len = SQFS_METADATA_SIZE(header);
 		dest_len = SQFS_METADATA_BLOCK_SIZE;
 		ret = sqfs_decompress(&ctxt, entries, &dest_len, metadata,
 				      src_len);
@@ -189,20 +224,125 @@ static int sqfs_frag_lookup(u32 inode_fragment_index,
 			goto out;
 		}
 	} else {
-		memcpy(entries, metadata, SQFS_METADATA_SIZE(header));
+		memcpy(entries, metadata, src_len);
 	}
 
-	*e = entries[offset];
-	ret = SQFS_COMPRESSED_BLOCK(e->size);
+	ctxt.frag_entries[block] = entries;
+	entries = NULL;
 
 out:
 	free(entries);
 	free(metadata_buffer);
-	free(table);
 
 	return ret;
 }
 
+/*
+ * Retrieves fragment block entry and returns true if the fragment block is
+ * compressed
+ */
+static int sqfs_frag_lookup(u32 inode_fragment_index,
+			    struct squashfs_fragment_block_entry *e)
+{
+	struct squashfs_super_block *sblk = ctxt.sblk;
+	int block, offset, ret;
+
+	if (inode_fragment_index >= get_unaligned_le32(&sblk->fragments))
+		return -EINVAL;
+
+	block = SQFS_FRAGMENT_INDEX(inode_fragment_index);
+	offset = SQFS_FRAGMENT_INDEX_OFFSET(inode_fragment_index);
+
+	if (!ctxt.frag_index) {
+		ret = sqfs_read_frag_index();
+		if (ret)
+			return ret;
+	}
+
+	if (!ctxt.frag_entries[block]) {
+		ret = sqfs_read_frag_entries(block);
+		if (ret)
+			return ret;
+	}
+
+	*e = ctxt.frag_entries[block][offset];
+
+	return SQFS_COMPRESSED_BLOCK(e->size);
+}
+
+/*
+ * Retrieves the decompressed contents of a fragment block, reading it only if
+ * it is not among the most recently used ones. The data belongs to the cache.
+ */
+static int sqfs_get_fragment(struct squashfs_fragment_block_entry *e,
+			     unsigned char **datap, unsigned long *sizep)
+{
+	struct squashfs_frag_cache *frag, *lru = ctxt.frags;
+	u64 start, n_blks, table_size, table_offset;
+	unsigned char *fragment, *data;
+	unsigned long dest_len;
+	int i, ret;
+
+	for (i = 0; i < ARRAY_SIZE(ctxt.frags); i++) {
+		frag = &ctxt.frags[i];
+		if (frag->data && frag->start == e->start) {
+			frag->last_used = ++ctxt.frag_tick;
+			*datap = frag->data;
+			*sizep = frag->size;
+			return 0;
+		}
+		if (lru->data && (!frag->data ||
+				  frag->last_used < lru->last_used))
+			lru = frag;
+	}
+
+	start = lldiv(e->start, ctxt.cur_dev->blksz);
+	table_size = SQFS_BLOCK_SIZE(e->size);
+	table_offset = e->start - (start * ctxt.cur_dev->blksz);
+	n_blks = DIV_ROUND_UP(table_size + table_offset, ctxt.cur_dev->blksz);
+
+	fragment = malloc_cache_aligned(n_blks * ctxt.cur_dev->blksz);
+	if (!fragment)
+		return -ENOMEM;
+
+	ret = sqfs_disk_read(start, n_blks, fragment);
+	if (ret < 0) {
+		free(fragment);
+		return ret;
+	}
+
+	if (SQFS_COMPRESSED_BLOCK(e->size)) {
+		dest_len = get_unaligned_le32(&ctxt.sblk->block_size);
+		data = malloc(dest_len);
+		if (!data) {
+			free(fragment);
+			return -ENOMEM;
+		}
+
+		ret = sqfs_decompress(&ctxt, data, &dest_len,
+				      fragment + table_offset, table_size);
+		free(fragment);
+		if (ret) {
+			free(data);
+			return ret;
+		}
+	} else {
+		data = fragment;
+		memmove(data, data + table_offset, table_size);
+		dest_len = table_size;
+	}
+
+	free(lru->data);
+	lru->start = e->start;
+	lru->size = dest_len;
+	lru->data = data;
+	lru->last_used = ++ctxt.frag_tick;
+	*datap = data;
+	*sizep = dest_len;
+
+	return 0;
+}
+
 /*
  * The entry name is a flexible array member, and we don't know its size before
  * actually reading the entry. So we need a first copy to retrieve this size so
@@ -880,11 +1020,9 @@ out:
 
 int sqfs_opendir(const char *filename, struct fs_dir_stream **dirsp)
 {
-	unsigned char *inode_table = NULL, *dir_table = NULL;
-	int j, token_count = 0, ret = 0, metablks_count;
+	int j, token_count = 0, ret = 0;
 	struct squashfs_dir_stream *dirs;
 	char **token_list = NULL, *path = NULL;
-	u32 *pos_list = NULL;
 
 	dirs = calloc(1, sizeof(*dirs));
 	if (!dirs)
@@ -897,16 +1035,23 @@ int sqfs_opendir(const char *filename, struct fs_dir_stream **dirsp)
 	dirs->inode_table = NULL;
 	dirs->dir_table = NULL;
 
-	ret = sqfs_read_inode_table(&inode_table);
-	if (ret) {
-		ret = -EINVAL;
-		goto out;
+	/* The tables are read once and kept in the context */
+	if (!ctxt.inode_table) {
+		ret = sqfs_read_inode_table(&ctxt.inode_table);
+		if (ret) {
+			ret = -EINVAL;
+			goto out;
+		}
 	}
 
-	metablks_count = sqfs_read_directory_table(&dir_table, &pos_list);
-	if (metablks_count < 1) {
-		ret = -EINVAL;
-		goto out;
+	if (!ctxt.dir_table) {
+		ret = sqfs_read_directory_table(&ctxt.dir_table,
+						&ctxt.dir_pos_list);
+		ctxt.dir_metablks = ret;
+		if (ret < 1) {
+			ret = -EINVAL;
+			goto out;
+		}
 	}
 
 	/* Tokenize filename */
@@ -936,10 +1081,10 @@ int sqfs_opendir(const char *filename, struct fs_dir_stream **dirsp)
 	 * ldir's (extended directory) size is greater than dir, so it works as
 	 * a general solution for the malloc size, since 'i' is a union.
 	 */
-	dirs->inode_table = inode_table;
-	dirs->dir_table = dir_table;
-	ret = sqfs_search_dir(dirs, token_list, token_count, pos_list,
-			      metablks_count);
+	dirs->inode_table = ctxt.inode_table;
+	dirs->dir_table = ctxt.dir_table;
+	ret = sqfs_search_dir(dirs, token_list, token_count, ctxt.dir_pos_list,
+			      ctxt.dir_metablks);
 	if (ret)
 		goto out;
 
@@ -963,12 +1108,9 @@ out:
 	for (j = 0; j < token_count; j++)
 		free(token_list[j]);
 	free(token_list);
-	free(pos_list);
 	free(path);
-	if (ret) {
-		free(inode_table);
+	if (ret)
 		free(dirs);
-	}
 
 	return ret;
 }
@@ -1091,6 +1233,7 @@ int sqfs_readdir(struct fs_dir_stream *fs_dirs, struct fs_dirent **dentp)
 int sqfs_probe(struct blk_desc *fs_dev_desc, struct disk_partition *fs_partition)
 {
 	struct squashfs_super_block *sblk;
+	ulong gen;
 	int ret;
 
 	ctxt.cur_dev = fs_dev_desc;
@@ -1109,6 +1252,21 @@ int sqfs_probe(struct blk_desc *fs_dev_desc, struct disk_partition *fs_partition
 
 	ctxt.sblk = sblk;
 
+	/*
+	 * Anything cached for another filesystem, or from before the device
+	 * was written to or rebound, cannot be used
+	 */
+	gen = blkcache_generation(fs_dev_desc->uclass_id, fs_dev_desc->devnum);
+	if (ctxt.cache_dev != fs_dev_desc || ctxt.cache_gen != gen ||
+	    ctxt.cache_part_start != fs_partition->start ||
+	    memcmp(&ctxt.cache_sblk, sblk, sizeof(*sblk))) {
+		sqfs_cache_free();
+		ctxt.cache_dev = fs_dev_desc;
+		ctxt.cache_gen = gen;
+		ctxt.cache_part_start = fs_partition->start;
+		ctxt.cache_sblk = *sblk;
+	}
+
 	ret = sqfs_decompressor_init(&ctxt);
 	if (ret) {
 		goto error;
@@ -1320,8 +1478,8 @@ static int sqfs_get_lregfile_info(struct squashfs_lreg_inode *lreg,
 int sqfs_read(const char *filename, void *buf, loff_t offset, loff_t len,
 	      loff_t *actread)
 {
-	char *dir = NULL, *fragment_block, *datablock = NULL;
-	char *fragment = NULL, *file = NULL, *resolved, *data;
+	char *dir = NULL, *datablock = NULL, *file = NULL, *resolved, *data;
+	unsigned char *fragment_block;
 	u64 start, n_blks, table_size, data_offset, table_offset, sparse_size;
 	int ret, j, i_number, datablk_count = 0;
 	struct squashfs_super_block *sblk = ctxt.sblk;
@@ -1526,53 +1684,20 @@ int sqfs_read(const char *filename, void *buf, loff_t offset, loff_t len,
 		goto out;
 	}
 
-	start = lldiv(frag_entry.start, ctxt.cur_dev->blksz);
-	table_size = SQFS_BLOCK_SIZE(frag_entry.size);
-	table_offset = frag_entry.start - (start * ctxt.cur_dev->blksz);
-	n_blks = DIV_ROUND_UP(table_size + table_offset, ctxt.cur_dev->blksz);
-
-	fragment = malloc_cache_aligned(n_blks * ctxt.cur_dev->blksz);
-
-	if (!fragment) {
-		ret = -ENOMEM;
+	ret = sqfs_get_fragment(&frag_entry, &fragment_block, &dest_len);
+	if (ret)
 		goto out;
-	}
 
-	ret = sqfs_disk_read(start, n_blks, fragment);
-	if (ret < 0)
+	if (finfo.offset + finfo.size - *actread > dest_len) {
+		ret = -EINVAL;
 		goto out;
-
-	/* File compressed and fragmented */
-	if (finfo.frag && finfo.comp) {
-		dest_len = get_unaligned_le32(&sblk->block_size);
-		fragment_block = malloc(dest_len);
-		if (!fragment_block) {
-			ret = -ENOMEM;
-			goto out;
-		}
-
-		ret = sqfs_decompress(&ctxt, fragment_block, &dest_len,
-				      (void *)fragment  + table_offset,
-				      frag_entry.size);
-		if (ret) {
-			free(fragment_block);
-			goto out;
-		}
-
-		memcpy(buf + *actread, &fragment_block[finfo.offset], finfo.size - *actread);
-		*actread = finfo.size;
-
-		free(fragment_block);
-
-	} else if (finfo.frag && !finfo.comp) {
-		fragment_block = (void *)fragment + table_offset;
-
-		memcpy(buf + *actread, &fragment_block[finfo.offset], finfo.size - *actread);
-		*actread = finfo.size;
 	}
 
+	memcpy(buf + *actread, &fragment_block[finfo.offset],
+	       finfo.size - *actread);
+	*actread = finfo.size;
+
 out:
-	free(fragment);
 	free(datablock);
 	free(file);
 	free(dir);
@@ -1712,6 +1837,8 @@ free_strings:
 void sqfs_close(void)
 {
 	sqfs_decompressor_cleanup(&ctxt);
+	if (!IS_ENABLED(CONFIG_FS_SQUASHFS_CACHE))
+		sqfs_cache_free();
 	free(ctxt.sblk);
 	ctxt.sblk = NULL;
 	ctxt.cur_dev = NULL;
@@ -1725,8 +1852,6 @@ void sqfs_closedir(struct fs_dir_stream *dirs)
 		return;
 
 	sqfs_dirs = (struct squashfs_dir_stream *)dirs;
-	free(sqfs_dirs->inode_table);
-	free(sqfs_dirs->dir_table);
 	free(sqfs_dirs->dir_header);
 	free(sqfs_dirs);
 }
@@ -71,6 +71,14 @@ struct squashfs_super_block {
 	__le64 export_table_start;
 };
 
+/* A decompressed fragment block, shared by the small files stored in it */
+struct squashfs_frag_cache {
+	u64 start;
+	unsigned long size;
+	unsigned char *data;
+	ulong last_used;
+};
+
 struct squashfs_ctxt {
 	struct disk_partition cur_part_info;
 	struct blk_desc *cur_dev;
@@ -78,6 +86,27 @@ struct squashfs_ctxt {
 #if IS_ENABLED(CONFIG_ZSTD)
 	void *zstd_workspace;
 #endif
+	/*
+	 * Decompressed metadata, kept until a different filesystem is probed.
+	 * 'cache_dev', 'cache_part_start' and 'cache_sblk' identify the
+	 * filesystem it belongs to, 'cache_gen' the block cache generation
+	 * of the device when it was read.
+	 */
+	struct blk_desc *cache_dev;
+	ulong cache_gen;
+	lbaint_t cache_part_start;
+	struct squashfs_super_block cache_sblk;
+	unsigned char *inode_table;
+	unsigned char *dir_table;
+	u32 *dir_pos_list;
+	int dir_metablks;
+	/* Fragment index table and the fragment entry blocks read so far */
+	u64 *frag_index;
+	struct squashfs_fragment_block_entry **frag_entries;
+	int frag_blocks;
+	struct squashfs_frag_cache
+		frags[CONFIG_FS_SQUASHFS_FRAGMENT_CACHE_SIZE];
+	ulong frag_tick;
 };
 
 struct squashfs_directory_index {
@@ -272,7 +301,7 @@ struct squashfs_dir_stream {
 	struct squashfs_ldir_inode i_ldir;
 	/*
 	 * References to the tables' beginnings. They are assigned in
-	 * sqfs_opendir() and freed in sqfs_closedir().
+	 * sqfs_opendir() and point to the tables cached in the context.
 	 */
 	unsigned char *inode_table;
 	unsigned char *dir_table;
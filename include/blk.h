@@ -111,18 +111,42 @@ struct blk_desc {
 /**
  * blkcache_read() - attempt to read a set of blocks from cache
  *
+ * This copies out blocks from the cache until it finds one which is not
+ * present, so the start of a read may come from the cache even if the rest
+ * must be read from the device.
+ *
  * @param iftype - uclass_id_x for type of device
  * @param dev - device index of particular type
  * @param start - starting block number
  * @param blkcnt - number of blocks to read
  * @param blksz - size in bytes of each block
  * @param buffer - buffer to contain cached data
+ * @param missp - if no blocks are in the cache, returns the number of blocks
+ *	from @start which must be read from the device, i.e. up to the next
+ *	cached block or @blkcnt
+ *
+ * Return: number of blocks at @start returned from cache, 0 if none
+ */
+lbaint_t blkcache_read(int iftype, int dev,
+		       lbaint_t start, lbaint_t blkcnt,
+		       unsigned long blksz, void *buffer, lbaint_t *missp);
+
+/**
+ * blkcache_readahead() - decide how many extra blocks to read
+ *
+ * This should be called before reading blocks which are not in the cache. If
+ * the read continues on from the last one, it returns the number of blocks
+ * to read after those requested, so that they can be added to the cache.
+ *
+ * @param iftype - uclass_id_x for type of device
+ * @param dev - device index of particular type
+ * @param start - starting block number
+ * @param blkcnt - number of blocks which are to be read
  *
- * Return: - 1 if block returned from cache, 0 otherwise.
+ * Return: number of blocks to read after @start + @blkcnt, 0 if none
  */
-int blkcache_read(int iftype, int dev,
-		  lbaint_t start, lbaint_t blkcnt,
-		  unsigned long blksz, void *buffer);
+lbaint_t blkcache_readahead(int iftype, int dev, lbaint_t start,
+			    lbaint_t blkcnt);
 
 /**
  * blkcache_fill() - make data read from a block device available
@@ -149,10 +173,23 @@ void blkcache_fill(int iftype, int dev,
  */
 void blkcache_invalidate(int iftype, int dev);
 
+/**
+ * blkcache_generation() - get the cache generation of a device
+ *
+ * This changes each time blkcache_invalidate() covers the device, so it
+ * can be used by caches above the block layer to tell whether the device
+ * may have been written or reinitialised since they read it.
+ *
+ * @param iftype - uclass_id_x for type of device
+ * @param dev - device index of particular type
+ * Return: generation of the device
+ */
+ulong blkcache_generation(int iftype, int dev);
+
 /**
  * blkcache_configure() - configure block cache
  *
- * @param blocks - maximum blocks per entry
+ * @param blocks - blocks per entry, at most 64
  * @param entries - maximum entries in cache
  */
 void blkcache_configure(unsigned blocks, unsigned entries);
@@ -163,11 +200,23 @@ void blkcache_configure(unsigned blocks, unsigned entries);
 struct block_cache_stats {
 	unsigned hits;
 	unsigned misses;
+	unsigned readaheads;
 	unsigned entries; /* current entry count */
 	unsigned max_blocks_per_entry;
 	unsigned max_entries;
 };
 
+/*
+ * statistics for one device using the block cache
+ */
+struct block_cache_dev_stats {
+	int iftype;
+	int devnum;
+	unsigned hits;
+	unsigned misses;
+	unsigned readaheads;
+};
+
 /**
  * get_blkcache_stats() - return statistics and reset
  *
@@ -175,14 +224,32 @@ struct block_cache_stats {
  */
 void blkcache_stats(struct block_cache_stats *stats);
 
+/**
+ * blkcache_dev_stats() - return statistics for a device and reset
+ *
+ * @param seq - sequence number of the device, starting at 0
+ * @param stats - statistics are copied here
+ * Return: 0 if OK, -ENOENT if there are no more devices
+ */
+int blkcache_dev_stats(int seq, struct block_cache_dev_stats *stats);
+
 /** blkcache_free() - free all memory allocated to the block cache */
 void blkcache_free(void);
 
 #else
 
-static inline int blkcache_read(int iftype, int dev,
-				lbaint_t start, lbaint_t blkcnt,
-				unsigned long blksz, void *buffer)
+static inline lbaint_t blkcache_read(int iftype, int dev,
+				     lbaint_t start, lbaint_t blkcnt,
+				     unsigned long blksz, void *buffer,
+				     lbaint_t *missp)
+{
+	*missp = blkcnt;
+
+	return 0;
+}
+
+static inline lbaint_t blkcache_readahead(int iftype, int dev,
+					  lbaint_t start, lbaint_t blkcnt)
 {
 	return 0;
 }
@@ -193,6 +260,11 @@ static inline void blkcache_fill(int iftype, int dev,
 
 static inline void blkcache_invalidate(int iftype, int dev) {}
 
+static inline ulong blkcache_generation(int iftype, int dev)
+{
+	return 0;
+}
+
 static inline void blkcache_free(void) {}
 
 #endif
@@ -540,8 +612,11 @@ static inline ulong blk_dread(struct blk_desc *block_dev, lbaint_t start,
 			      lbaint_t blkcnt, void *buffer)
 {
 	ulong blks_read;
+	lbaint_t miss;
+
 	if (blkcache_read(block_dev->uclass_id, block_dev->devnum,
-			  start, blkcnt, block_dev->blksz, buffer))
+			  start, blkcnt, block_dev->blksz, buffer,
+			  &miss) == blkcnt)
 		return blkcnt;
 
 	/*
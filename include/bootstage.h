@@ -213,6 +213,8 @@ enum bootstage_id {
 	BOOTSTAGE_ID_ACCUM_FSP_M,
 	BOOTSTAGE_ID_ACCUM_FSP_S,
 	BOOTSTAGE_ID_ACCUM_MMAP_SPI,
+	BOOTSTAGE_ID_ACCUM_HUSH,
+	BOOTSTAGE_ID_ACCUM_DCACHE,
 
 	/* a few spare for the user, from here */
 	BOOTSTAGE_ID_USER,
@@ -456,6 +458,56 @@ static inline int bootstage_init(bool first)
 
 #endif /* ENABLE_BOOTSTAGE */
 
+#if !defined(USE_HOSTCC) && CONFIG_IS_ENABLED(BOOTSTAGE_TIMING)
+/**
+ * bootstage_timing_start() - start timing an initcall or device probe
+ *
+ * Timings may nest, e.g. when probing a device probes its parent. The time
+ * spent in nested timings is subtracted from the enclosing one to give its
+ * self time. Strings are copied and may be truncated.
+ *
+ * If the table is full, the completed entry with the least time is dropped
+ * to make room.
+ *
+ * @kind:	Kind of entry, e.g. "initcall" or the uclass name of a device
+ * @name:	Name of the initcall or device
+ * @parent:	Name of the parent device, or NULL if none
+ * Return: slot to pass to bootstage_timing_end(), or -1 if not recorded
+ */
+int bootstage_timing_start(const char *kind, const char *name,
+			   const char *parent);
+
+/**
+ * bootstage_timing_end() - finish timing an initcall or device probe
+ *
+ * @slot:	Value returned by bootstage_timing_start()
+ */
+void bootstage_timing_end(int slot);
+
+/**
+ * bootstage_report_top() - print the most costly initcalls and device probes
+ *
+ * Entries are sorted by the time spent in them, excluding nested timings
+ *
+ * @count:	Maximum number of entries to print
+ */
+void bootstage_report_top(int count);
+#else
+static inline int bootstage_timing_start(const char *kind, const char *name,
+					 const char *parent)
+{
+	return -1;
+}
+
+static inline void bootstage_timing_end(int slot)
+{
+}
+
+static inline void bootstage_report_top(int count)
+{
+}
+#endif
+
 /* helpers for SPL */
 int _bootstage_stash_default(void);
 int _bootstage_unstash_default(void);
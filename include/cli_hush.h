@@ -38,6 +38,19 @@ static inline int set_local_var(const char *s, int flg_export)
 	return 0;
 }
 #endif
+#if CONFIG_IS_ENABLED(HUSH_PARSE_CACHE)
+/**
+ * hush_parse_cache_hits() - Get the number of scripts run from the cache
+ *
+ * Return: number of times a script was found already parsed
+ */
+unsigned long hush_parse_cache_hits(void);
+#else
+static inline unsigned long hush_parse_cache_hits(void)
+{
+	return 0;
+}
+#endif
 #if CONFIG_IS_ENABLED(HUSH_MODERN_PARSER)
 extern int u_boot_hush_start_modern(void);
 extern int parse_string_outer_modern(const char *str, int flag);
@@ -169,6 +169,44 @@ int console_announce_r(void);
  */
 void console_puts_select_stderr(bool serial_only, const char *s);
 
+#if CONFIG_IS_ENABLED(CONSOLE_BUFFER)
+/**
+ * console_buffer_flush() - Write out any buffered console output
+ *
+ * This is called before reading input, so that prompts are visible, and from
+ * flush(), which should be called before resetting or booting an OS
+ */
+void console_buffer_flush(void);
+
+/**
+ * console_buffer_poll() - Write out buffered output if it has waited too long
+ *
+ * This is called from schedule(), so that output does not stay in the buffer
+ * for much longer than CONFIG_CONSOLE_BUFFER_LATENCY_MS while U-Boot is busy
+ */
+void console_buffer_poll(void);
+
+/**
+ * console_buffer_pending() - Get the amount of buffered output
+ *
+ * Return: number of characters waiting to be written to stdout
+ */
+int console_buffer_pending(void);
+#else
+static inline void console_buffer_flush(void)
+{
+}
+
+static inline void console_buffer_poll(void)
+{
+}
+
+static inline int console_buffer_pending(void)
+{
+	return 0;
+}
+#endif
+
 /**
  * console_clear() - Clear the console
  *
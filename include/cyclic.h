@@ -14,6 +14,13 @@
 #include <linux/list.h>
 #include <asm/types.h>
 
+/*
+ * Number of lateness buckets kept for each function. Bucket n counts calls
+ * which started less than 10^(n + 1) us after their deadline, with the last
+ * bucket counting everything later than that.
+ */
+#define CYCLIC_LATE_BUCKETS	6
+
 /**
  * struct cyclic_info - Information about cyclic execution function
  *
@@ -23,9 +30,14 @@
  * @delay_ns: Delay is ns after which this function shall get executed
  * @start_time_us: Start time in us, when this function started its execution
  * @cpu_time_us: Total CPU time of this function
+ * @cpu_time_max_us: Longest CPU time of a single execution of this function
+ * @late_max_us: Longest time in us that an execution started after its
+ *	deadline
+ * @late_hist: Histogram of how late each execution started, see
+ *	CYCLIC_LATE_BUCKETS
  * @run_cnt: Counter of executions occurances
  * @next_call: Next time in us, when the function shall be executed again
- * @list: List node
+ * @list: List node, kept in order of @next_call
  * @already_warned: Flag that we've warned about exceeding CPU time usage
  */
 struct cyclic_info {
@@ -35,6 +47,9 @@ struct cyclic_info {
 	uint64_t delay_us;
 	uint64_t start_time_us;
 	uint64_t cpu_time_us;
+	uint64_t cpu_time_max_us;
+	uint64_t late_max_us;
+	uint64_t late_hist[CYCLIC_LATE_BUCKETS];
 	uint64_t run_cnt;
 	uint64_t next_call;
 	struct hlist_node list;
@@ -82,10 +97,13 @@ int cyclic_unregister_all(void);
 struct hlist_head *cyclic_get_list(void);
 
 /**
- * cyclic_run() - Interate over all registered cyclic functions
+ * cyclic_run() - Run the cyclic functions whose deadline has passed
  *
- * Interate over all registered cyclic functions and if the it's function
- * needs to be executed, then call into these registered functions.
+ * Functions are kept in order of their next deadline, so this only needs to
+ * look at the first one when nothing is due. Due functions are called in
+ * deadline order. Once one has run, others are only called while the time
+ * spent stays within CONFIG_CYCLIC_RUN_BUDGET_US; the rest are left for the
+ * next call.
  */
 void cyclic_run(void);
 
@@ -25,8 +25,9 @@ struct disk_partition;
 #define DIRENTSPERCLUST	((mydata->clust_size * mydata->sect_size) / \
 			 sizeof(dir_entry))
 
+/* Minimum size of the FAT buffer, a multiple of 3 to suit FAT12 */
 #define FATBUFBLOCKS	6
-#define FATBUFSIZE	(mydata->sect_size * FATBUFBLOCKS)
+#define FATBUFSIZE	(mydata->sect_size * mydata->fatbufblocks)
 #define FAT12BUFSIZE	((FATBUFSIZE*2)/3)
 #define FAT16BUFSIZE	(FATBUFSIZE/2)
 #define FAT32BUFSIZE	(FATBUFSIZE/4)
@@ -167,6 +168,14 @@ typedef struct {
 	__u32	fatlength;	/* Length of FAT in sectors */
 	__u16	fat_sect;	/* Starting sector of the FAT */
 	__u8	fat_dirty;      /* Set if fatbuf has been modified */
+	__u32	fatbufblocks;	/* Number of FAT sectors held in fatbuf */
+	__u32	dirty_start;	/* First modified sector in fatbuf */
+	__u32	dirty_end;	/* Sector after the last modified one */
+	unsigned long *usedmap;	/* Bitmap of clusters in use, when writing */
+	__u32	used_known;	/* Number of FAT entries recorded in usedmap */
+	__u32	num_clust;	/* Number of FAT entries, including reserved ones */
+	int	free_delta;	/* Change in the number of free clusters */
+	__u16	fsinfo_sect;	/* Sector of the FAT32 FSInfo structure */
 	__u32	rootdir_sect;	/* Start sector of root directory */
 	__u16	sect_size;	/* Size of sectors in bytes */
 	__u16	clust_size;	/* Size of clusters in sectors */
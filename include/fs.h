@@ -150,6 +150,26 @@ int fs_size(const char *filename, loff_t *size);
 int fs_read(const char *filename, ulong addr, loff_t offset, loff_t len,
 	    loff_t *actread);
 
+/**
+ * struct fs_cache_stats - statistics of the filesystem cache
+ *
+ * @hits:	size, exists and read calls answered from the cache
+ * @misses:	calls to the filesystem driver made to fill the cache
+ * @readaheads:	fills which read ahead beyond what was asked for
+ */
+struct fs_cache_stats {
+	uint hits;
+	uint misses;
+	uint readaheads;
+};
+
+/**
+ * fs_cache_stats() - return statistics of the filesystem cache and reset
+ *
+ * @stats:	statistics are copied here
+ */
+void fs_cache_stats(struct fs_cache_stats *stats);
+
 /**
  * fs_write() - write file to the partition previously set by fs_set_blk_dev()
  *
@@ -5,6 +5,8 @@
 
 #include <asm/types.h>
 #include <asm/u-boot.h>
+#include <linux/kernel.h>
+#include <linux/rbtree.h>
 
 /*
  * Logical memory blocks.
@@ -25,11 +27,17 @@ enum lmb_flags {
 /**
  * struct lmb_property - Description of one region.
  *
+ * @node:	Entry in the tree of regions, ordered by base address
+ * @next:	Next unused entry, while this entry is on a free list
  * @base:	Base address of the region.
  * @size:	Size of the region
  * @flags:	memory region attributes
  */
 struct lmb_property {
+	union {
+		struct rb_node node;
+		struct lmb_property *next;
+	};
 	phys_addr_t base;
 	phys_size_t size;
 	enum lmb_flags flags;
@@ -39,35 +47,45 @@ struct lmb_property {
  * For regions size management, see LMB configuration in KConfig
  * all the #if test are done with CONFIG_LMB_USE_MAX_REGIONS (boolean)
  *
+ * The regions are kept in a red-black tree, so there is no limit on their
+ * number. Entries are taken first from a pool built into struct lmb and,
+ * once that is used up, allocated with malloc(). The size of the pool is:
+ *
  * case 1. CONFIG_LMB_USE_MAX_REGIONS is defined (legacy mode)
- *         => CONFIG_LMB_MAX_REGIONS is used to configure the region size,
- *         directly in the array lmb_region.region[], with the same
- *         configuration for memory and reserved regions.
+ *         => CONFIG_LMB_MAX_REGIONS, for both memory and reserved regions
  *
  * case 2. CONFIG_LMB_USE_MAX_REGIONS is not defined, the size of each
- *         region is configurated *independently* with
+ *         pool is configured *independently* with
  *         => CONFIG_LMB_MEMORY_REGIONS: struct lmb.memory_regions
  *         => CONFIG_LMB_RESERVED_REGIONS: struct lmb.reserved_regions
- *         lmb_region.region is only a pointer to the correct buffer,
- *         initialized in lmb_init(). This configuration is useful to manage
- *         more reserved memory regions with CONFIG_LMB_RESERVED_REGIONS.
+ *
+ * Allocated entries are freed when their region goes away. Call
+ * lmb_uninit() before discarding a struct lmb which may hold more regions
+ * than its pool.
  */
+#if IS_ENABLED(CONFIG_LMB_USE_MAX_REGIONS)
+#define LMB_MEMORY_POOL		CONFIG_LMB_MAX_REGIONS
+#define LMB_RESERVED_POOL	CONFIG_LMB_MAX_REGIONS
+#else
+#define LMB_MEMORY_POOL		CONFIG_LMB_MEMORY_REGIONS
+#define LMB_RESERVED_POOL	CONFIG_LMB_RESERVED_REGIONS
+#endif
 
 /**
  * struct lmb_region - Description of a set of region.
  *
+ * @root: Tree of the regions, ordered by base address
  * @cnt: Number of regions.
- * @max: Size of the region array, max value of cnt.
- * @region: Array of the region properties
+ * @pool: Built-in entries, which are used before any are allocated
+ * @pool_size: Number of entries in @pool
+ * @free: List of unused entries in @pool
  */
 struct lmb_region {
+	struct rb_root root;
 	unsigned long cnt;
-	unsigned long max;
-#if IS_ENABLED(CONFIG_LMB_USE_MAX_REGIONS)
-	struct lmb_property region[CONFIG_LMB_MAX_REGIONS];
-#else
-	struct lmb_property *region;
-#endif
+	struct lmb_property *pool;
+	unsigned long pool_size;
+	struct lmb_property *free;
 };
 
 /**
@@ -80,19 +98,77 @@ struct lmb_region {
  *
  * @memory: Description of memory regions.
  * @reserved: Description of reserved regions.
- * @memory_regions: Array of the memory regions (statically allocated)
- * @reserved_regions: Array of the reserved regions (statically allocated)
+ * @memory_regions: Pool of entries for the memory regions
+ * @reserved_regions: Pool of entries for the reserved regions
  */
 struct lmb {
 	struct lmb_region memory;
 	struct lmb_region reserved;
-#if !IS_ENABLED(CONFIG_LMB_USE_MAX_REGIONS)
-	struct lmb_property memory_regions[CONFIG_LMB_MEMORY_REGIONS];
-	struct lmb_property reserved_regions[CONFIG_LMB_RESERVED_REGIONS];
-#endif
+	struct lmb_property memory_regions[LMB_MEMORY_POOL];
+	struct lmb_property reserved_regions[LMB_RESERVED_POOL];
 };
 
+/**
+ * lmb_first() - Get the region with the lowest base address
+ *
+ * @rgn:	set of regions
+ * Return:	region, or NULL if @rgn is empty
+ */
+static inline struct lmb_property *lmb_first(struct lmb_region *rgn)
+{
+	return rb_entry_safe(rb_first(&rgn->root), struct lmb_property, node);
+}
+
+/**
+ * lmb_next() - Get the region following another
+ *
+ * @prop:	region
+ * Return:	next region in address order, or NULL if @prop is the last
+ */
+static inline struct lmb_property *lmb_next(struct lmb_property *prop)
+{
+	return rb_entry_safe(rb_next(&prop->node), struct lmb_property, node);
+}
+
+/**
+ * lmb_for_each_region() - Iterate over a set of regions in address order
+ *
+ * @prop:	struct lmb_property * to use as the loop cursor
+ * @rgn:	set of regions
+ */
+#define lmb_for_each_region(prop, rgn) \
+	for (prop = lmb_first(rgn); prop; prop = lmb_next(prop))
+
+/**
+ * lmb_region_get() - Get a region by its position
+ *
+ * This walks the regions so is only intended for tests and debugging.
+ *
+ * @rgn:	set of regions
+ * @idx:	position of the region, in address order
+ * Return:	region, or NULL if @idx is not less than @rgn->cnt
+ */
+struct lmb_property *lmb_region_get(struct lmb_region *rgn, unsigned long idx);
+
+/**
+ * lmb_init() - Set up a logical memory block with no regions
+ *
+ * Any region entries allocated for an earlier use of @lmb are released, so
+ * a struct lmb can be set up again without calling lmb_uninit() first.
+ *
+ * @lmb:	the logical memory block struct
+ */
 void lmb_init(struct lmb *lmb);
+
+/**
+ * lmb_uninit() - Free the memory allocated for a logical memory block
+ *
+ * This releases the region entries which did not fit in the built-in pools.
+ * The struct lmb must be set up again with lmb_init() before reuse.
+ *
+ * @lmb:	the logical memory block struct
+ */
+void lmb_uninit(struct lmb *lmb);
 void lmb_init_and_reserve(struct lmb *lmb, struct bd_info *bd, void *fdt_blob);
 void lmb_init_and_reserve_range(struct lmb *lmb, phys_addr_t base,
 				phys_size_t size, void *fdt_blob);
@@ -117,6 +193,15 @@ phys_addr_t __lmb_alloc_base(struct lmb *lmb, phys_size_t size, ulong align,
 phys_addr_t lmb_alloc_addr(struct lmb *lmb, phys_addr_t base, phys_size_t size);
 phys_size_t lmb_get_free_size(struct lmb *lmb, phys_addr_t addr);
 
+/**
+ * lmb_get_reserved() - get the reserved region containing an address
+ *
+ * @lmb:	the logical memory block struct
+ * @addr:	address to look up
+ * Return:	reserved region comprising @addr, or NULL if there is none
+ */
+struct lmb_property *lmb_get_reserved(struct lmb *lmb, phys_addr_t addr);
+
 /**
  * lmb_is_reserved() - test if address is in reserved region
  *
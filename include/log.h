@@ -13,6 +13,7 @@
 #include <linker_lists.h>
 #include <dm/uclass-id.h>
 #include <linux/bitops.h>
+#include <linux/errno.h>
 #include <linux/list.h>
 
 struct cmd_tbl;
@@ -420,6 +421,7 @@ enum log_device_flags {
  *
  * @name: Name of driver
  * @emit: Method to call to emit a log record via this device
+ * @emit_fmt: Method to call to emit an unformatted log record
  * @flags: Initial value for flags (use LOGDF_ENABLE to enable on start-up)
  */
 struct log_driver {
@@ -432,6 +434,17 @@ struct log_driver {
 	 * for processing. The filter is checked before calling this function.
 	 */
 	int (*emit)(struct log_device *ldev, struct log_rec *rec);
+
+	/**
+	 * @emit_fmt: emit a log record without formatting the message
+	 *
+	 * If provided, this is called instead of @emit, with the format string
+	 * and arguments of the message. This allows the driver to defer the
+	 * cost of formatting. @rec->msg is only valid if another driver has
+	 * already needed the formatted message.
+	 */
+	int (*emit_fmt)(struct log_device *ldev, struct log_rec *rec,
+			const char *fmt, va_list args);
 	unsigned short flags;
 };
 
@@ -672,6 +685,35 @@ static inline int log_init(void)
 }
 #endif
 
+#if CONFIG_IS_ENABLED(LOG_RING)
+/**
+ * log_ring_dump() - format the records held in the log ring
+ *
+ * Records are formatted oldest first, using the current log format (see
+ * 'log format')
+ *
+ * @buf: Buffer to hold the text, or NULL to write it to the console
+ * @size: Size of @buf in bytes
+ * Return: number of bytes of text written to @buf, not including the nul
+ * terminator, or -ENOSPC if @buf is too small
+ */
+int log_ring_dump(char *buf, int size);
+
+/**
+ * log_ring_reset() - discard all the records held in the log ring
+ */
+void log_ring_reset(void);
+#else
+static inline int log_ring_dump(char *buf, int size)
+{
+	return -ENOSYS;
+}
+
+static inline void log_ring_reset(void)
+{
+}
+#endif
+
 /**
  * log_get_default_format() - get default log format
  *
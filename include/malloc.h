@@ -895,6 +895,65 @@ void malloc_enable_testing(int max_allocs);
 /** malloc_disable_testing() - Put malloc() into normal mode */
 void malloc_disable_testing(void);
 
+/**
+ * struct malloc_info - Heap usage, as collected with SYS_MALLOC_STATS
+ *
+ * @total_bytes: Size of the heap
+ * @in_use_bytes: Bytes currently allocated from the heap, including
+ *	allocator overhead and slab pages
+ * @max_claimed_bytes: Highest amount of the heap ever claimed with sbrk(),
+ *	i.e. the high-water mark of the heap top. Memory freed below the top
+ *	is still counted, so this is not the peak of @in_use_bytes
+ * @malloc_count: Number of calls to malloc(), calloc(), realloc() and
+ *	memalign()
+ * @free_count: Number of calls to free()
+ * @time_us: Time spent in the allocator, in microseconds
+ */
+struct malloc_info {
+	ulong total_bytes;
+	ulong in_use_bytes;
+	ulong max_claimed_bytes;
+	ulong malloc_count;
+	ulong free_count;
+	ulong time_us;
+};
+
+/**
+ * struct malloc_slab_info - Usage of a slab size class
+ *
+ * @size: Object size in bytes
+ * @per_page: Number of objects in each slab page
+ * @pages: Number of slab pages allocated
+ * @in_use: Number of objects allocated
+ * @peak: Highest value of @in_use
+ * @allocs: Total number of objects allocated from this class
+ */
+struct malloc_slab_info {
+	uint size;
+	uint per_page;
+	ulong pages;
+	ulong in_use;
+	ulong peak;
+	ulong allocs;
+};
+
+/**
+ * malloc_get_info() - Get heap usage statistics
+ *
+ * @info: Returns the statistics
+ */
+void malloc_get_info(struct malloc_info *info);
+
+/**
+ * malloc_get_slab_info() - Get the usage of a slab size class
+ *
+ * @idx: Index of the size class, starting at 0
+ * @info: Returns the usage
+ * Return: 0 if OK, -ENOENT if @idx is past the last size class or slabs are
+ *	not enabled
+ */
+int malloc_get_slab_info(uint idx, struct malloc_slab_info *info);
+
 #if CONFIG_IS_ENABLED(SYS_MALLOC_SIMPLE)
 #define malloc malloc_simple
 #define realloc realloc_simple
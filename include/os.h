@@ -530,6 +530,49 @@ int os_setup_signal_handlers(void);
  */
 void os_signal_action(int sig, unsigned long pc);
 
+/**
+ * os_profile_start() - start a periodic tick for the sampling profiler
+ *
+ * The tick is driven by the CPU time used by the process, so time spent
+ * waiting, e.g. for console input, is not sampled.
+ *
+ * @period_us:	time between ticks in microseconds
+ * @tick:	function to call from the signal handler on each tick, with
+ *		the interrupted program counter and frame pointer (both 0
+ *		if the host architecture is not supported) and the end of the
+ *		stack
+ * Return:	0 if OK, -ve on error
+ */
+int os_profile_start(unsigned int period_us,
+		     void (*tick)(unsigned long pc, unsigned long fp,
+				  unsigned long stack_top));
+
+/**
+ * os_profile_stop() - stop the periodic tick for the sampling profiler
+ */
+void os_profile_stop(void);
+
+/**
+ * os_perf_init() - open host performance counters
+ *
+ * This opens cycle, instruction, L1 data-cache miss and data-TLB miss
+ * counters for the sandbox process, in that order, counting in user space
+ * only. It does nothing if they are already open.
+ *
+ * @count:	number of counters, which must be 4
+ * Return:	0 if OK, -ve on error, e.g. if the host does not allow access
+ */
+int os_perf_init(unsigned int count);
+
+/**
+ * os_perf_read() - read the host performance counters
+ *
+ * @counts:	returns the value of each counter
+ * @count:	number of counters, which must be 4
+ * Return:	0 if OK, -ENODEV if not open, -EIO on read error
+ */
+int os_perf_read(unsigned long long *counts, unsigned int count);
+
 /**
  * os_get_time_offset() - get time offset
  *
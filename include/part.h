@@ -625,6 +625,20 @@ int get_disk_guid(struct blk_desc *desc, char *guid);
 
 #endif
 
+#if CONFIG_IS_ENABLED(EFI_PARTITION_CACHE)
+/**
+ * gpt_cache_drop() - Drop the GPT cached for a device
+ *
+ * This is called when the device is removed, so that the cached table
+ * does not outlive it.
+ *
+ * @desc:	block device descriptor
+ */
+void gpt_cache_drop(struct blk_desc *desc);
+#else
+static inline void gpt_cache_drop(struct blk_desc *desc) {}
+#endif
+
 #if CONFIG_IS_ENABLED(DOS_PARTITION)
 /**
  * is_valid_dos_buf() - Ensure that a DOS MBR image is valid
@@ -0,0 +1,100 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * Hardware performance counters
+ */
+
+#ifndef __PERF_H
+#define __PERF_H
+
+#include <linux/types.h>
+
+/**
+ * enum perf_event_id - events counted by the performance counters
+ *
+ * @PERF_CYCLES: CPU cycles
+ * @PERF_INSTRUCTIONS: instructions retired
+ * @PERF_CACHE_MISSES: level-1 data-cache refills
+ * @PERF_TLB_MISSES: level-1 data-TLB refills
+ * @PERF_EVENT_COUNT: number of events
+ */
+enum perf_event_id {
+	PERF_CYCLES,
+	PERF_INSTRUCTIONS,
+	PERF_CACHE_MISSES,
+	PERF_TLB_MISSES,
+
+	PERF_EVENT_COUNT,
+};
+
+/**
+ * struct perf_counts - a reading of all the counters
+ *
+ * @count: value of each counter, indexed by enum perf_event_id
+ * @wraps: number of times a counter wrapped more than once between two
+ *	readings, so that its count is too low. This only happens with
+ *	counters narrower than 64 bits which are not read often enough
+ */
+struct perf_counts {
+	u64 count[PERF_EVENT_COUNT];
+	u32 wraps;
+};
+
+/**
+ * perf_init() - set up and start the performance counters
+ *
+ * The counters run freely from then on. This may be called more than once.
+ *
+ * Return: 0 if OK, -ENODEV if there are no suitable counters, other -ve on
+ * error
+ */
+int perf_init(void);
+
+/**
+ * perf_read() - read the performance counters
+ *
+ * Counters which are narrower than 64 bits are extended in software, so they
+ * must be read at least once before they wrap. Wraps which are detected
+ * but cannot be accounted for are counted in @counts->wraps
+ *
+ * @counts:	returns the value of each counter
+ * Return: 0 if OK, -ENODEV if perf_init() has not succeeded
+ */
+int perf_read(struct perf_counts *counts);
+
+/**
+ * perf_sub() - work out the change in each counter between two readings
+ *
+ * @delta:	returns @end - @start for each counter
+ * @end:	later reading
+ * @start:	earlier reading
+ */
+static inline void perf_sub(struct perf_counts *delta,
+			    const struct perf_counts *end,
+			    const struct perf_counts *start)
+{
+	int i;
+
+	for (i = 0; i < PERF_EVENT_COUNT; i++)
+		delta->count[i] = end->count[i] - start->count[i];
+	delta->wraps = end->wraps - start->wraps;
+}
+
+/**
+ * perf_event_name() - get the name of an event
+ *
+ * @id:		event to check
+ * Return: name of the event
+ */
+static inline const char *perf_event_name(enum perf_event_id id)
+{
+	static const char *const names[PERF_EVENT_COUNT] = {
+		"cycles",
+		"instructions",
+		"cache-misses",
+		"tlb-misses",
+	};
+
+	return names[id];
+}
+
+#endif
@@ -0,0 +1,107 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * Sampling profiler
+ */
+
+#ifndef __PROFILE_H
+#define __PROFILE_H
+
+#include <linux/types.h>
+
+/**
+ * struct profile_stats - statistics about the samples taken
+ *
+ * @period_us:	time between samples in microseconds
+ * @running:	true while samples are being taken
+ * @samples:	number of samples taken
+ * @recorded:	number of samples currently held in the buffer
+ * @dropped:	number of samples overwritten because the buffer was full
+ * @unknown:	number of samples taken outside U-Boot's code
+ * @used:	bytes of the buffer in use
+ * @size:	size of the buffer in bytes
+ */
+struct profile_stats {
+	uint period_us;
+	bool running;
+	ulong samples;
+	ulong recorded;
+	ulong dropped;
+	ulong unknown;
+	ulong used;
+	ulong size;
+};
+
+/**
+ * profile_sample() - record a sample
+ *
+ * This is called from the periodic tick of the architecture. It records the
+ * interrupted program counter and the return addresses found by following
+ * the frame-pointer chain, which must lie on the current stack. Frames outside
+ * U-Boot's code are skipped.
+ *
+ * @pc:		program counter when the tick arrived
+ * @fp:		frame pointer when the tick arrived
+ * @stack_top:	end of the stack, above which no frame can lie
+ */
+void profile_sample(ulong pc, ulong fp, ulong stack_top);
+
+/**
+ * profile_start() - start taking samples
+ *
+ * The buffer is allocated on first use. Samples are kept from any previous
+ * run.
+ *
+ * @period_us:	time between samples in microseconds
+ * Return: 0 if OK, -ENOMEM if the buffer cannot be allocated, -EALREADY if
+ * already running, or another -ve error from the architecture
+ */
+int profile_start(uint period_us);
+
+/**
+ * profile_stop() - stop taking samples
+ */
+void profile_stop(void);
+
+/**
+ * profile_reset() - discard all samples and statistics
+ */
+void profile_reset(void);
+
+/**
+ * profile_get_stats() - get statistics about the samples taken
+ *
+ * @stats:	returns the statistics
+ */
+void profile_get_stats(struct profile_stats *stats);
+
+/**
+ * profile_list_samples() - write the recorded samples into a buffer
+ *
+ * This writes a struct trace_output_hdr of type TRACE_CHUNK_SAMPLES followed
+ * by the samples, oldest first, for use by proftool. The 'needed' parameter
+ * returns the number of bytes needed, which may be more than @buff_size.
+ *
+ * @buff:	buffer in which to place the data
+ * @buff_size:	size of buffer
+ * @needed:	returns number of bytes used / needed
+ * Return: 0 if OK, -ENOSPC if the buffer is too small
+ */
+int profile_list_samples(void *buff, size_t buff_size, size_t *needed);
+
+/**
+ * arch_profile_start() - start the periodic tick
+ *
+ * The architecture calls profile_sample() on every tick until
+ * arch_profile_stop() is called.
+ *
+ * @period_us:	time between ticks in microseconds
+ * Return: 0 if OK, -ENOSYS if there is no suitable timer
+ */
+int arch_profile_start(uint period_us);
+
+/**
+ * arch_profile_stop() - stop the periodic tick
+ */
+void arch_profile_stop(void);
+
+#endif
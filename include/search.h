@@ -44,9 +44,16 @@ struct env_entry {
 
 /* Data type for reentrant functions.  */
 struct hsearch_data {
-	struct env_entry_node *table;
-	unsigned int size;
-	unsigned int filled;
+	struct env_entry_node **table;	/* hashed slots, power-of-two size */
+	struct env_entry_node **sorted;	/* entries in ascending key order */
+	unsigned int size;		/* number of slots in table */
+	unsigned int filled;		/* number of entries */
+	bool dirty;			/* modified since last hclean_r() */
+	char *import_buf;		/* buffer kept by a H_ZEROCOPY import */
+	size_t import_size;
+	struct env_entry_node *pool;	/* nodes allocated by that import */
+	unsigned int pool_size;
+	unsigned int pool_used;
 /*
  * Callback function which will check whether the given change for variable
  * "item" to "newval" may be applied or not, and possibly apply such change.
@@ -58,7 +65,10 @@ struct hsearch_data {
 			 enum env_op, int flag);
 };
 
-/* Create a new hash table which will contain at most "nel" elements.  */
+/*
+ * Create a new hash table with room for "nel" elements; it grows as needed
+ * when more are added.
+ */
 int hcreate_r(size_t nel, struct hsearch_data *htab);
 
 /* Destroy current internal hash table.  */
@@ -103,10 +113,24 @@ int himport_r(struct hsearch_data *htab, const char *env, size_t size,
 	      const char sep, int flag, int crlf_is_lf, int nvars,
 	      char * const vars[]);
 
-/* Walk the whole table calling the callback on each element */
+/* Walk the whole table, in key order, calling the callback on each element */
 int hwalk_r(struct hsearch_data *htab,
 	    int (*callback)(struct env_entry *entry));
 
+/**
+ * hclean_r() - Mark the hash table as in sync with its backing store
+ *
+ * Any later change to the table (create, overwrite or delete of an entry)
+ * sets @htab->dirty again, so callers can skip writing out an unchanged
+ * table.
+ *
+ * @htab: Hash table
+ */
+static inline void hclean_r(struct hsearch_data *htab)
+{
+	htab->dirty = false;
+}
+
 /* Flags for himport_r(), hexport_r(), hdelete_r(), and hsearch_r() */
 #define H_NOCLEAR	(1 << 0) /* do not clear hash table before importing */
 #define H_FORCE		(1 << 1) /* overwrite read-only/write-once variables */
@@ -123,5 +147,6 @@ int hwalk_r(struct hsearch_data *htab,
 #define H_ORIGIN_FLAGS	(H_INTERACTIVE | H_PROGRAMMATIC)
 #define H_DEFAULT	(1 << 10) /* indicate that an import is default env */
 #define H_EXTERNAL	(1 << 11) /* indicate that an import is external env */
+#define H_ZEROCOPY	(1 << 12) /* keep the import buffer, point into it */
 
 #endif /* _SEARCH_H_ */
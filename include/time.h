@@ -36,6 +36,16 @@ unsigned long get_timer_us_long(unsigned long base);
  */
 void timer_test_add_offset(unsigned long offset);
 
+/**
+ * timer_test_freeze() - Stop or restart the time seen by tests
+ *
+ * While the time is stopped, it only moves when timer_test_add_offset() is
+ * called. When it restarts, it jumps to the host time plus any offset.
+ *
+ * @freeze: true to stop the time, false to let it run again
+ */
+void timer_test_freeze(bool freeze);
+
 /**
  * usec_to_tick() - convert microseconds to clock ticks
  *
@@ -34,6 +34,7 @@ enum {
 enum trace_chunk_type {
 	TRACE_CHUNK_FUNCS,
 	TRACE_CHUNK_CALLS,
+	TRACE_CHUNK_SAMPLES,
 };
 
 /* A trace record for a function, as written to the profile output file */
@@ -42,12 +43,17 @@ struct trace_output_func {
 	uint32_t call_count;		/* Number of times called */
 };
 
-/* A header at the start of the trace output buffer */
+/*
+ * A header at the start of the trace output buffer
+ *
+ * For TRACE_CHUNK_SAMPLES, each of the rec_count records is a uint32_t frame
+ * count followed by that many uint32_t code offsets, innermost frame first.
+ */
 struct trace_output_hdr {
 	enum trace_chunk_type type;	/* Record type */
 	uint32_t version;		/* Version (TRACE_VERSION) */
 	uint32_t rec_count;		/* Number of records */
-	uint32_t spare;			/* 0 */
+	uint32_t spare;			/* Sample period in us for samples, else 0 */
 	uint64_t text_base;		/* Value of CONFIG_TEXT_BASE */
 	uint64_t spare2;		/* 0 */
 };
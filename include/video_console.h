@@ -529,6 +529,16 @@ void vidconsole_list_fonts(struct udevice *dev);
  */
 int vidconsole_get_font_size(struct udevice *dev, const char **name, uint *sizep);
 
+/**
+ * console_truetype_glyph_hits() - get the number of glyphs reused from cache
+ *
+ * This is used by tests to check that the TrueType glyph cache is working
+ *
+ * @dev: TrueType vidconsole device
+ * Return: number of characters written using a cached glyph
+ */
+uint console_truetype_glyph_hits(struct udevice *dev);
+
 #ifdef CONFIG_VIDEO_COPY
 /**
  * vidconsole_sync_copy() - Sync back to the copy framebuffer
@@ -16,7 +16,7 @@
 #include <asm/cache.h>
 #include <asm/global_data.h>
 #include <asm/sections.h>
-#include <linux/list_sort.h>
+#include <linux/rbtree_augmented.h>
 #include <linux/sizes.h>
 
 DECLARE_GLOBAL_DATA_PTR;
@@ -26,18 +26,23 @@ DECLARE_GLOBAL_DATA_PTR;
 
 efi_uintn_t efi_memory_map_key;
 
-struct efi_mem_list {
-	struct list_head link;
+/**
+ * struct efi_mem_node - memory map entry
+ *
+ * @node:	node in the memory map tree, ordered by start address
+ * @max_free:	number of pages of the largest conventional memory area in the
+ *		subtree below and including this node
+ * @desc:	memory descriptor
+ */
+struct efi_mem_node {
+	struct rb_node node;
+	u64 max_free;
 	struct efi_mem_desc desc;
 };
 
-#define EFI_CARVE_NO_OVERLAP		-1
-#define EFI_CARVE_LOOP_AGAIN		-2
-#define EFI_CARVE_OVERLAPS_NONRAM	-3
-#define EFI_CARVE_OUT_OF_RESOURCES	-4
-
-/* This list contains all memory map items */
-static LIST_HEAD(efi_mem);
+/* This tree contains all memory map items */
+static struct rb_root efi_mem = RB_ROOT;
+static efi_uintn_t efi_mem_count;
 
 #ifdef CONFIG_EFI_LOADER_BOUNCE_BUFFER
 void *efi_bounce_buffer;
@@ -83,32 +88,45 @@ static u64 checksum(struct efi_pool_allocation *alloc)
 }
 
 /**
- * efi_mem_cmp() - comparator function for sorting memory map
+ * efi_mem_free_pages() - get number of free RAM pages in a memory area
  *
- * Sorts the memory list from highest address to lowest address
- *
- * When allocating memory we should always start from the highest
- * address chunk, so sort the memory list such that the first list
- * iterator gets the highest address and goes lower from there.
+ * @mem:	memory map entry
+ * Return:	number of pages if @mem is conventional memory, else 0
+ */
+static u64 efi_mem_free_pages(struct efi_mem_node *mem)
+{
+	if (mem->desc.type != EFI_CONVENTIONAL_MEMORY)
+		return 0;
+
+	return mem->desc.num_pages;
+}
+
+/**
+ * efi_mem_compute_max() - compute largest free RAM area in a subtree
  *
- * @priv:	unused
- * @a:		first memory area
- * @b:		second memory area
- * Return:	1 if @a is before @b, -1 if @b is before @a, 0 if equal
+ * @mem:	root of the subtree
+ * Return:	number of pages in the largest conventional memory area
  */
-static int efi_mem_cmp(void *priv, struct list_head *a, struct list_head *b)
+static u64 efi_mem_compute_max(struct efi_mem_node *mem)
 {
-	struct efi_mem_list *mema = list_entry(a, struct efi_mem_list, link);
-	struct efi_mem_list *memb = list_entry(b, struct efi_mem_list, link);
+	u64 max_free = efi_mem_free_pages(mem);
+	struct efi_mem_node *child;
 
-	if (mema->desc.physical_start == memb->desc.physical_start)
-		return 0;
-	else if (mema->desc.physical_start < memb->desc.physical_start)
-		return 1;
-	else
-		return -1;
+	if (mem->node.rb_left) {
+		child = rb_entry(mem->node.rb_left, struct efi_mem_node, node);
+		max_free = max(max_free, child->max_free);
+	}
+	if (mem->node.rb_right) {
+		child = rb_entry(mem->node.rb_right, struct efi_mem_node, node);
+		max_free = max(max_free, child->max_free);
+	}
+
+	return max_free;
 }
 
+RB_DECLARE_CALLBACKS(static, efi_mem_augment, struct efi_mem_node, node,
+		     u64, max_free, efi_mem_compute_max)
+
 /**
  * desc_get_end() - get end address of memory area
  *
@@ -121,138 +139,220 @@ static uint64_t desc_get_end(struct efi_mem_desc *desc)
 }
 
 /**
- * efi_mem_sort() - sort memory map
+ * efi_mem_update() - update the tree after an entry was resized
+ *
+ * Must be called whenever the size or type of an entry in the tree changes,
+ * before the tree is modified again.
  *
- * Sort the memory map and then try to merge adjacent memory areas.
+ * @mem:	memory map entry which was changed
  */
-static void efi_mem_sort(void)
+static void efi_mem_update(struct efi_mem_node *mem)
 {
-	struct list_head *lhandle;
-	struct efi_mem_list *prevmem = NULL;
-	bool merge_again = true;
-
-	list_sort(NULL, &efi_mem, efi_mem_cmp);
-
-	/* Now merge entries that can be merged */
-	while (merge_again) {
-		merge_again = false;
-		list_for_each(lhandle, &efi_mem) {
-			struct efi_mem_list *lmem;
-			struct efi_mem_desc *prev = &prevmem->desc;
-			struct efi_mem_desc *cur;
-			uint64_t pages;
-
-			lmem = list_entry(lhandle, struct efi_mem_list, link);
-			if (!prevmem) {
-				prevmem = lmem;
-				continue;
-			}
-
-			cur = &lmem->desc;
-
-			if ((desc_get_end(cur) == prev->physical_start) &&
-			    (prev->type == cur->type) &&
-			    (prev->attribute == cur->attribute)) {
-				/* There is an existing map before, reuse it */
-				pages = cur->num_pages;
-				prev->num_pages += pages;
-				prev->physical_start -= pages << EFI_PAGE_SHIFT;
-				prev->virtual_start -= pages << EFI_PAGE_SHIFT;
-				list_del(&lmem->link);
-				free(lmem);
-
-				merge_again = true;
-				break;
-			}
-
-			prevmem = lmem;
-		}
+	efi_mem_augment_propagate(&mem->node, NULL);
+}
+
+/**
+ * efi_mem_insert() - insert an entry into the memory map
+ *
+ * The entry must not overlap any entry already in the map.
+ *
+ * @mem:	memory map entry
+ */
+static void efi_mem_insert(struct efi_mem_node *mem)
+{
+	struct rb_node **link = &efi_mem.rb_node, *parent = NULL;
+	u64 start = mem->desc.physical_start;
+	u64 max_free = efi_mem_free_pages(mem);
+
+	while (*link) {
+		struct efi_mem_node *cur;
+
+		parent = *link;
+		cur = rb_entry(parent, struct efi_mem_node, node);
+		cur->max_free = max(cur->max_free, max_free);
+		if (start < cur->desc.physical_start)
+			link = &parent->rb_left;
+		else
+			link = &parent->rb_right;
 	}
+
+	mem->max_free = max_free;
+	rb_link_node(&mem->node, parent, link);
+	rb_insert_augmented(&mem->node, &efi_mem, &efi_mem_augment);
+	efi_mem_count++;
 }
 
 /**
- * efi_mem_carve_out() - unmap memory region
+ * efi_mem_remove() - remove an entry from the memory map and free it
  *
- * @map:		memory map
- * @carve_desc:		memory region to unmap
- * @overlap_only_ram:	the carved out region may only overlap RAM
- * Return:		the number of overlapping pages which have been
- *			removed from the map,
- *			EFI_CARVE_NO_OVERLAP, if the regions don't overlap,
- *			EFI_CARVE_OVERLAPS_NONRAM, if the carve and map overlap,
- *			and the map contains anything but free ram
- *			(only when overlap_only_ram is true),
- *			EFI_CARVE_LOOP_AGAIN, if the mapping list should be
- *			traversed again, as it has been altered.
- *
- * Unmaps all memory occupied by the carve_desc region from the list entry
- * pointed to by map.
- *
- * In case of EFI_CARVE_OVERLAPS_NONRAM it is the callers responsibility
- * to re-add the already carved out pages to the mapping.
- */
-static s64 efi_mem_carve_out(struct efi_mem_list *map,
-			     struct efi_mem_desc *carve_desc,
-			     bool overlap_only_ram)
+ * @mem:	memory map entry
+ */
+static void efi_mem_remove(struct efi_mem_node *mem)
 {
-	struct efi_mem_list *newmap;
-	struct efi_mem_desc *map_desc = &map->desc;
-	uint64_t map_start = map_desc->physical_start;
-	uint64_t map_end = map_start + (map_desc->num_pages << EFI_PAGE_SHIFT);
-	uint64_t carve_start = carve_desc->physical_start;
-	uint64_t carve_end = carve_start +
-			     (carve_desc->num_pages << EFI_PAGE_SHIFT);
-
-	/* check whether we're overlapping */
-	if ((carve_end <= map_start) || (carve_start >= map_end))
-		return EFI_CARVE_NO_OVERLAP;
-
-	/* We're overlapping with non-RAM, warn the caller if desired */
-	if (overlap_only_ram && (map_desc->type != EFI_CONVENTIONAL_MEMORY))
-		return EFI_CARVE_OVERLAPS_NONRAM;
-
-	/* Sanitize carve_start and carve_end to lie within our bounds */
-	carve_start = max(carve_start, map_start);
-	carve_end = min(carve_end, map_end);
-
-	/* Carving at the beginning of our map? Just move it! */
-	if (carve_start == map_start) {
-		if (map_end == carve_end) {
-			/* Full overlap, just remove map */
-			list_del(&map->link);
-			free(map);
+	rb_erase_augmented(&mem->node, &efi_mem, &efi_mem_augment);
+	efi_mem_count--;
+	free(mem);
+}
+
+/**
+ * efi_mem_next() - get the next entry in ascending address order
+ *
+ * @mem:	memory map entry
+ * Return:	next entry or NULL
+ */
+static struct efi_mem_node *efi_mem_next(struct efi_mem_node *mem)
+{
+	return rb_entry_safe(rb_next(&mem->node), struct efi_mem_node, node);
+}
+
+/**
+ * efi_mem_find() - find the entry starting at or below an address
+ *
+ * @addr:	address to look up
+ * Return:	entry with the highest start address not above @addr, or NULL
+ */
+static struct efi_mem_node *efi_mem_find(u64 addr)
+{
+	struct rb_node *node = efi_mem.rb_node;
+	struct efi_mem_node *found = NULL;
+
+	while (node) {
+		struct efi_mem_node *mem;
+
+		mem = rb_entry(node, struct efi_mem_node, node);
+		if (mem->desc.physical_start <= addr) {
+			found = mem;
+			node = node->rb_right;
 		} else {
-			map->desc.physical_start = carve_end;
-			map->desc.virtual_start = carve_end;
-			map->desc.num_pages = (map_end - carve_end)
-					      >> EFI_PAGE_SHIFT;
+			node = node->rb_left;
 		}
+	}
+
+	return found;
+}
+
+/**
+ * efi_mem_first_overlap() - find the lowest entry overlapping an area
+ *
+ * @start:	start address of the area
+ * @end:	end address + 1 of the area
+ * Return:	lowest overlapping entry or NULL
+ */
+static struct efi_mem_node *efi_mem_first_overlap(u64 start, u64 end)
+{
+	struct efi_mem_node *mem = efi_mem_find(start);
+
+	if (mem && desc_get_end(&mem->desc) > start)
+		return mem;
+	if (mem)
+		mem = efi_mem_next(mem);
+	else
+		mem = rb_entry_safe(rb_first(&efi_mem), struct efi_mem_node,
+				    node);
+	if (mem && mem->desc.physical_start < end)
+		return mem;
 
-		return (carve_end - carve_start) >> EFI_PAGE_SHIFT;
+	return NULL;
+}
+
+/**
+ * efi_mem_can_merge() - check if two memory areas can be merged
+ *
+ * @a:		memory map entry
+ * @b:		memory map entry
+ * Return:	true if both areas have the same type and attributes
+ */
+static bool efi_mem_can_merge(struct efi_mem_node *a, struct efi_mem_node *b)
+{
+	return a->desc.type == b->desc.type &&
+	       a->desc.attribute == b->desc.attribute;
+}
+
+/**
+ * efi_mem_check_ram() - check that an area is entirely free RAM
+ *
+ * @mem:	lowest entry overlapping the area
+ * @start:	start address of the area
+ * @end:	end address + 1 of the area
+ * Return:	true if the area is covered by conventional memory without gaps
+ */
+static bool efi_mem_check_ram(struct efi_mem_node *mem, u64 start, u64 end)
+{
+	u64 addr = start;
+
+	for (; mem && mem->desc.physical_start < end; mem = efi_mem_next(mem)) {
+		if (mem->desc.type != EFI_CONVENTIONAL_MEMORY ||
+		    mem->desc.physical_start > addr)
+			return false;
+		addr = desc_get_end(&mem->desc);
 	}
 
-	/*
-	 * Overlapping maps, just split the list map at carve_start,
-	 * it will get moved or removed in the next iteration.
-	 *
-	 * [ map_desc |__carve_start__| newmap ]
-	 */
+	return addr >= end;
+}
+
+/**
+ * efi_mem_carve_out() - unmap memory region
+ *
+ * Removes the area from all entries of the memory map it overlaps. Entries
+ * which are completely covered are dropped, all others are trimmed.
+ *
+ * @mem:	lowest entry overlapping the area
+ * @start:	start address of the area to unmap
+ * @end:	end address + 1 of the area to unmap
+ * Return:	EFI_SUCCESS or EFI_OUT_OF_RESOURCES if an entry could
+ *		not be split
+ */
+static efi_status_t efi_mem_carve_out(struct efi_mem_node *mem, u64 start,
+				      u64 end)
+{
+	struct efi_mem_node *next;
+
+	/* Carving out of the middle of an entry? Split it! */
+	if (mem && mem->desc.physical_start < start &&
+	    desc_get_end(&mem->desc) > end) {
+		next = calloc(1, sizeof(*next));
+		if (!next)
+			return EFI_OUT_OF_RESOURCES;
+		next->desc = mem->desc;
+		next->desc.physical_start = end;
+		next->desc.virtual_start = end;
+		next->desc.num_pages = (desc_get_end(&mem->desc) - end)
+				       >> EFI_PAGE_SHIFT;
+		mem->desc.num_pages = (start - mem->desc.physical_start)
+				      >> EFI_PAGE_SHIFT;
+		efi_mem_update(mem);
+		efi_mem_insert(next);
+
+		return EFI_SUCCESS;
+	}
+
+	while (mem && mem->desc.physical_start < end) {
+		u64 mem_start = mem->desc.physical_start;
+		u64 mem_end = desc_get_end(&mem->desc);
 
-	/* Create a new map from [ carve_start ... map_end ] */
-	newmap = calloc(1, sizeof(*newmap));
-	if (!newmap)
-		return EFI_CARVE_OUT_OF_RESOURCES;
-	newmap->desc = map->desc;
-	newmap->desc.physical_start = carve_start;
-	newmap->desc.virtual_start = carve_start;
-	newmap->desc.num_pages = (map_end - carve_start) >> EFI_PAGE_SHIFT;
-	/* Insert before current entry (descending address order) */
-	list_add_tail(&newmap->link, &map->link);
-
-	/* Shrink the map to [ map_start ... carve_start ] */
-	map_desc->num_pages = (carve_start - map_start) >> EFI_PAGE_SHIFT;
-
-	return EFI_CARVE_LOOP_AGAIN;
+		next = efi_mem_next(mem);
+		if (mem_start < start) {
+			/* Keep the part below the area */
+			mem->desc.num_pages = (start - mem_start)
+					      >> EFI_PAGE_SHIFT;
+			efi_mem_update(mem);
+		} else if (mem_end > end) {
+			/*
+			 * Keep the part above the area. Nothing else lies in
+			 * between, so the entry keeps its place in the tree.
+			 */
+			mem->desc.physical_start = end;
+			mem->desc.virtual_start = end;
+			mem->desc.num_pages = (mem_end - end) >> EFI_PAGE_SHIFT;
+			efi_mem_update(mem);
+		} else {
+			/* Full overlap, just remove the entry */
+			efi_mem_remove(mem);
+		}
+		mem = next;
+	}
+
+	return EFI_SUCCESS;
 }
 
 /**
@@ -268,11 +368,10 @@ static efi_status_t efi_add_memory_map_pg(u64 start, u64 pages,
 					  int memory_type,
 					  bool overlap_only_ram)
 {
-	struct list_head *lhandle;
-	struct efi_mem_list *newlist;
-	bool carve_again;
-	uint64_t carved_pages = 0;
+	struct efi_mem_node *newmem, *mem, *prev, *next;
+	u64 end = start + (pages << EFI_PAGE_SHIFT);
 	struct efi_event *evt;
+	efi_status_t ret;
 
 	EFI_PRINT("%s: 0x%llx 0x%llx %d %s\n", __func__,
 		  start, pages, memory_type, overlap_only_ram ? "yes" : "no");
@@ -284,86 +383,68 @@ static efi_status_t efi_add_memory_map_pg(u64 start, u64 pages,
 		return EFI_SUCCESS;
 
 	++efi_memory_map_key;
-	newlist = calloc(1, sizeof(*newlist));
-	if (!newlist)
+	newmem = calloc(1, sizeof(*newmem));
+	if (!newmem)
 		return EFI_OUT_OF_RESOURCES;
-	newlist->desc.type = memory_type;
-	newlist->desc.physical_start = start;
-	newlist->desc.virtual_start = start;
-	newlist->desc.num_pages = pages;
+	newmem->desc.type = memory_type;
+	newmem->desc.physical_start = start;
+	newmem->desc.virtual_start = start;
+	newmem->desc.num_pages = pages;
 
 	switch (memory_type) {
 	case EFI_RUNTIME_SERVICES_CODE:
 	case EFI_RUNTIME_SERVICES_DATA:
-		newlist->desc.attribute = EFI_MEMORY_WB | EFI_MEMORY_RUNTIME;
+		newmem->desc.attribute = EFI_MEMORY_WB | EFI_MEMORY_RUNTIME;
 		break;
 	case EFI_MMAP_IO:
-		newlist->desc.attribute = EFI_MEMORY_RUNTIME;
+		newmem->desc.attribute = EFI_MEMORY_RUNTIME;
 		break;
 	default:
-		newlist->desc.attribute = EFI_MEMORY_WB;
+		newmem->desc.attribute = EFI_MEMORY_WB;
 		break;
 	}
 
-	/* Add our new map */
-	do {
-		carve_again = false;
-		list_for_each(lhandle, &efi_mem) {
-			struct efi_mem_list *lmem;
-			s64 r;
-
-			lmem = list_entry(lhandle, struct efi_mem_list, link);
-			r = efi_mem_carve_out(lmem, &newlist->desc,
-					      overlap_only_ram);
-			switch (r) {
-			case EFI_CARVE_OUT_OF_RESOURCES:
-				free(newlist);
-				return EFI_OUT_OF_RESOURCES;
-			case EFI_CARVE_OVERLAPS_NONRAM:
-				/*
-				 * The user requested to only have RAM overlaps,
-				 * but we hit a non-RAM region. Error out.
-				 */
-				free(newlist);
-				return EFI_NO_MAPPING;
-			case EFI_CARVE_NO_OVERLAP:
-				/* Just ignore this list entry */
-				break;
-			case EFI_CARVE_LOOP_AGAIN:
-				/*
-				 * We split an entry, but need to loop through
-				 * the list again to actually carve it.
-				 */
-				carve_again = true;
-				break;
-			default:
-				/* We carved a number of pages */
-				carved_pages += r;
-				carve_again = true;
-				break;
-			}
-
-			if (carve_again) {
-				/* The list changed, we need to start over */
-				break;
-			}
-		}
-	} while (carve_again);
-
-	if (overlap_only_ram && (carved_pages != pages)) {
+	mem = efi_mem_first_overlap(start, end);
+	if (overlap_only_ram && !efi_mem_check_ram(mem, start, end)) {
 		/*
 		 * The payload wanted to have RAM overlaps, but we overlapped
-		 * with an unallocated region. Error out.
+		 * with non-RAM or an unallocated region. Error out.
 		 */
-		free(newlist);
+		free(newmem);
 		return EFI_NO_MAPPING;
 	}
 
-	/* Add our new map */
-        list_add_tail(&newlist->link, &efi_mem);
+	ret = efi_mem_carve_out(mem, start, end);
+	if (ret != EFI_SUCCESS) {
+		free(newmem);
+		return ret;
+	}
+
+	/* Add our new map, merging it with its neighbours where possible */
+	prev = efi_mem_find(start);
+	if (prev)
+		next = efi_mem_next(prev);
+	else
+		next = rb_entry_safe(rb_first(&efi_mem), struct efi_mem_node,
+				     node);
+
+	if (prev && desc_get_end(&prev->desc) == start &&
+	    efi_mem_can_merge(prev, newmem)) {
+		free(newmem);
+		newmem = prev;
+		newmem->desc.num_pages += pages;
+		efi_mem_update(newmem);
+	} else {
+		efi_mem_insert(newmem);
+	}
 
-	/* And make sure memory is listed in descending order */
-	efi_mem_sort();
+	if (next && next->desc.physical_start == end &&
+	    efi_mem_can_merge(newmem, next)) {
+		pages = next->desc.num_pages;
+		efi_mem_remove(next);
+		newmem->desc.num_pages += pages;
+		efi_mem_update(newmem);
+	}
 
 	/* Notify that the memory map was changed */
 	list_for_each_entry(evt, &efi_events, link) {
@@ -417,22 +498,55 @@ efi_status_t efi_add_memory_map(u64 start, u64 size, int memory_type)
  */
 static efi_status_t efi_check_allocated(u64 addr, bool must_be_allocated)
 {
-	struct efi_mem_list *item;
-
-	list_for_each_entry(item, &efi_mem, link) {
-		u64 start = item->desc.physical_start;
-		u64 end = start + (item->desc.num_pages << EFI_PAGE_SHIFT);
-
-		if (addr >= start && addr < end) {
-			if (must_be_allocated ^
-			    (item->desc.type == EFI_CONVENTIONAL_MEMORY))
-				return EFI_SUCCESS;
-			else
-				return EFI_NOT_FOUND;
+	struct efi_mem_node *mem = efi_mem_find(addr);
+
+	if (!mem || addr >= desc_get_end(&mem->desc))
+		return EFI_NOT_FOUND;
+
+	if (must_be_allocated ^ (mem->desc.type == EFI_CONVENTIONAL_MEMORY))
+		return EFI_SUCCESS;
+	else
+		return EFI_NOT_FOUND;
+}
+
+/**
+ * efi_mem_find_free() - find free memory pages in a subtree
+ *
+ * Subtrees without a large enough area of free RAM are skipped using the
+ * size cached in each node. Higher addresses are tried first.
+ *
+ * @node:	root of the subtree
+ * @len:	size of memory area needed
+ * @max_addr:	page aligned highest address to allocate
+ * Return:	highest suitable address in the subtree or 0
+ */
+static u64 efi_mem_find_free(struct rb_node *node, u64 len, u64 max_addr)
+{
+	struct efi_mem_node *mem;
+	u64 ret, top;
+
+	if (!node)
+		return 0;
+
+	mem = rb_entry(node, struct efi_mem_node, node);
+	if (mem->max_free < len >> EFI_PAGE_SHIFT)
+		return 0;
+
+	/* Everything on the right starts above max_addr */
+	if (mem->desc.physical_start < max_addr) {
+		ret = efi_mem_find_free(node->rb_right, len, max_addr);
+		if (ret)
+			return ret;
+
+		/* We only take memory from free RAM */
+		if (mem->desc.type == EFI_CONVENTIONAL_MEMORY) {
+			top = min(max_addr, desc_get_end(&mem->desc));
+			if (top - mem->desc.physical_start >= len)
+				return top - len;
 		}
 	}
 
-	return EFI_NOT_FOUND;
+	return efi_mem_find_free(node->rb_left, len, max_addr);
 }
 
 /**
@@ -444,44 +558,13 @@ static efi_status_t efi_check_allocated(u64 addr, bool must_be_allocated)
  */
 static uint64_t efi_find_free_memory(uint64_t len, uint64_t max_addr)
 {
-	struct list_head *lhandle;
-
 	/*
 	 * Prealign input max address, so we simplify our matching
 	 * logic below and can just reuse it as return pointer.
 	 */
 	max_addr &= ~EFI_PAGE_MASK;
 
-	list_for_each(lhandle, &efi_mem) {
-		struct efi_mem_list *lmem = list_entry(lhandle,
-			struct efi_mem_list, link);
-		struct efi_mem_desc *desc = &lmem->desc;
-		uint64_t desc_len = desc->num_pages << EFI_PAGE_SHIFT;
-		uint64_t desc_end = desc->physical_start + desc_len;
-		uint64_t curmax = min(max_addr, desc_end);
-		uint64_t ret = curmax - len;
-
-		/* We only take memory from free RAM */
-		if (desc->type != EFI_CONVENTIONAL_MEMORY)
-			continue;
-
-		/* Out of bounds for max_addr */
-		if ((ret + len) > max_addr)
-			continue;
-
-		/* Out of bounds for upper map limit */
-		if ((ret + len) > desc_end)
-			continue;
-
-		/* Out of bounds for lower map limit */
-		if (ret < desc->physical_start)
-			continue;
-
-		/* Return the highest address in this map within bounds */
-		return ret;
-	}
-
-	return 0;
+	return efi_mem_find_free(efi_mem.rb_node, len, max_addr);
 }
 
 /**
@@ -743,8 +826,7 @@ efi_status_t efi_get_memory_map(efi_uintn_t *memory_map_size,
 				uint32_t *descriptor_version)
 {
 	efi_uintn_t map_size = 0;
-	int map_entries = 0;
-	struct list_head *lhandle;
+	struct rb_node *node;
 	efi_uintn_t provided_map_size;
 
 	if (!memory_map_size)
@@ -752,10 +834,7 @@ efi_status_t efi_get_memory_map(efi_uintn_t *memory_map_size,
 
 	provided_map_size = *memory_map_size;
 
-	list_for_each(lhandle, &efi_mem)
-		map_entries++;
-
-	map_size = map_entries * sizeof(struct efi_mem_desc);
+	map_size = efi_mem_count * sizeof(struct efi_mem_desc);
 
 	*memory_map_size = map_size;
 
@@ -771,16 +850,9 @@ efi_status_t efi_get_memory_map(efi_uintn_t *memory_map_size,
 	if (!memory_map)
 		return EFI_INVALID_PARAMETER;
 
-	/* Copy list into array */
-	/* Return the list in ascending order */
-	memory_map = &memory_map[map_entries - 1];
-	list_for_each(lhandle, &efi_mem) {
-		struct efi_mem_list *lmem;
-
-		lmem = list_entry(lhandle, struct efi_mem_list, link);
-		*memory_map = lmem->desc;
-		memory_map--;
-	}
+	/* Copy tree into array in ascending order */
+	for (node = rb_first(&efi_mem); node; node = rb_next(node))
+		*memory_map++ = rb_entry(node, struct efi_mem_node, node)->desc;
 
 	if (map_key)
 		*map_key = efi_memory_map_key;
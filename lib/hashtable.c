@@ -15,7 +15,6 @@
 #include <errno.h>
 #include <log.h>
 #include <malloc.h>
-#include <sort.h>
 
 #ifdef USE_HOSTCC		/* HOST build */
 # include <string.h>
@@ -34,9 +33,6 @@
 # include <linux/ctype.h>
 #endif
 
-#define USED_FREE 0
-#define USED_DELETED -1
-
 #include <env_callback.h>
 #include <env_flags.h>
 #include <search.h>
@@ -51,46 +47,60 @@
  * The reentrant version has no static variables to maintain the state.
  * Instead the interface of all functions is extended to take an argument
  * which describes the current status.
+ *
+ * Each entry lives in its own node, so that pointers handed out by
+ * hsearch_r() stay valid when the table grows. Nodes are referenced twice:
+ * from the open-addressed slot array (linear probing, power-of-two size)
+ * used for lookups, and from an array kept sorted by key, which gives a
+ * stable iteration order and lets hexport_r() run without sorting.
+ *
+ * Entries created by a zero-copy import (H_ZEROCOPY) are not allocated one
+ * by one: their nodes come from a pool allocated by himport_r() and their
+ * key and data point into the retained import buffer. Such memory is never
+ * freed per entry; an entry whose data is overwritten gets a private copy.
  */
 
 struct env_entry_node {
-	int used;
+	unsigned int hval;
 	struct env_entry entry;
 };
 
-
-static void _hdelete(const char *key, struct hsearch_data *htab,
-		     struct env_entry *ep, int idx);
+/* Minimum number of slots; must be a power of two */
+#define HTAB_MIN_SIZE	16
 
 /*
  * hcreate()
  */
 
-/*
- * For the used double hash method the table size has to be a prime. To
- * correct the user given table size we need a prime test.  This trivial
- * algorithm is adequate because
- * a)  the code is (most probably) called a few times per program run and
- * b)  the number is small because the table must fit in the core
- * */
-static int isprime(unsigned int number)
+static unsigned int htab_hash(const char *key)
+{
+	unsigned int hval = 2166136261U;
+
+	/* FNV-1a */
+	while (*key) {
+		hval ^= (unsigned char)*key++;
+		hval *= 16777619U;
+	}
+
+	return hval;
+}
+
+/* Number of slots needed to hold "nel" entries below a 3/4 load factor */
+static unsigned int htab_slots(size_t nel)
 {
-	/* no even number will be passed */
-	unsigned int div = 3;
+	unsigned int size = HTAB_MIN_SIZE;
 
-	while (div * div < number && number % div != 0)
-		div += 2;
+	while (size - size / 4 <= nel)
+		size <<= 1;
 
-	return number % div != 0;
+	return size;
 }
 
 /*
  * Before using the hash table we must allocate memory for it.
- * Test for an existing table are done. We allocate one element
- * more as the found prime number says. This is done for more effective
- * indexing as explained in the comment for the hsearch function.
- * The contents of the table is zeroed, especially the field used
- * becomes zero.
+ * Test for an existing table are done. The table is sized so that "nel"
+ * entries fit below the maximum load factor; it will be grown on demand
+ * when more entries are added. The contents of the table is zeroed.
  */
 
 int hcreate_r(size_t nel, struct hsearch_data *htab)
@@ -107,18 +117,18 @@ int hcreate_r(size_t nel, struct hsearch_data *htab)
 		return 0;
 	}
 
-	/* Change nel to the first prime number not smaller as nel. */
-	nel |= 1;		/* make odd */
-	while (!isprime(nel))
-		nel += 2;
-
-	htab->size = nel;
+	htab->size = htab_slots(nel);
 	htab->filled = 0;
+	htab->dirty = false;
 
 	/* allocate memory and zero out */
-	htab->table = (struct env_entry_node *)calloc(htab->size + 1,
-						sizeof(struct env_entry_node));
-	if (htab->table == NULL) {
+	htab->table = calloc(htab->size, sizeof(struct env_entry_node *));
+	htab->sorted = calloc(htab->size, sizeof(struct env_entry_node *));
+	if (htab->table == NULL || htab->sorted == NULL) {
+		free(htab->table);
+		free(htab->sorted);
+		htab->table = NULL;
+		htab->sorted = NULL;
 		__set_errno(ENOMEM);
 		return 0;
 	}
@@ -127,6 +137,65 @@ int hcreate_r(size_t nel, struct hsearch_data *htab)
 	return 1;
 }
 
+/* Store a node in the first free slot of its probe sequence */
+static void htab_place(struct env_entry_node **table, unsigned int size,
+		       struct env_entry_node *node)
+{
+	unsigned int idx = node->hval & (size - 1);
+
+	while (table[idx])
+		idx = (idx + 1) & (size - 1);
+	table[idx] = node;
+}
+
+/*
+ * Double the number of slots and re-place all the nodes. The sorted array
+ * is resized along with it, so it never needs more than "size" entries.
+ */
+static int htab_grow(struct hsearch_data *htab)
+{
+	unsigned int size = htab->size << 1;
+	struct env_entry_node **table, **sorted;
+	unsigned int i;
+
+	table = calloc(size, sizeof(struct env_entry_node *));
+	if (!table)
+		return -ENOMEM;
+	sorted = realloc(htab->sorted, size * sizeof(struct env_entry_node *));
+	if (!sorted) {
+		free(table);
+		return -ENOMEM;
+	}
+
+	for (i = 0; i < htab->filled; i++)
+		htab_place(table, size, sorted[i]);
+
+	debug("hgrow: %u -> %u slots for %u entries\n", htab->size, size,
+	      htab->filled);
+	free(htab->table);
+	htab->table = table;
+	htab->sorted = sorted;
+	htab->size = size;
+
+	return 0;
+}
+
+/* Check whether "ptr" points into the retained import buffer */
+static bool htab_borrowed(struct hsearch_data *htab, const void *ptr)
+{
+	return htab->import_buf && (const char *)ptr >= htab->import_buf &&
+	       (const char *)ptr <= htab->import_buf + htab->import_size;
+}
+
+static void htab_free_node(struct hsearch_data *htab,
+			   struct env_entry_node *node)
+{
+	if (!htab_borrowed(htab, node->entry.data))
+		free(node->entry.data);
+	if (node < htab->pool || node >= htab->pool + htab->pool_size)
+		free(node);
+}
+
 
 /*
  * hdestroy()
@@ -148,18 +217,23 @@ void hdestroy_r(struct hsearch_data *htab)
 	}
 
 	/* free used memory */
-	for (i = 1; i <= htab->size; ++i) {
-		if (htab->table[i].used > 0) {
-			struct env_entry *ep = &htab->table[i].entry;
-
-			free((void *)ep->key);
-			free(ep->data);
-		}
-	}
+	for (i = 0; i < htab->filled; ++i)
+		htab_free_node(htab, htab->sorted[i]);
 	free(htab->table);
+	free(htab->sorted);
+	free(htab->pool);
+	free(htab->import_buf);
 
 	/* the sign for an existing table is an value != NULL in htable */
 	htab->table = NULL;
+	htab->sorted = NULL;
+	htab->pool = NULL;
+	htab->pool_size = 0;
+	htab->pool_used = 0;
+	htab->import_buf = NULL;
+	htab->import_size = 0;
+	htab->filled = 0;
+	htab->dirty = true;
 }
 
 /*
@@ -167,17 +241,10 @@ void hdestroy_r(struct hsearch_data *htab)
  */
 
 /*
- * This is the search function. It uses double hashing with open addressing.
- * The argument item.key has to be a pointer to an zero terminated, most
- * probably strings of chars. The function for generating a number of the
- * strings is simple but fast. It can be replaced by a more complex function
- * like ajw (see [Aho,Sethi,Ullman]) if the needs are shown.
- *
- * We use an trick to speed up the lookup. The table is created by hcreate
- * with one more element available. This enables us to use the index zero
- * special. This index will never be used because we store the first hash
- * index in the field used where zero means not used. Every other value
- * means used. The used field can be used as a first fast comparison for
+ * This is the search function. It uses linear probing with open addressing
+ * over a power-of-two sized slot array. The argument item.key has to be a
+ * pointer to an zero terminated, most probably strings of chars. The full
+ * hash value is kept in each node and used as a first fast comparison for
  * equality of the stored and the parameter value. This helps to prevent
  * unnecessary expensive calls of strcmp.
  *
@@ -193,25 +260,65 @@ void hdestroy_r(struct hsearch_data *htab)
  * - The standard implementation does not provide a way to update an
  *   existing entry.  This version will create a new entry or update an
  *   existing one when both "action == ENV_ENTER" and "item.data != NULL".
+ * - The table is not limited to the size given to hcreate_r(); it is
+ *   grown whenever it becomes three quarters full.
  * - Instead of returning 1 on success, we return the index into the
- *   internal hash table, which is also guaranteed to be positive.
- *   This allows us direct access to the found hash table slot for
- *   example for functions like hdelete().
+ *   internal hash table plus one, which is also guaranteed to be positive.
+ *
+ * hmatch_r() uses a different index: the (1-based) position of an entry
+ * in key order, so that it can be used as a cursor to walk the table.
  */
 
+/* Find the slot holding "key", or -1 if it is not in the table */
+static int htab_find_slot(struct hsearch_data *htab, const char *key,
+			  unsigned int hval)
+{
+	unsigned int idx = hval & (htab->size - 1);
+	struct env_entry_node *node;
+
+	while ((node = htab->table[idx])) {
+		if (node->hval == hval && !strcmp(key, node->entry.key))
+			return idx;
+		idx = (idx + 1) & (htab->size - 1);
+	}
+
+	return -1;
+}
+
+/* Return the position of the first sorted entry not less than "key" */
+static unsigned int htab_lower_bound(struct hsearch_data *htab,
+				     const char *key)
+{
+	unsigned int lo = 0, hi = htab->filled;
+
+	/* Imports are usually sorted, so check for an append first */
+	if (hi && strcmp(htab->sorted[hi - 1]->entry.key, key) < 0)
+		return hi;
+
+	while (lo < hi) {
+		unsigned int mid = lo + (hi - lo) / 2;
+
+		if (strcmp(htab->sorted[mid]->entry.key, key) < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return lo;
+}
+
 int hmatch_r(const char *match, int last_idx, struct env_entry **retval,
 	     struct hsearch_data *htab)
 {
 	unsigned int idx;
 	size_t key_len = strlen(match);
 
-	for (idx = last_idx + 1; idx < htab->size; ++idx) {
-		if (htab->table[idx].used <= 0)
-			continue;
-		if (!strncmp(match, htab->table[idx].entry.key, key_len)) {
-			*retval = &htab->table[idx].entry;
-			return idx;
-		}
+	/* Entries sharing a prefix are adjacent in the sorted array */
+	idx = last_idx ? last_idx : htab_lower_bound(htab, match);
+	if (idx < htab->filled &&
+	    !strncmp(match, htab->sorted[idx]->entry.key, key_len)) {
+		*retval = &htab->sorted[idx]->entry;
+		return idx + 1;
 	}
 
 	__set_errno(ESRCH);
@@ -231,195 +338,161 @@ do_callback(const struct env_entry *e, const char *name, const char *value,
 }
 
 /*
- * Compare an existing entry with the desired key, and overwrite if the action
- * is ENV_ENTER.  This is simply a helper function for hsearch_r().
+ * Overwrite an existing entry if the action is ENV_ENTER.  This is simply
+ * a helper function for hsearch_r().
  */
-static inline int _compare_and_overwrite_entry(struct env_entry item,
-		enum env_action action, struct env_entry **retval,
-		struct hsearch_data *htab, int flag, unsigned int hval,
-		unsigned int idx)
+static int _overwrite_entry(struct env_entry item, enum env_action action,
+			    struct env_entry **retval,
+			    struct hsearch_data *htab, int flag,
+			    unsigned int idx, bool borrow)
 {
-	if (htab->table[idx].used == hval
-	    && strcmp(item.key, htab->table[idx].entry.key) == 0) {
-		/* Overwrite existing value? */
-		if (action == ENV_ENTER && item.data) {
-			/* check for permission */
-			if (htab->change_ok != NULL && htab->change_ok(
-			    &htab->table[idx].entry, item.data,
-			    env_op_overwrite, flag)) {
-				debug("change_ok() rejected setting variable "
-					"%s, skipping it!\n", item.key);
-				__set_errno(EPERM);
-				*retval = NULL;
-				return 0;
-			}
+	struct env_entry_node *node = htab->table[idx];
 
-			/* If there is a callback, call it */
-			if (do_callback(&htab->table[idx].entry, item.key,
-					item.data, env_op_overwrite, flag)) {
-				debug("callback() rejected setting variable "
-					"%s, skipping it!\n", item.key);
-				__set_errno(EINVAL);
-				*retval = NULL;
-				return 0;
-			}
+	/* Overwrite existing value? */
+	if (action == ENV_ENTER && item.data) {
+		/* check for permission */
+		if (htab->change_ok != NULL && htab->change_ok(
+		    &node->entry, item.data, env_op_overwrite, flag)) {
+			debug("change_ok() rejected setting variable "
+				"%s, skipping it!\n", item.key);
+			__set_errno(EPERM);
+			*retval = NULL;
+			return 0;
+		}
 
-			free(htab->table[idx].entry.data);
-			htab->table[idx].entry.data = strdup(item.data);
-			if (!htab->table[idx].entry.data) {
-				__set_errno(ENOMEM);
-				*retval = NULL;
-				return 0;
-			}
+		/* If there is a callback, call it */
+		if (do_callback(&node->entry, item.key, item.data,
+				env_op_overwrite, flag)) {
+			debug("callback() rejected setting variable "
+				"%s, skipping it!\n", item.key);
+			__set_errno(EINVAL);
+			*retval = NULL;
+			return 0;
+		}
+
+		if (!htab_borrowed(htab, node->entry.data))
+			free(node->entry.data);
+		node->entry.data = borrow ? item.data : strdup(item.data);
+		htab->dirty = true;
+		if (!node->entry.data) {
+			__set_errno(ENOMEM);
+			*retval = NULL;
+			return 0;
 		}
-		/* return found entry */
-		*retval = &htab->table[idx].entry;
-		return idx;
 	}
-	/* keep searching */
-	return -1;
+	/* return found entry */
+	*retval = &node->entry;
+	return idx + 1;
 }
 
-int hsearch_r(struct env_entry item, enum env_action action,
-	      struct env_entry **retval, struct hsearch_data *htab, int flag)
+static void _hdelete(const char *key, struct hsearch_data *htab,
+		     struct env_entry_node *node);
+
+/*
+ * Common code for hsearch_r() and himport_r(). With "borrow" set, new
+ * entries are created from the node pool and keep item.key and item.data
+ * (which must point into the retained import buffer) instead of copies.
+ */
+static int _hsearch(struct env_entry item, enum env_action action,
+		    struct env_entry **retval, struct hsearch_data *htab,
+		    int flag, bool borrow)
 {
-	unsigned int hval;
-	unsigned int count;
-	unsigned int len = strlen(item.key);
-	unsigned int idx;
-	unsigned int first_deleted = 0;
-	int ret;
+	struct env_entry_node *node;
+	unsigned int hval, pos;
+	size_t len;
+	int idx;
 
-	/* Compute an value for the given string. Perhaps use a better method. */
-	hval = len;
-	count = len;
-	while (count-- > 0) {
-		hval <<= 4;
-		hval += item.key[count];
+	if (!htab->table) {
+		__set_errno(ESRCH);
+		*retval = NULL;
+		return 0;
 	}
 
-	/*
-	 * First hash function:
-	 * simply take the modul but prevent zero.
-	 */
-	hval %= htab->size;
-	if (hval == 0)
-		++hval;
-
-	/* The first index tried. */
-	idx = hval;
-
-	if (htab->table[idx].used) {
-		/*
-		 * Further action might be required according to the
-		 * action value.
-		 */
-		unsigned hval2;
-
-		if (htab->table[idx].used == USED_DELETED)
-			first_deleted = idx;
-
-		ret = _compare_and_overwrite_entry(item, action, retval, htab,
-			flag, hval, idx);
-		if (ret != -1)
-			return ret;
-
-		/*
-		 * Second hash function:
-		 * as suggested in [Knuth]
-		 */
-		hval2 = 1 + hval % (htab->size - 2);
-
-		do {
-			/*
-			 * Because SIZE is prime this guarantees to
-			 * step through all available indices.
-			 */
-			if (idx <= hval2)
-				idx = htab->size + idx - hval2;
-			else
-				idx -= hval2;
-
-			/*
-			 * If we visited all entries leave the loop
-			 * unsuccessfully.
-			 */
-			if (idx == hval)
-				break;
-
-			if (htab->table[idx].used == USED_DELETED
-			    && !first_deleted)
-				first_deleted = idx;
-
-			/* If entry is found use it. */
-			ret = _compare_and_overwrite_entry(item, action, retval,
-				htab, flag, hval, idx);
-			if (ret != -1)
-				return ret;
-		}
-		while (htab->table[idx].used != USED_FREE);
-	}
+	hval = htab_hash(item.key);
+	idx = htab_find_slot(htab, item.key, hval);
+	if (idx >= 0)
+		return _overwrite_entry(item, action, retval, htab, flag, idx,
+					borrow);
 
 	/* An empty bucket has been found. */
 	if (action == ENV_ENTER) {
 		/*
-		 * If table is full and another entry should be
-		 * entered return with error.
+		 * If the table is getting full, grow it before another
+		 * entry is entered.
 		 */
-		if (htab->filled == htab->size) {
+		if ((htab->filled + 1) * 4 > htab->size * 3 &&
+		    htab_grow(htab)) {
 			__set_errno(ENOMEM);
 			*retval = NULL;
 			return 0;
 		}
 
-		/*
-		 * Create new entry;
-		 * create copies of item.key and item.data
-		 */
-		if (first_deleted)
-			idx = first_deleted;
-
-		htab->table[idx].used = hval;
-		htab->table[idx].entry.key = strdup(item.key);
-		htab->table[idx].entry.data = strdup(item.data);
-		if (!htab->table[idx].entry.key ||
-		    !htab->table[idx].entry.data) {
-			__set_errno(ENOMEM);
-			*retval = NULL;
-			return 0;
+		if (borrow && htab->pool_used < htab->pool_size) {
+			/* Create new entry in place in the import buffer */
+			node = &htab->pool[htab->pool_used++];
+			node->entry.key = item.key;
+			node->entry.data = item.data;
+		} else {
+			/*
+			 * Create new entry;
+			 * create copies of item.key and item.data
+			 */
+			len = strlen(item.key);
+			node = calloc(1, sizeof(*node) + len + 1);
+			if (!node) {
+				__set_errno(ENOMEM);
+				*retval = NULL;
+				return 0;
+			}
+			memcpy(node + 1, item.key, len + 1);
+			node->entry.key = (char *)(node + 1);
+			node->entry.data = strdup(item.data);
+			if (!node->entry.data) {
+				free(node);
+				__set_errno(ENOMEM);
+				*retval = NULL;
+				return 0;
+			}
 		}
+		node->hval = hval;
 
+		htab_place(htab->table, htab->size, node);
+		pos = htab_lower_bound(htab, item.key);
+		memmove(&htab->sorted[pos + 1], &htab->sorted[pos],
+			(htab->filled - pos) * sizeof(htab->sorted[0]));
+		htab->sorted[pos] = node;
 		++htab->filled;
+		htab->dirty = true;
 
 		/* This is a new entry, so look up a possible callback */
-		env_callback_init(&htab->table[idx].entry);
+		env_callback_init(&node->entry);
 		/* Also look for flags */
-		env_flags_init(&htab->table[idx].entry);
+		env_flags_init(&node->entry);
 
 		/* check for permission */
 		if (htab->change_ok != NULL && htab->change_ok(
-		    &htab->table[idx].entry, item.data, env_op_create, flag)) {
+		    &node->entry, item.data, env_op_create, flag)) {
 			debug("change_ok() rejected setting variable "
 				"%s, skipping it!\n", item.key);
-			_hdelete(item.key, htab, &htab->table[idx].entry, idx);
+			_hdelete(item.key, htab, node);
 			__set_errno(EPERM);
 			*retval = NULL;
 			return 0;
 		}
 
 		/* If there is a callback, call it */
-		if (do_callback(&htab->table[idx].entry, item.key, item.data,
+		if (do_callback(&node->entry, item.key, item.data,
 				env_op_create, flag)) {
 			debug("callback() rejected setting variable "
 				"%s, skipping it!\n", item.key);
-			_hdelete(item.key, htab, &htab->table[idx].entry, idx);
+			_hdelete(item.key, htab, node);
 			__set_errno(EINVAL);
 			*retval = NULL;
 			return 0;
 		}
 
 		/* return new entry */
-		*retval = &htab->table[idx].entry;
+		*retval = &node->entry;
 		return 1;
 	}
 
@@ -428,6 +501,12 @@ int hsearch_r(struct env_entry item, enum env_action action,
 	return 0;
 }
 
+int hsearch_r(struct env_entry item, enum env_action action,
+	      struct env_entry **retval, struct hsearch_data *htab, int flag)
+{
+	return _hsearch(item, action, retval, htab, flag, false);
+}
+
 
 /*
  * hdelete()
@@ -440,36 +519,55 @@ int hsearch_r(struct env_entry item, enum env_action action,
  */
 
 static void _hdelete(const char *key, struct hsearch_data *htab,
-		     struct env_entry *ep, int idx)
+		     struct env_entry_node *node)
 {
-	/* free used entry */
+	unsigned int mask = htab->size - 1;
+	unsigned int idx, next, home, pos;
+
 	debug("hdelete: DELETING key \"%s\"\n", key);
-	free((void *)ep->key);
-	free(ep->data);
-	ep->flags = 0;
-	htab->table[idx].used = USED_DELETED;
 
+	/*
+	 * Remove the node from its slot and shift back any following nodes
+	 * of the same probe run, so that lookups never need tombstones.
+	 */
+	idx = htab_find_slot(htab, node->entry.key, node->hval);
+	for (next = (idx + 1) & mask; htab->table[next];
+	     next = (next + 1) & mask) {
+		home = htab->table[next]->hval & mask;
+		if (((next - home) & mask) >= ((next - idx) & mask)) {
+			htab->table[idx] = htab->table[next];
+			idx = next;
+		}
+	}
+	htab->table[idx] = NULL;
+
+	pos = htab_lower_bound(htab, node->entry.key);
 	--htab->filled;
+	memmove(&htab->sorted[pos], &htab->sorted[pos + 1],
+		(htab->filled - pos) * sizeof(htab->sorted[0]));
+	htab->dirty = true;
+
+	/* free used entry */
+	htab_free_node(htab, node);
 }
 
 int hdelete_r(const char *key, struct hsearch_data *htab, int flag)
 {
-	struct env_entry e, *ep;
+	struct env_entry_node *node;
 	int idx;
 
 	debug("hdelete: DELETE key \"%s\"\n", key);
 
-	e.key = (char *)key;
-
-	idx = hsearch_r(e, ENV_FIND, &ep, htab, 0);
-	if (idx == 0) {
+	idx = htab->table ? htab_find_slot(htab, key, htab_hash(key)) : -1;
+	if (idx < 0) {
 		__set_errno(ESRCH);
 		return -ENOENT;	/* not found */
 	}
+	node = htab->table[idx];
 
 	/* Check for permission */
 	if (htab->change_ok != NULL &&
-	    htab->change_ok(ep, NULL, env_op_delete, flag)) {
+	    htab->change_ok(&node->entry, NULL, env_op_delete, flag)) {
 		debug("change_ok() rejected deleting variable "
 			"%s, skipping it!\n", key);
 		__set_errno(EPERM);
@@ -477,15 +575,14 @@ int hdelete_r(const char *key, struct hsearch_data *htab, int flag)
 	}
 
 	/* If there is a callback, call it */
-	if (do_callback(&htab->table[idx].entry, key, NULL,
-			env_op_delete, flag)) {
+	if (do_callback(&node->entry, key, NULL, env_op_delete, flag)) {
 		debug("callback() rejected deleting variable "
 			"%s, skipping it!\n", key);
 		__set_errno(EINVAL);
 		return -EINVAL;
 	}
 
-	_hdelete(key, htab, ep, idx);
+	_hdelete(key, htab, node);
 
 	return 0;
 }
@@ -533,14 +630,6 @@ int hdelete_r(const char *key, struct hsearch_data *htab, int flag)
  *		bytes in the string will be '\0'-padded.
  */
 
-static int cmpkey(const void *p1, const void *p2)
-{
-	struct env_entry *e1 = *(struct env_entry **)p1;
-	struct env_entry *e2 = *(struct env_entry **)p2;
-
-	return (strcmp(e1->key, e2->key));
-}
-
 static int match_string(int flag, const char *str, const char *pat, void *priv)
 {
 	switch (flag & H_MATCH_METHOD) {
@@ -599,14 +688,29 @@ static int match_entry(struct env_entry *ep, int flag, int argc,
 	return 0;
 }
 
+/*
+ * Check whether an entry is to be exported, given the same arguments as
+ * hexport_r()
+ */
+static int export_entry(struct env_entry *ep, int flag, int argc,
+			char *const argv[])
+{
+	if (argc > 0 && !match_entry(ep, flag, argc, argv))
+		return 0;
+
+	if ((flag & H_HIDE_DOT) && ep->key[0] == '.')
+		return 0;
+
+	return 1;
+}
+
 ssize_t hexport_r(struct hsearch_data *htab, const char sep, int flag,
 		 char **resp, size_t size,
 		 int argc, char *const argv[])
 {
-	struct env_entry *list[htab->size];
 	char *res, *p;
 	size_t totlen;
-	int i, n;
+	int i;
 
 	/* Test for correct arguments.  */
 	if ((resp == NULL) || (htab == NULL)) {
@@ -618,54 +722,33 @@ ssize_t hexport_r(struct hsearch_data *htab, const char sep, int flag,
 	      htab, htab->size, htab->filled, (ulong)size);
 	/*
 	 * Pass 1:
-	 * search used entries,
+	 * search used entries (already sorted by key),
 	 * save addresses and compute total length
 	 */
-	for (i = 1, n = 0, totlen = 0; i <= htab->size; ++i) {
-
-		if (htab->table[i].used > 0) {
-			struct env_entry *ep = &htab->table[i].entry;
-			int found = match_entry(ep, flag, argc, argv);
-
-			if ((argc > 0) && (found == 0))
-				continue;
-
-			if ((flag & H_HIDE_DOT) && ep->key[0] == '.')
-				continue;
+	for (i = 0, totlen = 0; i < htab->filled; ++i) {
+		struct env_entry *ep = &htab->sorted[i]->entry;
 
-			list[n++] = ep;
+		if (!export_entry(ep, flag, argc, argv))
+			continue;
 
-			totlen += strlen(ep->key);
+		totlen += strlen(ep->key);
 
-			if (sep == '\0') {
-				totlen += strlen(ep->data);
-			} else {	/* check if escapes are needed */
-				char *s = ep->data;
+		if (sep == '\0') {
+			totlen += strlen(ep->data);
+		} else {	/* check if escapes are needed */
+			char *s = ep->data;
 
-				while (*s) {
+			while (*s) {
+				++totlen;
+				/* add room for needed escape chars */
+				if ((*s == sep) || (*s == '\\'))
 					++totlen;
-					/* add room for needed escape chars */
-					if ((*s == sep) || (*s == '\\'))
-						++totlen;
-					++s;
-				}
+				++s;
 			}
-			totlen += 2;	/* for '=' and 'sep' char */
 		}
+		totlen += 2;	/* for '=' and 'sep' char */
 	}
 
-#ifdef DEBUG
-	/* Pass 1a: print unsorted list */
-	printf("Unsorted: n=%d\n", n);
-	for (i = 0; i < n; ++i) {
-		printf("\t%3d: %p ==> %-10s => %s\n",
-		       i, list[i], list[i]->key, list[i]->data);
-	}
-#endif
-
-	/* Sort list by keys */
-	qsort(list, n, sizeof(struct env_entry *), cmpkey);
-
 	/* Check if the user supplied buffer size is sufficient */
 	if (size) {
 		if (size < totlen + 1) {	/* provided buffer too small */
@@ -693,17 +776,21 @@ ssize_t hexport_r(struct hsearch_data *htab, const char sep, int flag,
 	}
 	/*
 	 * Pass 2:
-	 * export sorted list of result data
+	 * export sorted list of result data, picking the same entries
 	 */
-	for (i = 0, p = res; i < n; ++i) {
+	for (i = 0, p = res; i < htab->filled; ++i) {
+		struct env_entry *ep = &htab->sorted[i]->entry;
 		const char *s;
 
-		s = list[i]->key;
+		if (!export_entry(ep, flag, argc, argv))
+			continue;
+
+		s = ep->key;
 		while (*s)
 			*p++ = *s++;
 		*p++ = '=';
 
-		s = list[i]->data;
+		s = ep->data;
 
 		while (*s) {
 			if ((*s == sep) || (*s == '\\'))
@@ -751,6 +838,27 @@ static int drop_var_from_set(const char *name, int nvars, char * vars[])
 	return res;
 }
 
+/*
+ * Return an upper bound for the number of entries in linearized data, i.e.
+ * the number of separators up to the end of the data
+ */
+static unsigned int himport_count(const char *data, size_t size,
+				  const char sep)
+{
+	unsigned int count = 1;
+	size_t i;
+
+	for (i = 0; i < size; i++) {
+		if (data[i] != sep && data[i])
+			continue;
+		if (!data[i] && (i + 1 >= size || !data[i + 1]))
+			break;
+		count++;
+	}
+
+	return count;
+}
+
 /*
  * Import linearized data into hash table.
  *
@@ -787,6 +895,11 @@ static int drop_var_from_set(const char *name, int nvars, char * vars[])
  *
  * In theory, arbitrary separator characters can be used, but only
  * '\0' and '\n' have really been tested.
+ *
+ * When the H_ZEROCOPY bit is set and a new hash table is created, the
+ * parsed copy of the data is kept by the hash table and the new entries
+ * point into it rather than holding their own copies of key and value.
+ * This saves two allocations per entry when loading a large environment.
  */
 
 int himport_r(struct hsearch_data *htab,
@@ -795,6 +908,8 @@ int himport_r(struct hsearch_data *htab,
 {
 	char *data, *sp, *dp, *name, *value;
 	char *localvars[nvars];
+	unsigned int count = 0;
+	bool borrow = false;
 	int i;
 
 	/* Test for correct arguments.  */
@@ -841,7 +956,8 @@ int himport_r(struct hsearch_data *htab,
 	 * (CONFIG_ENV_SIZE).  This heuristics will result in
 	 * unreasonably large numbers (and thus memory footprint) for
 	 * big flash environments (>8,000 entries for 64 KB
-	 * environment size), so we clip it to a reasonable value.
+	 * environment size), so we clip it to a reasonable value; the
+	 * table grows on demand if more entries are added.
 	 * On the other hand we need to add some more entries for free
 	 * space when importing very small buffers. Both boundaries can
 	 * be overwritten in the board config file if needed.
@@ -853,12 +969,34 @@ int himport_r(struct hsearch_data *htab,
 		if (nent > CONFIG_ENV_MAX_ENTRIES)
 			nent = CONFIG_ENV_MAX_ENTRIES;
 
+		/*
+		 * A zero-copy import into a new table keeps our copy of the
+		 * data and allocates all its nodes at once.
+		 */
+		if ((flag & H_ZEROCOPY) && size) {
+			count = himport_count(data, size, sep);
+			borrow = true;
+			if (nent < count)
+				nent = count;
+		}
+
 		debug("Create Hash Table: N=%d\n", nent);
 
 		if (hcreate_r(nent, htab) == 0) {
 			free(data);
 			return 0;
 		}
+
+		if (borrow) {
+			htab->pool = calloc(count, sizeof(*htab->pool));
+			if (htab->pool) {
+				htab->pool_size = count;
+				htab->import_buf = data;
+				htab->import_size = size;
+			} else {
+				borrow = false;
+			}
+		}
 	}
 
 	if (!size) {
@@ -928,7 +1066,8 @@ int himport_r(struct hsearch_data *htab,
 		if (*name == 0) {
 			debug("INSERT: unable to use an empty key\n");
 			__set_errno(EINVAL);
-			free(data);
+			if (!borrow)
+				free(data);
 			return 0;
 		}
 
@@ -940,7 +1079,7 @@ int himport_r(struct hsearch_data *htab,
 		e.key = name;
 		e.data = value;
 
-		hsearch_r(e, ENV_ENTER, &rv, htab, flag);
+		_hsearch(e, ENV_ENTER, &rv, htab, flag, borrow);
 #if !IS_ENABLED(CONFIG_ENV_WRITEABLE_LIST)
 		if (rv == NULL) {
 			printf("himport_r: can't insert \"%s=%s\" into hash table\n",
@@ -953,8 +1092,10 @@ int himport_r(struct hsearch_data *htab,
 			rv, name, value);
 	} while ((dp < data + size) && *dp);	/* size check needed for text */
 						/* without '\0' termination */
-	debug("INSERT: free(data = %p)\n", data);
-	free(data);
+	if (!borrow) {
+		debug("INSERT: free(data = %p)\n", data);
+		free(data);
+	}
 
 	if (flag & H_NOCLEAR)
 		goto end;
@@ -995,12 +1136,10 @@ int hwalk_r(struct hsearch_data *htab, int (*callback)(struct env_entry *entry))
 	int i;
 	int retval;
 
-	for (i = 1; i <= htab->size; ++i) {
-		if (htab->table[i].used > 0) {
-			retval = callback(&htab->table[i].entry);
-			if (retval)
-				return retval;
-		}
+	for (i = 0; i < htab->filled; ++i) {
+		retval = callback(&htab->sorted[i]->entry);
+		if (retval)
+			return retval;
 	}
 
 	return 0;
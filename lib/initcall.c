@@ -3,6 +3,7 @@
  * Copyright (c) 2013 The Chromium OS Authors.
  */
 
+#include <bootstage.h>
 #include <efi.h>
 #include <initcall.h>
 #include <log.h>
@@ -42,6 +43,31 @@ static int initcall_is_event(init_fnc_t func)
 	return 0;
 }
 
+/**
+ * initcall_timing_start() - Start timing an initcall, if enabled
+ *
+ * Initcalls are named by their unrelocated address, as shown in u-boot.map
+ *
+ * @func: Function to be called
+ * @type: Event number, if this is an event, else 0
+ * @reloc_ofs: Relocation offset of @func
+ * Return: slot to pass to bootstage_timing_end()
+ */
+static int initcall_timing_start(init_fnc_t func, enum event_t type,
+				 ulong reloc_ofs)
+{
+	char name[20];
+
+	if (!CONFIG_IS_ENABLED(BOOTSTAGE_TIMING))
+		return -1;
+	if (CONFIG_IS_ENABLED(EVENT) && type)
+		return bootstage_timing_start("event", event_type_name(type),
+					      NULL);
+	snprintf(name, sizeof(name), "%lx", (ulong)func - reloc_ofs);
+
+	return bootstage_timing_start("initcall", name, NULL);
+}
+
 /*
  * To enable debugging. add #define DEBUG at the top of the including file.
  *
@@ -54,6 +80,7 @@ int initcall_run_list(const init_fnc_t init_sequence[])
 	enum event_t type;
 	init_fnc_t func;
 	int ret = 0;
+	int timing;
 
 	for (ptr = init_sequence; func = *ptr, func; ptr++) {
 		type = initcall_is_event(func);
@@ -70,7 +97,9 @@ int initcall_run_list(const init_fnc_t init_sequence[])
 			debug("initcall: %p\n", (char *)func - reloc_ofs);
 		}
 
+		timing = initcall_timing_start(func, type, reloc_ofs);
 		ret = type ? event_notify_null(type) : func();
+		bootstage_timing_end(timing);
 		if (ret)
 			break;
 	}
@@ -12,6 +12,7 @@
 #include <lmb.h>
 #include <log.h>
 #include <malloc.h>
+#include <linux/list.h>
 
 #include <asm/global_data.h>
 #include <asm/sections.h>
@@ -23,19 +24,20 @@ DECLARE_GLOBAL_DATA_PTR;
 static void lmb_dump_region(struct lmb_region *rgn, char *name)
 {
 	unsigned long long base, size, end;
+	struct lmb_property *prop;
 	enum lmb_flags flags;
-	int i;
+	int i = 0;
 
-	printf(" %s.cnt = 0x%lx / max = 0x%lx\n", name, rgn->cnt, rgn->max);
+	printf(" %s.cnt = 0x%lx\n", name, rgn->cnt);
 
-	for (i = 0; i < rgn->cnt; i++) {
-		base = rgn->region[i].base;
-		size = rgn->region[i].size;
+	lmb_for_each_region(prop, rgn) {
+		base = prop->base;
+		size = prop->size;
 		end = base + size - 1;
-		flags = rgn->region[i].flags;
+		flags = prop->flags;
 
 		printf(" %s[%d]\t[0x%llx-0x%llx], 0x%08llx bytes flags: %x\n",
-		       name, i, base, end, size, flags);
+		       name, i++, base, end, size, flags);
 	}
 }
 
@@ -73,76 +75,212 @@ static long lmb_addrs_adjacent(phys_addr_t base1, phys_size_t size1,
 	return 0;
 }
 
-static long lmb_regions_overlap(struct lmb_region *rgn, unsigned long r1,
-				unsigned long r2)
+static inline phys_addr_t lmb_end(struct lmb_property *prop)
 {
-	phys_addr_t base1 = rgn->region[r1].base;
-	phys_size_t size1 = rgn->region[r1].size;
-	phys_addr_t base2 = rgn->region[r2].base;
-	phys_size_t size2 = rgn->region[r2].size;
+	return prop->base + prop->size - 1;
+}
 
-	return lmb_addrs_overlap(base1, size1, base2, size2);
+static inline struct lmb_property *lmb_prev(struct lmb_property *prop)
+{
+	return rb_entry_safe(rb_prev(&prop->node), struct lmb_property, node);
 }
-static long lmb_regions_adjacent(struct lmb_region *rgn, unsigned long r1,
-				 unsigned long r2)
+
+static struct lmb_property *lmb_last(struct lmb_region *rgn)
 {
-	phys_addr_t base1 = rgn->region[r1].base;
-	phys_size_t size1 = rgn->region[r1].size;
-	phys_addr_t base2 = rgn->region[r2].base;
-	phys_size_t size2 = rgn->region[r2].size;
-	return lmb_addrs_adjacent(base1, size1, base2, size2);
+	return rb_entry_safe(rb_last(&rgn->root), struct lmb_property, node);
 }
 
-static void lmb_remove_region(struct lmb_region *rgn, unsigned long r)
+/*
+ * Find the last region whose base is below @base, or at or below it if
+ * @inclusive is true. Returns NULL if there is none.
+ */
+static struct lmb_property *lmb_find_below(struct lmb_region *rgn,
+					   phys_addr_t base, bool inclusive)
 {
-	unsigned long i;
+	struct rb_node *node = rgn->root.rb_node;
+	struct lmb_property *found = NULL;
+
+	while (node) {
+		struct lmb_property *prop;
 
-	for (i = r; i < rgn->cnt - 1; i++) {
-		rgn->region[i].base = rgn->region[i + 1].base;
-		rgn->region[i].size = rgn->region[i + 1].size;
-		rgn->region[i].flags = rgn->region[i + 1].flags;
+		prop = rb_entry(node, struct lmb_property, node);
+		if (prop->base < base || (inclusive && prop->base == base)) {
+			found = prop;
+			node = node->rb_right;
+		} else {
+			node = node->rb_left;
+		}
 	}
-	rgn->cnt--;
+
+	return found;
 }
 
-/* Assumption: base addr of region 1 < base addr of region 2 */
-static void lmb_coalesce_regions(struct lmb_region *rgn, unsigned long r1,
-				 unsigned long r2)
+/* Find the lowest region overlapping (base, size), or NULL if none does */
+static struct lmb_property *lmb_find_overlap(struct lmb_region *rgn,
+					     phys_addr_t base,
+					     phys_size_t size)
 {
-	rgn->region[r1].size += rgn->region[r2].size;
-	lmb_remove_region(rgn, r2);
+	struct lmb_property *prop;
+
+	prop = lmb_find_below(rgn, base, true);
+	if (prop && lmb_addrs_overlap(base, size, prop->base, prop->size))
+		return prop;
+	prop = prop ? lmb_next(prop) : lmb_first(rgn);
+	if (prop && lmb_addrs_overlap(base, size, prop->base, prop->size))
+		return prop;
+
+	return NULL;
 }
 
-/*Assumption : base addr of region 1 < base addr of region 2*/
-static void lmb_fix_over_lap_regions(struct lmb_region *rgn, unsigned long r1,
-				     unsigned long r2)
+/**
+ * struct lmb_heap_property - An entry allocated once a pool is used up
+ *
+ * These are kept on a list with the region they belong to, so that
+ * lmb_init() can release any left behind by an earlier user of the same
+ * struct lmb without trusting its (possibly stale) contents.
+ *
+ * @prop: The entry itself
+ * @owner: Region the entry belongs to
+ * @sibling: Node in lmb_heap_props
+ */
+struct lmb_heap_property {
+	struct lmb_property prop;
+	struct lmb_region *owner;
+	struct list_head sibling;
+};
+
+static LIST_HEAD(lmb_heap_props);
+
+static struct lmb_property *lmb_new_property(struct lmb_region *rgn)
+{
+	struct lmb_property *prop = rgn->free;
+	struct lmb_heap_property *hprop;
+
+	if (prop) {
+		rgn->free = prop->next;
+		return prop;
+	}
+
+	hprop = malloc(sizeof(*hprop));
+	if (!hprop)
+		return NULL;
+	hprop->owner = rgn;
+	list_add(&hprop->sibling, &lmb_heap_props);
+
+	return &hprop->prop;
+}
+
+static void lmb_free_property(struct lmb_region *rgn,
+			      struct lmb_property *prop)
 {
-	phys_addr_t base1 = rgn->region[r1].base;
-	phys_size_t size1 = rgn->region[r1].size;
-	phys_addr_t base2 = rgn->region[r2].base;
-	phys_size_t size2 = rgn->region[r2].size;
+	struct lmb_heap_property *hprop;
 
-	if (base1 + size1 > base2 + size2) {
-		printf("This will not be a case any time\n");
-		return;
+	if (prop >= rgn->pool && prop < rgn->pool + rgn->pool_size) {
+		prop->next = rgn->free;
+		rgn->free = prop;
+	} else {
+		hprop = container_of(prop, struct lmb_heap_property, prop);
+		list_del(&hprop->sibling);
+		free(hprop);
 	}
-	rgn->region[r1].size = base2 + size2 - base1;
-	lmb_remove_region(rgn, r2);
+}
+
+/* Free all allocated entries of @rgn, whatever state it is in */
+static void lmb_release_region(struct lmb_region *rgn)
+{
+	struct lmb_heap_property *hprop, *next;
+
+	list_for_each_entry_safe(hprop, next, &lmb_heap_props, sibling) {
+		if (hprop->owner == rgn) {
+			list_del(&hprop->sibling);
+			free(hprop);
+		}
+	}
+}
+
+static long lmb_insert_region(struct lmb_region *rgn, phys_addr_t base,
+			      phys_size_t size, enum lmb_flags flags)
+{
+	struct rb_node **link = &rgn->root.rb_node;
+	struct rb_node *parent = NULL;
+	struct lmb_property *prop;
+
+	prop = lmb_new_property(rgn);
+	if (!prop)
+		return -1;
+	prop->base = base;
+	prop->size = size;
+	prop->flags = flags;
+
+	while (*link) {
+		parent = *link;
+		if (base < rb_entry(parent, struct lmb_property, node)->base)
+			link = &parent->rb_left;
+		else
+			link = &parent->rb_right;
+	}
+	rb_link_node(&prop->node, parent, link);
+	rb_insert_color(&prop->node, &rgn->root);
+	rgn->cnt++;
+
+	return 0;
+}
+
+static void lmb_remove_region(struct lmb_region *rgn,
+			      struct lmb_property *prop)
+{
+	rb_erase(&prop->node, &rgn->root);
+	lmb_free_property(rgn, prop);
+	rgn->cnt--;
+}
+
+static void lmb_init_region(struct lmb_region *rgn, struct lmb_property *pool,
+			    unsigned long pool_size)
+{
+	unsigned long i;
+
+	lmb_release_region(rgn);
+	rgn->root = RB_ROOT;
+	rgn->cnt = 0;
+	rgn->pool = pool;
+	rgn->pool_size = pool_size;
+	rgn->free = NULL;
+	for (i = pool_size; i--;) {
+		pool[i].next = rgn->free;
+		rgn->free = &pool[i];
+	}
+}
+
+static void lmb_uninit_region(struct lmb_region *rgn)
+{
+	lmb_release_region(rgn);
+	rgn->root = RB_ROOT;
+	rgn->cnt = 0;
 }
 
 void lmb_init(struct lmb *lmb)
 {
-#if IS_ENABLED(CONFIG_LMB_USE_MAX_REGIONS)
-	lmb->memory.max = CONFIG_LMB_MAX_REGIONS;
-	lmb->reserved.max = CONFIG_LMB_MAX_REGIONS;
-#else
-	lmb->memory.max = CONFIG_LMB_MEMORY_REGIONS;
-	lmb->reserved.max = CONFIG_LMB_RESERVED_REGIONS;
-	lmb->memory.region = lmb->memory_regions;
-	lmb->reserved.region = lmb->reserved_regions;
-#endif
-	lmb->memory.cnt = 0;
-	lmb->reserved.cnt = 0;
+	lmb_init_region(&lmb->memory, lmb->memory_regions, LMB_MEMORY_POOL);
+	lmb_init_region(&lmb->reserved, lmb->reserved_regions,
+			LMB_RESERVED_POOL);
+}
+
+void lmb_uninit(struct lmb *lmb)
+{
+	lmb_uninit_region(&lmb->memory);
+	lmb_uninit_region(&lmb->reserved);
+}
+
+struct lmb_property *lmb_region_get(struct lmb_region *rgn, unsigned long idx)
+{
+	struct lmb_property *prop;
+
+	lmb_for_each_region(prop, rgn) {
+		if (!idx--)
+			return prop;
+	}
+
+	return NULL;
 }
 
 void arch_lmb_reserve_generic(struct lmb *lmb, ulong sp, ulong end, ulong align)
@@ -256,91 +394,67 @@ void lmb_init_and_reserve_range(struct lmb *lmb, phys_addr_t base,
 static long lmb_add_region_flags(struct lmb_region *rgn, phys_addr_t base,
 				 phys_size_t size, enum lmb_flags flags)
 {
+	struct lmb_property *prev, *next;
+	phys_addr_t end = base + size - 1;
 	unsigned long coalesced = 0;
-	long adjacent, i;
 
-	if (rgn->cnt == 0) {
-		rgn->region[0].base = base;
-		rgn->region[0].size = size;
-		rgn->region[0].flags = flags;
-		rgn->cnt = 1;
-		return 0;
+	/*
+	 * Only the regions either side of base can contain, adjoin or overlap
+	 * the new one without also overlapping each other
+	 */
+	prev = lmb_find_below(rgn, base, false);
+	next = prev ? lmb_next(prev) : lmb_first(rgn);
+
+	if (prev) {
+		if (end <= lmb_end(prev))
+			/* Already have this region, or it has new flags */
+			return flags == prev->flags ? 0 : -1;
+		if (lmb_addrs_overlap(base, size, prev->base, prev->size))
+			return -1;
+		if (!lmb_addrs_adjacent(base, size, prev->base, prev->size) ||
+		    flags != prev->flags)
+			prev = NULL;
 	}
+	if (next && next->base == base && end <= lmb_end(next))
+		return flags == next->flags ? 0 : -1;
 
-	/* First try and coalesce this LMB with another. */
-	for (i = 0; i < rgn->cnt; i++) {
-		phys_addr_t rgnbase = rgn->region[i].base;
-		phys_size_t rgnsize = rgn->region[i].size;
-		phys_size_t rgnflags = rgn->region[i].flags;
-		phys_addr_t end = base + size - 1;
-		phys_addr_t rgnend = rgnbase + rgnsize - 1;
-		if (rgnbase <= base && end <= rgnend) {
-			if (flags == rgnflags)
-				/* Already have this region, so we're done */
-				return 0;
-			else
-				return -1; /* regions with new flags */
-		}
+	if (prev) {
+		struct lmb_property *over;
 
-		adjacent = lmb_addrs_adjacent(base, size, rgnbase, rgnsize);
-		if (adjacent > 0) {
-			if (flags != rgnflags)
-				break;
-			rgn->region[i].base -= size;
-			rgn->region[i].size += size;
-			coalesced++;
-			break;
-		} else if (adjacent < 0) {
-			if (flags != rgnflags)
-				break;
-			rgn->region[i].size += size;
-			coalesced++;
-			break;
-		} else if (lmb_addrs_overlap(base, size, rgnbase, rgnsize)) {
-			/* regions overlap */
-			return -1;
+		/* Any region overlapped when extending prev must match it */
+		for (over = next; over && over->base <= end;
+		     over = lmb_next(over)) {
+			if (over->flags != flags)
+				return -1;
 		}
-	}
 
-	if (i < rgn->cnt - 1 && rgn->region[i].flags == rgn->region[i + 1].flags)  {
-		if (lmb_regions_adjacent(rgn, i, i + 1)) {
-			lmb_coalesce_regions(rgn, i, i + 1);
-			coalesced++;
-		} else if (lmb_regions_overlap(rgn, i, i + 1)) {
-			/* fix overlapping area */
-			lmb_fix_over_lap_regions(rgn, i, i + 1);
+		prev->size += size;
+		coalesced++;
+
+		/* Absorb the regions which now adjoin or overlap prev */
+		while (next && next->flags == prev->flags &&
+		       next->base <= lmb_end(prev) + 1) {
+			if (lmb_end(next) > lmb_end(prev))
+				prev->size = lmb_end(next) - prev->base + 1;
+			lmb_remove_region(rgn, next);
 			coalesced++;
+			next = lmb_next(prev);
 		}
-	}
 
-	if (coalesced)
 		return coalesced;
-	if (rgn->cnt >= rgn->max)
-		return -1;
-
-	/* Couldn't coalesce the LMB, so add it to the sorted table. */
-	for (i = rgn->cnt-1; i >= 0; i--) {
-		if (base < rgn->region[i].base) {
-			rgn->region[i + 1].base = rgn->region[i].base;
-			rgn->region[i + 1].size = rgn->region[i].size;
-			rgn->region[i + 1].flags = rgn->region[i].flags;
-		} else {
-			rgn->region[i + 1].base = base;
-			rgn->region[i + 1].size = size;
-			rgn->region[i + 1].flags = flags;
-			break;
-		}
 	}
 
-	if (base < rgn->region[0].base) {
-		rgn->region[0].base = base;
-		rgn->region[0].size = size;
-		rgn->region[0].flags = flags;
+	if (next && lmb_addrs_overlap(base, size, next->base, next->size))
+		return -1;
+	if (next && lmb_addrs_adjacent(base, size, next->base, next->size) > 0 &&
+	    flags == next->flags) {
+		next->base = base;
+		next->size += size;
+		return 1;
 	}
 
-	rgn->cnt++;
-
-	return 0;
+	/* Couldn't coalesce the LMB, so add it to the tree */
+	return lmb_insert_region(rgn, base, size, flags);
 }
 
 static long lmb_add_region(struct lmb_region *rgn, phys_addr_t base,
@@ -360,51 +474,48 @@ long lmb_add(struct lmb *lmb, phys_addr_t base, phys_size_t size)
 long lmb_free(struct lmb *lmb, phys_addr_t base, phys_size_t size)
 {
 	struct lmb_region *rgn = &(lmb->reserved);
+	struct lmb_property *prop;
 	phys_addr_t rgnbegin, rgnend;
 	phys_addr_t end = base + size - 1;
-	int i;
-
-	rgnbegin = rgnend = 0; /* supress gcc warnings */
 
 	/* Find the region where (base, size) belongs to */
-	for (i = 0; i < rgn->cnt; i++) {
-		rgnbegin = rgn->region[i].base;
-		rgnend = rgnbegin + rgn->region[i].size - 1;
-
-		if ((rgnbegin <= base) && (end <= rgnend))
-			break;
-	}
+	prop = lmb_find_below(rgn, base, true);
 
 	/* Didn't find the region */
-	if (i == rgn->cnt)
+	if (!prop || end > lmb_end(prop))
 		return -1;
 
+	rgnbegin = prop->base;
+	rgnend = lmb_end(prop);
+
 	/* Check to see if we are removing entire region */
 	if ((rgnbegin == base) && (rgnend == end)) {
-		lmb_remove_region(rgn, i);
+		lmb_remove_region(rgn, prop);
 		return 0;
 	}
 
 	/* Check to see if region is matching at the front */
 	if (rgnbegin == base) {
-		rgn->region[i].base = end + 1;
-		rgn->region[i].size -= size;
+		prop->base = end + 1;
+		prop->size -= size;
 		return 0;
 	}
 
 	/* Check to see if the region is matching at the end */
 	if (rgnend == end) {
-		rgn->region[i].size -= size;
+		prop->size -= size;
 		return 0;
 	}
 
 	/*
-	 * We need to split the entry -  adjust the current one to the
-	 * beginging of the hole and add the region after hole.
+	 * We need to split the entry -  add the region after the hole and then
+	 * adjust the current one to the beginning of the hole.
 	 */
-	rgn->region[i].size = base - rgn->region[i].base;
-	return lmb_add_region_flags(rgn, end + 1, rgnend - end,
-				    rgn->region[i].flags);
+	if (lmb_insert_region(rgn, end + 1, rgnend - end, prop->flags))
+		return -1;
+	prop->size = base - prop->base;
+
+	return 0;
 }
 
 long lmb_reserve_flags(struct lmb *lmb, phys_addr_t base, phys_size_t size,
@@ -420,21 +531,6 @@ long lmb_reserve(struct lmb *lmb, phys_addr_t base, phys_size_t size)
 	return lmb_reserve_flags(lmb, base, size, LMB_NONE);
 }
 
-static long lmb_overlaps_region(struct lmb_region *rgn, phys_addr_t base,
-				phys_size_t size)
-{
-	unsigned long i;
-
-	for (i = 0; i < rgn->cnt; i++) {
-		phys_addr_t rgnbase = rgn->region[i].base;
-		phys_size_t rgnsize = rgn->region[i].size;
-		if (lmb_addrs_overlap(base, size, rgnbase, rgnsize))
-			break;
-	}
-
-	return (i < rgn->cnt) ? i : -1;
-}
-
 phys_addr_t lmb_alloc(struct lmb *lmb, phys_size_t size, ulong align)
 {
 	return lmb_alloc_base(lmb, size, align, LMB_ALLOC_ANYWHERE);
@@ -460,13 +556,12 @@ static phys_addr_t lmb_align_down(phys_addr_t addr, phys_size_t size)
 
 phys_addr_t __lmb_alloc_base(struct lmb *lmb, phys_size_t size, ulong align, phys_addr_t max_addr)
 {
-	long i, rgn;
+	struct lmb_property *mem, *res;
 	phys_addr_t base = 0;
-	phys_addr_t res_base;
 
-	for (i = lmb->memory.cnt - 1; i >= 0; i--) {
-		phys_addr_t lmbbase = lmb->memory.region[i].base;
-		phys_size_t lmbsize = lmb->memory.region[i].size;
+	for (mem = lmb_last(&lmb->memory); mem; mem = lmb_prev(mem)) {
+		phys_addr_t lmbbase = mem->base;
+		phys_size_t lmbsize = mem->size;
 
 		if (lmbsize < size)
 			continue;
@@ -482,18 +577,17 @@ phys_addr_t __lmb_alloc_base(struct lmb *lmb, phys_size_t size, ulong align, phy
 			continue;
 
 		while (base && lmbbase <= base) {
-			rgn = lmb_overlaps_region(&lmb->reserved, base, size);
-			if (rgn < 0) {
+			res = lmb_find_overlap(&lmb->reserved, base, size);
+			if (!res) {
 				/* This area isn't reserved, take it */
 				if (lmb_add_region(&lmb->reserved, base,
 						   size) < 0)
 					return 0;
 				return base;
 			}
-			res_base = lmb->reserved.region[rgn].base;
-			if (res_base < size)
+			if (res->base < size)
 				break;
-			base = lmb_align_down(res_base - size, align);
+			base = lmb_align_down(res->base - size, align);
 		}
 	}
 	return 0;
@@ -505,18 +599,17 @@ phys_addr_t __lmb_alloc_base(struct lmb *lmb, phys_size_t size, ulong align, phy
  */
 phys_addr_t lmb_alloc_addr(struct lmb *lmb, phys_addr_t base, phys_size_t size)
 {
-	long rgn;
+	struct lmb_property *mem;
 
 	/* Check if the requested address is in one of the memory regions */
-	rgn = lmb_overlaps_region(&lmb->memory, base, size);
-	if (rgn >= 0) {
+	mem = lmb_find_overlap(&lmb->memory, base, size);
+	if (mem) {
 		/*
 		 * Check if the requested end address is in the same memory
 		 * region we found.
 		 */
-		if (lmb_addrs_overlap(lmb->memory.region[rgn].base,
-				      lmb->memory.region[rgn].size,
-				      base + size - 1, 1)) {
+		if (lmb_addrs_overlap(mem->base, mem->size, base + size - 1,
+				      1)) {
 			/* ok, reserve the memory */
 			if (lmb_reserve(lmb, base, size) >= 0)
 				return base;
@@ -528,40 +621,42 @@ phys_addr_t lmb_alloc_addr(struct lmb *lmb, phys_addr_t base, phys_size_t size)
 /* Return number of bytes from a given address that are free */
 phys_size_t lmb_get_free_size(struct lmb *lmb, phys_addr_t addr)
 {
-	int i;
-	long rgn;
+	struct lmb_property *res;
 
 	/* check if the requested address is in the memory regions */
-	rgn = lmb_overlaps_region(&lmb->memory, addr, 1);
-	if (rgn >= 0) {
-		for (i = 0; i < lmb->reserved.cnt; i++) {
-			if (addr < lmb->reserved.region[i].base) {
-				/* first reserved range > requested address */
-				return lmb->reserved.region[i].base - addr;
-			}
-			if (lmb->reserved.region[i].base +
-			    lmb->reserved.region[i].size > addr) {
-				/* requested addr is in this reserved range */
-				return 0;
-			}
+	if (lmb_find_overlap(&lmb->memory, addr, 1)) {
+		res = lmb_find_below(&lmb->reserved, addr, true);
+		if (res && lmb_end(res) >= addr) {
+			/* requested addr is in this reserved range */
+			return 0;
+		}
+		res = res ? lmb_next(res) : lmb_first(&lmb->reserved);
+		if (res) {
+			/* first reserved range > requested address */
+			return res->base - addr;
 		}
 		/* if we come here: no reserved ranges above requested addr */
-		return lmb->memory.region[lmb->memory.cnt - 1].base +
-		       lmb->memory.region[lmb->memory.cnt - 1].size - addr;
+		return lmb_end(lmb_last(&lmb->memory)) + 1 - addr;
 	}
 	return 0;
 }
 
+struct lmb_property *lmb_get_reserved(struct lmb *lmb, phys_addr_t addr)
+{
+	struct lmb_property *res;
+
+	res = lmb_find_below(&lmb->reserved, addr, true);
+	if (res && addr <= lmb_end(res))
+		return res;
+	return NULL;
+}
+
 int lmb_is_reserved_flags(struct lmb *lmb, phys_addr_t addr, int flags)
 {
-	int i;
+	struct lmb_property *res = lmb_get_reserved(lmb, addr);
 
-	for (i = 0; i < lmb->reserved.cnt; i++) {
-		phys_addr_t upper = lmb->reserved.region[i].base +
-			lmb->reserved.region[i].size - 1;
-		if ((addr >= lmb->reserved.region[i].base) && (addr <= upper))
-			return (lmb->reserved.region[i].flags & flags) == flags;
-	}
+	if (res)
+		return (res->flags & flags) == flags;
 	return 0;
 }
 
@@ -21,11 +21,10 @@ static void panic_finish(void) __attribute__ ((noreturn));
 static void panic_finish(void)
 {
 	putc('\n');
+	flush();  /* flush the panic message before reset */
 #if defined(CONFIG_PANIC_HANG)
 	hang();
 #else
-	flush();  /* flush the panic message before reset */
-
 	do_reset(NULL, 0, 0, NULL);
 #endif
 	while (1)
@@ -0,0 +1,263 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Sampling profiler
+ *
+ * A periodic tick records the interrupted program counter and its callers
+ * into a ring buffer. Unlike function tracing this needs no instrumentation,
+ * so the code under test runs at close to its normal speed. The samples can
+ * be turned into a flame graph with proftool.
+ */
+
+#include <malloc.h>
+#include <profile.h>
+#include <trace.h>
+#include <linux/compiler.h>
+#include <linux/errno.h>
+#include <linux/sizes.h>
+#include <asm/global_data.h>
+#include <asm/sections.h>
+
+DECLARE_GLOBAL_DATA_PTR;
+
+/* Largest stack frame we follow, to stop at a corrupt frame pointer */
+#define PROFILE_MAX_FRAME	SZ_64K
+
+/**
+ * struct profile_state - state of the profiler
+ *
+ * The buffer holds variable-length records, each a word with the number of
+ * frames followed by one word per frame. When it is full, the oldest records
+ * are dropped to make room.
+ *
+ * @buf:	ring buffer of records
+ * @size:	size of @buf in words
+ * @head:	word index where the next record is written
+ * @tail:	word index of the oldest record
+ * @used:	number of words in use
+ * @period_us:	time between samples in microseconds
+ * @running:	true while samples are being taken
+ * @samples:	number of samples taken
+ * @recorded:	number of records in the buffer
+ * @dropped:	number of records dropped because the buffer was full
+ * @unknown:	number of samples with no frame in U-Boot's code
+ * @busy:	true while the buffer is being read or reset
+ */
+struct profile_state {
+	u32 *buf;
+	ulong size;
+	ulong head;
+	ulong tail;
+	ulong used;
+	uint period_us;
+	bool running;
+	ulong samples;
+	ulong recorded;
+	ulong dropped;
+	ulong unknown;
+	bool busy;
+};
+
+static struct profile_state prof;
+
+/*
+ * The tick may arrive at any time, so it must not touch the buffer while it
+ * is being read or reset
+ */
+static void profile_lock(void)
+{
+	prof.busy = true;
+	barrier();
+}
+
+static void profile_unlock(void)
+{
+	barrier();
+	prof.busy = false;
+}
+
+__weak int arch_profile_start(uint period_us)
+{
+	return -ENOSYS;
+}
+
+__weak void arch_profile_stop(void)
+{
+}
+
+/**
+ * profile_code_offset() - get the offset of an address into U-Boot's code
+ *
+ * @addr:	address to convert
+ * @offsetp:	returns the offset from the start of U-Boot
+ * Return: true if @addr lies within U-Boot
+ */
+static bool profile_code_offset(ulong addr, u32 *offsetp)
+{
+	ulong offset;
+
+#ifdef CONFIG_SANDBOX
+	offset = addr - (ulong)_init;
+#else
+	if (gd->flags & GD_FLG_RELOC)
+		offset = addr - gd->relocaddr;
+	else
+		offset = addr - CONFIG_TEXT_BASE;
+#endif
+	if (offset >= gd->mon_len)
+		return false;
+	*offsetp = offset;
+
+	return true;
+}
+
+/**
+ * profile_push() - add a record to the ring, dropping old records if needed
+ *
+ * @rec:	record to add
+ * @words:	size of the record in words
+ */
+static void profile_push(const u32 *rec, ulong words)
+{
+	ulong i;
+
+	while (prof.size - prof.used < words) {
+		ulong len = prof.buf[prof.tail] + 1;
+
+		prof.tail = (prof.tail + len) % prof.size;
+		prof.used -= len;
+		prof.recorded--;
+		prof.dropped++;
+	}
+
+	for (i = 0; i < words; i++) {
+		prof.buf[prof.head] = rec[i];
+		prof.head = (prof.head + 1) % prof.size;
+	}
+	prof.used += words;
+	prof.recorded++;
+}
+
+void profile_sample(ulong pc, ulong fp, ulong stack_top)
+{
+	u32 rec[CONFIG_PROFILE_DEPTH + 1];
+	ulong stack_bottom = (ulong)rec;
+	int depth = 0;
+
+	if (!prof.running || prof.busy)
+		return;
+	prof.samples++;
+
+	while (depth < CONFIG_PROFILE_DEPTH) {
+		ulong next;
+
+		if (profile_code_offset(pc, &rec[depth + 1]))
+			depth++;
+
+		/* Only follow frame pointers which are plausibly on the stack */
+		if (fp < stack_bottom || fp & (sizeof(ulong) - 1) ||
+		    fp + 2 * sizeof(ulong) > stack_top)
+			break;
+		next = ((ulong *)fp)[0];
+		pc = ((ulong *)fp)[1];
+
+		/* Keep this return address but stop at a corrupt next frame */
+		if (next <= fp || next - fp > PROFILE_MAX_FRAME)
+			next = 0;
+		fp = next;
+	}
+
+	if (!depth) {
+		prof.unknown++;
+		return;
+	}
+	rec[0] = depth;
+	profile_push(rec, depth + 1);
+}
+
+int profile_start(uint period_us)
+{
+	int ret;
+
+	if (prof.running)
+		return -EALREADY;
+	if (!prof.buf) {
+		prof.buf = malloc(CONFIG_PROFILE_BUFFER_SIZE);
+		if (!prof.buf)
+			return -ENOMEM;
+		prof.size = CONFIG_PROFILE_BUFFER_SIZE / sizeof(u32);
+	}
+
+	prof.period_us = period_us;
+	prof.running = true;
+	ret = arch_profile_start(period_us);
+	if (ret) {
+		prof.running = false;
+		return ret;
+	}
+
+	return 0;
+}
+
+void profile_stop(void)
+{
+	if (!prof.running)
+		return;
+	arch_profile_stop();
+	prof.running = false;
+}
+
+void profile_reset(void)
+{
+	profile_lock();
+	prof.head = 0;
+	prof.tail = 0;
+	prof.used = 0;
+	prof.samples = 0;
+	prof.recorded = 0;
+	prof.dropped = 0;
+	prof.unknown = 0;
+	profile_unlock();
+}
+
+void profile_get_stats(struct profile_stats *stats)
+{
+	profile_lock();
+	stats->period_us = prof.period_us;
+	stats->running = prof.running;
+	stats->samples = prof.samples;
+	stats->recorded = prof.recorded;
+	stats->dropped = prof.dropped;
+	stats->unknown = prof.unknown;
+	stats->used = prof.used * sizeof(u32);
+	stats->size = prof.size * sizeof(u32);
+	profile_unlock();
+}
+
+int profile_list_samples(void *buff, size_t buff_size, size_t *needed)
+{
+	struct trace_output_hdr *hdr = buff;
+	u32 *out = (u32 *)(hdr + 1);
+	ulong i, pos;
+
+	profile_lock();
+	*needed = sizeof(*hdr) + prof.used * sizeof(u32);
+	if (*needed > buff_size) {
+		profile_unlock();
+		return -ENOSPC;
+	}
+
+	memset(hdr, '\0', sizeof(*hdr));
+	hdr->type = TRACE_CHUNK_SAMPLES;
+	hdr->version = TRACE_VERSION;
+	hdr->rec_count = prof.recorded;
+	hdr->spare = prof.period_us;
+	hdr->text_base = CONFIG_TEXT_BASE;
+
+	for (i = 0, pos = prof.tail; i < prof.used; i++) {
+		out[i] = prof.buf[pos];
+		pos = (pos + 1) % prof.size;
+	}
+	profile_unlock();
+
+	return 0;
+}
@@ -103,16 +103,18 @@ static int lmb_test_dump_region(struct unit_test_state *uts,
 				struct lmb_region *rgn, char *name)
 {
 	unsigned long long base, size, end;
+	struct lmb_property *prop;
 	enum lmb_flags flags;
-	int i;
+	int i = -1;
 
-	ut_assert_nextline(" %s.cnt = 0x%lx / max = 0x%lx", name, rgn->cnt, rgn->max);
+	ut_assert_nextline(" %s.cnt = 0x%lx", name, rgn->cnt);
 
-	for (i = 0; i < rgn->cnt; i++) {
-		base = rgn->region[i].base;
-		size = rgn->region[i].size;
+	lmb_for_each_region(prop, rgn) {
+		i++;
+		base = prop->base;
+		size = prop->size;
 		end = base + size - 1;
-		flags = rgn->region[i].flags;
+		flags = prop->flags;
 
 		/*
 		 * this entry includes the stack (get_sp()) on many platforms
@@ -0,0 +1,71 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Tests for command lookup
+ */
+
+#include <common.h>
+#include <command.h>
+#include <test/cmd.h>
+#include <test/ut.h>
+
+/*
+ * Check that find_cmd(), which uses a sorted index, agrees with a linear
+ * search of the command table for every command name and every
+ * abbreviation of it
+ */
+static int cmd_test_find_cmd(struct unit_test_state *uts)
+{
+	struct cmd_tbl *start = ll_entry_start(struct cmd_tbl, cmd);
+	const int count = ll_entry_count(struct cmd_tbl, cmd);
+	char name[64];
+	int i, len;
+
+	for (i = 0; i < count; i++) {
+		strlcpy(name, start[i].name, sizeof(name));
+		for (len = strlen(name); len > 0; len--) {
+			name[len] = '\0';
+			ut_asserteq_ptr(find_cmd_tbl(name, start, count),
+					find_cmd(name));
+		}
+	}
+
+	return 0;
+}
+CMD_TEST(cmd_test_find_cmd, 0);
+
+/* Check each kind of lookup result */
+static int cmd_test_find_cmd_kinds(struct unit_test_state *uts)
+{
+	struct cmd_tbl *cmd;
+
+	/* Exact match */
+	cmd = find_cmd("version");
+	ut_assertnonnull(cmd);
+	ut_asserteq_str("version", cmd->name);
+
+	/* Unique abbreviation */
+	cmd = find_cmd("versio");
+	ut_assertnonnull(cmd);
+	ut_asserteq_str("version", cmd->name);
+
+	if (IS_ENABLED(CONFIG_CMD_MEMORY)) {
+		/* Exact match which is also a prefix of other commands */
+		cmd = find_cmd("md");
+		ut_assertnonnull(cmd);
+		ut_asserteq_str("md", cmd->name);
+
+		/* The size suffix is not part of the name */
+		ut_asserteq_ptr(cmd, find_cmd("md.b"));
+
+		/* Ambiguous prefix, shared by md and mw */
+		ut_assertnull(find_cmd("m"));
+	}
+
+	/* Not found */
+	ut_assertnull(find_cmd("no_such_command"));
+	ut_assertnull(find_cmd("versionx"));
+	ut_assertnull(find_cmd(""));
+
+	return 0;
+}
+CMD_TEST(cmd_test_find_cmd_kinds, 0);
@@ -0,0 +1,82 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Tests for the perf command
+ */
+
+#include <common.h>
+#include <command.h>
+#include <perf.h>
+#include <test/cmd.h>
+#include <test/ut.h>
+
+/**
+ * check_stat() - check the output of 'perf stat' after the command's output
+ *
+ * @uts: Test state
+ * @cmd: Name of the command that was run
+ * Return: 0 if OK, -ve on error
+ */
+static int check_stat(struct unit_test_state *uts, const char *cmd)
+{
+	int i;
+
+	ut_assert_nextline_empty();
+	ut_assert_nextline("Performance counters for '%s':", cmd);
+	for (i = 0; i < PERF_EVENT_COUNT; i++) {
+		char *name;
+
+		console_record_readline(uts->actual_str,
+					sizeof(uts->actual_str));
+		name = strrchr(uts->actual_str, ' ');
+		ut_assertnonnull(name);
+		ut_asserteq_str(perf_event_name(i), name + 1);
+	}
+
+	/* Instructions per cycle are only shown if any cycles were counted */
+	console_record_readline(uts->actual_str, sizeof(uts->actual_str));
+	if (strstr(uts->actual_str, "instructions per cycle"))
+		console_record_readline(uts->actual_str,
+					sizeof(uts->actual_str));
+	ut_assertnonnull(strstr(uts->actual_str, "seconds elapsed"));
+	ut_assert_console_end();
+
+	return 0;
+}
+
+/* Check that counters only go up and that 'perf stat' reports them */
+static int cmd_test_perf_stat(struct unit_test_state *uts)
+{
+	struct perf_counts start, end;
+	int i;
+
+	/* The host may not allow access to its counters */
+	if (perf_init()) {
+		ut_asserteq(1, run_command("perf stat echo hello", 0));
+		ut_assert_nextlinen("Performance counters not available");
+		ut_assert_console_end();
+
+		return -EAGAIN;
+	}
+
+	ut_assertok(perf_read(&start));
+	ut_assertok(run_command("echo hello", 0));
+	ut_assertok(perf_read(&end));
+	ut_assert(end.count[PERF_CYCLES] > start.count[PERF_CYCLES]);
+	ut_assert(end.count[PERF_INSTRUCTIONS] >
+		  start.count[PERF_INSTRUCTIONS]);
+	for (i = 0; i < PERF_EVENT_COUNT; i++)
+		ut_assert(end.count[i] >= start.count[i]);
+	ut_assert_nextline("hello");
+	ut_assert_console_end();
+
+	ut_assertok(run_command("perf stat echo hello", 0));
+	ut_assert_nextline("hello");
+	ut_assertok(check_stat(uts, "echo"));
+
+	/* The command's failure is passed on */
+	ut_asserteq(1, run_command("perf stat false", 0));
+	ut_assertok(check_stat(uts, "false"));
+
+	return 0;
+}
+CMD_TEST(cmd_test_perf_stat, UT_TESTF_CONSOLE_REC);
@@ -0,0 +1,74 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Tests for the console output buffer
+ */
+
+#include <common.h>
+#include <console.h>
+#include <cyclic.h>
+#include <time.h>
+#include <asm/global_data.h>
+#include <test/common.h>
+#include <test/test.h>
+#include <test/ut.h>
+
+DECLARE_GLOBAL_DATA_PTR;
+
+static int check_console_buffer(struct unit_test_state *uts)
+{
+	puts("\r");
+	flush();
+	ut_asserteq(0, console_buffer_pending());
+
+	/* Just after a flush, output is held */
+	putc('\r');
+	puts("\r\r");
+	ut_asserteq(3, console_buffer_pending());
+
+	/* Checking for input does not write it out, e.g. in ctrlc() */
+	tstc();
+	ctrlc();
+	ut_asserteq(3, console_buffer_pending());
+
+	/* Output is held until the latency has passed */
+	timer_test_add_offset(CONFIG_CONSOLE_BUFFER_LATENCY_MS - 1);
+	schedule();
+	ut_asserteq(3, console_buffer_pending());
+	timer_test_add_offset(1);
+	schedule();
+	ut_asserteq(0, console_buffer_pending());
+
+	/* It is also written out on request, e.g. before booting */
+	puts("\r");
+	ut_asserteq(1, console_buffer_pending());
+	flush();
+	ut_asserteq(0, console_buffer_pending());
+
+	/* Even when the console has been silenced since, e.g. by bootm */
+	puts("\r");
+	gd->flags |= GD_FLG_SILENT | GD_FLG_DISABLE_CONSOLE;
+	flush();
+	gd->flags &= ~(GD_FLG_SILENT | GD_FLG_DISABLE_CONSOLE);
+	ut_asserteq(0, console_buffer_pending());
+
+	return 0;
+}
+
+/* Check when buffered output is written out */
+static int common_test_console_buffer(struct unit_test_state *uts)
+{
+	ulong flags = gd->flags;
+	int ret;
+
+	/* Output is dropped when silent, so allow it, writing only '\r' */
+	gd->flags &= ~(GD_FLG_SILENT | GD_FLG_RECORD);
+
+	/* Stop the clock, so that output is only written out when expected */
+	timer_test_freeze(true);
+	ret = check_console_buffer(uts);
+	timer_test_freeze(false);
+	gd->flags = flags;
+
+	return ret;
+}
+COMMON_TEST(common_test_console_buffer, 0);
@@ -33,3 +33,64 @@ static int dm_test_cyclic_running(struct unit_test_state *uts)
 	return 0;
 }
 COMMON_TEST(dm_test_cyclic_running, 0);
+
+/* Order in which cyclic_test_order() was called, by name */
+static char cyclic_order[5];
+static int cyclic_order_len;
+
+static void cyclic_test_order(void *ctx)
+{
+	const char *name = ctx;
+
+	if (cyclic_order_len < sizeof(cyclic_order) - 1)
+		cyclic_order[cyclic_order_len++] = *name;
+}
+
+/* Check that due functions run by deadline and that they are accounted */
+static int dm_test_cyclic_deadline(struct unit_test_state *uts)
+{
+	struct cyclic_info *cyc_a, *cyc_b, *cyclic;
+	u64 prev = 0, total;
+	int i;
+
+	memset(cyclic_order, '\0', sizeof(cyclic_order));
+	cyclic_order_len = 0;
+	cyc_a = cyclic_register(cyclic_test_order, 2000, "a", "a");
+	ut_assertnonnull(cyc_a);
+	cyc_b = cyclic_register(cyclic_test_order, 1000, "b", "b");
+	ut_assertnonnull(cyc_b);
+
+	/*
+	 * Both are due now, so they run in the order they were added. Allow
+	 * for the run budget being used up by other functions.
+	 */
+	for (i = 0; i < 3 && cyclic_order_len < 2; i++)
+		schedule();
+	ut_asserteq_str("ab", cyclic_order);
+
+	/* The list stays in deadline order */
+	hlist_for_each_entry(cyclic, cyclic_get_list(), list) {
+		ut_assert(cyclic->next_call >= prev);
+		prev = cyclic->next_call;
+	}
+
+	/* Nothing is due yet */
+	schedule();
+	ut_asserteq_str("ab", cyclic_order);
+
+	/* Now both are due, with b's deadline earlier than a's */
+	timer_test_add_offset(3);
+	for (i = 0; i < 3 && cyclic_order_len < 4; i++)
+		schedule();
+	ut_asserteq_str("abba", cyclic_order);
+
+	ut_asserteq(2, cyc_b->run_cnt);
+	ut_assert(cyc_b->late_max_us >= 2000);
+	ut_assert(cyc_b->cpu_time_max_us <= cyc_b->cpu_time_us);
+	for (total = 0, i = 0; i < CYCLIC_LATE_BUCKETS; i++)
+		total += cyc_b->late_hist[i];
+	ut_asserteq(2, total);
+
+	return 0;
+}
+COMMON_TEST(dm_test_cyclic_deadline, 0);
@@ -0,0 +1,77 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Tests for the malloc() slab front end
+ */
+
+#include <common.h>
+#include <malloc.h>
+#include <test/common.h>
+#include <test/test.h>
+#include <test/ut.h>
+#include <linux/sizes.h>
+
+/* Find the slab size class used for a request of @size bytes */
+static int find_slab_class(uint size, struct malloc_slab_info *info)
+{
+	int i;
+
+	for (i = 0; !malloc_get_slab_info(i, info); i++) {
+		if (info->size >= size)
+			return i;
+	}
+
+	return -ENOENT;
+}
+
+/* Test that small allocations are served by, and returned to, the slabs */
+static int common_test_malloc_slab(struct unit_test_state *uts)
+{
+	struct malloc_slab_info before, after;
+	u8 *ptr, *big;
+	int idx, i;
+
+	idx = find_slab_class(40, &before);
+	ut_assert(idx >= 0);
+
+	ptr = malloc(40);
+	ut_assertnonnull(ptr);
+	ut_assertok(malloc_get_slab_info(idx, &after));
+	ut_asserteq(before.in_use + 1, after.in_use);
+	ut_asserteq(before.allocs + 1, after.allocs);
+	ut_asserteq(after.size, malloc_usable_size(ptr));
+
+	/* Growing within the class keeps the object where it is */
+	ut_asserteq_ptr(ptr, realloc(ptr, after.size));
+
+	/* Growing past the largest class moves it out of the slabs */
+	memset(ptr, 0xa5, after.size);
+	big = realloc(ptr, SZ_4K);
+	ut_assertnonnull(big);
+	ut_assert(malloc_usable_size(big) >= SZ_4K);
+	for (i = 0; i < after.size; i++)
+		ut_asserteq(0xa5, big[i]);
+	ut_assertok(malloc_get_slab_info(idx, &after));
+	ut_asserteq(before.in_use, after.in_use);
+	free(big);
+
+	/* The free list is LIFO, so this reuses a dirty object */
+	ptr = malloc(40);
+	ut_assertnonnull(ptr);
+	memset(ptr, 0xff, 40);
+	free(ptr);
+	ptr = calloc(5, 8);
+	ut_assertnonnull(ptr);
+	for (i = 0; i < 40; i++)
+		ut_asserteq(0, ptr[i]);
+	free(ptr);
+
+	ut_assertok(malloc_get_slab_info(idx, &after));
+	ut_asserteq(before.in_use, after.in_use);
+	ut_asserteq(before.allocs + 3, after.allocs);
+
+	/* A size which overflows is rejected rather than wrapped */
+	ut_assertnull(calloc(SIZE_MAX / 8 + 2, 8));
+
+	return 0;
+}
+COMMON_TEST(common_test_malloc_slab, 0);
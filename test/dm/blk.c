@@ -6,6 +6,7 @@
 #include <common.h>
 #include <blk.h>
 #include <dm.h>
+#include <malloc.h>
 #include <part.h>
 #include <sandbox_host.h>
 #include <usb.h>
@@ -335,3 +336,83 @@ static int dm_test_blk_foreach(struct unit_test_state *uts)
 	return 0;
 }
 DM_TEST(dm_test_blk_foreach, UT_TESTF_SCAN_PDATA | UT_TESTF_SCAN_FDT);
+
+/* Test that the block cache serves repeated, sequential and partial reads */
+static int dm_test_blk_cache(struct unit_test_state *uts)
+{
+	struct block_cache_dev_stats dstats;
+	struct block_cache_stats stats;
+	char write[8 * 512], read[8 * 512];
+	struct blk_desc *desc;
+	char *big;
+	ulong gen;
+	int i;
+
+	if (!CONFIG_IS_ENABLED(BLOCK_CACHE))
+		return -EAGAIN;
+
+	ut_assertok(blk_get_device_by_str("mmc", "0", &desc));
+	ut_asserteq(512, desc->blksz);
+	for (i = 0; i < sizeof(write); i++)
+		write[i] = i * 3;
+	ut_asserteq(8, blk_dwrite(desc, 0, 8, write));
+	blkcache_free();
+
+	/* The first read misses and the second comes from the cache */
+	ut_asserteq(2, blk_dread(desc, 0, 2, read));
+	ut_asserteq(2, blk_dread(desc, 0, 2, read));
+	blkcache_stats(&stats);
+	ut_asserteq(1, stats.hits);
+	ut_asserteq(1, stats.misses);
+	ut_asserteq(0, stats.readaheads);
+
+	/* Carrying on from there reads ahead, so the next read is cached */
+	ut_asserteq(2, blk_dread(desc, 2, 2, read + 2 * 512));
+	ut_asserteq(4, blk_dread(desc, 4, 4, read + 4 * 512));
+	ut_asserteq_mem(write, read, sizeof(read));
+	blkcache_stats(&stats);
+	ut_asserteq(1, stats.hits);
+	ut_asserteq(1, stats.misses);
+	ut_asserteq(1, stats.readaheads);
+
+	/* A read which is partly cached only reads the missing parts */
+	blkcache_invalidate(desc->uclass_id, desc->devnum);
+	ut_asserteq(2, blk_dread(desc, 0, 2, read));
+	ut_asserteq(2, blk_dread(desc, 4, 2, read));
+	memset(read, '\0', sizeof(read));
+	ut_asserteq(8, blk_dread(desc, 0, 8, read));
+	ut_asserteq_mem(write, read, sizeof(read));
+	blkcache_stats(&stats);
+	ut_asserteq(2, stats.hits);
+	ut_asserteq(4, stats.misses);
+	ut_asserteq(0, stats.readaheads);
+
+	/* The device's statistics have been kept separately */
+	ut_assertok(blkcache_dev_stats(0, &dstats));
+	ut_asserteq(desc->uclass_id, dstats.iftype);
+	ut_asserteq(desc->devnum, dstats.devnum);
+	ut_asserteq(4, dstats.hits);
+	ut_asserteq(6, dstats.misses);
+	ut_asserteq(1, dstats.readaheads);
+	ut_asserteq(-ENOENT, blkcache_dev_stats(1, &dstats));
+
+	/* Writing to the device changes its generation */
+	gen = blkcache_generation(desc->uclass_id, desc->devnum);
+	ut_asserteq(gen, blkcache_generation(desc->uclass_id, desc->devnum));
+	ut_asserteq(8, blk_dwrite(desc, 0, 8, write));
+	ut_assert(gen != blkcache_generation(desc->uclass_id, desc->devnum));
+
+	/* A large read is not cached, so it cannot push out other blocks */
+	big = malloc(64 * 512);
+	ut_assertnonnull(big);
+	blkcache_stats(&stats);
+	ut_asserteq(64, blk_dread(desc, 64, 64, big));
+	ut_asserteq(2, blk_dread(desc, 64, 2, read));
+	free(big);
+	blkcache_stats(&stats);
+	ut_asserteq(0, stats.hits);
+	ut_asserteq(2, stats.misses);
+
+	return 0;
+}
+DM_TEST(dm_test_blk_cache, UT_TESTF_SCAN_PDATA | UT_TESTF_SCAN_FDT);
@@ -8,6 +8,7 @@
 #include <mmc.h>
 #include <part.h>
 #include <part_efi.h>
+#include <dm/device-internal.h>
 #include <dm/test.h>
 #include <test/ut.h>
 
@@ -195,3 +196,64 @@ static int dm_test_part_get_info_by_type(struct unit_test_state *uts)
 	return 0;
 }
 DM_TEST(dm_test_part_get_info_by_type, UT_TESTF_SCAN_PDATA | UT_TESTF_SCAN_FDT);
+
+/* Check that the GPT is read again after the device is written */
+static int dm_test_part_gpt_cache(struct unit_test_state *uts)
+{
+	char str_disk_guid[UUID_STR_LEN + 1];
+	struct blk_desc *mmc_dev_desc;
+	struct disk_partition info;
+	struct disk_partition parts[2] = {
+		{
+			.start = 48, /* GPT data takes up the first 34 blocks or so */
+			.size = 1,
+			.name = "test1",
+		},
+		{
+			.start = 49,
+			.size = 1,
+			.name = "test2",
+		},
+	};
+
+	ut_asserteq(2, blk_get_device_by_str("mmc", "2", &mmc_dev_desc));
+	if (CONFIG_IS_ENABLED(RANDOM_UUID)) {
+		gen_rand_uuid_str(parts[0].uuid, UUID_STR_FORMAT_STD);
+		gen_rand_uuid_str(parts[1].uuid, UUID_STR_FORMAT_STD);
+		gen_rand_uuid_str(str_disk_guid, UUID_STR_FORMAT_STD);
+	}
+	ut_assertok(gpt_restore(mmc_dev_desc, str_disk_guid, parts,
+				ARRAY_SIZE(parts)));
+
+	/* Repeated lookups give the same answer */
+	ut_assertok(part_get_info(mmc_dev_desc, 2, &info));
+	ut_asserteq(49, info.start);
+	ut_asserteq_str("test2", (char *)info.name);
+	ut_assertok(part_get_info(mmc_dev_desc, 1, &info));
+	ut_asserteq(48, info.start);
+	ut_asserteq_str("test1", (char *)info.name);
+	ut_assertok(part_get_info(mmc_dev_desc, 2, &info));
+	ut_asserteq(49, info.start);
+
+	/* Rewriting the table must not leave the old one in use */
+	parts[1].start = 50;
+	strcpy((char *)parts[1].name, "other");
+	ut_assertok(gpt_restore(mmc_dev_desc, str_disk_guid, parts,
+				ARRAY_SIZE(parts)));
+	ut_assertok(part_get_info(mmc_dev_desc, 2, &info));
+	ut_asserteq(50, info.start);
+	ut_asserteq_str("other", (char *)info.name);
+
+	/* Nor does the cache hide a missing partition */
+	ut_asserteq(-ENOENT, part_get_info(mmc_dev_desc, 3, &info));
+
+	/* Removing the device drops the table, so it is read again later */
+	ut_assertok(device_remove(mmc_dev_desc->bdev, DM_REMOVE_NORMAL));
+	ut_assertok(device_probe(mmc_dev_desc->bdev));
+	ut_assertok(part_get_info(mmc_dev_desc, 2, &info));
+	ut_asserteq(50, info.start);
+	ut_asserteq_str("other", (char *)info.name);
+
+	return 0;
+}
+DM_TEST(dm_test_part_gpt_cache, UT_TESTF_SCAN_PDATA | UT_TESTF_SCAN_FDT);
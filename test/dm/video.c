@@ -604,3 +604,38 @@ static int dm_test_video_truetype_bs(struct unit_test_state *uts)
 	return 0;
 }
 DM_TEST(dm_test_video_truetype_bs, UT_TESTF_SCAN_PDATA | UT_TESTF_SCAN_FDT);
+
+/*
+ * Test that TrueType glyphs are reused and give the same output. The output
+ * with the cache is the same as without, so the frame-buffer checks in the
+ * tests above also apply to the cache.
+ */
+static int dm_test_video_truetype_glyphs(struct unit_test_state *uts)
+{
+	const char *test_string = "Criticism may not be agreeable, but it is necessary. It fulfils the same function as pain in the human body.";
+	struct video_priv *priv;
+	struct udevice *dev, *con;
+	uint hits;
+	void *fb;
+
+	ut_assertok(video_get_nologo(uts, &dev));
+	ut_assertok(uclass_get_device(UCLASS_VIDEO_CONSOLE, 0, &con));
+	priv = dev_get_uclass_priv(dev);
+	fb = malloc(priv->fb_size);
+	ut_assertnonnull(fb);
+
+	vidconsole_put_string(con, test_string);
+	memcpy(fb, priv->fb, priv->fb_size);
+
+	/* Drawing the same text in the same place uses the cached glyphs */
+	hits = console_truetype_glyph_hits(con);
+	ut_assertok(video_clear(dev));
+	vidconsole_position_cursor(con, 0, 0);
+	vidconsole_put_string(con, test_string);
+	ut_assert(console_truetype_glyph_hits(con) > hits);
+	ut_assertok(memcmp(fb, priv->fb, priv->fb_size));
+	free(fb);
+
+	return 0;
+}
+DM_TEST(dm_test_video_truetype_glyphs, UT_TESTF_SCAN_PDATA | UT_TESTF_SCAN_FDT);
@@ -124,3 +124,94 @@ static int env_test_htab_deletes(struct unit_test_state *uts)
 }
 
 ENV_TEST(env_test_htab_deletes, 0);
+
+/*
+ * Fill the hashtable far beyond its initial size, then check that it grew,
+ * that iteration is in key order and that changes are tracked
+ */
+static int env_test_htab_grow(struct unit_test_state *uts)
+{
+	struct hsearch_data htab;
+	struct env_entry *ritem;
+	char prev[20] = "";
+	int idx, count;
+
+	memset(&htab, 0, sizeof(htab));
+	ut_asserteq(1, hcreate_r(SIZE, &htab));
+	ut_assert(!htab.dirty);
+
+	ut_assertok(htab_fill(uts, &htab, SIZE * 64));
+	ut_assertok(htab_check_fill(uts, &htab, SIZE * 64));
+	ut_asserteq(SIZE * 64, htab.filled);
+	ut_assert(htab.size > SIZE * 64);
+	ut_assert(htab.dirty);
+
+	count = 0;
+	idx = 0;
+	while ((idx = hmatch_r("", idx, &ritem, &htab))) {
+		ut_assert(strcmp(prev, ritem->key) < 0);
+		strcpy(prev, ritem->key);
+		count++;
+	}
+	ut_asserteq(SIZE * 64, count);
+
+	/* "1", "10".."19", "100".."199" and "1000".."1999" */
+	count = 0;
+	idx = 0;
+	while ((idx = hmatch_r("1", idx, &ritem, &htab)))
+		count++;
+	ut_asserteq(1111, count);
+
+	hclean_r(&htab);
+	ut_assertok(hdelete_r("42", &htab, 0));
+	ut_assert(htab.dirty);
+	ut_asserteq(-ENOENT, hdelete_r("42", &htab, 0));
+
+	hdestroy_r(&htab);
+	return 0;
+}
+
+ENV_TEST(env_test_htab_grow, 0);
+
+/* Import without copying entries, then modify them */
+static int env_test_htab_zerocopy(struct unit_test_state *uts)
+{
+	static const char env[] = "a=1\0bb=22\0ccc=333\0";
+	struct hsearch_data htab;
+	struct env_entry item, *ritem;
+	char *buf;
+
+	memset(&htab, 0, sizeof(htab));
+	ut_asserteq(1, himport_r(&htab, env, sizeof(env), '\0', H_ZEROCOPY,
+				 0, 0, NULL));
+	ut_asserteq(3, htab.filled);
+	buf = htab.import_buf;
+	ut_assertnonnull(buf);
+
+	item.callback = NULL;
+	item.flags = 0;
+	item.key = "bb";
+	item.data = NULL;
+	ut_assert(hsearch_r(item, ENV_FIND, &ritem, &htab, 0) > 0);
+	ut_asserteq_str("22", ritem->data);
+	ut_asserteq_ptr(buf + 4, ritem->key);
+	ut_asserteq_ptr(buf + 7, ritem->data);
+
+	/* Overwriting gives the entry its own copy of the data */
+	item.data = "new";
+	ut_assert(hsearch_r(item, ENV_ENTER, &ritem, &htab, 0) > 0);
+	ut_asserteq_str("new", ritem->data);
+	ut_assert(ritem->data < buf || ritem->data > buf + sizeof(env));
+
+	ut_assertok(hdelete_r("a", &htab, 0));
+	item.key = "ccc";
+	item.data = NULL;
+	ut_assert(hsearch_r(item, ENV_FIND, &ritem, &htab, 0) > 0);
+	ut_asserteq_str("333", ritem->data);
+
+	hdestroy_r(&htab);
+	ut_assertnull(htab.import_buf);
+	return 0;
+}
+
+ENV_TEST(env_test_htab_zerocopy, 0);
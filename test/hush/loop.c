@@ -4,6 +4,7 @@
  * Francis Laniel, Amarula Solutions, francis.laniel@amarulasolutions.com
  */
 
+#include <cli_hush.h>
 #include <command.h>
 #include <env_attr.h>
 #include <test/hush.h>
@@ -34,6 +35,83 @@ static int hush_test_for(struct unit_test_state *uts)
 }
 HUSH_TEST(hush_test_for, 0);
 
+/* Running the same script again must expand variables again */
+static int hush_test_for_repeat(struct unit_test_state *uts)
+{
+	char val[2] = "0";
+	ulong hits;
+
+	console_record_reset_enable();
+	hits = hush_parse_cache_hits();
+
+	for (val[0] = '1'; val[0] <= '3'; val[0]++) {
+		ut_assertok(env_set("loop_k", val));
+		ut_assertok(run_command("for loop_j in a b; do echo $loop_j$loop_k; done", 0));
+		ut_assert_nextline("a%s", val);
+		ut_assert_nextline("b%s", val);
+		ut_assert_console_end();
+	}
+	ut_assertok(env_set("loop_k", NULL));
+
+	/* At least the second and third runs come from the parse cache */
+	if (CONFIG_IS_ENABLED(HUSH_PARSE_CACHE) &&
+	    (gd->flags & GD_FLG_HUSH_OLD_PARSER))
+		ut_assert(hush_parse_cache_hits() >= hits + 2);
+
+	if (gd->flags & GD_FLG_HUSH_MODERN_PARSER) {
+		/* Reset local variable. */
+		ut_assertok(run_command("loop_j=", 0));
+	} else if (gd->flags & GD_FLG_HUSH_OLD_PARSER) {
+		puts("Beware: this test set local variable loop_j and it cannot be unset!");
+	}
+
+	return 0;
+}
+HUSH_TEST(hush_test_for_repeat, 0);
+
+/* Print the argument, then change it in place as some commands do */
+static int do_ut_hush_mangle(struct cmd_tbl *cmdtp, int flag, int argc,
+			     char *const argv[])
+{
+	if (argc != 2)
+		return CMD_RET_USAGE;
+	printf("%s\n", argv[1]);
+	memset(argv[1], 'x', strlen(argv[1]));
+
+	return 0;
+}
+
+U_BOOT_CMD(
+	ut_hush_mangle, 2, 0, do_ut_hush_mangle,
+	"Print an argument and overwrite it, for hush tests",
+	"<arg>"
+);
+
+/* A command changing its arguments must not change a cached script */
+static int hush_test_cached_args(struct unit_test_state *uts)
+{
+	ulong hits;
+	int i;
+
+	console_record_reset_enable();
+	hits = hush_parse_cache_hits();
+
+	for (i = 0; i < 3; i++) {
+		ut_assertok(run_command("ut_hush_mangle abc; ut_hush_mangle def",
+					0));
+		ut_assert_nextline("abc");
+		ut_assert_nextline("def");
+	}
+	ut_assert_console_end();
+
+	if (CONFIG_IS_ENABLED(HUSH_PARSE_CACHE) &&
+	    (gd->flags & GD_FLG_HUSH_OLD_PARSER))
+		ut_assert(hush_parse_cache_hits() >= hits + 2);
+
+	return 0;
+}
+HUSH_TEST(hush_test_cached_args, 0);
+
 static int hush_test_while(struct unit_test_state *uts)
 {
 	console_record_reset_enable();
@@ -0,0 +1,132 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Test the UEFI memory map
+ */
+
+#include <common.h>
+#include <efi_loader.h>
+#include <malloc.h>
+#include <test/lib.h>
+#include <test/test.h>
+#include <test/ut.h>
+
+#define NUM_ALLOCS	64
+
+/**
+ * get_map() - read the memory map into a newly allocated buffer
+ *
+ * malloc() is used rather than efi_get_memory_map_alloc() so that reading
+ * the map does not change it.
+ *
+ * @map_size:	returns the size of the map in bytes
+ * Return:	memory map, or NULL on error
+ */
+static struct efi_mem_desc *get_map(efi_uintn_t *map_size)
+{
+	struct efi_mem_desc *map;
+	efi_uintn_t desc_size;
+	u32 desc_version;
+
+	*map_size = 0;
+	if (efi_get_memory_map(map_size, NULL, NULL, &desc_size,
+			       &desc_version) != EFI_BUFFER_TOO_SMALL)
+		return NULL;
+	map = malloc(*map_size);
+	if (!map)
+		return NULL;
+	if (efi_get_memory_map(map_size, map, NULL, &desc_size,
+			       &desc_version) != EFI_SUCCESS) {
+		free(map);
+		return NULL;
+	}
+
+	return map;
+}
+
+/**
+ * check_map() - check that the memory map is sorted and fully merged
+ *
+ * @uts:	test state
+ * Return:	0 if OK, else failure
+ */
+static int check_map(struct unit_test_state *uts)
+{
+	struct efi_mem_desc *map;
+	efi_uintn_t map_size;
+	int i, count;
+
+	map = get_map(&map_size);
+	ut_assertnonnull(map);
+	count = map_size / sizeof(*map);
+
+	for (i = 0; i < count; i++) {
+		ut_assert(map[i].num_pages);
+		ut_asserteq_64(map[i].physical_start, map[i].virtual_start);
+		if (!i)
+			continue;
+
+		/* Ascending and not overlapping */
+		ut_assert(map[i - 1].physical_start +
+			  (map[i - 1].num_pages << EFI_PAGE_SHIFT) <=
+			  map[i].physical_start);
+
+		/* Adjacent entries of the same kind must have been merged */
+		if (map[i - 1].physical_start +
+		    (map[i - 1].num_pages << EFI_PAGE_SHIFT) ==
+		    map[i].physical_start)
+			ut_assert(map[i - 1].type != map[i].type ||
+				  map[i - 1].attribute != map[i].attribute);
+	}
+	free(map);
+
+	return 0;
+}
+
+/* Test that many interleaved allocations keep the map consistent */
+static int lib_test_efi_memory_map(struct unit_test_state *uts)
+{
+	struct efi_mem_desc *before, *after;
+	efi_uintn_t before_size, after_size;
+	u64 addr[NUM_ALLOCS];
+	int i;
+
+	before = get_map(&before_size);
+	ut_assertnonnull(before);
+	ut_assertok(check_map(uts));
+
+	/* Alternate types so that neighbouring allocations cannot merge */
+	for (i = 0; i < NUM_ALLOCS; i++) {
+		ut_asserteq(EFI_SUCCESS,
+			    efi_allocate_pages(EFI_ALLOCATE_ANY_PAGES,
+					       i & 1 ? EFI_LOADER_DATA :
+					       EFI_BOOT_SERVICES_DATA,
+					       1 + i % 3, &addr[i]));
+		ut_assert(addr[i]);
+	}
+	ut_assertok(check_map(uts));
+
+	/* Allocated pages cannot be allocated again at a fixed address */
+	ut_asserteq_64(EFI_NOT_FOUND,
+		       efi_allocate_pages(EFI_ALLOCATE_ADDRESS, EFI_LOADER_DATA,
+					  1, &addr[0]));
+
+	/* Free every other allocation, then the rest, in reverse order */
+	for (i = 0; i < NUM_ALLOCS; i += 2)
+		ut_asserteq(EFI_SUCCESS, efi_free_pages(addr[i], 1 + i % 3));
+	ut_assertok(check_map(uts));
+	ut_asserteq_64(EFI_NOT_FOUND, efi_free_pages(addr[0], 1));
+	for (i = NUM_ALLOCS - 1; i > 0; i -= 2)
+		ut_asserteq(EFI_SUCCESS, efi_free_pages(addr[i], 1 + i % 3));
+	ut_assertok(check_map(uts));
+
+	/* Everything was merged back into the original map */
+	after = get_map(&after_size);
+	ut_assertnonnull(after);
+	ut_asserteq(before_size, after_size);
+	ut_asserteq_mem(before, after, before_size);
+	free(after);
+	free(before);
+
+	return 0;
+}
+LIB_TEST(lib_test_efi_memory_map, 0);
@@ -8,6 +8,7 @@
 #include <lmb.h>
 #include <log.h>
 #include <malloc.h>
+#include <time.h>
 #include <dm/test.h>
 #include <test/lib.h>
 #include <test/test.h>
@@ -27,22 +28,22 @@ static int check_lmb(struct unit_test_state *uts, struct lmb *lmb,
 {
 	if (ram_size) {
 		ut_asserteq(lmb->memory.cnt, 1);
-		ut_asserteq(lmb->memory.region[0].base, ram_base);
-		ut_asserteq(lmb->memory.region[0].size, ram_size);
+		ut_asserteq(lmb_region_get(&lmb->memory, 0)->base, ram_base);
+		ut_asserteq(lmb_region_get(&lmb->memory, 0)->size, ram_size);
 	}
 
 	ut_asserteq(lmb->reserved.cnt, num_reserved);
 	if (num_reserved > 0) {
-		ut_asserteq(lmb->reserved.region[0].base, base1);
-		ut_asserteq(lmb->reserved.region[0].size, size1);
+		ut_asserteq(lmb_region_get(&lmb->reserved, 0)->base, base1);
+		ut_asserteq(lmb_region_get(&lmb->reserved, 0)->size, size1);
 	}
 	if (num_reserved > 1) {
-		ut_asserteq(lmb->reserved.region[1].base, base2);
-		ut_asserteq(lmb->reserved.region[1].size, size2);
+		ut_asserteq(lmb_region_get(&lmb->reserved, 1)->base, base2);
+		ut_asserteq(lmb_region_get(&lmb->reserved, 1)->size, size2);
 	}
 	if (num_reserved > 2) {
-		ut_asserteq(lmb->reserved.region[2].base, base3);
-		ut_asserteq(lmb->reserved.region[2].size, size3);
+		ut_asserteq(lmb_region_get(&lmb->reserved, 2)->base, base3);
+		ut_asserteq(lmb_region_get(&lmb->reserved, 2)->size, size3);
 	}
 	return 0;
 }
@@ -88,14 +89,14 @@ static int test_multi_alloc(struct unit_test_state *uts, const phys_addr_t ram,
 
 	if (ram0_size) {
 		ut_asserteq(lmb.memory.cnt, 2);
-		ut_asserteq(lmb.memory.region[0].base, ram0);
-		ut_asserteq(lmb.memory.region[0].size, ram0_size);
-		ut_asserteq(lmb.memory.region[1].base, ram);
-		ut_asserteq(lmb.memory.region[1].size, ram_size);
+		ut_asserteq(lmb_region_get(&lmb.memory, 0)->base, ram0);
+		ut_asserteq(lmb_region_get(&lmb.memory, 0)->size, ram0_size);
+		ut_asserteq(lmb_region_get(&lmb.memory, 1)->base, ram);
+		ut_asserteq(lmb_region_get(&lmb.memory, 1)->size, ram_size);
 	} else {
 		ut_asserteq(lmb.memory.cnt, 1);
-		ut_asserteq(lmb.memory.region[0].base, ram);
-		ut_asserteq(lmb.memory.region[0].size, ram_size);
+		ut_asserteq(lmb_region_get(&lmb.memory, 0)->base, ram);
+		ut_asserteq(lmb_region_get(&lmb.memory, 0)->size, ram_size);
 	}
 
 	/* reserve 64KiB somewhere */
@@ -166,14 +167,14 @@ static int test_multi_alloc(struct unit_test_state *uts, const phys_addr_t ram,
 
 	if (ram0_size) {
 		ut_asserteq(lmb.memory.cnt, 2);
-		ut_asserteq(lmb.memory.region[0].base, ram0);
-		ut_asserteq(lmb.memory.region[0].size, ram0_size);
-		ut_asserteq(lmb.memory.region[1].base, ram);
-		ut_asserteq(lmb.memory.region[1].size, ram_size);
+		ut_asserteq(lmb_region_get(&lmb.memory, 0)->base, ram0);
+		ut_asserteq(lmb_region_get(&lmb.memory, 0)->size, ram0_size);
+		ut_asserteq(lmb_region_get(&lmb.memory, 1)->base, ram);
+		ut_asserteq(lmb_region_get(&lmb.memory, 1)->size, ram_size);
 	} else {
 		ut_asserteq(lmb.memory.cnt, 1);
-		ut_asserteq(lmb.memory.region[0].base, ram);
-		ut_asserteq(lmb.memory.region[0].size, ram_size);
+		ut_asserteq(lmb_region_get(&lmb.memory, 0)->base, ram);
+		ut_asserteq(lmb_region_get(&lmb.memory, 0)->size, ram_size);
 	}
 
 	return 0;
@@ -668,18 +669,15 @@ static int lib_test_lmb_get_free_size(struct unit_test_state *uts)
 }
 LIB_TEST(lib_test_lmb_get_free_size, 0);
 
-#ifdef CONFIG_LMB_USE_MAX_REGIONS
+/* Check that the number of regions is not limited by the built-in pools */
 static int lib_test_lmb_max_regions(struct unit_test_state *uts)
 {
-	const phys_addr_t ram = 0x00000000;
-	/*
-	 * All of 32bit memory space will contain regions for this test, so
-	 * we need to scale ram_size (which in this case is the size of the lmb
-	 * region) to match.
-	 */
-	const phys_size_t ram_size = ((0xFFFFFFFF >> CONFIG_LMB_MAX_REGIONS)
-			+ 1) * CONFIG_LMB_MAX_REGIONS;
+	const int count = 4 * max(LMB_MEMORY_POOL, LMB_RESERVED_POOL);
+	const phys_addr_t ram = 0x40000000;
 	const phys_size_t blk_size = 0x10000;
+	/* Each memory region has room for all the reserved blocks */
+	const phys_size_t ram_size = 2 * count * blk_size;
+	struct lmb_property *prop;
 	phys_addr_t offset;
 	struct lmb lmb;
 	int ret, i;
@@ -687,56 +685,84 @@ static int lib_test_lmb_max_regions(struct unit_test_state *uts)
 	lmb_init(&lmb);
 
 	ut_asserteq(lmb.memory.cnt, 0);
-	ut_asserteq(lmb.memory.max, CONFIG_LMB_MAX_REGIONS);
 	ut_asserteq(lmb.reserved.cnt, 0);
-	ut_asserteq(lmb.reserved.max, CONFIG_LMB_MAX_REGIONS);
 
-	/*  Add CONFIG_LMB_MAX_REGIONS memory regions */
-	for (i = 0; i < CONFIG_LMB_MAX_REGIONS; i++) {
+	/*  Add separate memory regions, well past the size of the pool */
+	for (i = 0; i < count; i++) {
 		offset = ram + 2 * i * ram_size;
 		ret = lmb_add(&lmb, offset, ram_size);
 		ut_asserteq(ret, 0);
 	}
-	ut_asserteq(lmb.memory.cnt, CONFIG_LMB_MAX_REGIONS);
-	ut_asserteq(lmb.reserved.cnt, 0);
-
-	/*  error for the (CONFIG_LMB_MAX_REGIONS + 1) memory regions */
-	offset = ram + 2 * (CONFIG_LMB_MAX_REGIONS + 1) * ram_size;
-	ret = lmb_add(&lmb, offset, ram_size);
-	ut_asserteq(ret, -1);
-
-	ut_asserteq(lmb.memory.cnt, CONFIG_LMB_MAX_REGIONS);
+	ut_asserteq(lmb.memory.cnt, count);
 	ut_asserteq(lmb.reserved.cnt, 0);
 
-	/*  reserve CONFIG_LMB_MAX_REGIONS regions */
-	for (i = 0; i < CONFIG_LMB_MAX_REGIONS; i++) {
+	/*  reserve separate blocks in the first memory region */
+	for (i = count - 1; i >= 0; i--) {
 		offset = ram + 2 * i * blk_size;
 		ret = lmb_reserve(&lmb, offset, blk_size);
 		ut_asserteq(ret, 0);
 	}
+	ut_asserteq(lmb.memory.cnt, count);
+	ut_asserteq(lmb.reserved.cnt, count);
 
-	ut_asserteq(lmb.memory.cnt, CONFIG_LMB_MAX_REGIONS);
-	ut_asserteq(lmb.reserved.cnt, CONFIG_LMB_MAX_REGIONS);
+	/*  check each regions */
+	i = 0;
+	lmb_for_each_region(prop, &lmb.memory)
+		ut_asserteq(prop->base, ram + 2 * i++ * ram_size);
+	ut_asserteq(i, count);
+
+	i = 0;
+	lmb_for_each_region(prop, &lmb.reserved)
+		ut_asserteq(prop->base, ram + 2 * i++ * blk_size);
+	ut_asserteq(i, count);
+
+	ut_asserteq(1, lmb_is_reserved(&lmb, ram + 2 * (count - 1) * blk_size));
+	ut_asserteq(0, lmb_is_reserved(&lmb, ram + (2 * count - 1) * blk_size));
+
+	/*  filling the gaps coalesces everything into one region */
+	for (i = 0; i < count - 1; i++) {
+		offset = ram + (2 * i + 1) * blk_size;
+		ret = lmb_reserve(&lmb, offset, blk_size);
+		ut_asserteq(ret, 2);
+	}
+	ASSERT_LMB(&lmb, 0, 0, 1, ram, (2 * count - 1) * blk_size,
+		   0, 0, 0, 0);
 
-	/*  error for the 9th reserved blocks */
-	offset = ram + 2 * (CONFIG_LMB_MAX_REGIONS + 1) * blk_size;
-	ret = lmb_reserve(&lmb, offset, blk_size);
-	ut_asserteq(ret, -1);
+	lmb_uninit(&lmb);
 
-	ut_asserteq(lmb.memory.cnt, CONFIG_LMB_MAX_REGIONS);
-	ut_asserteq(lmb.reserved.cnt, CONFIG_LMB_MAX_REGIONS);
+	return 0;
+}
+LIB_TEST(lib_test_lmb_max_regions, 0);
 
-	/*  check each regions */
-	for (i = 0; i < CONFIG_LMB_MAX_REGIONS; i++)
-		ut_asserteq(lmb.memory.region[i].base, ram + 2 * i * ram_size);
+/* Check that setting up an lmb again releases its allocated entries */
+static int lib_test_lmb_reinit(struct unit_test_state *uts)
+{
+	const int count = 2 * LMB_MEMORY_POOL;
+	const phys_addr_t ram = 0x40000000;
+	const phys_size_t blk_size = 0x10000;
+	struct lmb lmb;
+	ulong start;
+	int i;
+
+	start = ut_check_free();
+	lmb_init(&lmb);
+	for (i = 0; i < count; i++)
+		ut_assertok(lmb_add(&lmb, ram + 2 * i * blk_size, blk_size));
+	ut_asserteq(count, lmb.memory.cnt);
+
+	/* No lmb_uninit(), as when bootm sets up images->lmb again */
+	lmb_init(&lmb);
+	ut_asserteq(0, lmb.memory.cnt);
+	for (i = 0; i < count; i++)
+		ut_assertok(lmb_add(&lmb, ram + 2 * i * blk_size, blk_size));
+	ut_asserteq(count, lmb.memory.cnt);
 
-	for (i = 0; i < CONFIG_LMB_MAX_REGIONS; i++)
-		ut_asserteq(lmb.reserved.region[i].base, ram + 2 * i * blk_size);
+	lmb_uninit(&lmb);
+	ut_assertok(ut_check_delta(start));
 
 	return 0;
 }
-LIB_TEST(lib_test_lmb_max_regions, 0);
-#endif
+LIB_TEST(lib_test_lmb_reinit, 0);
 
 static int lib_test_lmb_flags(struct unit_test_state *uts)
 {
@@ -768,7 +794,7 @@ static int lib_test_lmb_flags(struct unit_test_state *uts)
 	ASSERT_LMB(&lmb, ram, ram_size, 1, 0x40010000, 0x10000,
 		   0, 0, 0, 0);
 
-	ut_asserteq(lmb_is_nomap(&lmb.reserved.region[0]), 1);
+	ut_asserteq(lmb_is_nomap(lmb_region_get(&lmb.reserved, 0)), 1);
 
 	/* merge after */
 	ret = lmb_reserve_flags(&lmb, 0x40020000, 0x10000, LMB_NOMAP);
@@ -782,15 +808,15 @@ static int lib_test_lmb_flags(struct unit_test_state *uts)
 	ASSERT_LMB(&lmb, ram, ram_size, 1, 0x40000000, 0x30000,
 		   0, 0, 0, 0);
 
-	ut_asserteq(lmb_is_nomap(&lmb.reserved.region[0]), 1);
+	ut_asserteq(lmb_is_nomap(lmb_region_get(&lmb.reserved, 0)), 1);
 
 	ret = lmb_reserve_flags(&lmb, 0x40030000, 0x10000, LMB_NONE);
 	ut_asserteq(ret, 0);
 	ASSERT_LMB(&lmb, ram, ram_size, 2, 0x40000000, 0x30000,
 		   0x40030000, 0x10000, 0, 0);
 
-	ut_asserteq(lmb_is_nomap(&lmb.reserved.region[0]), 1);
-	ut_asserteq(lmb_is_nomap(&lmb.reserved.region[1]), 0);
+	ut_asserteq(lmb_is_nomap(lmb_region_get(&lmb.reserved, 0)), 1);
+	ut_asserteq(lmb_is_nomap(lmb_region_get(&lmb.reserved, 1)), 0);
 
 	/* test that old API use LMB_NONE */
 	ret = lmb_reserve(&lmb, 0x40040000, 0x10000);
@@ -798,8 +824,8 @@ static int lib_test_lmb_flags(struct unit_test_state *uts)
 	ASSERT_LMB(&lmb, ram, ram_size, 2, 0x40000000, 0x30000,
 		   0x40030000, 0x20000, 0, 0);
 
-	ut_asserteq(lmb_is_nomap(&lmb.reserved.region[0]), 1);
-	ut_asserteq(lmb_is_nomap(&lmb.reserved.region[1]), 0);
+	ut_asserteq(lmb_is_nomap(lmb_region_get(&lmb.reserved, 0)), 1);
+	ut_asserteq(lmb_is_nomap(lmb_region_get(&lmb.reserved, 1)), 0);
 
 	ret = lmb_reserve_flags(&lmb, 0x40070000, 0x10000, LMB_NOMAP);
 	ut_asserteq(ret, 0);
@@ -817,10 +843,207 @@ static int lib_test_lmb_flags(struct unit_test_state *uts)
 	ASSERT_LMB(&lmb, ram, ram_size, 3, 0x40000000, 0x30000,
 		   0x40030000, 0x20000, 0x40050000, 0x30000);
 
-	ut_asserteq(lmb_is_nomap(&lmb.reserved.region[0]), 1);
-	ut_asserteq(lmb_is_nomap(&lmb.reserved.region[1]), 0);
-	ut_asserteq(lmb_is_nomap(&lmb.reserved.region[2]), 1);
+	ut_asserteq(lmb_is_nomap(lmb_region_get(&lmb.reserved, 0)), 1);
+	ut_asserteq(lmb_is_nomap(lmb_region_get(&lmb.reserved, 1)), 0);
+	ut_asserteq(lmb_is_nomap(lmb_region_get(&lmb.reserved, 2)), 1);
 
 	return 0;
 }
 LIB_TEST(lib_test_lmb_flags, 0);
+
+static int lib_test_lmb_get_reserved(struct unit_test_state *uts)
+{
+	const phys_addr_t ram = 0x40000000;
+	const phys_size_t ram_size = 0x20000000;
+	struct lmb_property *res;
+	struct lmb lmb;
+
+	lmb_init(&lmb);
+	ut_asserteq(0, lmb_add(&lmb, ram, ram_size));
+	ut_asserteq(0, lmb_reserve(&lmb, 0x40010000, 0x10000));
+	ut_asserteq(0, lmb_reserve_flags(&lmb, 0x40030000, 0x10000,
+					 LMB_NOMAP));
+
+	ut_assertnull(lmb_get_reserved(&lmb, 0x4000ffff));
+	res = lmb_get_reserved(&lmb, 0x40010000);
+	ut_assertnonnull(res);
+	ut_asserteq(0x40010000, res->base);
+	ut_asserteq(0x10000, res->size);
+	ut_asserteq_ptr(res, lmb_get_reserved(&lmb, 0x4001ffff));
+	ut_assertnull(lmb_get_reserved(&lmb, 0x40020000));
+
+	res = lmb_get_reserved(&lmb, 0x40038000);
+	ut_assertnonnull(res);
+	ut_asserteq(0x40030000, res->base);
+	ut_asserteq(LMB_NOMAP, res->flags);
+
+	return 0;
+}
+LIB_TEST(lib_test_lmb_get_reserved, 0);
+
+/* Number of blocks in the region used by the stress test */
+#define STRESS_BLOCKS	512
+#define STRESS_BLK	0x1000
+#define STRESS_OPS	20000
+
+static uint lmb_test_rand(uint *seed)
+{
+	*seed = *seed * 1103515245 + 12345;
+
+	return *seed >> 16;
+}
+
+/* Check that the reserved regions match @map, one byte per block */
+static int check_stress_map(struct unit_test_state *uts, struct lmb *lmb,
+			    phys_addr_t ram, const u8 *map)
+{
+	struct lmb_property *prop;
+	phys_addr_t last_end = 0;
+	unsigned long cnt = 0;
+	phys_addr_t addr;
+	int blk, i;
+
+	lmb_for_each_region(prop, &lmb->reserved) {
+		/* Sorted, not overlapping and not left uncoalesced */
+		if (cnt)
+			ut_assert(prop->base > last_end + 1);
+		last_end = prop->base + prop->size - 1;
+		cnt++;
+
+		blk = (prop->base - ram) / STRESS_BLK;
+		for (i = 0; i < prop->size / STRESS_BLK; i++)
+			ut_asserteq(1, map[blk + i]);
+	}
+	ut_asserteq(cnt, lmb->reserved.cnt);
+
+	for (blk = 0; blk < STRESS_BLOCKS; blk++) {
+		addr = ram + blk * STRESS_BLK;
+		ut_asserteq(map[blk], lmb_is_reserved(lmb, addr));
+	}
+
+	return 0;
+}
+
+/* Return the highest block at which @len free blocks start, or -1 */
+static int stress_find_free(const u8 *map, int len)
+{
+	int blk, i;
+
+	for (blk = STRESS_BLOCKS - len; blk >= 0; blk--) {
+		for (i = 0; i < len && !map[blk + i]; i++)
+			;
+		if (i == len)
+			return blk;
+	}
+
+	return -1;
+}
+
+/*
+ * Apply random reservations, allocations and frees, and check the regions
+ * against a simple map of the blocks after each one
+ */
+static int lib_test_lmb_stress(struct unit_test_state *uts)
+{
+	const phys_addr_t ram = 0x40000000;
+	const phys_addr_t top = ram + STRESS_BLOCKS * STRESS_BLK;
+	u8 map[STRESS_BLOCKS];
+	phys_addr_t addr;
+	uint seed = 1;
+	struct lmb lmb;
+	int op, blk, len, i;
+	long ret;
+
+	memset(map, '\0', sizeof(map));
+	lmb_init(&lmb);
+	ut_assertok(lmb_add(&lmb, ram, STRESS_BLOCKS * STRESS_BLK));
+
+	for (op = 0; op < STRESS_OPS; op++) {
+		blk = lmb_test_rand(&seed) % STRESS_BLOCKS;
+		len = 1 + lmb_test_rand(&seed) % 8;
+		if (blk + len > STRESS_BLOCKS)
+			len = STRESS_BLOCKS - blk;
+		for (i = 0; i < len && map[blk + i] == map[blk]; i++)
+			;
+		addr = ram + blk * STRESS_BLK;
+
+		switch (lmb_test_rand(&seed) % 3) {
+		case 0:
+			/* Reserve a free range */
+			if (i < len || map[blk])
+				continue;
+			ret = lmb_reserve(&lmb, addr, len * STRESS_BLK);
+			ut_assert(ret >= 0);
+			memset(map + blk, 1, len);
+			break;
+		case 1:
+			/* Free a reserved range, always within one region */
+			if (i < len || !map[blk])
+				continue;
+			ret = lmb_free(&lmb, addr, len * STRESS_BLK);
+			ut_asserteq(0, ret);
+			memset(map + blk, 0, len);
+			break;
+		case 2:
+			/* Allocate from the top */
+			blk = stress_find_free(map, len);
+			addr = __lmb_alloc_base(&lmb, len * STRESS_BLK,
+						STRESS_BLK, top);
+			if (blk < 0) {
+				ut_asserteq(0, addr);
+				continue;
+			}
+			ut_asserteq(ram + blk * STRESS_BLK, addr);
+			memset(map + blk, 1, len);
+			break;
+		}
+		ut_assertok(check_stress_map(uts, &lmb, ram, map));
+	}
+	lmb_uninit(&lmb);
+
+	return 0;
+}
+LIB_TEST(lib_test_lmb_stress, 0);
+
+/* Number of separate reservations made by the benchmark */
+#define BENCH_REGIONS	2000
+
+/* Time reserving many separate regions and allocating among them */
+static int lib_test_lmb_bench(struct unit_test_state *uts)
+{
+	const phys_addr_t ram = 0x40000000;
+	const phys_size_t blk_size = 0x1000;
+	ulong reserve, alloc, lookup;
+	struct lmb lmb;
+	int i;
+
+	lmb_init(&lmb);
+	ut_assertok(lmb_add(&lmb, ram, 4 * BENCH_REGIONS * blk_size));
+
+	/* Leave a two-block gap after every reservation */
+	reserve = timer_get_us();
+	for (i = 0; i < BENCH_REGIONS; i++)
+		ut_asserteq(0, lmb_reserve(&lmb, ram + 4 * i * blk_size,
+					   2 * blk_size));
+	reserve = timer_get_us() - reserve;
+	ut_asserteq(BENCH_REGIONS, lmb.reserved.cnt);
+
+	lookup = timer_get_us();
+	for (i = 0; i < BENCH_REGIONS; i++)
+		ut_asserteq(1, lmb_is_reserved(&lmb, ram + 4 * i * blk_size));
+	lookup = timer_get_us() - lookup;
+
+	/* Each allocation fills the highest remaining gap */
+	alloc = timer_get_us();
+	for (i = 0; i < BENCH_REGIONS; i++)
+		ut_assert(lmb_alloc(&lmb, 2 * blk_size, blk_size));
+	alloc = timer_get_us() - alloc;
+	ut_asserteq(1, lmb.reserved.cnt);
+
+	printf("%d regions: reserve %lu us, lookup %lu us, alloc %lu us\n",
+	       BENCH_REGIONS, reserve, lookup, alloc);
+	lmb_uninit(&lmb);
+
+	return 0;
+}
+LIB_TEST(lib_test_lmb_bench, 0);
@@ -0,0 +1,89 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Test the sampling profiler
+ */
+
+#include <common.h>
+#include <malloc.h>
+#include <profile.h>
+#include <trace.h>
+#include <asm/sections.h>
+#include <test/lib.h>
+#include <test/test.h>
+#include <test/ut.h>
+
+/* Long enough that no real tick arrives while the test runs */
+#define TEST_PERIOD_US	10000000
+
+static int lib_test_profile(struct unit_test_state *uts)
+{
+	ulong leaf = (ulong)profile_sample + 4;
+	ulong caller = (ulong)profile_start + 8;
+	ulong outer = (ulong)profile_stop + 12;
+	struct trace_output_hdr *hdr;
+	struct profile_stats stats;
+	size_t needed, size;
+	ulong frames[4];
+	u32 *rec;
+	void *buf;
+
+	/* Two frame records, the second ending the chain */
+	frames[0] = (ulong)&frames[2];
+	frames[1] = caller;
+	frames[2] = 0;
+	frames[3] = outer;
+
+	profile_reset();
+	ut_assertok(profile_start(TEST_PERIOD_US));
+	ut_asserteq(-EALREADY, profile_start(TEST_PERIOD_US));
+	profile_sample(leaf, (ulong)frames, (ulong)(frames + 4));
+
+	/* Nothing in U-Boot, so this counts as unknown */
+	profile_sample(0, 0, 0);
+	profile_stop();
+
+	/* Samples are ignored when stopped */
+	profile_sample(leaf, 0, 0);
+
+	profile_get_stats(&stats);
+	ut_asserteq(false, stats.running);
+	ut_asserteq(TEST_PERIOD_US, stats.period_us);
+	ut_asserteq(2, stats.samples);
+	ut_asserteq(1, stats.recorded);
+	ut_asserteq(0, stats.dropped);
+	ut_asserteq(1, stats.unknown);
+	ut_asserteq(4 * sizeof(u32), stats.used);
+
+	/* Too small */
+	ut_asserteq(-ENOSPC, profile_list_samples(NULL, 0, &needed));
+	ut_asserteq(sizeof(*hdr) + 4 * sizeof(u32), needed);
+
+	size = needed;
+	buf = malloc(size);
+	ut_assertnonnull(buf);
+	ut_assertok(profile_list_samples(buf, size, &needed));
+	ut_asserteq(size, needed);
+
+	hdr = buf;
+	ut_asserteq(TRACE_CHUNK_SAMPLES, hdr->type);
+	ut_asserteq(TRACE_VERSION, hdr->version);
+	ut_asserteq(1, hdr->rec_count);
+	ut_asserteq(TEST_PERIOD_US, hdr->spare);
+
+	/* Leaf first, then each caller */
+	rec = (u32 *)(hdr + 1);
+	ut_asserteq(3, rec[0]);
+	ut_asserteq(leaf - (ulong)_init, rec[1]);
+	ut_asserteq(caller - (ulong)_init, rec[2]);
+	ut_asserteq(outer - (ulong)_init, rec[3]);
+	free(buf);
+
+	profile_reset();
+	profile_get_stats(&stats);
+	ut_asserteq(0, stats.samples);
+	ut_asserteq(0, stats.recorded);
+	ut_asserteq(0, stats.used);
+
+	return 0;
+}
+LIB_TEST(lib_test_profile, 0);
@@ -0,0 +1,132 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Test the log ring, which formats records only when they are read
+ */
+
+#include <common.h>
+#include <command.h>
+#include <console.h>
+#include <log.h>
+#include <malloc.h>
+#include <asm/global_data.h>
+#include <test/log.h>
+#include <test/ut.h>
+
+DECLARE_GLOBAL_DATA_PTR;
+
+/* Test that records are formatted correctly when read */
+static int log_test_ring(struct unit_test_state *uts)
+{
+	int log_fmt = gd->log_fmt;
+	char buf[80], str[8];
+
+	log_ring_reset();
+	gd->log_fmt = BIT(LOGF_MSG);
+	strcpy(str, "abc");
+	log_info("%d %5lx %-4s|%.*s|%c %zu 100%%\n", -12, 0xabcL, str, 2,
+		 "xyz", 'q', (size_t)7);
+
+	/* Strings are copied when the record is stored */
+	strcpy(str, "def");
+	ut_asserteq(27, log_ring_dump(buf, sizeof(buf)));
+	ut_asserteq_str("-12   abc abc |xy|q 7 100%\n", buf);
+	ut_asserteq(-ENOSPC, log_ring_dump(buf, 10));
+
+	/* The current log format is used */
+	gd->log_fmt = BIT(LOGF_LEVEL) | BIT(LOGF_MSG);
+	ut_assertok(console_record_reset_enable());
+	ut_assertok(run_command("log dump", 0));
+	gd->log_fmt = log_fmt;
+	ut_assert_nextline("INFO. -12   abc abc |xy|q 7 100%%");
+	ut_assert_console_end();
+
+	return 0;
+}
+LOG_TEST_FLAGS(log_test_ring, UT_TESTF_CONSOLE_REC);
+
+/* Test that the oldest records are dropped when the ring is full */
+static int log_test_ring_wrap(struct unit_test_state *uts)
+{
+	int log_fmt = gd->log_fmt;
+	int filt, len, i;
+	char last[20];
+	char *buf;
+
+	buf = malloc(CONFIG_LOG_RING_SIZE);
+	ut_assertnonnull(buf);
+
+	/* Keep the console quiet, as it would be with debug records */
+	filt = log_add_filter_flags("console", NULL, LOGL_MAX, NULL,
+				    LOGFF_DENY);
+	ut_assert(filt >= 0);
+	log_ring_reset();
+	gd->log_fmt = BIT(LOGF_MSG);
+	for (i = 0; i < CONFIG_LOG_RING_SIZE / 16; i++)
+		log_info("rec %d\n", i);
+	ut_assertok(log_remove_filter("console", filt));
+
+	len = log_ring_dump(buf, CONFIG_LOG_RING_SIZE);
+	gd->log_fmt = log_fmt;
+	ut_assert(len > 0);
+	ut_assert(strncmp("rec 0\n", buf, 6));
+	snprintf(last, sizeof(last), "rec %d\n", i - 1);
+	ut_asserteq_str(last, buf + len - strlen(last));
+	free(buf);
+
+	return 0;
+}
+LOG_TEST_FLAGS(log_test_ring_wrap, UT_TESTF_CONSOLE_REC);
+
+/* Test records whose names and message end are only known when logged */
+static int log_test_ring_names(struct unit_test_state *uts)
+{
+	int log_fmt = gd->log_fmt;
+	char file[20], buf[80];
+	int filt;
+
+	/* Without the console the ring driver is the only one to see it */
+	filt = log_add_filter_flags("console", NULL, LOGL_MAX, NULL,
+				    LOGFF_DENY);
+	ut_assert(filt >= 0);
+	log_ring_reset();
+	gd->log_fmt = BIT(LOGF_FILE) | BIT(LOGF_MSG);
+
+	/* The newline comes from an argument, so the message ends here */
+	strcpy(file, "file.c");
+	ut_assertok(_log(LOGC_NONE, LOGL_INFO, file, 12, __func__, "%s",
+			 "abc\n"));
+	ut_assert(!gd->log_cont);
+
+	/* The file name is copied into the record */
+	strcpy(file, "other.c");
+	ut_asserteq(12, log_ring_dump(buf, sizeof(buf)));
+	ut_asserteq_str("file.c: abc\n", buf);
+
+	/* Nothing is shown if the format has nothing to show */
+	gd->log_fmt = 0;
+	ut_asserteq(0, log_ring_dump(buf, sizeof(buf)));
+	ut_asserteq_str("", buf);
+
+	ut_assertok(_log(LOGC_NONE, LOGL_INFO, file, 12, __func__, "%s",
+			 "abc"));
+	ut_assert(gd->log_cont);
+
+	/* The end is found without formatting the message */
+	ut_assertok(_log(LOGC_NONE, LOGL_INFO, file, 12, __func__, "%c", '\n'));
+	ut_assert(!gd->log_cont);
+	ut_assertok(_log(LOGC_NONE, LOGL_INFO, file, 12, __func__, "%d", 3));
+	ut_assert(gd->log_cont);
+	ut_assertok(_log(LOGC_NONE, LOGL_INFO, file, 12, __func__, "%s.", "x"));
+	ut_assert(gd->log_cont);
+
+	/* With several arguments, a trailing string is taken to end the line */
+	ut_assertok(_log(LOGC_NONE, LOGL_INFO, file, 12, __func__, "%d %s", 3,
+			 "x"));
+	ut_assert(!gd->log_cont);
+	gd->log_cont = false;
+	gd->log_fmt = log_fmt;
+	ut_assertok(log_remove_filter("console", filt));
+
+	return 0;
+}
+LOG_TEST_FLAGS(log_test_ring_names, UT_TESTF_CONSOLE_REC);
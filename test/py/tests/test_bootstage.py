@@ -30,6 +30,23 @@ def test_bootstage_report(u_boot_console):
     assert 'Accumulated time:' in output
     assert 'dm_r' in output
 
+@pytest.mark.buildconfigspec('bootstage')
+@pytest.mark.buildconfigspec('cmd_bootstage')
+@pytest.mark.buildconfigspec('bootstage_timing')
+def test_bootstage_report_top(u_boot_console):
+    output = u_boot_console.run_command('bootstage report --top 5')
+    assert 'initcalls and probes, in microseconds' in output
+    lines = output.splitlines()
+    assert 'Self' in lines[1] and 'Parent' in lines[1]
+    assert len(lines) >= 3
+
+    # The first column is sorted by decreasing self time
+    times = [int(line.split()[0].replace(',', '')) for line in lines[2:7]]
+    assert times == sorted(times, reverse=True)
+
+    output = u_boot_console.run_command('bootstage report --top 1000')
+    assert 'initcall' in output
+
 @pytest.mark.buildconfigspec('bootstage')
 @pytest.mark.buildconfigspec('cmd_bootstage')
 @pytest.mark.buildconfigspec('bootstage_stash')
@@ -2,6 +2,7 @@
 # Copyright (C) 2022 Huang Jianan <jnhuang95@gmail.com>
 # Author: Huang Jianan <jnhuang95@gmail.com>
 
+import hashlib
 import os
 import pytest
 import shutil
@@ -19,7 +20,17 @@ def generate_file(name, size):
     file.write(content)
     file.close()
 
-def make_erofs_image(build_dir):
+def generate_text_file(name, size):
+    """
+    Generates a file of numbered lines, so that any part of it can be told
+    from any other.
+    """
+    content = ''.join('line {:06d}\n'.format(i) for i in range(size // 12 + 1))
+    file = open(name, 'w')
+    file.write(content[:size])
+    file.close()
+
+def make_erofs_image(build_dir, compressor='lz4'):
     """
     Makes the EROFS images used for the test.
 
@@ -27,6 +38,7 @@ def make_erofs_image(build_dir):
     erofs_src_dir/
     ├── f4096
     ├── f7812
+    ├── lines
     ├── subdir/
     │   └── subdir-file
     ├── symdir -> subdir
@@ -41,6 +53,9 @@ def make_erofs_image(build_dir):
     # 7812: Compressed file
     generate_file(os.path.join(root, 'f7812'), 7812)
 
+    # 65536: Compressed file spanning several clusters
+    generate_text_file(os.path.join(root, 'lines'), 65536)
+
     # sub-directory with a single file inside
     subdir_path = os.path.join(root, 'subdir')
     os.makedirs(subdir_path)
@@ -53,8 +68,8 @@ def make_erofs_image(build_dir):
     input_path = os.path.join(build_dir, EROFS_SRC_DIR)
     output_path = os.path.join(build_dir, EROFS_IMAGE_NAME)
     args = ' '.join([output_path, input_path])
-    subprocess.run(['mkfs.erofs -zlz4 ' + args], shell=True, check=True,
-                   stdout=subprocess.DEVNULL)
+    cmd = 'mkfs.erofs -z{} {}'.format(compressor, args)
+    subprocess.run([cmd], shell=True, check=True, stdout=subprocess.DEVNULL)
 
 def clean_erofs_image(build_dir):
     """
@@ -73,8 +88,9 @@ def erofs_ls_at_root(u_boot_console):
     slash = u_boot_console.run_command('erofsls host 0 /')
     assert no_slash == slash
 
-    expected_lines = ['./', '../', '4096   f4096', '7812   f7812', 'subdir/',
-                      '<SYM>   symdir', '<SYM>   symfile', '4 file(s), 3 dir(s)']
+    expected_lines = ['./', '../', '4096   f4096', '7812   f7812', '65536   lines',
+                      'subdir/', '<SYM>   symdir', '<SYM>   symfile',
+                      '5 file(s), 3 dir(s)']
 
     output = u_boot_console.run_command('erofsls host 0')
     for line in expected_lines:
@@ -161,6 +177,29 @@ def erofs_load_files_at_symlink(u_boot_console):
     address = '$kernel_addr_r'
     erofs_load_files(u_boot_console, files, sizes, address)
 
+def erofs_load_partial(u_boot_console):
+    """
+    Test loading parts of a compressed file, including parts which start and
+    end inside a cluster. Each part is loaded twice, so the second load is
+    served from the decompressed clusters kept by the first.
+    """
+    build_dir = u_boot_console.config.build_dir
+    path = os.path.join(build_dir, EROFS_SRC_DIR, 'lines')
+    with open(path, 'rb') as file:
+        content = file.read()
+
+    address = '$kernel_addr_r'
+    parts = [(0, 100), (5000, 3000), (4090, 20), (4096, 8192), (60000, 5536)]
+    for (pos, size) in parts:
+        expected = hashlib.md5(content[pos:pos + size]).hexdigest()
+        for _ in range(2):
+            cmd = 'erofsload host 0 {} lines {:x} {:x}'.format(address, size, pos)
+            out = u_boot_console.run_command(cmd)
+            assert '{} bytes read'.format(size) in out
+
+            out = u_boot_console.run_command('md5sum {} {:x}'.format(address, size))
+            assert out.split()[-1] == expected
+
 def erofs_load_non_existent_file(u_boot_console):
     """
     Test if the EROFS support will crash when load a nonexistent file.
@@ -181,18 +220,12 @@ def erofs_run_all_tests(u_boot_console):
     erofs_load_files_at_root(u_boot_console)
     erofs_load_files_at_subdir(u_boot_console)
     erofs_load_files_at_symlink(u_boot_console)
+    erofs_load_partial(u_boot_console)
     erofs_load_non_existent_file(u_boot_console)
 
-@pytest.mark.boardspec('sandbox')
-@pytest.mark.buildconfigspec('cmd_fs_generic')
-@pytest.mark.buildconfigspec('cmd_erofs')
-@pytest.mark.buildconfigspec('fs_erofs')
-@pytest.mark.requiredtool('mkfs.erofs')
-@pytest.mark.requiredtool('md5sum')
-
-def test_erofs(u_boot_console):
+def erofs_test_image(u_boot_console, compressor):
     """
-    Executes the erofs test suite.
+    Makes an image using the given compressor and runs all test cases on it.
     """
     build_dir = u_boot_console.config.build_dir
 
@@ -207,7 +240,7 @@ def test_erofs(u_boot_console):
 
     try:
         # setup test environment
-        make_erofs_image(build_dir)
+        make_erofs_image(build_dir, compressor)
         image_path = os.path.join(build_dir, EROFS_IMAGE_NAME)
         u_boot_console.run_command('host bind 0 {}'.format(image_path))
         # run all tests
@@ -218,3 +251,29 @@ def test_erofs(u_boot_console):
 
     # clean test environment
     clean_erofs_image(build_dir)
+
+@pytest.mark.boardspec('sandbox')
+@pytest.mark.buildconfigspec('cmd_fs_generic')
+@pytest.mark.buildconfigspec('cmd_erofs')
+@pytest.mark.buildconfigspec('fs_erofs')
+@pytest.mark.requiredtool('mkfs.erofs')
+@pytest.mark.requiredtool('md5sum')
+
+def test_erofs(u_boot_console):
+    """
+    Executes the erofs test suite.
+    """
+    erofs_test_image(u_boot_console, 'lz4')
+
+@pytest.mark.boardspec('sandbox')
+@pytest.mark.buildconfigspec('cmd_fs_generic')
+@pytest.mark.buildconfigspec('cmd_erofs')
+@pytest.mark.buildconfigspec('fs_erofs_zip_zstd')
+@pytest.mark.requiredtool('mkfs.erofs')
+@pytest.mark.requiredtool('md5sum')
+
+def test_erofs_zstd(u_boot_console):
+    """
+    Executes the erofs test suite on a Zstandard compressed image.
+    """
+    erofs_test_image(u_boot_console, 'zstd')
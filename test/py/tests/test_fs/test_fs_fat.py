@@ -10,6 +10,79 @@ This test verifies fat specific file system behaviour.
 
 import pytest
 import re
+import struct
+from subprocess import call, check_call
+from tests import fs_helper
+
+def read_boot_sector(fs_img):
+    """Read the layout of a FAT filesystem from its boot sector
+
+    Args:
+        fs_img (str): Filename of the filesystem image
+
+    Returns:
+        dict: bytes per sector, sectors per cluster, reserved sectors, number
+        of FATs, root-directory entries, sectors per FAT and FSInfo sector
+    """
+    with open(fs_img, 'rb') as fd:
+        bs = fd.read(512)
+    fat_sects = struct.unpack_from('<H', bs, 22)[0]
+    if not fat_sects:
+        fat_sects = struct.unpack_from('<I', bs, 36)[0]
+    return {
+        'sect_size': struct.unpack_from('<H', bs, 11)[0],
+        'clust_sects': bs[13],
+        'reserved': struct.unpack_from('<H', bs, 14)[0],
+        'fats': bs[16],
+        'root_entries': struct.unpack_from('<H', bs, 17)[0],
+        'fat_sects': fat_sects,
+        'fsinfo': struct.unpack_from('<H', bs, 48)[0],
+    }
+
+def fat16_clusters(fs_img, name):
+    """Get the clusters of a file in the root directory of a FAT16 image
+
+    Args:
+        fs_img (str): Filename of the filesystem image
+        name (str): Short name of the file, padded to 11 characters
+
+    Returns:
+        list of int: Clusters used by the file, in order
+    """
+    bs = read_boot_sector(fs_img)
+    fat_start = bs['reserved'] * bs['sect_size']
+    root_start = fat_start + bs['fats'] * bs['fat_sects'] * bs['sect_size']
+    with open(fs_img, 'rb') as fd:
+        fd.seek(fat_start)
+        fat = fd.read(bs['fat_sects'] * bs['sect_size'])
+        fd.seek(root_start)
+        root = fd.read(bs['root_entries'] * 32)
+    for ofs in range(0, len(root), 32):
+        if root[ofs:ofs + 11] == name.encode():
+            break
+    else:
+        return []
+    clust = struct.unpack_from('<H', root, ofs + 26)[0]
+    clusters = []
+    while 2 <= clust < 0xfff8:
+        clusters.append(clust)
+        clust = struct.unpack_from('<H', fat, clust * 2)[0]
+    return clusters
+
+def fat32_free_count(fs_img):
+    """Get the free-cluster count from the FSInfo sector of a FAT32 image
+
+    Args:
+        fs_img (str): Filename of the filesystem image
+
+    Returns:
+        int: Number of free clusters recorded in FSInfo
+    """
+    bs = read_boot_sector(fs_img)
+    with open(fs_img, 'rb') as fd:
+        fd.seek(bs['fsinfo'] * bs['sect_size'])
+        fsinfo = fd.read(512)
+    return struct.unpack_from('<I', fsinfo, 488)[0]
 
 @pytest.mark.boardspec('sandbox')
 @pytest.mark.slow
@@ -23,3 +96,144 @@ class TestFsFat(object):
                 'host bind 0 %s' % fs_img,
                 'fatinfo host 0:0'])
             assert(re.search('Filesystem: %s' % fs_type.upper(), ''.join(output)))
+
+    @pytest.mark.buildconfigspec('fat_write')
+    def test_fs_fat_enospc(self, u_boot_console, u_boot_config):
+        """Test that a write which does not fit leaves the filesystem intact"""
+        fs_img = fs_helper.mk_fs(u_boot_config, 'fat16', 0x1000000, 'enospc')
+        try:
+            with u_boot_console.log.section('Test Case 2 - ENOSPC'):
+                output = u_boot_console.run_command_list([
+                    'host bind 0 %s' % fs_img,
+                    'fatwrite host 0:0 1000000 small 1000',
+                    'fatwrite host 0:0 1000000 big 1000000',
+                    'fatls host 0:0',
+                    'host unbind 0'])
+                assert 'Error: no space left' in output[2]
+                assert 'small' in output[3]
+                assert 'big' not in output[3]
+
+                # No clusters are lost and the FAT copies agree
+                check_call('fsck.vfat -n %s' % fs_img, shell=True)
+        finally:
+            call('rm -f %s' % fs_img, shell=True)
+
+    @pytest.mark.buildconfigspec('fat_write')
+    def test_fs_fat_contig(self, u_boot_console, u_boot_config):
+        """Test that a new file goes in a free run which can hold it"""
+        fs_img = fs_helper.mk_fs(u_boot_config, 'fat16', 0x1000000, 'contig')
+        try:
+            bs = read_boot_sector(fs_img)
+            clust_size = bs['clust_sects'] * bs['sect_size']
+            with u_boot_console.log.section('Test Case 3 - contiguous'):
+                # Leave a one-cluster hole between two files
+                u_boot_console.run_command_list([
+                    'host bind 0 %s' % fs_img,
+                    'fatwrite host 0:0 1000000 a %x' % clust_size,
+                    'fatwrite host 0:0 1000000 b %x' % clust_size,
+                    'fatwrite host 0:0 1000000 c %x' % clust_size,
+                    'fatrm host 0:0 b',
+                    'fatwrite host 0:0 1000000 big %x' % (clust_size * 8),
+                    'fatwrite host 0:0 1000000 d %x' % clust_size,
+                    'host unbind 0'])
+
+                # The large file skips the hole and the small one fills it
+                big = fat16_clusters(fs_img, 'BIG        ')
+                assert len(big) == 8
+                assert big == list(range(big[0], big[0] + 8))
+                assert fat16_clusters(fs_img, 'D          ') == \
+                    [fat16_clusters(fs_img, 'A          ')[0] + 1]
+        finally:
+            call('rm -f %s' % fs_img, shell=True)
+
+    @pytest.mark.buildconfigspec('fat_write')
+    def test_fs_fat_fsinfo(self, u_boot_console, u_boot_config):
+        """Test that the FAT32 free-cluster count is kept up to date"""
+        fs_img = fs_helper.mk_fs(u_boot_config, 'fat32', 0x4000000, 'fsinfo')
+        try:
+            bs = read_boot_sector(fs_img)
+            clust_size = bs['clust_sects'] * bs['sect_size']
+            free = fat32_free_count(fs_img)
+            with u_boot_console.log.section('Test Case 4 - FSInfo'):
+                u_boot_console.run_command_list([
+                    'host bind 0 %s' % fs_img,
+                    'fatwrite host 0:0 1000000 file %x' % (clust_size * 10),
+                    'host unbind 0'])
+                assert fat32_free_count(fs_img) == free - 10
+
+                # Remount and free the clusters again
+                u_boot_console.run_command_list([
+                    'host bind 0 %s' % fs_img,
+                    'fatrm host 0:0 file',
+                    'host unbind 0'])
+                assert fat32_free_count(fs_img) == free
+                check_call('fsck.vfat -n %s' % fs_img, shell=True)
+        finally:
+            call('rm -f %s' % fs_img, shell=True)
+
+    @pytest.mark.buildconfigspec('fat_write')
+    @pytest.mark.buildconfigspec('fs_cache')
+    @pytest.mark.buildconfigspec('cmd_blkcache')
+    @pytest.mark.buildconfigspec('cmd_blkmap')
+    def test_fs_fat_cache(self, u_boot_console, u_boot_config):
+        """Test that small reads are cached and writes are seen afterwards"""
+        fs_img = fs_helper.mk_fs(u_boot_config, 'fat16', 0x1000000, 'cache')
+        try:
+            with u_boot_console.log.section('Test Case 5 - file cache'):
+                u_boot_console.run_command_list([
+                    'host bind 0 %s' % fs_img,
+                    'mw.b 1000000 61 10000',
+                    'fatwrite host 0:0 1000000 file 10000',
+                    'blkcache show'])
+
+                # The second size comes from the cache
+                output = u_boot_console.run_command_list([
+                    'size host 0:0 file',
+                    'size host 0:0 file',
+                    'blkcache show'])
+                assert re.search(r'file hits: 1\b', output[2])
+                assert re.search(r'file misses: 1\b', output[2])
+
+                # The first read reads ahead, which serves the others
+                output = u_boot_console.run_command_list([
+                    'load host 0:0 2000000 file 1000 0',
+                    'load host 0:0 2000000 file 1000 1000',
+                    'load host 0:0 2000000 file 1000 8000',
+                    'load host 0:0 2000000 file 1000 0',
+                    'blkcache show',
+                    'cmp.b 1000000 2000000 1000'])
+                assert re.search(r'file hits: 3\b', output[4])
+                assert re.search(r'file misses: 1\b', output[4])
+                assert re.search(r'file read-aheads: 1\b', output[4])
+                assert 'Total of 4096 byte(s) were the same' in output[5]
+
+                # Writing the file drops it from the cache
+                output = u_boot_console.run_command_list([
+                    'mw.b 1000000 62 10000',
+                    'fatwrite host 0:0 1000000 file 10000',
+                    'load host 0:0 2000000 file 1000 0',
+                    'cmp.b 1000000 2000000 1000'])
+                assert 'Total of 4096 byte(s) were the same' in output[3]
+
+                # So does writing the device underneath the filesystem
+                bs = read_boot_sector(fs_img)
+                clust_size = bs['clust_sects'] * bs['sect_size']
+                data_start = (bs['reserved'] + bs['fats'] * bs['fat_sects']) * \
+                    bs['sect_size'] + bs['root_entries'] * 32
+                clust = fat16_clusters(fs_img, 'FILE       ')[0]
+                blk = (data_start + (clust - 2) * clust_size) // 512
+                output = u_boot_console.run_command_list([
+                    'load host 0:0 2000000 file 1000 0',
+                    'mw.b 1000000 63 200',
+                    'blkmap create cache',
+                    'blkmap map cache 0 %x linear host 0 0' % (0x1000000 // 512),
+                    'blkmap get cache dev devnum',
+                    'blkmap dev ${devnum}',
+                    'blkmap write 1000000 %x 1' % blk,
+                    'blkmap destroy cache',
+                    'load host 0:0 2000000 file 1000 0',
+                    'cmp.b 1000000 2000000 200',
+                    'host unbind 0'])
+                assert 'Total of 512 byte(s) were the same' in output[9]
+        finally:
+            call('rm -f %s' % fs_img, shell=True)
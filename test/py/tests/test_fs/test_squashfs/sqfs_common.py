@@ -66,20 +66,21 @@ def init_standard_table():
     for key, value in zip(STANDARD_TABLE.keys(), opts_list):
         STANDARD_TABLE[key] = value
 
-def generate_file(file_name, file_size):
-    """ Generates a file filled with 'x'.
+def generate_file(file_name, file_size, fill='x'):
+    """ Generates a file filled with 'fill'.
 
     Args:
         file_name: the file's name.
         file_size: the content's length and therefore the file size.
+        fill: the character the file is filled with.
     """
-    content = 'x' * file_size
+    content = fill * file_size
 
     file = open(file_name, 'w')
     file.write(content)
     file.close()
 
-def generate_sqfs_src_dir(build_dir):
+def generate_sqfs_src_dir(build_dir, fill='x'):
     """ Generates the source directory used to make the SquashFS images.
 
     The source directory is generated at build_dir, and it has the following
@@ -99,6 +100,7 @@ def generate_sqfs_src_dir(build_dir):
 
     Args:
         build_dir: u-boot's build-sandbox directory.
+        fill: the character the files are filled with.
     """
 
     root = os.path.join(build_dir, SQFS_SRC_DIR)
@@ -107,20 +109,20 @@ def generate_sqfs_src_dir(build_dir):
 
     # 4096: minimum block size
     file_name = 'f4096'
-    generate_file(os.path.join(root, file_name), 4096)
+    generate_file(os.path.join(root, file_name), 4096, fill)
 
     # 5096: minimum block size + 1000 chars (fragment)
     file_name = 'f5096'
-    generate_file(os.path.join(root, file_name), 5096)
+    generate_file(os.path.join(root, file_name), 5096, fill)
 
     # 1000: less than minimum block size (fragment only)
     file_name = 'f1000'
-    generate_file(os.path.join(root, file_name), 1000)
+    generate_file(os.path.join(root, file_name), 1000, fill)
 
     # sub-directory with a single file inside
     subdir_path = os.path.join(root, 'subdir')
     os.makedirs(subdir_path)
-    generate_file(os.path.join(subdir_path, 'subdir-file'), 100)
+    generate_file(os.path.join(subdir_path, 'subdir-file'), 100, fill)
 
     # symlink (target: sub-directory)
     os.symlink('subdir', os.path.join(root, 'sym'))
@@ -9,7 +9,7 @@ import pytest
 from sqfs_common import SQFS_SRC_DIR, STANDARD_TABLE
 from sqfs_common import generate_sqfs_src_dir, make_all_images
 from sqfs_common import clean_sqfs_src_dir, clean_all_images
-from sqfs_common import check_mksquashfs_version
+from sqfs_common import check_mksquashfs_version, mksquashfs
 
 @pytest.mark.requiredtool('md5sum')
 def original_md5sum(path):
@@ -152,3 +152,47 @@ def test_sqfs_load(u_boot_console):
     # clean test environment
     clean_all_images(build_dir)
     clean_sqfs_src_dir(build_dir)
+
+@pytest.mark.boardspec('sandbox')
+@pytest.mark.buildconfigspec('cmd_fs_generic')
+@pytest.mark.buildconfigspec('cmd_squashfs')
+@pytest.mark.buildconfigspec('fs_squashfs')
+@pytest.mark.requiredtool('mksquashfs')
+def test_sqfs_load_cached(u_boot_console):
+    """ Checks that metadata kept between commands is used correctly.
+
+    Fragment-packed files are loaded twice, so that the second pass is served
+    from the tables and fragment blocks kept by the first. The image is then
+    rebuilt in place with different contents and an identical superblock, and
+    rebound, after which the new contents must be read.
+
+    Args:
+        u_boot_console: provides the means to interact with U-Boot's console.
+    """
+    build_dir = u_boot_console.config.build_dir
+    image_path = os.path.join(build_dir, 'sqfs_cache')
+    input_path = os.path.join(build_dir, SQFS_SRC_DIR)
+    opts = '-comp gzip -always-use-fragments -noappend -mkfs-time 0'
+    files = ['f1000', 'subdir/subdir-file', 'f5096', 'f4096']
+    sizes = ['1000', '100', '5096', '4096']
+    address = '$kernel_addr_r'
+
+    check_mksquashfs_version()
+    try:
+        generate_sqfs_src_dir(build_dir)
+        mksquashfs(' '.join([input_path, image_path, opts]))
+        u_boot_console.run_command('host bind 0 {}'.format(image_path))
+        sqfs_load_files(u_boot_console, files, sizes, address)
+        sqfs_load_files(u_boot_console, files, sizes, address)
+
+        clean_sqfs_src_dir(build_dir)
+        generate_sqfs_src_dir(build_dir, 'y')
+        mksquashfs(' '.join([input_path, image_path, opts]))
+        u_boot_console.run_command('host bind 0 {}'.format(image_path))
+        sqfs_load_files(u_boot_console, files, sizes, address)
+        sqfs_load_files(u_boot_console, files, sizes, address)
+    finally:
+        if os.path.exists(image_path):
+            os.remove(image_path)
+        if os.path.exists(input_path):
+            clean_sqfs_src_dir(build_dir)
@@ -254,6 +254,10 @@ struct func_info *func_list;
 int func_count;			/* number of functions */
 struct trace_call *call_list;	/* list of all calls in the input trace file */
 int call_count;			/* number of calls */
+uint32_t *sample_list;		/* samples: depth followed by offsets, leaf first */
+size_t sample_words;		/* number of words in sample_list */
+int sample_count;		/* number of samples */
+ulong sample_period;		/* time between samples in microseconds */
 int verbose;	/* Verbosity level 0=none, 1=warn, 2=notice, 3=info, 4=debug */
 ulong text_offset;		/* text address of first function */
 ulong text_base;		/* CONFIG_TEXT_BASE from trace file */
@@ -292,7 +296,8 @@ static void usage(void)
 		"   -f <subtype>\tSpecify output subtype\n"
 		"   -m <map>\tSpecify System.map file\n"
 		"   -o <fname>\tSpecify output file\n"
-		"   -t <fname>\tSpecify trace data file (from U-Boot 'trace calls')\n"
+		"   -t <fname>\tSpecify trace data file (from U-Boot 'trace calls'\n"
+		"\t\tand/or 'profile dump')\n"
 		"   -v <0-4>\tSpecify verbosity\n"
 		"\n"
 		"Subtypes for dump-ftrace:\n"
@@ -483,11 +488,54 @@ static int read_calls(FILE *fin, size_t count)
 	return 0;
 }
 
+/**
+ * read_samples() - Read the list of samples from the profile data
+ *
+ * Each sample is a word holding the number of frames, followed by the offset
+ * of each frame, starting with the interrupted function
+ *
+ * @fin: File to read from
+ * @count: Number of samples to read
+ * Returns: 0 if OK, -1 on error
+ */
+static int read_samples(FILE *fin, size_t count)
+{
+	int i;
+
+	notice("sample count: %zu\n", count);
+	for (i = 0; i < count; i++) {
+		uint32_t depth;
+		uint32_t *list;
+
+		if (read_data(fin, &depth, sizeof(depth)))
+			return -1;
+		if (!depth || depth > MAX_STACK_DEPTH) {
+			error("Invalid sample depth %u\n", depth);
+			return -1;
+		}
+		list = realloc(sample_list,
+			       (sample_words + depth + 1) * sizeof(*list));
+		if (!list) {
+			error("Cannot allocate sample_list\n");
+			return -1;
+		}
+		sample_list = list;
+		list += sample_words;
+		*list++ = depth;
+		if (read_data(fin, list, depth * sizeof(*list)))
+			return -1;
+		sample_words += depth + 1;
+		sample_count++;
+	}
+
+	return 0;
+}
+
 /**
  * read_trace() - Read the U-Boot trace file
  *
- * Read in the calls from the trace file. The function list is ignored at
- * present
+ * Read in the calls and samples from the trace file. The function list is
+ * ignored at present
  *
  * @fin: File to read
  * Returns 0 if OK, non-zero on error
@@ -515,6 +563,12 @@ static int read_trace(FILE *fin)
 			if (read_calls(fin, hdr.rec_count))
 				return 1;
 			break;
+
+		case TRACE_CHUNK_SAMPLES:
+			sample_period = hdr.spare;
+			if (read_samples(fin, hdr.rec_count))
+				return 1;
+			break;
 		}
 	}
 	return 0;
@@ -1635,6 +1689,38 @@ static struct flame_node *create_node(const char *msg)
 	return node;
 }
 
+/**
+ * find_child() - Find the child of a node for a function, creating it if needed
+ *
+ * @state: Current flamegraph state
+ * @node: Parent node
+ * @func: Function to look for
+ * Returns: Child node, or NULL if out of memory
+ */
+static struct flame_node *find_child(struct flame_state *state,
+				     struct flame_node *node,
+				     struct func_info *func)
+{
+	struct flame_node *child;
+
+	/* see if we have this as a child node already */
+	list_for_each_entry(child, &node->child_head, sibling_node) {
+		if (child->func == func)
+			return child;
+	}
+
+	/* create a new node */
+	child = create_node("child");
+	if (!child)
+		return NULL;
+	list_add_tail(&child->sibling_node, &node->child_head);
+	child->func = func;
+	child->parent = node;
+	state->nodes++;
+
+	return child;
+}
+
 /**
  * process_call(): Add a call to the flamegraph info
  *
@@ -1658,26 +1744,11 @@ static int process_call(struct flame_state *state, bool entry, ulong timestamp,
 	int stack_ptr = state->stack_ptr;
 
 	if (entry) {
-		struct flame_node *child, *chd;
-
-		/* see if we have this as a child node already */
-		child = NULL;
-		list_for_each_entry(chd, &node->child_head, sibling_node) {
-			if (chd->func == func) {
-				child = chd;
-				break;
-			}
-		}
-		if (!child) {
-			/* create a new node */
-			child = create_node("child");
-			if (!child)
-				return -1;
-			list_add_tail(&child->sibling_node, &node->child_head);
-			child->func = func;
-			child->parent = node;
-			state->nodes++;
-		}
+		struct flame_node *child;
+
+		child = find_child(state, node, func);
+		if (!child)
+			return -1;
 		debug("entry %s: move from %s to %s\n", func->name,
 		      node->func ? node->func->name : "(root)",
 		      child->func->name);
@@ -1725,12 +1796,56 @@ static int process_call(struct flame_state *state, bool entry, ulong timestamp,
 	return 0;
 }
 
+/**
+ * process_sample() - Add a sample to the flamegraph info
+ *
+ * This increments the count for the sampled call stack, creating nodes as
+ * needed, and adds the sample period to its duration
+ *
+ * @state: Current flamegraph state
+ * @tree: Root of the tree
+ * @sample: Sample to add: depth followed by offsets, leaf first
+ * Returns: 0 on success, -ve on error
+ */
+static int process_sample(struct flame_state *state, struct flame_node *tree,
+			  const uint32_t *sample)
+{
+	struct flame_node *node = tree;
+	int i;
+
+	for (i = sample[0]; i > 0; i--) {
+		struct func_info *func;
+		uint offset = sample[i];
+
+		/*
+		 * Callers are recorded by their return address, which may be
+		 * just past the end of the calling function
+		 */
+		if (i > 1)
+			offset--;
+		func = find_caller_by_offset(offset);
+		if (!func) {
+			warn("Cannot find function at %lx\n",
+			     text_offset + offset);
+			continue;
+		}
+		node = find_child(state, node, func);
+		if (!node)
+			return -1;
+	}
+	node->count++;
+	node->duration += sample_period;
+
+	return 0;
+}
+
 /**
  * make_flame_tree() - Create a tree of stack traces
  *
  * Set up a tree, with the root node having the top-level functions as children
  * and the leaf nodes being leaf functions. Each node has a count of how many
- * times this function appears in the trace
+ * times this function appears in the trace, or in the samples taken by the
+ * profiler
  *
  * @out_format: Output format to use
  * @treep: Returns the resulting flamegraph tree
@@ -1742,6 +1857,7 @@ static int make_flame_tree(enum out_format_t out_format,
 	struct flame_state state;
 	struct flame_node *tree;
 	struct trace_call *call;
+	const uint32_t *sample;
 	int i;
 
 	/* maintain a stack of start times, etc. for 'calling' functions */
@@ -1768,6 +1884,12 @@ static int make_flame_tree(enum out_format_t out_format,
 		if (process_call(&state, entry, timestamp, func))
 			return -1;
 	}
+
+	for (i = 0, sample = sample_list; i < sample_count; i++) {
+		if (process_sample(&state, tree, sample))
+			return -1;
+		sample += sample[0] + 1;
+	}
 	fprintf(stderr, "%d nodes\n", state.nodes);
 	*treep = tree;
 